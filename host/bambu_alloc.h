@@ -0,0 +1,274 @@
+// Bambu Lab NFC Parser - Allocator Hooks
+// The host library's loader, catalog, hash tables and columnar output
+// allocate through a BambuAllocator chosen per thread:
+//   - default: the thread's arena. Blocks are carved from 256 KiB chunks by
+//     bumping a pointer and recycled through per-thread free lists, one per
+//     power-of-two size class (16 B .. 64 KiB), so a steady workload stops
+//     calling malloc once its working set has been seen. Larger blocks go
+//     straight to malloc. Chunks are never returned to the system.
+//   - bambu_heap_allocator: plain malloc/realloc/free
+//   - any other allocator a consumer installs with bambu_alloc_use()
+// Containers remember the allocator they were created with, and frees pass
+// the block size, so blocks carry no header. Arena blocks may be freed on
+// any thread; they join that thread's free lists. Build with
+// -DBAMBU_ALLOC_DEFAULT=bambu_heap_allocator to make the heap the default,
+// e.g. for sanitizer runs, which cannot see inside arena chunks.
+//
+// Every call is counted per thread and per stage (bambu_alloc_stage()), as
+// are the calls that reached malloc, so a service can assert that its
+// per-tag path does not allocate at all.
+
+#ifndef BAMBU_ALLOC_H
+#define BAMBU_ALLOC_H
+
+#include <pthread.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define BAMBU_ARENA_CHUNK_SIZE (256 * 1024)
+#define BAMBU_ARENA_MIN_SHIFT  4   // Smallest class: 16 bytes
+#define BAMBU_ARENA_CLASSES    13  // 16 B .. 64 KiB
+#define BAMBU_ARENA_MAX_BLOCK  ((size_t)1 << (BAMBU_ARENA_MIN_SHIFT + BAMBU_ARENA_CLASSES - 1))
+
+typedef struct {
+    void* (*alloc)(void* context, size_t size);
+    void* (*resize)(void* context, void* ptr, size_t old_size, size_t new_size);
+    void (*release)(void* context, void* ptr, size_t size);
+    void* context;
+} BambuAllocator;
+
+// Ingest stages; allocations are counted per stage, and the latency
+// metrics (bambu_metrics.h) time every stage but BambuStageOther
+typedef enum {
+    BambuStageOther,     // Setup, teardown and anything unstaged
+    BambuStageLoad,      // Reading and parsing dumps and input files
+    BambuStageValidate,  // bambu_tag_is_valid()
+    BambuStageDecode,    // bambu_decode()
+    BambuStageLookup,    // Catalog lookup and catalog loading
+    BambuStageOutput,    // Writing records out
+    BambuStageCount,
+} BambuStage;
+
+static const char* const BAMBU_STAGE_NAMES[BambuStageCount] = {
+    [BambuStageOther] = "other",
+    [BambuStageLoad] = "load",
+    [BambuStageValidate] = "validate",
+    [BambuStageDecode] = "decode",
+    [BambuStageLookup] = "lookup",
+    [BambuStageOutput] = "output",
+};
+
+typedef struct {
+    uint64_t allocs;  // Allocations and resizes
+    uint64_t frees;
+    uint64_t bytes;   // Bytes requested by allocations and resizes
+    uint64_t system;  // Calls that reached malloc/realloc
+} BambuAllocCounters;
+
+typedef struct {
+    BambuAllocCounters stages[BambuStageCount];
+} BambuAllocStats;
+
+typedef struct {
+    uint8_t* bump;  // Next free byte of the current chunk
+    size_t remaining;
+    void* free_lists[BAMBU_ARENA_CLASSES];  // Singly linked through the blocks
+} BambuArena;
+
+// Per-thread state
+static _Thread_local BambuArena bambu_thread_arena;
+static _Thread_local const BambuAllocator* bambu_thread_allocator;  // NULL = BAMBU_ALLOC_DEFAULT
+static _Thread_local BambuStage bambu_thread_alloc_stage;
+static _Thread_local BambuAllocStats bambu_thread_alloc_stats;
+
+// All arena chunks, linked through their first bytes, so they stay
+// reachable after the thread that carved them exits
+static void* bambu_arena_chunks;
+static pthread_mutex_t bambu_arena_chunks_lock = PTHREAD_MUTEX_INITIALIZER;
+
+// Helper: Count a call that reached the system allocator
+static inline void bambu_alloc_count_system(void) {
+    bambu_thread_alloc_stats.stages[bambu_thread_alloc_stage].system++;
+}
+
+// ============================================================================
+// Heap allocator
+// ============================================================================
+
+static inline void* bambu_heap_alloc(void* context, size_t size) {
+    (void)context;
+    bambu_alloc_count_system();
+    return malloc(size);
+}
+
+static inline void* bambu_heap_resize(void* context, void* ptr, size_t old_size, size_t new_size) {
+    (void)context;
+    (void)old_size;
+    bambu_alloc_count_system();
+    return realloc(ptr, new_size);
+}
+
+static inline void bambu_heap_release(void* context, void* ptr, size_t size) {
+    (void)context;
+    (void)size;
+    free(ptr);
+}
+
+static const BambuAllocator bambu_heap_allocator = {
+    bambu_heap_alloc,
+    bambu_heap_resize,
+    bambu_heap_release,
+    NULL,
+};
+
+// ============================================================================
+// Arena allocator (state is per thread; the allocator itself is shared)
+// ============================================================================
+
+// Helper: Size class of a block of at most BAMBU_ARENA_MAX_BLOCK bytes
+static inline size_t bambu_arena_class(size_t size) {
+    size_t cls = 0;
+    while(((size_t)1 << (BAMBU_ARENA_MIN_SHIFT + cls)) < size) cls++;
+    return cls;
+}
+
+static inline void* bambu_arena_alloc(void* context, size_t size) {
+    (void)context;
+    if(size > BAMBU_ARENA_MAX_BLOCK) return bambu_heap_alloc(NULL, size);
+    BambuArena* arena = &bambu_thread_arena;
+    size_t cls = bambu_arena_class(size);
+    void* block = arena->free_lists[cls];
+    if(block) {
+        memcpy(&arena->free_lists[cls], block, sizeof(void*));
+        return block;
+    }
+
+    size_t block_size = (size_t)1 << (BAMBU_ARENA_MIN_SHIFT + cls);
+    if(arena->remaining < block_size) {
+        uint8_t* chunk = malloc(BAMBU_ARENA_CHUNK_SIZE);
+        bambu_alloc_count_system();
+        if(!chunk) return NULL;
+        pthread_mutex_lock(&bambu_arena_chunks_lock);
+        memcpy(chunk, &bambu_arena_chunks, sizeof(void*));
+        bambu_arena_chunks = chunk;
+        pthread_mutex_unlock(&bambu_arena_chunks_lock);
+        // The first 16 bytes link the chunk and keep blocks 16-byte aligned
+        arena->bump = chunk + 16;
+        arena->remaining = BAMBU_ARENA_CHUNK_SIZE - 16;
+    }
+    block = arena->bump;
+    arena->bump += block_size;
+    arena->remaining -= block_size;
+    return block;
+}
+
+static inline void bambu_arena_release(void* context, void* ptr, size_t size) {
+    (void)context;
+    if(size > BAMBU_ARENA_MAX_BLOCK) {
+        free(ptr);
+        return;
+    }
+    BambuArena* arena = &bambu_thread_arena;
+    size_t cls = bambu_arena_class(size);
+    memcpy(ptr, &arena->free_lists[cls], sizeof(void*));
+    arena->free_lists[cls] = ptr;
+}
+
+static inline void* bambu_arena_resize(void* context, void* ptr, size_t old_size, size_t new_size) {
+    if(old_size > BAMBU_ARENA_MAX_BLOCK && new_size > BAMBU_ARENA_MAX_BLOCK) {
+        return bambu_heap_resize(NULL, ptr, old_size, new_size);
+    }
+    if(old_size <= BAMBU_ARENA_MAX_BLOCK && new_size <= BAMBU_ARENA_MAX_BLOCK &&
+       bambu_arena_class(old_size) == bambu_arena_class(new_size)) {
+        return ptr;  // Already fits
+    }
+    void* grown = bambu_arena_alloc(context, new_size);
+    if(!grown) return NULL;
+    memcpy(grown, ptr, old_size < new_size ? old_size : new_size);
+    bambu_arena_release(context, ptr, old_size);
+    return grown;
+}
+
+static const BambuAllocator bambu_arena_allocator = {
+    bambu_arena_alloc,
+    bambu_arena_resize,
+    bambu_arena_release,
+    NULL,
+};
+
+// ============================================================================
+// Hooks
+// ============================================================================
+
+#ifndef BAMBU_ALLOC_DEFAULT
+#define BAMBU_ALLOC_DEFAULT bambu_arena_allocator
+#endif
+
+// The calling thread's current allocator
+static inline const BambuAllocator* bambu_allocator(void) {
+    return bambu_thread_allocator ? bambu_thread_allocator : &BAMBU_ALLOC_DEFAULT;
+}
+
+// Make allocator (NULL = BAMBU_ALLOC_DEFAULT) the calling thread's current
+// allocator for containers created from now on. Returns the previous one.
+static inline const BambuAllocator* bambu_alloc_use(const BambuAllocator* allocator) {
+    const BambuAllocator* previous = bambu_allocator();
+    bambu_thread_allocator = allocator;
+    return previous;
+}
+
+// Attribute the calling thread's allocations to stage from now on.
+// Returns the previous stage.
+static inline BambuStage bambu_alloc_stage(BambuStage stage) {
+    BambuStage previous = bambu_thread_alloc_stage;
+    bambu_thread_alloc_stage = stage;
+    return previous;
+}
+
+// Counters of the calling thread
+static inline const BambuAllocStats* bambu_alloc_stats(void) {
+    return &bambu_thread_alloc_stats;
+}
+
+static inline void* bambu_mem_alloc(const BambuAllocator* allocator, size_t size) {
+    BambuAllocCounters* counters = &bambu_thread_alloc_stats.stages[bambu_thread_alloc_stage];
+    counters->allocs++;
+    counters->bytes += size;
+    return allocator->alloc(allocator->context, size ? size : 1);
+}
+
+static inline void* bambu_mem_calloc(const BambuAllocator* allocator, size_t count, size_t size) {
+    if(size && count > SIZE_MAX / size) return NULL;
+    void* ptr = bambu_mem_alloc(allocator, count * size);
+    if(ptr) memset(ptr, 0, count * size);
+    return ptr;
+}
+
+// Grow or shrink a block (ptr may be NULL with old_size 0)
+static inline void* bambu_mem_resize(const BambuAllocator* allocator, void* ptr, size_t old_size, size_t new_size) {
+    if(!ptr) return bambu_mem_alloc(allocator, new_size);
+    BambuAllocCounters* counters = &bambu_thread_alloc_stats.stages[bambu_thread_alloc_stage];
+    counters->allocs++;
+    counters->bytes += new_size;
+    return allocator->resize(allocator->context, ptr, old_size ? old_size : 1, new_size ? new_size : 1);
+}
+
+// Free a block of size bytes (the size it was allocated or resized to)
+static inline void bambu_mem_free(const BambuAllocator* allocator, void* ptr, size_t size) {
+    if(!ptr) return;
+    bambu_thread_alloc_stats.stages[bambu_thread_alloc_stage].frees++;
+    allocator->release(allocator->context, ptr, size ? size : 1);
+}
+
+// Copy of a string; free with bambu_mem_free(allocator, copy, strlen(copy) + 1)
+static inline char* bambu_mem_strdup(const BambuAllocator* allocator, const char* str) {
+    size_t size = strlen(str) + 1;
+    char* copy = bambu_mem_alloc(allocator, size);
+    if(copy) memcpy(copy, str, size);
+    return copy;
+}
+
+#endif // BAMBU_ALLOC_H
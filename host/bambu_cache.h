@@ -0,0 +1,349 @@
+// Bambu Lab NFC Parser - Persistent Decode Cache
+// Remembers decode results across runs so batch jobs only load and decode
+// dumps that changed:
+//   - path entries map a file (path hash, size, mtime, inode) to the hash
+//     of its contents: an unchanged file is answered from its stat alone
+//   - content entries map a content hash to the decode result (packed
+//     record, or "not a dump" / "not a Bambu tag") and the record's index
+//     in bambu_filament_table[]: renamed or copied dumps hit too
+//   - the file stores a hash of bambu_filament_table[]; when the catalog
+//     changes, decode results are kept and only the catalog indexes are
+//     re-resolved. Indexes are also checked against the variant ID on
+//     load, so a bad one is re-resolved rather than trusted.
+// The cache file is native-endian and meant for the machine that wrote
+// it; a file with another format, magic, decoder or record version
+// (BAMBU_DECODER_VERSION, BAMBU_RECORD_VERSION) is ignored and rebuilt. A cache
+// allocates through the allocator current when it is opened
+// (host/bambu_alloc.h).
+//
+// Requires bambu_host.h to be included first.
+
+#ifndef BAMBU_CACHE_H
+#define BAMBU_CACHE_H
+
+#include "bambu_hash.h"
+#include "../plugin/bambu_frame.h"
+
+#define BAMBU_CACHE_MAGIC   "BMBCACHE"
+#define BAMBU_CACHE_FORMAT  2
+// Decode results are only reused from the same decoder and record layout
+#define BAMBU_CACHE_DECODER ((uint32_t)BAMBU_DECODER_VERSION << 8 | BAMBU_RECORD_VERSION)
+#define BAMBU_CACHE_NO_INFO 0xFFFF  // Variant not in the catalog
+
+typedef enum {
+    BambuCacheDecoded,    // Bambu tag, record available
+    BambuCacheNotDump,    // Not a Mifare Classic dump
+    BambuCacheNotBambu,   // Dump, but not a valid Bambu tag
+    BambuCacheUnreadable, // File could not be opened (never cached)
+} BambuCacheStatus;
+
+typedef struct {
+    uint64_t path_hash;
+    uint64_t size;
+    int64_t mtime_ns;
+    uint64_t inode;
+    uint64_t content_hash;
+} BambuCachePath;
+
+typedef struct {
+    uint64_t content_hash;
+    uint32_t offset;  // Packed record in the payload arena
+    uint8_t len;
+    uint8_t status;   // BambuCacheStatus
+    uint16_t info;    // Index in bambu_filament_table[] or BAMBU_CACHE_NO_INFO
+} BambuCacheContent;
+
+typedef struct {
+    const BambuAllocator* allocator;
+    uint64_t catalog_hash;  // bambu_cache_catalog_hash() at open
+    BambuCachePath* paths;
+    size_t path_count;
+    size_t path_capacity;
+    BambuHashIndex path_index;
+    BambuCacheContent* contents;
+    size_t content_count;
+    size_t content_capacity;
+    BambuHashIndex content_index;
+    uint8_t* payloads;
+    size_t payload_fill;
+    size_t payload_capacity;
+    // Statistics
+    size_t stat_hits;     // Unchanged files, not read
+    size_t content_hits;  // Read, but contents already known
+    size_t misses;        // Loaded and decoded
+    size_t reresolved;    // Catalog indexes refreshed (catalog changed, or index invalid)
+} BambuCache;
+
+static inline void bambu_cache_free(BambuCache* cache) {
+    const BambuAllocator* allocator = cache->allocator;
+    if(allocator) {
+        bambu_mem_free(allocator, cache->paths, cache->path_capacity * sizeof(BambuCachePath));
+        bambu_mem_free(allocator, cache->contents, cache->content_capacity * sizeof(BambuCacheContent));
+        bambu_mem_free(allocator, cache->payloads, cache->payload_capacity);
+    }
+    if(cache->path_index.slots) bambu_hash_index_free(&cache->path_index);
+    if(cache->content_index.slots) bambu_hash_index_free(&cache->content_index);
+    memset(cache, 0, sizeof(BambuCache));
+}
+
+// Helper: Grow an array of count elements to hold one more
+static inline bool bambu_cache_reserve(
+    const BambuAllocator* allocator,
+    void** array,
+    size_t* capacity,
+    size_t count,
+    size_t size) {
+    if(count < *capacity) return true;
+    size_t grown_capacity = *capacity ? *capacity * 2 : 1024;
+    void* grown = bambu_mem_resize(allocator, *array, *capacity * size, grown_capacity * size);
+    if(!grown) return false;
+    *array = grown;
+    *capacity = grown_capacity;
+    return true;
+}
+
+// Helper: Hash of the catalog contents, standing in for a version number
+static inline uint64_t bambu_cache_catalog_hash(void) {
+    uint64_t hash = BAMBU_HASH_SEED;
+    for(size_t i = 0; i < BAMBU_FILAMENT_TABLE_SIZE; i++) {
+        const BambuFilamentInfo* info = &bambu_filament_table[i];
+        // Terminators included, so field boundaries are part of the hash
+        hash = bambu_hash_bytes(hash, info->variant_id, strlen(info->variant_id) + 1);
+        hash = bambu_hash_bytes(hash, info->filament_code, strlen(info->filament_code) + 1);
+        hash = bambu_hash_bytes(hash, info->color_name, strlen(info->color_name) + 1);
+    }
+    return hash;
+}
+
+// Helper: True if a stored catalog index is in range and names variant_id.
+// A variant absent from an unchanged catalog stays absent.
+static inline bool bambu_cache_info_valid(uint16_t info, const char* variant_id) {
+    if(info == BAMBU_CACHE_NO_INFO) return true;
+    return info < BAMBU_FILAMENT_TABLE_SIZE && strcmp(bambu_filament_table[info].variant_id, variant_id) == 0;
+}
+
+// Helper: Catalog index of a variant ID
+static inline uint16_t bambu_cache_resolve(const char* variant_id) {
+    const BambuFilamentInfo* info = bambu_lookup_filament(variant_id);
+    return info ? (uint16_t)(info - bambu_filament_table) : BAMBU_CACHE_NO_INFO;
+}
+
+// Helper: Add a content entry, NULL on allocation failure
+static inline BambuCacheContent* bambu_cache_add_content(
+    BambuCache* cache,
+    uint64_t content_hash,
+    BambuCacheStatus status,
+    const uint8_t* payload,
+    uint8_t len,
+    uint16_t info) {
+    if(!bambu_cache_reserve(
+           cache->allocator,
+           (void**)&cache->contents,
+           &cache->content_capacity,
+           cache->content_count,
+           sizeof(BambuCacheContent))) {
+        return NULL;
+    }
+    while(cache->payload_fill + len > cache->payload_capacity) {
+        size_t capacity = cache->payload_capacity ? cache->payload_capacity * 2 : 1 << 16;
+        uint8_t* grown = bambu_mem_resize(cache->allocator, cache->payloads, cache->payload_capacity, capacity);
+        if(!grown) return NULL;
+        cache->payloads = grown;
+        cache->payload_capacity = capacity;
+    }
+    uint32_t id = (uint32_t)cache->content_count;
+    if(bambu_hash_index_put(&cache->content_index, content_hash, id) != id) return NULL;
+
+    BambuCacheContent* content = &cache->contents[cache->content_count++];
+    content->content_hash = content_hash;
+    content->offset = (uint32_t)cache->payload_fill;
+    content->len = len;
+    content->status = (uint8_t)status;
+    content->info = info;
+    memcpy(&cache->payloads[cache->payload_fill], payload, len);
+    cache->payload_fill += len;
+    return content;
+}
+
+// Helper: Set the content hash of a file, false on allocation failure
+static inline bool bambu_cache_set_path(BambuCache* cache, const BambuCachePath* entry) {
+    uint32_t id = bambu_hash_index_get(&cache->path_index, entry->path_hash);
+    if(id != BAMBU_HASH_INDEX_EMPTY) {
+        cache->paths[id] = *entry;
+        return true;
+    }
+    if(!bambu_cache_reserve(
+           cache->allocator, (void**)&cache->paths, &cache->path_capacity, cache->path_count, sizeof(BambuCachePath))) {
+        return false;
+    }
+    id = (uint32_t)cache->path_count;
+    if(bambu_hash_index_put(&cache->path_index, entry->path_hash, id) != id) return false;
+    cache->paths[cache->path_count++] = *entry;
+    return true;
+}
+
+// Open the cache file at path. A missing, unreadable or foreign file
+// gives an empty cache; returns false only on allocation failure.
+static inline bool bambu_cache_open(BambuCache* cache, const char* path) {
+    memset(cache, 0, sizeof(BambuCache));
+    cache->allocator = bambu_allocator();
+    cache->catalog_hash = bambu_cache_catalog_hash();
+    if(!bambu_hash_index_alloc(&cache->path_index, cache->allocator, 1024) ||
+       !bambu_hash_index_alloc(&cache->content_index, cache->allocator, 1024)) {
+        bambu_cache_free(cache);
+        return false;
+    }
+
+    FILE* f = fopen(path, "rb");
+    if(!f) return true;
+    char magic[8];
+    uint32_t header[4];  // Format, decoder, path count, content count
+    uint64_t catalog_hash;
+    bool ok = fread(magic, 1, sizeof(magic), f) == sizeof(magic) &&
+              memcmp(magic, BAMBU_CACHE_MAGIC, sizeof(magic)) == 0 &&
+              fread(header, sizeof(uint32_t), 4, f) == 4 && header[0] == BAMBU_CACHE_FORMAT &&
+              header[1] == BAMBU_CACHE_DECODER && fread(&catalog_hash, sizeof(catalog_hash), 1, f) == 1;
+    if(!ok) {  // Missing or foreign: start empty
+        fclose(f);
+        return true;
+    }
+    bool stale_catalog = catalog_hash != cache->catalog_hash;
+
+    for(uint32_t i = 0; ok && i < header[2]; i++) {
+        BambuCachePath entry;
+        ok = fread(&entry, sizeof(entry), 1, f) == 1 && bambu_cache_set_path(cache, &entry);
+    }
+    for(uint32_t i = 0; ok && i < header[3]; i++) {
+        BambuCacheContent entry;
+        uint8_t payload[BAMBU_FRAME_MAX_PAYLOAD];
+        ok = fread(&entry, sizeof(entry), 1, f) == 1 && fread(payload, 1, entry.len, f) == entry.len;
+        if(ok && entry.status == BambuCacheDecoded) {
+            BambuSpoolRecord record;
+            ok = bambu_record_unpack(payload, entry.len, &record, NULL);
+            if(ok && (stale_catalog || !bambu_cache_info_valid(entry.info, record.variant_id))) {
+                entry.info = bambu_cache_resolve(record.variant_id);
+                cache->reresolved++;
+            }
+        }
+        ok = ok && bambu_cache_add_content(
+                       cache, entry.content_hash, entry.status, payload, entry.len, entry.info) != NULL;
+    }
+    fclose(f);
+
+    if(!ok) {  // Corrupt or truncated: start over
+        bambu_cache_free(cache);
+        return bambu_cache_open(cache, "");
+    }
+    return true;
+}
+
+// Decode the dump at path, from the cache when possible. On
+// BambuCacheDecoded, record and info (NULL if not in the catalog) are
+// set. Returns BambuCacheUnreadable also on allocation failure.
+static inline BambuCacheStatus bambu_cache_decode_file(
+    BambuCache* cache,
+    const char* path,
+    BambuSpoolRecord* record,
+    const BambuFilamentInfo** info) {
+    struct stat st;
+    if(stat(path, &st) != 0) return BambuCacheUnreadable;
+    BambuCachePath entry = {
+        .path_hash = bambu_hash_bytes(BAMBU_HASH_SEED, path, strlen(path)),
+        .size = (uint64_t)st.st_size,
+        .mtime_ns = (int64_t)st.st_mtim.tv_sec * 1000000000 + st.st_mtim.tv_nsec,
+        .inode = (uint64_t)st.st_ino,
+    };
+
+    const BambuCacheContent* content = NULL;
+    uint32_t id = bambu_hash_index_get(&cache->path_index, entry.path_hash);
+    if(id != BAMBU_HASH_INDEX_EMPTY) {
+        const BambuCachePath* known = &cache->paths[id];
+        if(known->size == entry.size && known->mtime_ns == entry.mtime_ns && known->inode == entry.inode) {
+            uint32_t content_id = bambu_hash_index_get(&cache->content_index, known->content_hash);
+            if(content_id != BAMBU_HASH_INDEX_EMPTY) {
+                content = &cache->contents[content_id];
+                cache->stat_hits++;
+            }
+        }
+    }
+
+    if(!content) {
+        char buf[BAMBU_DUMP_MAX_SIZE];
+        size_t len;
+        if(!bambu_dump_read(path, buf, &len)) return BambuCacheUnreadable;
+        entry.content_hash = bambu_hash_bytes(BAMBU_HASH_SEED, buf, len);
+        uint32_t content_id = bambu_hash_index_get(&cache->content_index, entry.content_hash);
+        if(content_id != BAMBU_HASH_INDEX_EMPTY) {
+            content = &cache->contents[content_id];
+            cache->content_hits++;
+        } else {
+            MfClassicData data;
+            BambuCacheStatus status = BambuCacheNotDump;
+            uint8_t payload[BAMBU_FRAME_MAX_PAYLOAD];
+            uint8_t payload_len = 0;
+            uint16_t catalog_index = BAMBU_CACHE_NO_INFO;
+            if(bambu_dump_parse(buf, len, &data)) {
+                status = BambuCacheNotBambu;
+                BambuSpoolRecord decoded;
+                if(bambu_decode(&data, &decoded)) {
+                    status = BambuCacheDecoded;
+                    payload_len = (uint8_t)bambu_record_pack(&decoded, 0, payload);
+                    catalog_index = bambu_cache_resolve(decoded.variant_id);
+                }
+            }
+            content = bambu_cache_add_content(
+                cache, entry.content_hash, status, payload, payload_len, catalog_index);
+            if(!content) return BambuCacheUnreadable;
+            cache->misses++;
+        }
+        if(!bambu_cache_set_path(cache, &entry)) return BambuCacheUnreadable;
+    }
+
+    if(content->status == BambuCacheDecoded) {
+        bambu_record_unpack(&cache->payloads[content->offset], content->len, record, NULL);
+        *info = content->info == BAMBU_CACHE_NO_INFO ? NULL : &bambu_filament_table[content->info];
+    }
+    return (BambuCacheStatus)content->status;
+}
+
+// Write the cache to path (via path.tmp and a rename). Content entries no
+// longer referenced by any file are dropped.
+static inline bool bambu_cache_save(const BambuCache* cache, const char* path) {
+    char tmp_path[4096];
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path);
+    FILE* f = fopen(tmp_path, "wb");
+    if(!f) return false;
+    setvbuf(f, NULL, _IOFBF, 1 << 20);
+
+    size_t live_size = cache->content_count ? cache->content_count : 1;
+    uint8_t* live = bambu_mem_calloc(cache->allocator, live_size, 1);
+    bool ok = live != NULL;
+    uint32_t live_count = 0;
+    for(size_t i = 0; ok && i < cache->path_count; i++) {
+        uint32_t id = bambu_hash_index_get(&cache->content_index, cache->paths[i].content_hash);
+        if(id != BAMBU_HASH_INDEX_EMPTY && !live[id]) {
+            live[id] = 1;
+            live_count++;
+        }
+    }
+
+    uint32_t header[4] = {BAMBU_CACHE_FORMAT, BAMBU_CACHE_DECODER, (uint32_t)cache->path_count, live_count};
+    ok = ok && fwrite(BAMBU_CACHE_MAGIC, 1, 8, f) == 8 && fwrite(header, sizeof(header), 1, f) == 1 &&
+         fwrite(&cache->catalog_hash, sizeof(cache->catalog_hash), 1, f) == 1;
+    if(ok && cache->path_count > 0) {
+        ok = fwrite(cache->paths, sizeof(BambuCachePath), cache->path_count, f) == cache->path_count;
+    }
+    for(size_t i = 0; ok && i < cache->content_count; i++) {
+        if(!live[i]) continue;
+        const BambuCacheContent* content = &cache->contents[i];
+        ok = fwrite(content, sizeof(BambuCacheContent), 1, f) == 1 &&
+             fwrite(&cache->payloads[content->offset], 1, content->len, f) == content->len;
+    }
+    bambu_mem_free(cache->allocator, live, live_size);
+    if(fclose(f) != 0) ok = false;
+    if(ok) ok = rename(tmp_path, path) == 0;
+    if(!ok) remove(tmp_path);
+    return ok;
+}
+
+#endif // BAMBU_CACHE_H
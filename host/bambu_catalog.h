@@ -0,0 +1,317 @@
+// Bambu Lab NFC Parser - Reloadable Filament Catalog
+// bambu_lookup_filament() searches the table compiled into
+// plugin/bambu_filaments.h. Long-running host processes can instead load
+// the catalog from a file and replace it while they run:
+//   - a snapshot is an immutable, hash-indexed copy of one catalog file
+//   - BambuCatalog publishes the current snapshot through an atomic
+//     pointer; readers never lock, wait or retry
+//   - replaced snapshots are retired and freed only once no reader can
+//     still hold them (epoch-based reclamation: each reader announces the
+//     epoch it entered in, a snapshot retired in epoch E is freed when no
+//     reader is still inside an epoch before E)
+//
+// Catalog file: one "VARIANT_ID,FILAMENT_CODE,Color Name" line per
+// filament (the color name is the rest of the line and may contain
+// commas). Blank lines and lines starting with '#' are ignored.
+//
+// A snapshot allocates through the allocator current when it is created
+// (bambu_alloc.h) and may be freed on any thread.
+//
+// Requires bambu_host.h to be included first.
+
+#ifndef BAMBU_CATALOG_H
+#define BAMBU_CATALOG_H
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+
+#include "bambu_hash.h"
+
+#define BAMBU_CATALOG_MAX_READERS 64
+
+typedef struct BambuCatalogSnapshot {
+    const BambuAllocator* allocator;
+    BambuFilamentInfo* entries;
+    size_t count;
+    size_t capacity;
+    char* text;            // Loaded file the entries point into (NULL for the built-in table)
+    size_t text_size;
+    BambuHashIndex index;  // Variant ID hash -> entry
+    uint64_t version;      // Set when published: 1, 2, 3, ...
+    uint64_t retire_epoch;
+    struct BambuCatalogSnapshot* next_retired;
+} BambuCatalogSnapshot;
+
+// One slot per reader thread, on its own cache line so readers do not
+// contend with each other
+typedef struct {
+    _Alignas(64) atomic_uint_fast64_t epoch;  // Epoch entered in, 0 while outside
+    atomic_bool used;
+} BambuCatalogReaderSlot;
+
+typedef struct {
+    _Atomic(BambuCatalogSnapshot*) current;
+    atomic_uint_fast64_t epoch;  // Starts at 1, advanced by every publish
+    BambuCatalogReaderSlot readers[BAMBU_CATALOG_MAX_READERS];
+    pthread_mutex_t writer_lock;  // Serializes publishers, never taken by readers
+    BambuCatalogSnapshot* retired;
+    uint64_t published;
+    size_t reclaimed;
+} BambuCatalog;
+
+// ============================================================================
+// Snapshots
+// ============================================================================
+
+static inline void bambu_catalog_snapshot_free(BambuCatalogSnapshot* snapshot) {
+    if(!snapshot) return;
+    const BambuAllocator* allocator = snapshot->allocator;
+    bambu_hash_index_free(&snapshot->index);
+    bambu_mem_free(allocator, snapshot->entries, snapshot->capacity * sizeof(BambuFilamentInfo));
+    bambu_mem_free(allocator, snapshot->text, snapshot->text_size);
+    bambu_mem_free(allocator, snapshot, sizeof(BambuCatalogSnapshot));
+}
+
+// Helper: Hash index key of a variant ID
+static inline uint64_t bambu_catalog_key(const char* variant_id) {
+    return bambu_hash_bytes(BAMBU_HASH_SEED, variant_id, strlen(variant_id));
+}
+
+// Helper: Append an entry, false on allocation failure or duplicate variant
+static inline bool bambu_catalog_snapshot_add(BambuCatalogSnapshot* snapshot, const BambuFilamentInfo* info) {
+    if(snapshot->count == snapshot->capacity) {
+        size_t capacity = snapshot->capacity ? snapshot->capacity * 2 : 256;
+        BambuFilamentInfo* grown = bambu_mem_resize(
+            snapshot->allocator,
+            snapshot->entries,
+            snapshot->capacity * sizeof(BambuFilamentInfo),
+            capacity * sizeof(BambuFilamentInfo));
+        if(!grown) return false;
+        snapshot->entries = grown;
+        snapshot->capacity = capacity;
+    }
+    uint32_t id = (uint32_t)snapshot->count;
+    if(bambu_hash_index_put(&snapshot->index, bambu_catalog_key(info->variant_id), id) != id) {
+        return false;
+    }
+    snapshot->entries[snapshot->count++] = *info;
+    return true;
+}
+
+// Helper: Allocate an empty snapshot
+static inline BambuCatalogSnapshot* bambu_catalog_snapshot_alloc(size_t expected) {
+    const BambuAllocator* allocator = bambu_allocator();
+    BambuCatalogSnapshot* snapshot = bambu_mem_calloc(allocator, 1, sizeof(BambuCatalogSnapshot));
+    if(!snapshot) return NULL;
+    snapshot->allocator = allocator;
+    if(!bambu_hash_index_alloc(&snapshot->index, allocator, expected)) {
+        bambu_mem_free(allocator, snapshot, sizeof(BambuCatalogSnapshot));
+        return NULL;
+    }
+    return snapshot;
+}
+
+// Snapshot of the table compiled into bambu_filaments.h
+static inline BambuCatalogSnapshot* bambu_catalog_snapshot_builtin(void) {
+    BambuCatalogSnapshot* snapshot = bambu_catalog_snapshot_alloc(BAMBU_FILAMENT_TABLE_SIZE);
+    if(!snapshot) return NULL;
+    for(size_t i = 0; i < BAMBU_FILAMENT_TABLE_SIZE; i++) {
+        if(!bambu_catalog_snapshot_add(snapshot, &bambu_filament_table[i])) {
+            bambu_catalog_snapshot_free(snapshot);
+            return NULL;
+        }
+    }
+    return snapshot;
+}
+
+// Load a catalog file. Returns NULL if it cannot be read or a line is
+// malformed or repeats a variant ID; *bad_line is then that line number
+// (0 for I/O or allocation failures).
+static inline BambuCatalogSnapshot* bambu_catalog_snapshot_load(const char* path, size_t* bad_line) {
+    *bad_line = 0;
+    FILE* file = fopen(path, "rb");
+    if(!file) return NULL;
+    const BambuAllocator* allocator = bambu_allocator();
+    char* text = NULL;
+    size_t len = 0;
+    if(fseek(file, 0, SEEK_END) == 0) {
+        long size = ftell(file);
+        if(size >= 0 && fseek(file, 0, SEEK_SET) == 0 &&
+           (text = bambu_mem_alloc(allocator, (size_t)size + 1))) {
+            len = fread(text, 1, (size_t)size, file);
+            if(len != (size_t)size) {
+                bambu_mem_free(allocator, text, (size_t)size + 1);
+                text = NULL;
+            }
+        }
+    }
+    fclose(file);
+    if(!text) return NULL;
+    text[len] = '\0';
+
+    BambuCatalogSnapshot* snapshot = bambu_catalog_snapshot_alloc(len / 24);
+    if(!snapshot) {
+        bambu_mem_free(allocator, text, len + 1);
+        return NULL;
+    }
+    snapshot->text = text;
+    snapshot->text_size = len + 1;
+
+    // Split in place: the entries point into text
+    size_t line_number = 0;
+    char* line = text;
+    while(*line) {
+        line_number++;
+        char* end = strchr(line, '\n');
+        char* next = end ? end + 1 : line + strlen(line);
+        if(end) *end = '\0';
+        if(end > line && end[-1] == '\r') end[-1] = '\0';
+
+        if(line[0] != '\0' && line[0] != '#') {
+            char* code = strchr(line, ',');
+            char* color = code ? strchr(code + 1, ',') : NULL;
+            if(!color || code == line || color == code + 1 || color[1] == '\0') {
+                *bad_line = line_number;
+                bambu_catalog_snapshot_free(snapshot);
+                return NULL;
+            }
+            *code++ = '\0';
+            *color++ = '\0';
+            BambuFilamentInfo info = {line, code, color};
+            if(!bambu_catalog_snapshot_add(snapshot, &info)) {
+                *bad_line = line_number;
+                bambu_catalog_snapshot_free(snapshot);
+                return NULL;
+            }
+        }
+        line = next;
+    }
+    return snapshot;
+}
+
+// Find filament info by variant_id, NULL if not in the snapshot
+static inline const BambuFilamentInfo*
+    bambu_catalog_snapshot_lookup(const BambuCatalogSnapshot* snapshot, const char* variant_id) {
+    uint32_t id = bambu_hash_index_get(&snapshot->index, bambu_catalog_key(variant_id));
+    if(id == BAMBU_HASH_INDEX_EMPTY) return NULL;
+    const BambuFilamentInfo* info = &snapshot->entries[id];
+    return strcmp(info->variant_id, variant_id) == 0 ? info : NULL;
+}
+
+// ============================================================================
+// Publication and reclamation
+// ============================================================================
+
+// Start with snapshot (taken over) as the current catalog
+static inline bool bambu_catalog_init(BambuCatalog* catalog, BambuCatalogSnapshot* snapshot) {
+    memset(catalog, 0, sizeof(BambuCatalog));
+    if(pthread_mutex_init(&catalog->writer_lock, NULL) != 0) return false;
+    snapshot->version = catalog->published = 1;
+    atomic_init(&catalog->current, snapshot);
+    atomic_init(&catalog->epoch, 1);
+    for(size_t i = 0; i < BAMBU_CATALOG_MAX_READERS; i++) {
+        atomic_init(&catalog->readers[i].epoch, 0);
+        atomic_init(&catalog->readers[i].used, false);
+    }
+    return true;
+}
+
+// Claim a reader slot for the calling thread. Returns the reader id, or
+// -1 if all BAMBU_CATALOG_MAX_READERS slots are taken.
+static inline int bambu_catalog_reader_register(BambuCatalog* catalog) {
+    for(int i = 0; i < BAMBU_CATALOG_MAX_READERS; i++) {
+        bool expected = false;
+        if(atomic_compare_exchange_strong(&catalog->readers[i].used, &expected, true)) return i;
+    }
+    return -1;
+}
+
+static inline void bambu_catalog_reader_unregister(BambuCatalog* catalog, int reader) {
+    atomic_store(&catalog->readers[reader].epoch, 0);
+    atomic_store(&catalog->readers[reader].used, false);
+}
+
+// Enter a read-side section and return the current snapshot. The
+// snapshot and everything looked up in it stay valid until
+// bambu_catalog_exit(); sections must not nest.
+static inline const BambuCatalogSnapshot* bambu_catalog_enter(BambuCatalog* catalog, int reader) {
+    // Announce the epoch before loading the pointer: a publisher that
+    // misses the announcement has already swapped the pointer
+    atomic_store(&catalog->readers[reader].epoch, atomic_load(&catalog->epoch));
+    return atomic_load(&catalog->current);
+}
+
+static inline void bambu_catalog_exit(BambuCatalog* catalog, int reader) {
+    atomic_store_explicit(&catalog->readers[reader].epoch, 0, memory_order_release);
+}
+
+// Helper: Free retired snapshots no reader can still hold. Caller holds
+// writer_lock.
+static inline void bambu_catalog_reclaim_locked(BambuCatalog* catalog) {
+    uint64_t oldest = UINT64_MAX;
+    for(size_t i = 0; i < BAMBU_CATALOG_MAX_READERS; i++) {
+        uint64_t epoch = atomic_load(&catalog->readers[i].epoch);
+        if(epoch && epoch < oldest) oldest = epoch;
+    }
+    BambuCatalogSnapshot** link = &catalog->retired;
+    while(*link) {
+        BambuCatalogSnapshot* snapshot = *link;
+        if(snapshot->retire_epoch <= oldest) {
+            *link = snapshot->next_retired;
+            bambu_catalog_snapshot_free(snapshot);
+            catalog->reclaimed++;
+        } else {
+            link = &snapshot->next_retired;
+        }
+    }
+}
+
+// Free whatever retired snapshots are no longer in use. Returns the
+// number still waiting for readers.
+static inline size_t bambu_catalog_reclaim(BambuCatalog* catalog) {
+    pthread_mutex_lock(&catalog->writer_lock);
+    bambu_catalog_reclaim_locked(catalog);
+    size_t pending = 0;
+    for(BambuCatalogSnapshot* s = catalog->retired; s; s = s->next_retired) pending++;
+    pthread_mutex_unlock(&catalog->writer_lock);
+    return pending;
+}
+
+// Make snapshot (taken over) the current catalog. Readers already inside
+// a section keep the previous one, which is freed on a later publish or
+// reclaim once they have all left. Never waits for readers.
+static inline void bambu_catalog_publish(BambuCatalog* catalog, BambuCatalogSnapshot* snapshot) {
+    pthread_mutex_lock(&catalog->writer_lock);
+    snapshot->version = ++catalog->published;
+    BambuCatalogSnapshot* old = atomic_exchange(&catalog->current, snapshot);
+    old->retire_epoch = atomic_fetch_add(&catalog->epoch, 1) + 1;
+    old->next_retired = catalog->retired;
+    catalog->retired = old;
+    bambu_catalog_reclaim_locked(catalog);
+    pthread_mutex_unlock(&catalog->writer_lock);
+}
+
+// Load a catalog file and publish it. On failure the current catalog
+// stays in place; see bambu_catalog_snapshot_load() for bad_line.
+static inline bool bambu_catalog_reload(BambuCatalog* catalog, const char* path, size_t* bad_line) {
+    BambuCatalogSnapshot* snapshot = bambu_catalog_snapshot_load(path, bad_line);
+    if(!snapshot) return false;
+    bambu_catalog_publish(catalog, snapshot);
+    return true;
+}
+
+// Wait until every retired snapshot has been freed
+static inline void bambu_catalog_synchronize(BambuCatalog* catalog) {
+    while(bambu_catalog_reclaim(catalog) > 0) sched_yield();
+}
+
+// Free the catalog; no reader may be inside a section
+static inline void bambu_catalog_free(BambuCatalog* catalog) {
+    bambu_catalog_synchronize(catalog);
+    bambu_catalog_snapshot_free(atomic_load(&catalog->current));
+    pthread_mutex_destroy(&catalog->writer_lock);
+    memset(catalog, 0, sizeof(BambuCatalog));
+}
+
+#endif // BAMBU_CATALOG_H
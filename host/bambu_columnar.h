@@ -0,0 +1,621 @@
+// Bambu Lab NFC Parser - Columnar Spool Inventory Files
+// Stores decoded spool records column by column: one fixed-width array per
+// numeric field and dictionary-encoded (uint16 code) columns for the
+// repetitive strings, so aggregates only read the columns they use.
+//
+// File layout (all integers little-endian):
+//   Header     "BSPC", version u16, column count u16, row count u32, 0 u32
+//   Directory  one 44-byte entry per column:
+//              name[24], type u8, width u8, 0 u16,
+//              data offset u32, data size u32, dict offset u32, dict size u32
+//   Sections   column data, each 8-byte aligned. A dictionary section is a
+//              u32 string count followed by (u8 length, bytes) per string.
+// Columns are looked up by name, so readers ignore columns they do not
+// know and files from newer writers stay readable.
+//
+// Writers and readers allocate through the allocator current when they are
+// initialized or opened (bambu_alloc.h). bambu_record_file_load() reads
+// either record file format: a .bspc file or a frame log.
+//
+// Requires bambu_host.h to be included first.
+
+#ifndef BAMBU_COLUMNAR_H
+#define BAMBU_COLUMNAR_H
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "bambu_hash.h"
+#include "bambu_stream.h"
+
+#define BAMBU_COLUMNAR_MAGIC       "BSPC"
+#define BAMBU_COLUMNAR_VERSION     1
+#define BAMBU_COLUMNAR_HEADER_SIZE 16
+#define BAMBU_COLUMNAR_ENTRY_SIZE  44
+#define BAMBU_COLUMNAR_NAME_LEN    24
+#define BAMBU_COLUMNAR_MAX_COLUMNS 64
+
+typedef enum {
+    BambuColumnTypeUint,   // width-byte unsigned integers
+    BambuColumnTypeBytes,  // width-byte opaque values
+    BambuColumnTypeDict,   // uint16 codes into a string dictionary
+} BambuColumnType;
+
+typedef struct {
+    const char* name;
+    BambuColumnType type;
+    uint8_t width;
+} BambuColumnSpec;
+
+typedef enum {
+    BambuColumnUid,
+    BambuColumnVariantId,
+    BambuColumnMaterialId,
+    BambuColumnFilamentType,
+    BambuColumnDetailedType,
+    BambuColumnColorName,
+    BambuColumnColorRgba,
+    BambuColumnWeight,
+    BambuColumnDiameter,
+    BambuColumnDryingTemp,
+    BambuColumnDryingHours,
+    BambuColumnHotendMin,
+    BambuColumnHotendMax,
+    BambuColumnNozzleDiameter,
+    BambuColumnSpoolWidth,
+    BambuColumnFilamentLength,
+    BambuColumnProductionDate,
+    BambuColumnScanTime,
+    BambuColumnTrayUid,
+    BambuColumnCount,
+} BambuColumnId;
+
+static const BambuColumnSpec bambu_columns[BambuColumnCount] = {
+    [BambuColumnUid] = {"uid", BambuColumnTypeBytes, 11},  // Length byte + 10
+    [BambuColumnVariantId] = {"variant_id", BambuColumnTypeDict, 2},
+    [BambuColumnMaterialId] = {"material_id", BambuColumnTypeDict, 2},
+    [BambuColumnFilamentType] = {"filament_type", BambuColumnTypeDict, 2},
+    [BambuColumnDetailedType] = {"detailed_type", BambuColumnTypeDict, 2},
+    [BambuColumnColorName] = {"color_name", BambuColumnTypeDict, 2},  // From the catalog
+    [BambuColumnColorRgba] = {"color_rgba", BambuColumnTypeUint, 4},
+    [BambuColumnWeight] = {"weight_g", BambuColumnTypeUint, 2},
+    [BambuColumnDiameter] = {"diameter_mm_x100", BambuColumnTypeUint, 2},
+    [BambuColumnDryingTemp] = {"drying_temp_c", BambuColumnTypeUint, 2},
+    [BambuColumnDryingHours] = {"drying_hours", BambuColumnTypeUint, 2},
+    [BambuColumnHotendMin] = {"hotend_min_c", BambuColumnTypeUint, 2},
+    [BambuColumnHotendMax] = {"hotend_max_c", BambuColumnTypeUint, 2},
+    [BambuColumnNozzleDiameter] = {"nozzle_diameter_mm_x100", BambuColumnTypeUint, 2},
+    [BambuColumnSpoolWidth] = {"spool_width_mm_x100", BambuColumnTypeUint, 2},
+    [BambuColumnFilamentLength] = {"filament_length_m", BambuColumnTypeUint, 2},
+    [BambuColumnProductionDate] = {"production_minutes", BambuColumnTypeUint, 4},  // 0 = unknown
+    [BambuColumnScanTime] = {"scan_time", BambuColumnTypeUint, 4},
+    [BambuColumnTrayUid] = {"tray_uid", BambuColumnTypeBytes, 16},
+};
+
+// Helper: Little-endian integer access
+static inline uint32_t bambu_columnar_read_uint(const uint8_t* data, uint8_t width) {
+    uint32_t value = 0;
+    for(uint8_t i = 0; i < width; i++) value |= (uint32_t)data[i] << (8 * i);
+    return value;
+}
+
+static inline void bambu_columnar_write_uint(uint8_t* data, uint32_t value, uint8_t width) {
+    for(uint8_t i = 0; i < width; i++) data[i] = (uint8_t)(value >> (8 * i));
+}
+
+// ============================================================================
+// Writer: accumulates rows in memory, then writes the file in one go
+// ============================================================================
+
+typedef struct {
+    uint8_t* data;
+    size_t len;
+    size_t capacity;
+    const BambuAllocator* allocator;
+} BambuByteBuffer;
+
+typedef struct {
+    BambuByteBuffer columns[BambuColumnCount];
+    BambuStringDict dicts[BambuColumnCount];  // Dictionary columns only
+    uint32_t rows;
+} BambuColumnarWriter;
+
+// Helper: Reserve len bytes at the end of a buffer
+static inline uint8_t* bambu_byte_buffer_append(BambuByteBuffer* buffer, size_t len) {
+    if(buffer->len + len > buffer->capacity) {
+        size_t capacity = buffer->capacity ? buffer->capacity : 4096;
+        while(capacity < buffer->len + len) capacity *= 2;
+        uint8_t* grown = bambu_mem_resize(buffer->allocator, buffer->data, buffer->capacity, capacity);
+        if(!grown) return NULL;
+        buffer->data = grown;
+        buffer->capacity = capacity;
+    }
+    uint8_t* out = &buffer->data[buffer->len];
+    buffer->len += len;
+    return out;
+}
+
+static inline bool bambu_columnar_writer_init(BambuColumnarWriter* writer) {
+    memset(writer, 0, sizeof(BambuColumnarWriter));
+    for(size_t i = 0; i < BambuColumnCount; i++) {
+        writer->columns[i].allocator = bambu_allocator();
+        if(bambu_columns[i].type != BambuColumnTypeDict) continue;
+        if(!bambu_string_dict_init(&writer->dicts[i])) return false;
+    }
+    return true;
+}
+
+static inline void bambu_columnar_writer_free(BambuColumnarWriter* writer) {
+    for(size_t i = 0; i < BambuColumnCount; i++) {
+        BambuByteBuffer* column = &writer->columns[i];
+        if(column->data) bambu_mem_free(column->allocator, column->data, column->capacity);
+        bambu_string_dict_free(&writer->dicts[i]);
+    }
+    memset(writer, 0, sizeof(BambuColumnarWriter));
+}
+
+// Drop all rows but keep the column buffers and dictionaries, so a writer
+// reused for successive batches stops allocating once it has seen the
+// largest batch and every distinct string. Saved files may then list
+// strings no row of theirs uses.
+static inline void bambu_columnar_writer_reset(BambuColumnarWriter* writer) {
+    for(size_t i = 0; i < BambuColumnCount; i++) writer->columns[i].len = 0;
+    writer->rows = 0;
+}
+
+// Append one decoded record with its catalog entry (NULL if unknown), for
+// callers that already looked it up. Returns false on allocation failure or
+// if a dictionary column exceeds 65536 distinct strings.
+static inline bool bambu_columnar_writer_add_info(
+    BambuColumnarWriter* writer,
+    const BambuSpoolRecord* record,
+    uint32_t scan_time,
+    const BambuFilamentInfo* info) {
+    uint32_t production_minutes = 0;
+    bambu_date_parse(record->production_date, &production_minutes);
+
+    for(size_t i = 0; i < BambuColumnCount; i++) {
+        const BambuColumnSpec* spec = &bambu_columns[i];
+        uint8_t* out = bambu_byte_buffer_append(&writer->columns[i], spec->width);
+        if(!out) return false;
+
+        const char* str = NULL;
+        uint32_t value = 0;
+        switch((BambuColumnId)i) {
+        case BambuColumnUid:
+            memset(out, 0, spec->width);
+            out[0] = record->uid_len;
+            memcpy(&out[1], record->uid, record->uid_len);
+            continue;
+        case BambuColumnTrayUid:
+            memcpy(out, record->tray_uid, spec->width);
+            continue;
+        case BambuColumnVariantId: str = record->variant_id; break;
+        case BambuColumnMaterialId: str = record->material_id; break;
+        case BambuColumnFilamentType: str = record->filament_type; break;
+        case BambuColumnDetailedType: str = record->detailed_type; break;
+        case BambuColumnColorName: str = info ? info->color_name : ""; break;
+        case BambuColumnColorRgba:
+            value = ((uint32_t)record->color_r << 24) | ((uint32_t)record->color_g << 16) |
+                    ((uint32_t)record->color_b << 8) | record->color_a;
+            break;
+        case BambuColumnWeight: value = record->weight_grams; break;
+        case BambuColumnDiameter: value = record->diameter_mm_x100; break;
+        case BambuColumnDryingTemp: value = record->drying_temp_c; break;
+        case BambuColumnDryingHours: value = record->drying_hours; break;
+        case BambuColumnHotendMin: value = record->hotend_min_c; break;
+        case BambuColumnHotendMax: value = record->hotend_max_c; break;
+        case BambuColumnNozzleDiameter: value = record->nozzle_diameter_mm_x100; break;
+        case BambuColumnSpoolWidth: value = record->spool_width_mm_x100; break;
+        case BambuColumnFilamentLength: value = record->filament_length_m; break;
+        case BambuColumnProductionDate: value = production_minutes; break;
+        case BambuColumnScanTime: value = scan_time; break;
+        case BambuColumnCount: break;
+        }
+
+        if(spec->type == BambuColumnTypeDict) {
+            int32_t code = bambu_string_dict_code(&writer->dicts[i], str);
+            if(code < 0) return false;
+            value = (uint32_t)code;
+        }
+        bambu_columnar_write_uint(out, value, spec->width);
+    }
+    writer->rows++;
+    return true;
+}
+
+// Append one decoded record (see bambu_columnar_writer_add_info)
+static inline bool bambu_columnar_writer_add(
+    BambuColumnarWriter* writer,
+    const BambuSpoolRecord* record,
+    uint32_t scan_time) {
+    return bambu_columnar_writer_add_info(writer, record, scan_time, bambu_lookup_filament(record->variant_id));
+}
+
+// Helper: Write zero padding up to the next 8-byte boundary
+static inline bool bambu_columnar_pad(FILE* f, uint32_t* offset) {
+    static const uint8_t zeros[8] = {0};
+    uint32_t pad = (8 - (*offset % 8)) % 8;
+    *offset += pad;
+    return fwrite(zeros, 1, pad, f) == pad;
+}
+
+// Write all accumulated rows to path. Returns false on I/O error.
+static inline bool bambu_columnar_writer_save(const BambuColumnarWriter* writer, const char* path) {
+    FILE* f = fopen(path, "wb");
+    if(!f) return false;
+
+    // Lay out sections: dictionary then codes for dict columns
+    uint32_t data_offset[BambuColumnCount];
+    uint32_t dict_offset[BambuColumnCount];
+    uint32_t dict_size[BambuColumnCount];
+    uint32_t offset = BAMBU_COLUMNAR_HEADER_SIZE + BambuColumnCount * BAMBU_COLUMNAR_ENTRY_SIZE;
+    for(size_t i = 0; i < BambuColumnCount; i++) {
+        dict_offset[i] = 0;
+        dict_size[i] = 0;
+        if(bambu_columns[i].type == BambuColumnTypeDict) {
+            offset = (offset + 7) & ~7u;
+            dict_offset[i] = offset;
+            dict_size[i] = 4;
+            for(size_t s = 0; s < writer->dicts[i].count; s++) {
+                dict_size[i] += 1 + (uint32_t)strlen(writer->dicts[i].strings[s]);
+            }
+            offset += dict_size[i];
+        }
+        offset = (offset + 7) & ~7u;
+        data_offset[i] = offset;
+        offset += (uint32_t)writer->columns[i].len;
+    }
+
+    uint8_t header[BAMBU_COLUMNAR_HEADER_SIZE] = {0};
+    memcpy(header, BAMBU_COLUMNAR_MAGIC, 4);
+    bambu_columnar_write_uint(&header[4], BAMBU_COLUMNAR_VERSION, 2);
+    bambu_columnar_write_uint(&header[6], BambuColumnCount, 2);
+    bambu_columnar_write_uint(&header[8], writer->rows, 4);
+    bool ok = fwrite(header, 1, sizeof(header), f) == sizeof(header);
+
+    for(size_t i = 0; ok && i < BambuColumnCount; i++) {
+        uint8_t entry[BAMBU_COLUMNAR_ENTRY_SIZE] = {0};
+        strncpy((char*)entry, bambu_columns[i].name, BAMBU_COLUMNAR_NAME_LEN - 1);
+        entry[24] = (uint8_t)bambu_columns[i].type;
+        entry[25] = bambu_columns[i].width;
+        bambu_columnar_write_uint(&entry[28], data_offset[i], 4);
+        bambu_columnar_write_uint(&entry[32], (uint32_t)writer->columns[i].len, 4);
+        bambu_columnar_write_uint(&entry[36], dict_offset[i], 4);
+        bambu_columnar_write_uint(&entry[40], dict_size[i], 4);
+        ok = fwrite(entry, 1, sizeof(entry), f) == sizeof(entry);
+    }
+
+    offset = BAMBU_COLUMNAR_HEADER_SIZE + BambuColumnCount * BAMBU_COLUMNAR_ENTRY_SIZE;
+    for(size_t i = 0; ok && i < BambuColumnCount; i++) {
+        if(bambu_columns[i].type == BambuColumnTypeDict) {
+            ok = bambu_columnar_pad(f, &offset);
+            uint8_t count[4];
+            bambu_columnar_write_uint(count, (uint32_t)writer->dicts[i].count, 4);
+            ok = ok && fwrite(count, 1, 4, f) == 4;
+            for(size_t s = 0; ok && s < writer->dicts[i].count; s++) {
+                const char* str = writer->dicts[i].strings[s];
+                uint8_t len = (uint8_t)strlen(str);
+                ok = fputc(len, f) != EOF && fwrite(str, 1, len, f) == len;
+            }
+            offset += dict_size[i];
+        }
+        ok = ok && bambu_columnar_pad(f, &offset);
+        size_t len = writer->columns[i].len;
+        ok = ok && (len == 0 || fwrite(writer->columns[i].data, 1, len, f) == len);
+        offset += (uint32_t)len;
+    }
+
+    if(fclose(f) != 0) ok = false;
+    return ok;
+}
+
+// ============================================================================
+// Reader: maps the file and resolves columns by name
+// ============================================================================
+
+typedef struct {
+    char name[BAMBU_COLUMNAR_NAME_LEN];
+    BambuColumnType type;
+    uint8_t width;
+    const uint8_t* data;  // rows * width bytes
+    char** dict;          // Decoded dictionary strings (dict columns)
+    uint32_t dict_count;
+    uint32_t dict_pool_size;
+} BambuColumn;
+
+typedef struct {
+    const BambuAllocator* allocator;
+    uint8_t* base;
+    size_t size;
+    uint32_t rows;
+    uint16_t column_count;
+    BambuColumn columns[BAMBU_COLUMNAR_MAX_COLUMNS];
+    const BambuColumn* by_id[BambuColumnCount];  // Known columns, NULL if absent
+} BambuColumnarReader;
+
+static inline void bambu_columnar_close(BambuColumnarReader* reader) {
+    for(size_t i = 0; i < reader->column_count; i++) {
+        BambuColumn* column = &reader->columns[i];
+        if(column->dict) {
+            bambu_mem_free(reader->allocator, column->dict[0], column->dict_pool_size);  // String pool
+            size_t dict_size = (column->dict_count ? column->dict_count : 1) * sizeof(char*);
+            bambu_mem_free(reader->allocator, column->dict, dict_size);
+        }
+    }
+    if(reader->base) munmap(reader->base, reader->size);
+    memset(reader, 0, sizeof(BambuColumnarReader));
+}
+
+// Helper: Decode a dictionary section into NUL-terminated strings
+static inline bool bambu_columnar_load_dict(
+    const BambuAllocator* allocator,
+    BambuColumn* column,
+    const uint8_t* section,
+    uint32_t size) {
+    if(size < 4) return false;
+    uint32_t count = bambu_columnar_read_uint(section, 4);
+    if(count > (size - 4)) return false;  // Each string takes at least 1 byte
+
+    char** dict = bambu_mem_calloc(allocator, count ? count : 1, sizeof(char*));
+    char* pool = bambu_mem_alloc(allocator, size);  // Strings + NULs never exceed the section
+    if(!dict || !pool) {
+        bambu_mem_free(allocator, dict, (count ? count : 1) * sizeof(char*));
+        bambu_mem_free(allocator, pool, size);
+        return false;
+    }
+    column->dict = dict;
+    column->dict[0] = pool;
+    column->dict_count = count;
+    column->dict_pool_size = size;
+
+    uint32_t pos = 4;
+    for(uint32_t s = 0; s < count; s++) {
+        if(pos >= size || pos + 1 + section[pos] > size) return false;
+        uint8_t len = section[pos];
+        column->dict[s] = pool;
+        memcpy(pool, &section[pos + 1], len);
+        pool[len] = '\0';
+        pool += len + 1;
+        pos += 1 + len;
+    }
+    return true;
+}
+
+// Open a columnar file. Returns false if it is missing or malformed.
+static inline bool bambu_columnar_open(BambuColumnarReader* reader, const char* path) {
+    memset(reader, 0, sizeof(BambuColumnarReader));
+    reader->allocator = bambu_allocator();
+    int fd = open(path, O_RDONLY);
+    if(fd < 0) return false;
+    off_t size = lseek(fd, 0, SEEK_END);
+    if(size < BAMBU_COLUMNAR_HEADER_SIZE) {
+        close(fd);
+        return false;
+    }
+    void* base = mmap(NULL, (size_t)size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if(base == MAP_FAILED) return false;
+    reader->base = base;
+    reader->size = (size_t)size;
+
+    const uint8_t* header = reader->base;
+    if(memcmp(header, BAMBU_COLUMNAR_MAGIC, 4) != 0 ||
+       bambu_columnar_read_uint(&header[4], 2) != BAMBU_COLUMNAR_VERSION) {
+        bambu_columnar_close(reader);
+        return false;
+    }
+    uint32_t column_count = bambu_columnar_read_uint(&header[6], 2);
+    reader->rows = bambu_columnar_read_uint(&header[8], 4);
+    if(column_count > BAMBU_COLUMNAR_MAX_COLUMNS ||
+       BAMBU_COLUMNAR_HEADER_SIZE + (size_t)column_count * BAMBU_COLUMNAR_ENTRY_SIZE > reader->size) {
+        bambu_columnar_close(reader);
+        return false;
+    }
+
+    for(uint32_t i = 0; i < column_count; i++) {
+        const uint8_t* entry =
+            &reader->base[BAMBU_COLUMNAR_HEADER_SIZE + i * BAMBU_COLUMNAR_ENTRY_SIZE];
+        BambuColumn* column = &reader->columns[i];
+        reader->column_count = (uint16_t)(i + 1);
+        memcpy(column->name, entry, BAMBU_COLUMNAR_NAME_LEN - 1);
+        column->type = (BambuColumnType)entry[24];
+        column->width = entry[25];
+        uint32_t data_offset = bambu_columnar_read_uint(&entry[28], 4);
+        uint32_t data_size = bambu_columnar_read_uint(&entry[32], 4);
+        uint32_t dict_offset = bambu_columnar_read_uint(&entry[36], 4);
+        uint32_t dict_size = bambu_columnar_read_uint(&entry[40], 4);
+
+        bool valid = column->width > 0 && column->width <= 16 &&
+                     (uint64_t)reader->rows * column->width == data_size &&
+                     (uint64_t)data_offset + data_size <= reader->size &&
+                     (uint64_t)dict_offset + dict_size <= reader->size;
+        if(valid && column->type == BambuColumnTypeDict) {
+            valid = column->width == 2 &&
+                    bambu_columnar_load_dict(reader->allocator, column, &reader->base[dict_offset], dict_size);
+        }
+        if(!valid) {
+            bambu_columnar_close(reader);
+            return false;
+        }
+        column->data = &reader->base[data_offset];
+
+        for(size_t id = 0; id < BambuColumnCount; id++) {
+            if(strcmp(column->name, bambu_columns[id].name) == 0 &&
+               column->type == bambu_columns[id].type &&
+               column->width == bambu_columns[id].width) {
+                reader->by_id[id] = column;
+            }
+        }
+    }
+    return true;
+}
+
+// Find a column by name, NULL if absent
+static inline const BambuColumn* bambu_columnar_find(
+    const BambuColumnarReader* reader,
+    const char* name) {
+    for(size_t i = 0; i < reader->column_count; i++) {
+        if(strcmp(reader->columns[i].name, name) == 0) return &reader->columns[i];
+    }
+    return NULL;
+}
+
+// Value of a Uint column, or the dictionary code of a Dict column
+static inline uint32_t bambu_column_uint(const BambuColumn* column, uint32_t row) {
+    return bambu_columnar_read_uint(&column->data[(size_t)row * column->width], column->width);
+}
+
+// String value of a Dict column ("" for out-of-range codes)
+static inline const char* bambu_column_string(const BambuColumn* column, uint32_t row) {
+    uint32_t code = bambu_column_uint(column, row);
+    return code < column->dict_count ? column->dict[code] : "";
+}
+
+// Helper: Copy a dictionary string into a fixed-size record field
+static inline void bambu_columnar_copy_string(
+    const BambuColumnarReader* reader,
+    BambuColumnId id,
+    uint32_t row,
+    char* dest,
+    size_t dest_size) {
+    dest[0] = '\0';
+    if(!reader->by_id[id]) return;
+    strncpy(dest, bambu_column_string(reader->by_id[id], row), dest_size - 1);
+    dest[dest_size - 1] = '\0';
+}
+
+// Reassemble a full record from its columns. scan_time may be NULL.
+// Columns missing from the file leave their fields zeroed.
+static inline void bambu_columnar_get_record(
+    const BambuColumnarReader* reader,
+    uint32_t row,
+    BambuSpoolRecord* record,
+    uint32_t* scan_time) {
+    memset(record, 0, sizeof(BambuSpoolRecord));
+    const BambuColumn* const* col = reader->by_id;
+
+    if(col[BambuColumnUid]) {
+        const uint8_t* uid = &col[BambuColumnUid]->data[(size_t)row * 11];
+        record->uid_len = uid[0] <= sizeof(record->uid) ? uid[0] : 0;
+        memcpy(record->uid, &uid[1], record->uid_len);
+    }
+    bambu_columnar_copy_string(
+        reader, BambuColumnVariantId, row, record->variant_id, sizeof(record->variant_id));
+    bambu_columnar_copy_string(
+        reader, BambuColumnMaterialId, row, record->material_id, sizeof(record->material_id));
+    bambu_columnar_copy_string(
+        reader, BambuColumnFilamentType, row, record->filament_type, sizeof(record->filament_type));
+    bambu_columnar_copy_string(
+        reader, BambuColumnDetailedType, row, record->detailed_type, sizeof(record->detailed_type));
+
+    if(col[BambuColumnColorRgba]) {
+        uint32_t rgba = bambu_column_uint(col[BambuColumnColorRgba], row);
+        record->color_r = (uint8_t)(rgba >> 24);
+        record->color_g = (uint8_t)(rgba >> 16);
+        record->color_b = (uint8_t)(rgba >> 8);
+        record->color_a = (uint8_t)rgba;
+    }
+
+    static const struct {
+        BambuColumnId id;
+        size_t offset;
+    } u16_fields[] = {
+        {BambuColumnWeight, offsetof(BambuSpoolRecord, weight_grams)},
+        {BambuColumnDiameter, offsetof(BambuSpoolRecord, diameter_mm_x100)},
+        {BambuColumnDryingTemp, offsetof(BambuSpoolRecord, drying_temp_c)},
+        {BambuColumnDryingHours, offsetof(BambuSpoolRecord, drying_hours)},
+        {BambuColumnHotendMin, offsetof(BambuSpoolRecord, hotend_min_c)},
+        {BambuColumnHotendMax, offsetof(BambuSpoolRecord, hotend_max_c)},
+        {BambuColumnNozzleDiameter, offsetof(BambuSpoolRecord, nozzle_diameter_mm_x100)},
+        {BambuColumnSpoolWidth, offsetof(BambuSpoolRecord, spool_width_mm_x100)},
+        {BambuColumnFilamentLength, offsetof(BambuSpoolRecord, filament_length_m)},
+    };
+    for(size_t i = 0; i < sizeof(u16_fields) / sizeof(u16_fields[0]); i++) {
+        if(!col[u16_fields[i].id]) continue;
+        uint16_t value = (uint16_t)bambu_column_uint(col[u16_fields[i].id], row);
+        memcpy((uint8_t*)record + u16_fields[i].offset, &value, sizeof(value));
+    }
+
+    if(col[BambuColumnProductionDate]) {
+        uint32_t minutes = bambu_column_uint(col[BambuColumnProductionDate], row);
+        if(minutes) bambu_date_format(minutes, record->production_date);
+    }
+    if(col[BambuColumnTrayUid]) {
+        memcpy(record->tray_uid, &col[BambuColumnTrayUid]->data[(size_t)row * 16], sizeof(record->tray_uid));
+    }
+    if(scan_time) {
+        *scan_time = col[BambuColumnScanTime] ? bambu_column_uint(col[BambuColumnScanTime], row) : 0;
+    }
+}
+
+// ============================================================================
+// Record files
+// ============================================================================
+
+// Called for every record of a record file; return false to stop reading
+typedef bool (*BambuRecordCallback)(const BambuSpoolRecord* record, uint32_t scan_time, void* context);
+
+typedef struct {
+    BambuRecordCallback callback;
+    void* context;
+    bool stopped;
+} BambuRecordFileSink;
+
+// Helper: Forward a record of a frame log until the callback stops
+static inline void bambu_record_file_frame(const BambuSpoolRecord* record, uint32_t scan_time, void* context) {
+    BambuRecordFileSink* sink = context;
+    if(!sink->stopped && !sink->callback(record, scan_time, sink->context)) sink->stopped = true;
+}
+
+// Feed every record of a .bspc file, or of a frame log (bambu_receive -l)
+// for any other path, to callback. Unreadable files and skipped frames are
+// reported on stderr. Returns false if the file could not be read or the
+// callback stopped.
+static inline bool bambu_record_file_load(const char* path, BambuRecordCallback callback, void* context) {
+    if(bambu_host_has_suffix(path, ".bspc")) {
+        BambuColumnarReader reader;
+        if(!bambu_columnar_open(&reader, path)) {
+            fprintf(stderr, "Not a readable columnar file: %s\n", path);
+            return false;
+        }
+        bool ok = true;
+        for(uint32_t row = 0; ok && row < reader.rows; row++) {
+            BambuSpoolRecord record;
+            uint32_t scan_time;
+            bambu_columnar_get_record(&reader, row, &record, &scan_time);
+            ok = callback(&record, scan_time, context);
+        }
+        bambu_columnar_close(&reader);
+        return ok;
+    }
+
+    int fd = open(path, O_RDONLY);
+    if(fd < 0) {
+        fprintf(stderr, "Failed to open: %s\n", path);
+        return false;
+    }
+    BambuRecordFileSink sink = {callback, context, false};
+    BambuStream stream;
+    bambu_stream_init(&stream, bambu_record_file_frame, &sink);
+    uint8_t buf[65536];
+    ssize_t n;
+    do {
+        n = read(fd, buf, sizeof(buf));
+        if(n > 0) bambu_stream_feed(&stream, buf, (size_t)n);
+    } while((n > 0 || (n < 0 && errno == EINTR)) && !sink.stopped);
+    close(fd);
+    if(stream.rx.crc_errors || stream.bad_records) {
+        fprintf(
+            stderr,
+            "%s: %u CRC errors, %u malformed records skipped\n",
+            path,
+            stream.rx.crc_errors,
+            stream.bad_records);
+    }
+    if(n < 0) fprintf(stderr, "Failed to read: %s\n", path);
+    return n == 0 && !sink.stopped;
+}
+
+#endif // BAMBU_COLUMNAR_H
@@ -0,0 +1,119 @@
+/**
+ * bambu_dupes - Find cloned and duplicated spool tags across dump archives
+ *
+ * Fingerprints every Bambu dump (spool data and signature blocks) and
+ * reports, in a single pass over the inputs:
+ *   DUPLICATE     same UID and payload as an earlier dump
+ *   UID_CONFLICT  same UID as an earlier dump but different payload
+ *   CLONE         same payload as an earlier dump under a different UID
+ *
+ * Usage: bambu_dupes [PATH...]
+ *   PATH  dump file, directory (searched recursively) or "-" to read
+ *         paths from stdin. Defaults to "-".
+ *
+ * Output: one tab-separated line per finding:
+ *   KIND  PATH  UID  EARLIER_PATH  EARLIER_UID
+ */
+
+#include "bambu_host.h"
+#include "bambu_dupes.h"
+
+typedef struct {
+    char* path;
+    char uid_hex[21];
+} DumpInfo;
+
+typedef struct {
+    BambuDupeIndex index;
+    DumpInfo* dumps;
+    size_t dumps_capacity;
+    size_t unreadable;
+    size_t not_bambu;
+    size_t counts[4];  // Per BambuDupeKind
+} DupesContext;
+
+static const char* const kind_names[] = {
+    [BambuDupeNew] = "NEW",
+    [BambuDupeExact] = "DUPLICATE",
+    [BambuDupeUidConflict] = "UID_CONFLICT",
+    [BambuDupeClone] = "CLONE",
+};
+
+static bool on_input(const char* path, void* context) {
+    DupesContext* ctx = context;
+
+    MfClassicData data;
+    if(!bambu_nfc_load(path, &data)) {
+        ctx->unreadable++;
+        return true;
+    }
+    if(!bambu_tag_is_valid(&data)) {
+        ctx->not_bambu++;
+        return true;
+    }
+
+    if(ctx->index.count == ctx->dumps_capacity) {
+        size_t capacity = ctx->dumps_capacity ? ctx->dumps_capacity * 2 : 1024;
+        DumpInfo* grown = bambu_mem_resize(
+            ctx->index.by_uid.allocator, ctx->dumps, ctx->dumps_capacity * sizeof(DumpInfo), capacity * sizeof(DumpInfo));
+        if(!grown) return false;
+        ctx->dumps = grown;
+        ctx->dumps_capacity = capacity;
+    }
+
+    DumpInfo* info = &ctx->dumps[ctx->index.count];
+    size_t uid_len = 0;
+    const uint8_t* uid = mf_classic_get_uid(&data, &uid_len);
+    bambu_uid_to_hex(uid, uid_len, info->uid_hex);
+    info->path = bambu_mem_strdup(ctx->index.by_uid.allocator, path);
+    if(!info->path) return false;
+
+    BambuDupeResult result;
+    if(!bambu_dupes_add(&ctx->index, &data, &result)) return false;
+    ctx->counts[result.kind]++;
+
+    if(result.kind != BambuDupeNew) {
+        const DumpInfo* other = &ctx->dumps[result.other];
+        printf(
+            "%s\t%s\t%s\t%s\t%s\n",
+            kind_names[result.kind],
+            info->path,
+            info->uid_hex,
+            other->path,
+            other->uid_hex);
+    }
+    return true;
+}
+
+int main(int argc, char* argv[]) {
+    static char* const stdin_input[] = {"-"};
+
+    DupesContext ctx = {0};
+    if(!bambu_dupes_init(&ctx.index, 4096)) {
+        fprintf(stderr, "Out of memory\n");
+        return 1;
+    }
+
+    bool ok = argc > 1 ? bambu_host_for_each_input(&argv[1], argc - 1, on_input, &ctx) :
+                         bambu_host_for_each_input(stdin_input, 1, on_input, &ctx);
+
+    fprintf(
+        stderr,
+        "%zu Bambu dumps: %zu unique, %zu duplicates, %zu UID conflicts, %zu clones "
+        "(%zu not Bambu, %zu unreadable)\n",
+        ctx.index.count,
+        ctx.counts[BambuDupeNew],
+        ctx.counts[BambuDupeExact],
+        ctx.counts[BambuDupeUidConflict],
+        ctx.counts[BambuDupeClone],
+        ctx.not_bambu,
+        ctx.unreadable);
+
+    const BambuAllocator* allocator = ctx.index.by_uid.allocator;
+    for(size_t i = 0; i < ctx.index.count; i++) {
+        bambu_mem_free(allocator, ctx.dumps[i].path, strlen(ctx.dumps[i].path) + 1);
+    }
+    bambu_mem_free(allocator, ctx.dumps, ctx.dumps_capacity * sizeof(DumpInfo));
+    bambu_dupes_free(&ctx.index);
+    return ok ? 0 : 1;
+}
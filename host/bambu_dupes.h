@@ -0,0 +1,131 @@
+// Bambu Lab NFC Parser - Clone and Duplicate Detection
+// Fingerprints dumps and classifies each one against everything seen
+// before it in a single pass, using two hash indexes:
+//   - by UID: same UID again with the same payload is an exact duplicate,
+//     with a different payload it is a UID conflict, unless the dump that
+//     first had this payload also had this UID (an exact duplicate of it)
+//   - by payload: same payload under a different UID is a clone
+// The payload fingerprint covers the spool data blocks 1-14 and the
+// signature blocks, excluding block 0 (UID/manufacturer) and all sector
+// trailers (keys are often unknown in dumps).
+//
+// Requires bambu_host.h to be included first.
+
+#ifndef BAMBU_DUPES_H
+#define BAMBU_DUPES_H
+
+#include "bambu_hash.h"
+
+typedef struct {
+    uint64_t uid_hash;
+    uint64_t payload_hash;
+} BambuFingerprint;
+
+typedef enum {
+    BambuDupeNew,          // First time this UID and payload are seen
+    BambuDupeExact,        // Same UID, same payload as an earlier dump
+    BambuDupeUidConflict,  // Same UID, different payload
+    BambuDupeClone,        // Same payload, different UID
+} BambuDupeKind;
+
+typedef struct {
+    BambuDupeKind kind;
+    uint32_t other;  // Id of the earlier dump it matched (unless New)
+} BambuDupeResult;
+
+typedef struct {
+    BambuHashIndex by_uid;
+    BambuHashIndex by_payload;
+    BambuFingerprint* fingerprints;  // Indexed by dump id
+    size_t count;
+    size_t capacity;
+} BambuDupeIndex;
+
+static inline BambuFingerprint bambu_fingerprint(const MfClassicData* data) {
+    BambuFingerprint fp;
+    size_t uid_len = 0;
+    const uint8_t* uid = mf_classic_get_uid(data, &uid_len);
+    fp.uid_hash = bambu_hash_bytes(BAMBU_HASH_SEED, uid, uid_len);
+
+    uint64_t h = BAMBU_HASH_SEED;
+    for(size_t block = BLOCK_MATERIAL_IDS; block <= BLOCK_FILAMENT_LENGTH; block++) {
+        if(bambu_is_sector_trailer(block)) continue;
+        h = bambu_hash_bytes(h, data->block[block].data, 16);
+    }
+    for(size_t block = BLOCK_SIGNATURE_FIRST; block <= BLOCK_SIGNATURE_LAST; block++) {
+        if(bambu_is_sector_trailer(block)) continue;
+        h = bambu_hash_bytes(h, data->block[block].data, 16);
+    }
+    fp.payload_hash = h;
+    return fp;
+}
+
+static inline bool bambu_dupes_init(BambuDupeIndex* index, size_t expected) {
+    memset(index, 0, sizeof(BambuDupeIndex));
+    if(!bambu_hash_index_init(&index->by_uid, expected)) return false;
+    if(!bambu_hash_index_init(&index->by_payload, expected)) {
+        bambu_hash_index_free(&index->by_uid);
+        return false;
+    }
+    return true;
+}
+
+static inline void bambu_dupes_free(BambuDupeIndex* index) {
+    // The fingerprints share the UID index's allocator
+    if(index->fingerprints) {
+        bambu_mem_free(index->by_uid.allocator, index->fingerprints, index->capacity * sizeof(BambuFingerprint));
+    }
+    bambu_hash_index_free(&index->by_uid);
+    bambu_hash_index_free(&index->by_payload);
+    memset(index, 0, sizeof(BambuDupeIndex));
+}
+
+// Add the next dump and classify it. Its id is the number of dumps added
+// before it (0, 1, 2, ...). Returns false on allocation failure.
+static inline bool bambu_dupes_add(
+    BambuDupeIndex* index,
+    const MfClassicData* data,
+    BambuDupeResult* result) {
+    if(index->count == index->capacity) {
+        size_t capacity = index->capacity ? index->capacity * 2 : 1024;
+        BambuFingerprint* grown = bambu_mem_resize(
+            index->by_uid.allocator,
+            index->fingerprints,
+            index->capacity * sizeof(BambuFingerprint),
+            capacity * sizeof(BambuFingerprint));
+        if(!grown) return false;
+        index->fingerprints = grown;
+        index->capacity = capacity;
+    }
+
+    uint32_t id = (uint32_t)index->count;
+    BambuFingerprint fp = bambu_fingerprint(data);
+    index->fingerprints[index->count++] = fp;
+
+    result->kind = BambuDupeNew;
+    result->other = id;
+
+    uint32_t uid_owner = bambu_hash_index_put(&index->by_uid, fp.uid_hash, id);
+    uint32_t payload_owner = bambu_hash_index_put(&index->by_payload, fp.payload_hash, id);
+    if(uid_owner == BAMBU_HASH_INDEX_EMPTY || payload_owner == BAMBU_HASH_INDEX_EMPTY) {
+        return false;
+    }
+
+    if(uid_owner != id) {
+        result->kind = BambuDupeUidConflict;
+        result->other = uid_owner;
+        if(index->fingerprints[uid_owner].payload_hash == fp.payload_hash) {
+            result->kind = BambuDupeExact;
+        } else if(payload_owner != id && index->fingerprints[payload_owner].uid_hash == fp.uid_hash) {
+            // A later dump of this UID was the first with this payload
+            result->kind = BambuDupeExact;
+            result->other = payload_owner;
+        }
+    } else if(payload_owner != id) {
+        result->kind = BambuDupeClone;
+        result->other = payload_owner;
+    }
+    return true;
+}
+
+#endif // BAMBU_DUPES_H
@@ -0,0 +1,334 @@
+// Bambu Lab NFC Parser - Encoder and Synthetic Dump Generator
+// Inverse of bambu_decode(): writes a BambuSpoolRecord into a Mifare
+// Classic 1K image using the block layout in bambu_parser.h, and renders
+// images as Flipper .nfc text or raw 1024-byte .bin/.mfd files.
+//
+// Synthetic records are drawn deterministically from a seed over
+// bambu_filament_table[] with per-material temperatures, weights and
+// production dates, so any dump of a corpus can be regenerated from
+// (seed, index) alone.
+//
+// Generated images decode to exactly the record they were built from, but
+// the RSA signature area (blocks 40-62) is filled with pseudo-random bytes
+// and sector trailer keys are left zero: they will not pass a printer's
+// signature check and are meant for host-side testing only.
+//
+// Requires bambu_host.h to be included first.
+
+#ifndef BAMBU_ENCODE_H
+#define BAMBU_ENCODE_H
+
+#include "bambu_hash.h"
+
+// Helper: Write little-endian uint16
+static inline void bambu_write_le16(uint8_t* out, uint16_t value) {
+    out[0] = (uint8_t)value;
+    out[1] = (uint8_t)(value >> 8);
+}
+
+// Helper: Write a float as little-endian IEEE 754
+static inline void bambu_write_le_float(uint8_t* out, float value) {
+    union {
+        uint32_t u;
+        float f;
+    } val;
+    val.f = value;
+    out[0] = (uint8_t)val.u;
+    out[1] = (uint8_t)(val.u >> 8);
+    out[2] = (uint8_t)(val.u >> 16);
+    out[3] = (uint8_t)(val.u >> 24);
+}
+
+// Helper: Copy a string into a zero-padded field of len bytes
+static inline void bambu_write_ascii(uint8_t* out, const char* str, size_t len) {
+    size_t n = strlen(str);
+    if(n > len) n = len;
+    memcpy(out, str, n);
+    memset(out + n, 0, len - n);
+}
+
+// Encode a record into a 1K image. Blocks not covered by the record get
+// the constant values seen on real tags; trailers get the Bambu access
+// bits with zero keys.
+static inline void bambu_encode(const BambuSpoolRecord* record, MfClassicData* data) {
+    memset(data, 0, sizeof(MfClassicData));
+    data->type = MfClassicType1k;
+
+    // UID and manufacturer block: UID, BCC, SAK, ATQA (4-byte UIDs only)
+    Iso14443_3aData* iso = &data->iso14443_3a_data;
+    iso->uid_len = record->uid_len > 4 ? 4 : record->uid_len;
+    memcpy(iso->uid, record->uid, iso->uid_len);
+    iso->atqa[0] = 0x00;
+    iso->atqa[1] = 0x04;
+    iso->sak = 0x08;
+    uint8_t* block0 = data->block[0].data;
+    memcpy(block0, iso->uid, 4);
+    block0[4] = block0[0] ^ block0[1] ^ block0[2] ^ block0[3];
+    block0[5] = iso->sak;
+    block0[6] = iso->atqa[1];
+    block0[7] = iso->atqa[0];
+
+    // Block 1: Variant ID (bytes 0-7) and Material ID (bytes 8-15)
+    uint8_t* block1 = data->block[BLOCK_MATERIAL_IDS].data;
+    bambu_write_ascii(&block1[0], record->variant_id, 8);
+    bambu_write_ascii(&block1[8], record->material_id, 8);
+
+    bambu_write_ascii(data->block[BLOCK_FILAMENT_TYPE].data, record->filament_type, 16);
+    bambu_write_ascii(data->block[BLOCK_DETAILED_TYPE].data, record->detailed_type, 16);
+
+    // Block 5: RGBA, weight, diameter
+    uint8_t* block5 = data->block[BLOCK_COLOR_WEIGHT].data;
+    block5[0] = record->color_r;
+    block5[1] = record->color_g;
+    block5[2] = record->color_b;
+    block5[3] = record->color_a;
+    bambu_write_le16(&block5[4], record->weight_grams);
+    bambu_write_le_float(&block5[8], record->diameter_mm_x100 / 100.0f);
+
+    // Block 6: Drying temp/hours, hotend max/min
+    uint8_t* block6 = data->block[BLOCK_TEMPERATURES].data;
+    bambu_write_le16(&block6[0], record->drying_temp_c);
+    bambu_write_le16(&block6[2], record->drying_hours);
+    bambu_write_le16(&block6[8], record->hotend_max_c);
+    bambu_write_le16(&block6[10], record->hotend_min_c);
+
+    bambu_write_le_float(&data->block[BLOCK_NOZZLE].data[12], record->nozzle_diameter_mm_x100 / 100.0f);
+    memcpy(data->block[BLOCK_TRAY_UID].data, record->tray_uid, sizeof(record->tray_uid));
+    bambu_write_le16(&data->block[BLOCK_SPOOL_WIDTH].data[4], record->spool_width_mm_x100);
+
+    // Block 12: Full date; block 13: short "YY_MM_DD_HH" form
+    bambu_write_ascii(data->block[BLOCK_PRODUCTION_DATE].data, record->production_date, 16);
+    bambu_write_ascii(data->block[BLOCK_PRODUCTION_DATE + 1].data, record->production_date + 2, 11);
+
+    bambu_write_le16(&data->block[BLOCK_FILAMENT_LENGTH].data[4], record->filament_length_m);
+
+    // Format markers present on every tag seen so far
+    data->block[16].data[0] = 0x02;
+    data->block[16].data[2] = 0x01;
+    data->block[BLOCK_SIGNATURE_FIRST].data[0] = 0x01;
+
+    // Signature stand-in: pseudo-random but fixed for a given payload, so
+    // re-encoding a record reproduces the same image
+    uint64_t h = bambu_hash_bytes(BAMBU_HASH_SEED, data->block, 16 * (BLOCK_FILAMENT_LENGTH + 1));
+    for(size_t block = BLOCK_SIGNATURE_FIRST + 2; block <= BLOCK_SIGNATURE_LAST; block++) {
+        if(bambu_is_sector_trailer(block)) continue;
+        for(size_t i = 0; i < 16; i += 8) {
+            h = bambu_hash_mix(h + block * 16 + i);
+            memcpy(&data->block[block].data[i], &h, 8);
+        }
+    }
+
+    for(size_t block = 3; block < BAMBU_HOST_NUM_BLOCKS; block += 4) {
+        static const uint8_t access_bits[4] = {0x87, 0x87, 0x87, 0x69};
+        memcpy(&data->block[block].data[6], access_bits, sizeof(access_bits));
+    }
+}
+
+// ============================================================================
+// Output formats
+// ============================================================================
+
+// Write an image as a Flipper "Mifare Classic" .nfc text dump. Trailer
+// keys are written as unknown ("??") like a dump made without the keys.
+static inline bool bambu_nfc_write(FILE* out, const MfClassicData* data) {
+    char uid[3 * 10 + 1] = " ";
+    for(size_t i = 0; i < data->iso14443_3a_data.uid_len; i++) {
+        snprintf(&uid[i * 3], 4, " %02X", data->iso14443_3a_data.uid[i]);
+    }
+    fprintf(
+        out,
+        "Filetype: Flipper NFC device\n"
+        "Version: 4\n"
+        "# Device type can be ISO14443-3A, ISO14443-3B, ISO14443-4A, ISO14443-4B, ISO15693-3, "
+        "FeliCa, NTAG/Ultralight, Mifare Classic, Mifare Plus, Mifare DESFire, SLIX, ST25TB\n"
+        "Device type: Mifare Classic\n"
+        "# UID is common for all formats\n"
+        "UID:%s\n"
+        "# ISO14443-3A specific data\n"
+        "ATQA: %02X %02X\n"
+        "SAK: %02X\n"
+        "# Mifare Classic specific data\n"
+        "Mifare Classic type: 1K\n"
+        "Data format version: 2\n"
+        "# Mifare Classic blocks, '\?\?' means unknown data\n",
+        uid,
+        data->iso14443_3a_data.atqa[0],
+        data->iso14443_3a_data.atqa[1],
+        data->iso14443_3a_data.sak);
+
+    for(size_t block = 0; block < BAMBU_HOST_NUM_BLOCKS; block++) {
+        char line[16 * 3 + 1];
+        bool trailer = bambu_is_sector_trailer(block);
+        for(size_t i = 0; i < 16; i++) {
+            bool unknown_key = trailer && (i < 6 || i >= 10);
+            if(unknown_key) {
+                memcpy(&line[i * 3], " ??", 4);
+            } else {
+                snprintf(&line[i * 3], 4, " %02X", data->block[block].data[i]);
+            }
+        }
+        fprintf(out, "Block %zu:%s\n", block, line);
+    }
+    return !ferror(out);
+}
+
+// Write an image as a raw 1024-byte .bin/.mfd file
+static inline bool bambu_mfd_write(FILE* out, const MfClassicData* data) {
+    for(size_t block = 0; block < BAMBU_HOST_NUM_BLOCKS; block++) {
+        if(fwrite(data->block[block].data, 1, 16, out) != 16) return false;
+    }
+    return true;
+}
+
+// ============================================================================
+// Synthetic records
+// ============================================================================
+
+// Per-material properties, keyed by variant prefix (the Material ID
+// without "GF"). Temperatures follow Bambu's published profiles.
+typedef struct {
+    const char* prefix;          // e.g. "A00"
+    const char* filament_type;   // Block 2
+    const char* detailed_type;   // Block 4
+    uint16_t drying_temp_c;
+    uint16_t drying_hours;
+    uint16_t hotend_min_c;
+    uint16_t hotend_max_c;
+    uint16_t length_per_kg_m;
+} BambuMaterialProfile;
+
+static const BambuMaterialProfile bambu_material_profiles[] = {
+    {"A00", "PLA", "PLA Basic", 55, 8, 190, 230, 330},
+    {"A01", "PLA", "PLA Matte", 55, 8, 190, 230, 315},
+    {"A02", "PLA", "PLA Metal", 55, 8, 190, 230, 290},
+    {"A05", "PLA", "PLA Silk", 55, 8, 190, 230, 330},
+    {"A06", "PLA", "PLA Silk", 55, 8, 190, 230, 330},
+    {"A07", "PLA", "PLA Marble", 55, 8, 190, 230, 310},
+    {"A08", "PLA", "PLA Sparkle", 55, 8, 190, 230, 310},
+    {"A09", "PLA", "PLA Tough", 55, 8, 190, 230, 325},
+    {"A10", "PLA", "PLA Tough+", 55, 8, 190, 230, 325},
+    {"A11", "PLA", "PLA Aero", 55, 8, 220, 260, 660},
+    {"A12", "PLA", "PLA Glow", 55, 8, 190, 230, 300},
+    {"A15", "PLA", "PLA Galaxy", 55, 8, 190, 230, 320},
+    {"A16", "PLA", "PLA Wood", 60, 6, 190, 230, 330},
+    {"A17", "PLA", "PLA Translucent", 55, 8, 190, 230, 330},
+    {"A18", "PLA", "PLA Lite", 55, 8, 190, 230, 330},
+    {"A50", "PLA", "PLA-CF", 55, 8, 210, 240, 310},
+    {"B00", "ABS", "ABS", 80, 8, 240, 270, 400},
+    {"B01", "ASA", "ASA", 80, 8, 240, 270, 390},
+    {"B02", "ASA", "ASA Aero", 80, 8, 240, 280, 780},
+    {"B50", "ABS", "ABS-GF", 80, 8, 240, 270, 360},
+    {"C00", "PC", "PC", 80, 8, 260, 280, 350},
+    {"C01", "PC", "PC FR", 80, 8, 260, 280, 340},
+    {"G01", "PETG", "PETG Translucent", 65, 8, 230, 260, 325},
+    {"G02", "PETG", "PETG HF", 65, 8, 230, 260, 325},
+    {"G50", "PETG", "PETG-CF", 65, 8, 240, 270, 300},
+    {"N04", "PA", "PAHT-CF", 80, 12, 260, 290, 330},
+    {"N08", "PA", "PA6-GF", 80, 12, 260, 290, 310},
+    {"S02", "PLA", "Support For PLA", 55, 8, 190, 230, 330},
+    {"S03", "PA", "Support For PA", 80, 12, 260, 290, 300},
+    {"S04", "PVA", "PVA", 55, 8, 220, 250, 270},
+    {"S05", "PLA", "Support For PLA", 55, 8, 190, 230, 330},
+    {"S06", "ABS", "Support for ABS", 80, 8, 240, 270, 400},
+    {"U02", "TPU", "TPU for AMS", 70, 8, 220, 240, 330},
+};
+#define BAMBU_NUM_MATERIAL_PROFILES (sizeof(bambu_material_profiles) / sizeof(bambu_material_profiles[0]))
+
+// Profile for a variant ID ("A00-R3" -> "A00"), or NULL
+static inline const BambuMaterialProfile* bambu_material_profile(const char* variant_id) {
+    for(size_t i = 0; i < BAMBU_NUM_MATERIAL_PROFILES; i++) {
+        if(strncmp(variant_id, bambu_material_profiles[i].prefix, 3) == 0) {
+            return &bambu_material_profiles[i];
+        }
+    }
+    return NULL;
+}
+
+// Set the variant and everything derived from it: material ID, types,
+// temperatures and the catalog color. Returns false for an unknown prefix.
+static inline bool bambu_record_set_variant(BambuSpoolRecord* record, const char* variant_id) {
+    const BambuMaterialProfile* profile = bambu_material_profile(variant_id);
+    if(profile == NULL) return false;
+    snprintf(record->variant_id, sizeof(record->variant_id), "%s", variant_id);
+    snprintf(record->material_id, sizeof(record->material_id), "GF%.3s", variant_id);
+    snprintf(record->filament_type, sizeof(record->filament_type), "%s", profile->filament_type);
+    snprintf(record->detailed_type, sizeof(record->detailed_type), "%s", profile->detailed_type);
+    record->drying_temp_c = profile->drying_temp_c;
+    record->drying_hours = profile->drying_hours;
+    record->hotend_min_c = profile->hotend_min_c;
+    record->hotend_max_c = profile->hotend_max_c;
+
+    // No RGB in the catalog: derive a stable color per variant
+    uint64_t color = bambu_hash_mix(bambu_hash_bytes(BAMBU_HASH_SEED, variant_id, strlen(variant_id)));
+    record->color_r = (uint8_t)color;
+    record->color_g = (uint8_t)(color >> 8);
+    record->color_b = (uint8_t)(color >> 16);
+    record->color_a = strstr(profile->detailed_type, "Translucent") ? 0x80 : 0xFF;
+    return true;
+}
+
+// Set the spool weight and the matching filament length
+static inline void bambu_record_set_weight(BambuSpoolRecord* record, uint16_t weight_grams) {
+    const BambuMaterialProfile* profile = bambu_material_profile(record->variant_id);
+    uint32_t per_kg = profile ? profile->length_per_kg_m : 330;
+    record->weight_grams = weight_grams;
+    record->filament_length_m = (uint16_t)(per_kg * weight_grams / 1000);
+}
+
+// Deterministic generator (splitmix64): the same (seed, index) always
+// yields the same record, independent of how many records came before.
+static inline uint64_t bambu_rng_next(uint64_t* state) {
+    uint64_t z = (*state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+// Helper: Uniform draw in [0, n)
+static inline uint32_t bambu_rng_below(uint64_t* state, uint32_t n) {
+    return (uint32_t)(((bambu_rng_next(state) >> 32) * n) >> 32);
+}
+
+// Helper: Tag UID of the index-th record. A bijection of index keeps UIDs
+// unique across 2^32 records.
+static inline void bambu_random_uid(uint64_t seed, uint64_t index, BambuSpoolRecord* record) {
+    uint32_t uid = (uint32_t)(index * 0x9E3779B1u) ^ (uint32_t)bambu_hash_mix(seed);
+    record->uid_len = 4;
+    for(size_t i = 0; i < 4; i++) record->uid[i] = (uint8_t)(uid >> (24 - 8 * i));
+}
+
+// Draw the index-th synthetic record of the corpus identified by seed
+static inline void bambu_random_record(uint64_t seed, uint64_t index, BambuSpoolRecord* record) {
+    static const uint16_t weights[] = {1000, 1000, 1000, 1000, 1000, 1000, 750, 500, 250};
+    uint64_t state = bambu_hash_mix(seed ^ bambu_hash_mix(index + 1));
+    memset(record, 0, sizeof(BambuSpoolRecord));
+    bambu_random_uid(seed, index, record);
+
+    // Variant and material from the catalog; colors are fixed per variant
+    const BambuFilamentInfo* info = &bambu_filament_table[bambu_rng_below(&state, BAMBU_FILAMENT_TABLE_SIZE)];
+    bambu_record_set_variant(record, info->variant_id);
+    record->weight_grams = weights[bambu_rng_below(&state, sizeof(weights) / sizeof(weights[0]))];
+    bambu_record_set_weight(record, record->weight_grams);
+    record->diameter_mm_x100 = 175;
+    record->nozzle_diameter_mm_x100 = bambu_rng_below(&state, 4) == 0 ? 40 : 20;
+    record->spool_width_mm_x100 = (uint16_t)(100 + bambu_rng_below(&state, 6500));
+
+    // Production date: 2022-01-01 .. 2025-12-31
+    uint32_t start = (uint32_t)bambu_days_from_civil(2022, 1, 1) * 1440u;
+    uint32_t span = 4u * 365u * 1440u;
+    bambu_date_format(start + bambu_rng_below(&state, span), record->production_date);
+
+    for(size_t i = 0; i < sizeof(record->tray_uid); i += 8) {
+        uint64_t bits = bambu_rng_next(&state);
+        memcpy(&record->tray_uid[i], &bits, 8);
+    }
+}
+
+// Draw the index-th tag of a corpus of two-tag spools: tags 2n and 2n+1
+// carry spool n's payload and tray UID under their own UIDs
+static inline void bambu_random_pair_record(uint64_t seed, uint64_t index, BambuSpoolRecord* record) {
+    bambu_random_record(seed, index / 2, record);
+    bambu_random_uid(seed, index, record);
+}
+
+#endif // BAMBU_ENCODE_H
@@ -0,0 +1,408 @@
+/**
+ * bambu_export - Export decoded spool inventories in columnar form
+ *
+ * Decodes Bambu dumps and writes one columnar file (host/bambu_columnar.h)
+ * with fixed-width numeric columns and dictionary-encoded strings, or
+ * reads such a file back as tab-separated text.
+ *
+ * Usage: bambu_export [--metrics DEST] [--cache FILE | -j N] -o OUT.bspc [PATH...]
+ *        bambu_export -r IN.bspc [COLUMN...]
+ *   -o OUT          Decode dumps (files, directories or "-" for a stdin
+ *                   path list; default "-") into OUT
+ *   -r IN           Print IN as TSV: the listed columns only, or full
+ *                   records
+ *   --metrics DEST  Export ingest metrics (host/bambu_metrics.h) as
+ *                   Prometheus text: a file rewritten every second and at
+ *                   exit, or "unix:PATH" to serve them on a unix socket
+ *                   while exporting
+ *   --cache FILE    Reuse decode results from FILE (host/bambu_cache.h)
+ *                   for dumps that did not change since the last run, and
+ *                   update it
+ *   -j N            Decode on N threads, with dump reads batched through
+ *                   io_uring where available (host/bambu_loader.h); rows
+ *                   are then written in completion order
+ */
+
+#include "bambu_host.h"
+#include "bambu_columnar.h"
+#include "bambu_metrics.h"
+#include "bambu_cache.h"
+#include "bambu_loader.h"
+
+#define METRICS_FILE_INTERVAL_NS 1000000000ULL
+#define MAX_JOBS                 32
+
+typedef struct {
+    BambuColumnarWriter writer;
+    pthread_mutex_t writer_lock;  // Held around writer updates with -j
+    atomic_size_t skipped;
+    atomic_bool failed;
+    BambuMetrics metrics;
+    BambuMetricsShard* shard;
+    const char* metrics_file;
+    uint64_t metrics_written_ns;
+    BambuCache* cache;
+    BambuLoader* loader;
+    BambuAllocStats worker_allocs;  // Summed as loader workers exit
+} ExportContext;
+
+// Metrics shard of a loader worker thread
+static _Thread_local BambuMetricsShard* worker_shard;
+
+// Helper: Add a decoded record to the export; the current stage started
+// at start
+static bool add_record(
+    ExportContext* ctx,
+    BambuMetricsShard* shard,
+    const char* path,
+    const BambuSpoolRecord* record,
+    const BambuFilamentInfo* info,
+    uint64_t start) {
+    bambu_metrics_count(shard, info ? BambuCounterCatalogHits : BambuCounterCatalogMisses);
+    uint64_t now = bambu_metrics_stage(shard, BambuStageOutput, start);
+    pthread_mutex_lock(&ctx->writer_lock);
+    bool added = bambu_columnar_writer_add_info(&ctx->writer, record, 0, info);
+    pthread_mutex_unlock(&ctx->writer_lock);
+    bambu_metrics_stage(shard, BambuStageOther, now);
+    if(!added) {
+        bambu_metrics_count(shard, BambuCounterOutputFailures);
+        fprintf(stderr, "Failed to add %s\n", path);
+        ctx->failed = true;
+        return false;
+    }
+    bambu_metrics_count(shard, BambuCounterRecords);
+    return true;
+}
+
+// Helper: Decode through the cache; the load stage covers the cache
+// lookup and any load and decode it needs
+static bool on_cached_input(ExportContext* ctx, const char* path, uint64_t start) {
+    BambuMetricsShard* shard = ctx->shard;
+    BambuSpoolRecord record;
+    const BambuFilamentInfo* info = NULL;
+    BambuCacheStatus status = bambu_cache_decode_file(ctx->cache, path, &record, &info);
+    if(status != BambuCacheDecoded) bambu_metrics_stage(shard, BambuStageOther, start);
+    switch(status) {
+    case BambuCacheDecoded:
+        return add_record(ctx, shard, path, &record, info, start);
+    case BambuCacheNotBambu:
+        bambu_metrics_count(shard, BambuCounterRejected);
+        break;
+    case BambuCacheNotDump:
+        fprintf(stderr, "Not a Mifare Classic dump: %s\n", path);
+        bambu_metrics_count(shard, BambuCounterLoadFailures);
+        break;
+    case BambuCacheUnreadable:
+        fprintf(stderr, "Failed to open: %s\n", path);
+        bambu_metrics_count(shard, BambuCounterLoadFailures);
+        break;
+    }
+    ctx->skipped++;
+    return true;
+}
+
+// Helper: Validate, decode, look up and write one loaded dump (data is
+// NULL if it failed to load); the load stage started at start. Every
+// bambu_metrics_stage() call times the stage it leaves.
+static bool export_dump(
+    ExportContext* ctx,
+    BambuMetricsShard* shard,
+    const char* path,
+    const MfClassicData* data,
+    uint64_t start) {
+    if(!data) {
+        bambu_metrics_stage(shard, BambuStageOther, start);
+        bambu_metrics_count(shard, BambuCounterLoadFailures);
+        ctx->skipped++;
+        return true;
+    }
+
+    uint64_t now = bambu_metrics_stage(shard, BambuStageValidate, start);
+    bool valid = bambu_tag_is_valid(data);
+    now = bambu_metrics_stage(shard, BambuStageDecode, now);
+    if(!valid) {
+        bambu_metrics_count(shard, BambuCounterRejected);
+        ctx->skipped++;
+        return true;
+    }
+
+    BambuSpoolRecord record;
+    bool decoded = bambu_decode(data, &record);
+    now = bambu_metrics_stage(shard, BambuStageLookup, now);
+    if(!decoded) {
+        bambu_metrics_count(shard, BambuCounterDecodeFailures);
+        ctx->skipped++;
+        return true;
+    }
+
+    const BambuFilamentInfo* info = bambu_lookup_filament(record.variant_id);
+    return add_record(ctx, shard, path, &record, info, now);
+}
+
+// Helper: Load, validate, decode, look up and write one input, or hand
+// it to the loader
+static bool export_input(ExportContext* ctx, const char* path) {
+    BambuMetricsShard* shard = ctx->shard;
+
+    bambu_metrics_count(shard, BambuCounterInputs);
+    uint64_t start = bambu_metrics_now_ns();
+    if(ctx->metrics_file && start - ctx->metrics_written_ns >= METRICS_FILE_INTERVAL_NS) {
+        bambu_metrics_write_file(&ctx->metrics, ctx->metrics_file);
+        ctx->metrics_written_ns = start = bambu_metrics_now_ns();
+    }
+    if(ctx->loader) {
+        bambu_loader_add(ctx->loader, path);
+        return !ctx->failed;
+    }
+
+    bambu_alloc_stage(BambuStageLoad);
+    if(ctx->cache) return on_cached_input(ctx, path, start);
+
+    MfClassicData data;
+    bool loaded = bambu_nfc_load(path, &data);
+    return export_dump(ctx, shard, path, loaded ? &data : NULL, start);
+}
+
+static bool on_input(const char* path, void* context) {
+    bool ok = export_input(context, path);
+    bambu_alloc_stage(BambuStageOther);
+    return ok;
+}
+
+// Loader worker: the load stage covers parsing the buffer; reading it
+// overlapped with other work
+static void on_loaded(const char* path, const char* buf, size_t len, int error, void* context) {
+    ExportContext* ctx = context;
+    if(!worker_shard) worker_shard = bambu_metrics_shard(&ctx->metrics);
+    uint64_t start = bambu_metrics_now_ns();
+    bambu_alloc_stage(BambuStageLoad);
+    MfClassicData data;
+    bool loaded = false;
+    if(error) {
+        fprintf(stderr, "Failed to open: %s\n", path);
+    } else if(!(loaded = bambu_dump_parse(buf, len, &data))) {
+        fprintf(stderr, "Not a Mifare Classic dump: %s\n", path);
+    }
+    export_dump(ctx, worker_shard, path, loaded ? &data : NULL, start);
+    bambu_alloc_stage(BambuStageOther);
+}
+
+static void on_worker_exit(void* context) {
+    ExportContext* ctx = context;
+    const BambuAllocStats* stats = bambu_alloc_stats();
+    pthread_mutex_lock(&ctx->writer_lock);
+    for(size_t stage = 0; stage < BambuStageCount; stage++) {
+        BambuAllocCounters* sum = &ctx->worker_allocs.stages[stage];
+        sum->allocs += stats->stages[stage].allocs;
+        sum->frees += stats->stages[stage].frees;
+        sum->bytes += stats->stages[stage].bytes;
+        sum->system += stats->stages[stage].system;
+    }
+    pthread_mutex_unlock(&ctx->writer_lock);
+}
+
+// Helper: Allocations per stage (host/bambu_alloc.h) of this thread and
+// the loader workers on stderr
+static void print_allocations(const BambuAllocStats* workers) {
+    const BambuAllocStats* stats = bambu_alloc_stats();
+    uint64_t system = 0;
+    fprintf(stderr, "Allocations:");
+    for(size_t stage = 0; stage < BambuStageCount; stage++) {
+        fprintf(
+            stderr,
+            "%s %s %llu",
+            stage ? "," : "",
+            BAMBU_STAGE_NAMES[stage],
+            (unsigned long long)(stats->stages[stage].allocs + workers->stages[stage].allocs));
+        system += stats->stages[stage].system + workers->stages[stage].system;
+    }
+    fprintf(stderr, " (%llu reached malloc)\n", (unsigned long long)system);
+}
+
+static int export_dumps(
+    const char* metrics_dest,
+    const char* cache_path,
+    uint32_t jobs,
+    const char* out_path,
+    char* const* inputs,
+    int count) {
+    static char* const stdin_input[] = {"-"};
+
+    ExportContext ctx = {0};
+    pthread_mutex_init(&ctx.writer_lock, NULL);
+    if(!bambu_columnar_writer_init(&ctx.writer) || !bambu_metrics_init(&ctx.metrics, "bambu_export")) {
+        fprintf(stderr, "Out of memory\n");
+        bambu_columnar_writer_free(&ctx.writer);
+        return 1;
+    }
+    ctx.shard = bambu_metrics_shard(&ctx.metrics);
+    if(metrics_dest && strncmp(metrics_dest, "unix:", 5) == 0) {
+        if(!bambu_metrics_serve(&ctx.metrics, metrics_dest + 5)) {
+            perror(metrics_dest + 5);
+            bambu_metrics_free(&ctx.metrics);
+            bambu_columnar_writer_free(&ctx.writer);
+            return 1;
+        }
+    } else {
+        ctx.metrics_file = metrics_dest;
+    }
+    BambuCache cache;
+    if(cache_path) {
+        if(!bambu_cache_open(&cache, cache_path)) {
+            fprintf(stderr, "Out of memory\n");
+            bambu_metrics_free(&ctx.metrics);
+            bambu_columnar_writer_free(&ctx.writer);
+            return 1;
+        }
+        ctx.cache = &cache;
+    }
+    BambuLoader loader;
+    if(jobs > 0) {
+        BambuLoaderConfig config = {
+            .workers = jobs,
+            .on_dump = on_loaded,
+            .on_worker_exit = on_worker_exit,
+            .context = &ctx,
+        };
+        if(!bambu_loader_start(&loader, &config)) {
+            fprintf(stderr, "Failed to start the loader\n");
+            bambu_metrics_free(&ctx.metrics);
+            bambu_columnar_writer_free(&ctx.writer);
+            return 1;
+        }
+        ctx.loader = &loader;
+    }
+
+    if(count > 0) {
+        bambu_host_for_each_input(inputs, count, on_input, &ctx);
+    } else {
+        bambu_host_for_each_input(stdin_input, 1, on_input, &ctx);
+    }
+    if(ctx.loader) {
+        bambu_loader_finish(&loader);
+        fprintf(
+            stderr,
+            "Loader: %llu files, %llu bytes via %s\n",
+            (unsigned long long)loader.files,
+            (unsigned long long)loader.bytes,
+            BAMBU_LOADER_BACKEND_NAMES[loader.backend]);
+        if(loader.uring_error) {
+            fprintf(stderr, "io_uring failed (%s); finished with blocking reads\n", strerror(loader.uring_error));
+        }
+    }
+
+    int status = 0;
+    if(ctx.failed || !bambu_columnar_writer_save(&ctx.writer, out_path)) {
+        fprintf(stderr, "Failed to write %s\n", out_path);
+        status = 1;
+    } else {
+        fprintf(stderr, "%u records written, %zu inputs skipped\n", ctx.writer.rows, (size_t)ctx.skipped);
+        print_allocations(&ctx.worker_allocs);
+    }
+    if(ctx.cache) {
+        fprintf(
+            stderr,
+            "Cache: %zu unchanged, %zu known contents, %zu decoded, %zu re-resolved after a catalog change\n",
+            cache.stat_hits,
+            cache.content_hits,
+            cache.misses,
+            cache.reresolved);
+        if(!bambu_cache_save(&cache, cache_path)) {
+            perror(cache_path);
+            status = 1;
+        }
+        bambu_cache_free(&cache);
+    }
+    if(ctx.metrics_file && !bambu_metrics_write_file(&ctx.metrics, ctx.metrics_file)) {
+        perror(ctx.metrics_file);
+        status = 1;
+    }
+    bambu_metrics_free(&ctx.metrics);
+    bambu_columnar_writer_free(&ctx.writer);
+    pthread_mutex_destroy(&ctx.writer_lock);
+    return status;
+}
+
+static int print_columns(const char* in_path, char* const* names, int count) {
+    BambuColumnarReader reader;
+    if(!bambu_columnar_open(&reader, in_path)) {
+        fprintf(stderr, "Not a readable columnar file: %s\n", in_path);
+        return 1;
+    }
+
+    if(count == 0) {
+        printf(BAMBU_TSV_HEADER);
+        for(uint32_t row = 0; row < reader.rows; row++) {
+            BambuSpoolRecord record;
+            uint32_t scan_time;
+            bambu_columnar_get_record(&reader, row, &record, &scan_time);
+            bambu_record_print_tsv(stdout, &record, scan_time);
+        }
+        bambu_columnar_close(&reader);
+        return 0;
+    }
+
+    // Projection: only the requested columns' pages are touched
+    const BambuColumn* columns[BAMBU_COLUMNAR_MAX_COLUMNS];
+    if(count > BAMBU_COLUMNAR_MAX_COLUMNS) count = BAMBU_COLUMNAR_MAX_COLUMNS;
+    for(int i = 0; i < count; i++) {
+        columns[i] = bambu_columnar_find(&reader, names[i]);
+        if(!columns[i]) {
+            fprintf(stderr, "No such column: %s\n", names[i]);
+            bambu_columnar_close(&reader);
+            return 1;
+        }
+        printf("%s%s", i ? "\t" : "", names[i]);
+    }
+    printf("\n");
+
+    for(uint32_t row = 0; row < reader.rows; row++) {
+        for(int i = 0; i < count; i++) {
+            const BambuColumn* column = columns[i];
+            if(i) putchar('\t');
+            if(column->type == BambuColumnTypeDict) {
+                fputs(bambu_column_string(column, row), stdout);
+            } else if(column->type == BambuColumnTypeUint) {
+                printf("%u", bambu_column_uint(column, row));
+            } else {
+                for(uint8_t b = 0; b < column->width; b++) {
+                    printf("%02X", column->data[(size_t)row * column->width + b]);
+                }
+            }
+        }
+        putchar('\n');
+    }
+    bambu_columnar_close(&reader);
+    return 0;
+}
+
+int main(int argc, char* argv[]) {
+    const char* metrics_dest = NULL;
+    const char* cache_path = NULL;
+    uint32_t jobs = 0;
+    bool usage = false;
+    while(argc >= 3 && (strcmp(argv[1], "--metrics") == 0 || strcmp(argv[1], "--cache") == 0 ||
+                        strcmp(argv[1], "-j") == 0)) {
+        if(strcmp(argv[1], "--metrics") == 0) {
+            metrics_dest = argv[2];
+        } else if(strcmp(argv[1], "--cache") == 0) {
+            cache_path = argv[2];
+        } else {
+            jobs = (uint32_t)strtoul(argv[2], NULL, 10);
+            usage = usage || jobs == 0 || jobs > MAX_JOBS;
+        }
+        argv += 2;
+        argc -= 2;
+    }
+    // The cache is not thread-safe and reads the dumps itself
+    usage = usage || (jobs > 0 && cache_path);
+    if(!usage && argc >= 3 && strcmp(argv[1], "-o") == 0) {
+        return export_dumps(metrics_dest, cache_path, jobs, argv[2], &argv[3], argc - 3);
+    }
+    if(argc >= 3 && strcmp(argv[1], "-r") == 0) {
+        return print_columns(argv[2], &argv[3], argc - 3);
+    }
+    fprintf(stderr, "Usage: bambu_export [--metrics FILE|unix:PATH] [--cache FILE | -j N] -o OUT.bspc [PATH...]\n");
+    fprintf(stderr, "       bambu_export -r IN.bspc [COLUMN...]\n");
+    return 1;
+}
@@ -0,0 +1,164 @@
+/**
+ * bambu_gen - Generate synthetic Bambu spool dumps
+ *
+ * Writes COUNT deterministic dumps (host/bambu_encode.h) for load and
+ * scale testing. Dump i of a corpus depends only on (SEED, i), so a range
+ * of a large corpus can be regenerated with --start.
+ *
+ * Usage: bambu_gen [OPTION...] -o DIR
+ *        bambu_gen [OPTION...] -o -
+ *   -o DIR          Output directory; dumps go to DIR/NNNN/ in shards of
+ *                   1000 files. "-" writes a single dump to stdout.
+ *   -n COUNT        Number of dumps (default 1)
+ *   -s SEED         Corpus seed (default 1)
+ *   --start N       Index of the first dump (default 0)
+ *   -f nfc|bin      Flipper .nfc text (default) or raw 1024-byte image
+ *   --variant ID    Fix the variant (e.g. A00-R3); material, types and
+ *                   temperatures follow it
+ *   --weight G      Fix the spool weight in grams
+ *   --date DATE     Fix the production date (YYYY_MM_DD_HH_MM)
+ *   --pairs         Two tags per spool, as on real spools: dumps 2n and
+ *                   2n+1 share spool n's payload and tray UID
+ */
+
+#include "bambu_host.h"
+#include "bambu_encode.h"
+
+#include <errno.h>
+
+#define GEN_SHARD_SIZE 1000
+
+typedef struct {
+    bool pairs;
+    const char* variant_id;
+    long weight_grams;
+    const char* production_date;
+} GenOverrides;
+
+static bool make_dir(const char* path) {
+    return mkdir(path, 0777) == 0 || errno == EEXIST;
+}
+
+static bool write_dump(FILE* out, const MfClassicData* data, bool binary) {
+    return binary ? bambu_mfd_write(out, data) : bambu_nfc_write(out, data);
+}
+
+static void build_record(uint64_t seed, uint64_t index, const GenOverrides* overrides, BambuSpoolRecord* record) {
+    if(overrides->pairs) {
+        bambu_random_pair_record(seed, index, record);
+    } else {
+        bambu_random_record(seed, index, record);
+    }
+    if(overrides->variant_id) {
+        bambu_record_set_variant(record, overrides->variant_id);
+        bambu_record_set_weight(record, record->weight_grams);
+    }
+    if(overrides->weight_grams >= 0) {
+        bambu_record_set_weight(record, (uint16_t)overrides->weight_grams);
+    }
+    if(overrides->production_date) {
+        snprintf(record->production_date, sizeof(record->production_date), "%s", overrides->production_date);
+    }
+}
+
+static int usage(void) {
+    fprintf(stderr, "Usage: bambu_gen [-n COUNT] [-s SEED] [--start N] [-f nfc|bin]\n");
+    fprintf(stderr, "                 [--variant ID] [--weight G] [--date DATE] [--pairs] -o DIR|-\n");
+    return 1;
+}
+
+int main(int argc, char* argv[]) {
+    const char* out_dir = NULL;
+    uint64_t count = 1;
+    uint64_t seed = 1;
+    uint64_t start = 0;
+    bool binary = false;
+    GenOverrides overrides = {false, NULL, -1, NULL};
+
+    for(int i = 1; i < argc; i++) {
+        const char* opt = argv[i];
+        if(strcmp(opt, "--pairs") == 0) {
+            overrides.pairs = true;
+            continue;
+        }
+        if(i + 1 >= argc) return usage();
+        const char* arg = argv[++i];
+
+        if(strcmp(opt, "-o") == 0) {
+            out_dir = arg;
+        } else if(strcmp(opt, "-n") == 0) {
+            count = strtoull(arg, NULL, 10);
+        } else if(strcmp(opt, "-s") == 0) {
+            seed = strtoull(arg, NULL, 0);
+        } else if(strcmp(opt, "--start") == 0) {
+            start = strtoull(arg, NULL, 10);
+        } else if(strcmp(opt, "-f") == 0) {
+            if(strcmp(arg, "bin") == 0) {
+                binary = true;
+            } else if(strcmp(arg, "nfc") != 0) {
+                return usage();
+            }
+        } else if(strcmp(opt, "--variant") == 0) {
+            if(bambu_material_profile(arg) == NULL) {
+                fprintf(stderr, "Unknown variant prefix: %s\n", arg);
+                return 1;
+            }
+            overrides.variant_id = arg;
+        } else if(strcmp(opt, "--weight") == 0) {
+            overrides.weight_grams = atol(arg);
+            if(overrides.weight_grams < 0 || overrides.weight_grams > UINT16_MAX) return usage();
+        } else if(strcmp(opt, "--date") == 0) {
+            uint32_t minutes;
+            if(!bambu_date_parse(arg, &minutes)) return usage();
+            overrides.production_date = arg;
+        } else {
+            return usage();
+        }
+    }
+    if(!out_dir) return usage();
+
+    MfClassicData data;
+    BambuSpoolRecord record;
+
+    if(strcmp(out_dir, "-") == 0) {
+        build_record(seed, start, &overrides, &record);
+        bambu_encode(&record, &data);
+        return write_dump(stdout, &data, binary) ? 0 : 1;
+    }
+
+    if(!make_dir(out_dir)) {
+        fprintf(stderr, "Failed to create %s: %s\n", out_dir, strerror(errno));
+        return 1;
+    }
+
+    const char* suffix = binary ? "bin" : "nfc";
+    for(uint64_t index = start; index < start + count; index++) {
+        char path[4096];
+        snprintf(path, sizeof(path), "%s/%04llu", out_dir, (unsigned long long)(index / GEN_SHARD_SIZE));
+        if(index == start || index % GEN_SHARD_SIZE == 0) {
+            if(!make_dir(path)) {
+                fprintf(stderr, "Failed to create %s: %s\n", path, strerror(errno));
+                return 1;
+            }
+        }
+
+        build_record(seed, index, &overrides, &record);
+        bambu_encode(&record, &data);
+
+        char uid_hex[21];
+        bambu_uid_to_hex(record.uid, record.uid_len, uid_hex);
+        size_t dir_len = strlen(path);
+        snprintf(&path[dir_len], sizeof(path) - dir_len, "/bambu_%s.%s", uid_hex, suffix);
+
+        FILE* out = fopen(path, binary ? "wb" : "w");
+        bool ok = out != NULL && write_dump(out, &data, binary);
+        if(out != NULL && fclose(out) != 0) ok = false;
+        if(!ok) {
+            fprintf(stderr, "Failed to write %s\n", path);
+            return 1;
+        }
+    }
+
+    fprintf(stderr, "%llu dumps written to %s\n", (unsigned long long)count, out_dir);
+    return 0;
+}
@@ -0,0 +1,187 @@
+// Bambu Lab NFC Parser - Hashing and Hash Index
+// 64-bit content hashing and an open-addressing hash index mapping 64-bit
+// keys to 32-bit values (typically an index into a caller-owned array).
+// Keys are treated as unique: two inputs with the same 64-bit hash are
+// considered equal, which at archive scale (1e5-1e7 dumps) is a
+// collision probability well below 1e-5. Tables allocate through the
+// allocator current when they are created (bambu_alloc.h).
+
+#ifndef BAMBU_HASH_H
+#define BAMBU_HASH_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bambu_alloc.h"
+
+#define BAMBU_HASH_SEED 0xCBF29CE484222325ULL  // FNV-1a 64-bit offset basis
+
+// FNV-1a 64-bit, chainable via the h argument (start with BAMBU_HASH_SEED)
+static inline uint64_t bambu_hash_bytes(uint64_t h, const void* data, size_t len) {
+    const uint8_t* bytes = data;
+    for(size_t i = 0; i < len; i++) {
+        h ^= bytes[i];
+        h *= 0x100000001B3ULL;
+    }
+    return h;
+}
+
+// Finalizer (splitmix64): spreads FNV output across all bits so the low
+// bits can be used directly as a table slot
+static inline uint64_t bambu_hash_mix(uint64_t h) {
+    h ^= h >> 30;
+    h *= 0xBF58476D1CE4E5B9ULL;
+    h ^= h >> 27;
+    h *= 0x94D049BB133111EBULL;
+    h ^= h >> 31;
+    return h;
+}
+
+#define BAMBU_HASH_INDEX_EMPTY UINT32_MAX
+
+typedef struct {
+    uint64_t key;
+    uint32_t value;  // BAMBU_HASH_INDEX_EMPTY marks a free slot
+} BambuHashSlot;
+
+typedef struct {
+    BambuHashSlot* slots;
+    size_t capacity;  // Always a power of two
+    size_t count;
+    const BambuAllocator* allocator;
+} BambuHashIndex;
+
+// Helper: Allocate an empty table with room for expected keys
+static inline bool bambu_hash_index_alloc(
+    BambuHashIndex* index,
+    const BambuAllocator* allocator,
+    size_t expected) {
+    size_t capacity = 16;
+    while(capacity < expected * 2) capacity <<= 1;
+    index->slots = bambu_mem_alloc(allocator, capacity * sizeof(BambuHashSlot));
+    if(!index->slots) return false;
+    for(size_t i = 0; i < capacity; i++) index->slots[i].value = BAMBU_HASH_INDEX_EMPTY;
+    index->capacity = capacity;
+    index->count = 0;
+    index->allocator = allocator;
+    return true;
+}
+
+static inline bool bambu_hash_index_init(BambuHashIndex* index, size_t expected) {
+    return bambu_hash_index_alloc(index, bambu_allocator(), expected);
+}
+
+static inline void bambu_hash_index_free(BambuHashIndex* index) {
+    bambu_mem_free(index->allocator, index->slots, index->capacity * sizeof(BambuHashSlot));
+    memset(index, 0, sizeof(BambuHashIndex));
+}
+
+// Helper: Find the slot holding key, or the free slot where it would go
+static inline BambuHashSlot* bambu_hash_index_slot(const BambuHashIndex* index, uint64_t key) {
+    size_t mask = index->capacity - 1;
+    size_t i = (size_t)bambu_hash_mix(key) & mask;
+    while(index->slots[i].value != BAMBU_HASH_INDEX_EMPTY && index->slots[i].key != key) {
+        i = (i + 1) & mask;
+    }
+    return &index->slots[i];
+}
+
+// Returns the value stored for key, or BAMBU_HASH_INDEX_EMPTY
+static inline uint32_t bambu_hash_index_get(const BambuHashIndex* index, uint64_t key) {
+    return bambu_hash_index_slot(index, key)->value;
+}
+
+// Helper: Double the table when it passes 70% load
+static inline bool bambu_hash_index_grow(BambuHashIndex* index) {
+    BambuHashIndex bigger;
+    if(!bambu_hash_index_alloc(&bigger, index->allocator, index->capacity)) return false;
+    for(size_t i = 0; i < index->capacity; i++) {
+        if(index->slots[i].value == BAMBU_HASH_INDEX_EMPTY) continue;
+        *bambu_hash_index_slot(&bigger, index->slots[i].key) = index->slots[i];
+    }
+    bigger.count = index->count;
+    bambu_hash_index_free(index);
+    *index = bigger;
+    return true;
+}
+
+// Insert key -> value unless key is already present.
+// Returns the value now stored for key (the existing one if present), or
+// BAMBU_HASH_INDEX_EMPTY if the table could not grow.
+static inline uint32_t bambu_hash_index_put(BambuHashIndex* index, uint64_t key, uint32_t value) {
+    if((index->count + 1) * 10 > index->capacity * 7 && !bambu_hash_index_grow(index)) {
+        return BAMBU_HASH_INDEX_EMPTY;
+    }
+    BambuHashSlot* slot = bambu_hash_index_slot(index, key);
+    if(slot->value == BAMBU_HASH_INDEX_EMPTY) {
+        slot->key = key;
+        slot->value = value;
+        index->count++;
+    }
+    return slot->value;
+}
+
+// ============================================================================
+// String dictionary: interns strings as dense codes 0, 1, 2, ...
+// ============================================================================
+
+typedef struct {
+    char** strings;  // Indexed by code
+    size_t count;
+    size_t capacity;
+    BambuHashIndex index;  // String hash -> code
+} BambuStringDict;
+
+static inline bool bambu_string_dict_init(BambuStringDict* dict) {
+    memset(dict, 0, sizeof(BambuStringDict));
+    return bambu_hash_index_init(&dict->index, 64);
+}
+
+static inline void bambu_string_dict_free(BambuStringDict* dict) {
+    const BambuAllocator* allocator = dict->index.allocator;
+    for(size_t i = 0; i < dict->count; i++) {
+        bambu_mem_free(allocator, dict->strings[i], strlen(dict->strings[i]) + 1);
+    }
+    if(dict->strings) bambu_mem_free(allocator, dict->strings, dict->capacity * sizeof(char*));
+    if(dict->index.slots) bambu_hash_index_free(&dict->index);
+    memset(dict, 0, sizeof(BambuStringDict));
+}
+
+// Code of an already interned string, or -1
+static inline int32_t bambu_string_dict_find(const BambuStringDict* dict, const char* str) {
+    uint64_t key = bambu_hash_bytes(BAMBU_HASH_SEED, str, strlen(str));
+    uint32_t code = bambu_hash_index_get(&dict->index, key);
+    return code == BAMBU_HASH_INDEX_EMPTY ? -1 : (int32_t)code;
+}
+
+// Code for a string, adding it to the dictionary if new. Codes fit in
+// uint16; returns -1 if the dictionary is full or out of memory.
+static inline int32_t bambu_string_dict_code(BambuStringDict* dict, const char* str) {
+    int32_t existing = bambu_string_dict_find(dict, str);
+    if(existing >= 0) return existing;
+    if(dict->count > UINT16_MAX) return -1;
+
+    if(dict->count == dict->capacity) {
+        size_t capacity = dict->capacity ? dict->capacity * 2 : 64;
+        char** grown = bambu_mem_resize(
+            dict->index.allocator, dict->strings, dict->capacity * sizeof(char*), capacity * sizeof(char*));
+        if(!grown) return -1;
+        dict->strings = grown;
+        dict->capacity = capacity;
+    }
+    char* copy = bambu_mem_strdup(dict->index.allocator, str);
+    if(!copy) return -1;
+    uint32_t code = (uint32_t)dict->count;
+    uint64_t key = bambu_hash_bytes(BAMBU_HASH_SEED, str, strlen(str));
+    if(bambu_hash_index_put(&dict->index, key, code) != code) {
+        bambu_mem_free(dict->index.allocator, copy, strlen(copy) + 1);
+        return -1;
+    }
+    dict->strings[dict->count++] = copy;
+    return (int32_t)code;
+}
+
+#endif // BAMBU_HASH_H
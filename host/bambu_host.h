@@ -0,0 +1,468 @@
+// Bambu Lab NFC Parser - Host Support
+// Mock Flipper Zero types and .nfc dump loading for the host-side tools
+// in this directory. Include this instead of the plugin headers directly;
+// it defines the Flipper types the shared parser expects and then pulls in
+// plugin/bambu_parser.h and plugin/bambu_filaments.h.
+
+#ifndef BAMBU_HOST_H
+#define BAMBU_HOST_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "bambu_alloc.h"
+
+// ============================================================================
+// Mock Flipper Zero types (subset of nfc/protocols/mf_classic/mf_classic.h)
+// ============================================================================
+
+typedef enum {
+    MfClassicTypeMini,
+    MfClassicType1k,
+    MfClassicType4k,
+} MfClassicType;
+
+typedef struct {
+    uint8_t data[16];
+} MfClassicBlock;
+
+typedef struct {
+    uint8_t uid[10];
+    uint8_t uid_len;
+    uint8_t atqa[2];
+    uint8_t sak;
+} Iso14443_3aData;
+
+#define BAMBU_HOST_NUM_BLOCKS 64  // Mifare Classic 1K
+
+typedef struct {
+    Iso14443_3aData iso14443_3a_data;
+    MfClassicType type;
+    MfClassicBlock block[BAMBU_HOST_NUM_BLOCKS];
+} MfClassicData;
+
+static inline const uint8_t* mf_classic_get_uid(const MfClassicData* data, size_t* uid_len) {
+    *uid_len = data->iso14443_3a_data.uid_len;
+    return data->iso14443_3a_data.uid;
+}
+
+#include "../plugin/bambu_parser.h"
+#include "../plugin/bambu_filaments.h"
+
+// ============================================================================
+// .nfc dump loading
+// ============================================================================
+
+// Helper: Parse two hex digits, returns -1 for anything else (including "??")
+static inline int bambu_host_hex_byte(const char* str) {
+    int result = 0;
+    for(int i = 0; i < 2; i++) {
+        char c = str[i];
+        result <<= 4;
+        if(c >= '0' && c <= '9') {
+            result |= c - '0';
+        } else if(c >= 'A' && c <= 'F') {
+            result |= c - 'A' + 10;
+        } else if(c >= 'a' && c <= 'f') {
+            result |= c - 'a' + 10;
+        } else {
+            return -1;
+        }
+    }
+    return result;
+}
+
+// Helper: Parse up to max space-separated hex bytes, unknown bytes stay 0
+// Returns the number of byte positions consumed
+static inline size_t bambu_host_parse_hex_bytes(
+    const char* str,
+    const char* end,
+    uint8_t* out,
+    size_t max) {
+    size_t count = 0;
+    while(count < max) {
+        while(str < end && *str == ' ') str++;
+        if(end - str < 2) break;
+        int byte = bambu_host_hex_byte(str);
+        if(byte >= 0) {
+            out[count] = (uint8_t)byte;
+        } else if(str[0] != '?') {
+            break;
+        }
+        count++;
+        str += 2;
+    }
+    return count;
+}
+
+// Parse a Flipper "Mifare Classic" .nfc text dump held in memory
+// Returns false if no Mifare Classic type line was found
+static inline bool bambu_nfc_parse(const char* text, size_t len, MfClassicData* data) {
+    memset(data, 0, sizeof(MfClassicData));
+    data->type = MfClassicType1k;
+
+    bool found_type = false;
+    const char* end = text + len;
+    const char* line = text;
+    while(line < end) {
+        const char* eol = memchr(line, '\n', (size_t)(end - line));
+        if(!eol) eol = end;
+        size_t line_len = (size_t)(eol - line);
+
+        if(line_len >= 5 && strncmp(line, "UID: ", 5) == 0) {
+            data->iso14443_3a_data.uid_len = (uint8_t)bambu_host_parse_hex_bytes(
+                line + 5, eol, data->iso14443_3a_data.uid, sizeof(data->iso14443_3a_data.uid));
+        } else if(line_len >= 6 && strncmp(line, "ATQA: ", 6) == 0) {
+            bambu_host_parse_hex_bytes(line + 6, eol, data->iso14443_3a_data.atqa, 2);
+        } else if(line_len >= 5 && strncmp(line, "SAK: ", 5) == 0) {
+            bambu_host_parse_hex_bytes(line + 5, eol, &data->iso14443_3a_data.sak, 1);
+        } else if(line_len >= 23 && strncmp(line, "Mifare Classic type: ", 21) == 0) {
+            if(strncmp(line + 21, "1K", 2) == 0) {
+                data->type = MfClassicType1k;
+                found_type = true;
+            } else if(strncmp(line + 21, "4K", 2) == 0) {
+                data->type = MfClassicType4k;
+                found_type = true;
+            } else if(strncmp(line + 21, "MI", 2) == 0) {
+                data->type = MfClassicTypeMini;
+                found_type = true;
+            }
+        } else if(line_len > 6 && strncmp(line, "Block ", 6) == 0) {
+            // "Block N: XX XX XX ..."
+            char* colon = NULL;
+            long block_num = strtol(line + 6, &colon, 10);
+            if(colon && colon < eol && *colon == ':' && block_num >= 0 &&
+               block_num < BAMBU_HOST_NUM_BLOCKS) {
+                bambu_host_parse_hex_bytes(colon + 1, eol, data->block[block_num].data, 16);
+            }
+        }
+
+        line = eol + 1;
+    }
+
+    return found_type;
+}
+
+#define BAMBU_MFD_1K_SIZE (BAMBU_HOST_NUM_BLOCKS * 16)
+
+// Parse a raw 1K card image (.bin/.mfd: 64 blocks of 16 bytes, as written
+// by proxmark3, libnfc and bambu_gen). The UID, SAK and ATQA are taken
+// from the manufacturer block, so only 4-byte UIDs are supported.
+static inline bool bambu_mfd_parse(const uint8_t* image, size_t len, MfClassicData* data) {
+    if(len != BAMBU_MFD_1K_SIZE) return false;
+    memset(data, 0, sizeof(MfClassicData));
+    data->type = MfClassicType1k;
+    for(size_t i = 0; i < BAMBU_HOST_NUM_BLOCKS; i++) {
+        memcpy(data->block[i].data, &image[i * 16], 16);
+    }
+    memcpy(data->iso14443_3a_data.uid, image, 4);
+    data->iso14443_3a_data.uid_len = 4;
+    data->iso14443_3a_data.sak = image[5];
+    data->iso14443_3a_data.atqa[0] = image[7];
+    data->iso14443_3a_data.atqa[1] = image[6];
+    return true;
+}
+
+// Flipper dumps of a 1K card are ~4KB; 16KB leaves room for comments
+#define BAMBU_DUMP_MAX_SIZE 16384
+
+// Parse a dump file's contents: a raw 1K image or a .nfc text dump
+static inline bool bambu_dump_parse(const char* buf, size_t len, MfClassicData* data) {
+    if(len == BAMBU_MFD_1K_SIZE && memcmp(buf, "Filetype:", 9) != 0) {
+        return bambu_mfd_parse((const uint8_t*)buf, len, data);
+    }
+    return bambu_nfc_parse(buf, len, data);
+}
+
+// Read up to BAMBU_DUMP_MAX_SIZE bytes of a dump file into buf.
+// Returns false if the file cannot be opened or read. Uses plain file
+// descriptors: unlike fopen(), nothing is allocated per dump.
+static inline bool bambu_dump_read(const char* path, char* buf, size_t* len) {
+    int fd = open(path, O_RDONLY);
+    if(fd < 0) return false;
+    *len = 0;
+    ssize_t n;
+    while(*len < BAMBU_DUMP_MAX_SIZE && (n = read(fd, buf + *len, BAMBU_DUMP_MAX_SIZE - *len)) != 0) {
+        if(n < 0) {
+            close(fd);
+            return false;
+        }
+        *len += (size_t)n;
+    }
+    close(fd);
+    return true;
+}
+
+// Load a .nfc text dump or a raw 1K image. Errors are reported on stderr.
+static inline bool bambu_nfc_load(const char* path, MfClassicData* data) {
+    char buf[BAMBU_DUMP_MAX_SIZE];
+    size_t len;
+    if(!bambu_dump_read(path, buf, &len)) {
+        fprintf(stderr, "Failed to open: %s\n", path);
+        return false;
+    }
+    if(!bambu_dump_parse(buf, len, data)) {
+        fprintf(stderr, "Not a Mifare Classic dump: %s\n", path);
+        return false;
+    }
+    return true;
+}
+
+// ============================================================================
+// Production dates
+// ============================================================================
+
+// Helper: Days since 1970-01-01 for a proleptic Gregorian date
+static inline int32_t bambu_days_from_civil(int32_t year, uint32_t month, uint32_t day) {
+    year -= month <= 2;
+    int32_t era = (year >= 0 ? year : year - 399) / 400;
+    uint32_t yoe = (uint32_t)(year - era * 400);
+    uint32_t doy = (153 * (month > 2 ? month - 3 : month + 9) + 2) / 5 + day - 1;
+    uint32_t doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + (int32_t)doe - 719468;
+}
+
+// Parse a block 12 "YYYY_MM_DD_HH_MM" date into minutes since 1970-01-01
+// (any separator is accepted). Returns false if it is not a plausible date.
+static inline bool bambu_date_parse(const char* raw, uint32_t* minutes) {
+    unsigned year, month, day, hour, minute;
+    if(strlen(raw) < 16) return false;
+    for(size_t i = 0; i < 16; i++) {
+        bool separator = i == 4 || i == 7 || i == 10 || i == 13;
+        if(!separator && (raw[i] < '0' || raw[i] > '9')) return false;
+    }
+    year = (unsigned)atoi(raw);
+    month = (unsigned)atoi(raw + 5);
+    day = (unsigned)atoi(raw + 8);
+    hour = (unsigned)atoi(raw + 11);
+    minute = (unsigned)atoi(raw + 14);
+    if(year < 1970 || month < 1 || month > 12 || day < 1 || day > 31 || hour > 23 ||
+       minute > 59) {
+        return false;
+    }
+    int32_t days = bambu_days_from_civil((int32_t)year, month, day);
+    *minutes = (uint32_t)days * 1440u + hour * 60u + minute;
+    return true;
+}
+
+// Format minutes since 1970-01-01 as a block 12 style "YYYY_MM_DD_HH_MM"
+// (out: 17 bytes)
+static inline void bambu_date_format(uint32_t minutes, char* out) {
+    int32_t z = (int32_t)(minutes / 1440u) + 719468;
+    int32_t era = (z >= 0 ? z : z - 146096) / 146097;
+    uint32_t doe = (uint32_t)(z - era * 146097);
+    uint32_t yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    uint32_t doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    uint32_t mp = (5 * doy + 2) / 153;
+    uint32_t day = doy - (153 * mp + 2) / 5 + 1;
+    uint32_t month = mp < 10 ? mp + 3 : mp - 9;
+    int32_t year = (int32_t)yoe + era * 400 + (month <= 2);
+    char buf[48];  // Roomy enough that the compiler can prove no truncation
+    snprintf(
+        buf,
+        sizeof(buf),
+        "%04d_%02u_%02u_%02u_%02u",
+        (int)year,
+        month,
+        day,
+        (minutes % 1440u) / 60u,
+        minutes % 60u);
+    memcpy(out, buf, 16);
+    out[16] = '\0';
+}
+
+// ============================================================================
+// Input enumeration
+// ============================================================================
+
+// Called once per input dump path; return false to stop the walk
+typedef bool (*BambuInputCallback)(const char* path, void* context);
+
+// Helper: Case-insensitive suffix check
+static inline bool bambu_host_has_suffix(const char* path, const char* suffix) {
+    size_t path_len = strlen(path);
+    size_t suffix_len = strlen(suffix);
+    if(path_len < suffix_len) return false;
+    return strcasecmp(path + path_len - suffix_len, suffix) == 0;
+}
+
+// Helper: Dump file types picked up when walking directories
+static inline bool bambu_host_is_dump_path(const char* path) {
+    return bambu_host_has_suffix(path, ".nfc") || bambu_host_has_suffix(path, ".bin") ||
+           bambu_host_has_suffix(path, ".mfd");
+}
+
+// Helper: Sort directory entries so walks are deterministic
+static inline int bambu_host_compare_names(const void* a, const void* b) {
+    return strcmp(*(char* const*)a, *(char* const*)b);
+}
+
+// Helper: Recursively visit dump files below a directory, sorted by name.
+// Names are packed into one pool, so a directory costs a few allocations
+// (in the load stage) however many dumps it holds.
+static inline bool bambu_host_walk_dir(const char* dir, BambuInputCallback callback, void* context) {
+    DIR* d = opendir(dir);
+    if(!d) {
+        fprintf(stderr, "Failed to open directory: %s\n", dir);
+        return false;
+    }
+
+    const BambuAllocator* allocator = bambu_allocator();
+    BambuStage stage = bambu_alloc_stage(BambuStageLoad);
+    char* pool = NULL;
+    size_t pool_len = 0;
+    size_t pool_capacity = 0;
+    size_t count = 0;
+    bool ok = true;
+    struct dirent* entry;
+    while(ok && (entry = readdir(d)) != NULL) {
+        if(entry->d_name[0] == '.') continue;
+        size_t len = strlen(entry->d_name) + 1;
+        if(pool_len + len > pool_capacity) {
+            size_t capacity = pool_capacity ? pool_capacity * 2 : 4096;
+            while(capacity < pool_len + len) capacity *= 2;
+            char* grown = bambu_mem_resize(allocator, pool, pool_capacity, capacity);
+            if(!grown) break;
+            pool = grown;
+            pool_capacity = capacity;
+        }
+        memcpy(&pool[pool_len], entry->d_name, len);
+        pool_len += len;
+        count++;
+    }
+    closedir(d);
+
+    // Point into the pool only once it no longer moves
+    char** names = bambu_mem_alloc(allocator, (count ? count : 1) * sizeof(char*));
+    bambu_alloc_stage(stage);
+    if(!names) {
+        bambu_mem_free(allocator, pool, pool_capacity);
+        return false;
+    }
+    for(size_t i = 0, pos = 0; i < count; i++) {
+        names[i] = &pool[pos];
+        pos += strlen(names[i]) + 1;
+    }
+    if(count > 0) qsort(names, count, sizeof(char*), bambu_host_compare_names);
+
+    for(size_t i = 0; ok && i < count; i++) {
+        char path[4096];
+        snprintf(path, sizeof(path), "%s/%s", dir, names[i]);
+        struct stat st;
+        if(stat(path, &st) == 0 && S_ISDIR(st.st_mode)) {
+            ok = bambu_host_walk_dir(path, callback, context);
+        } else if(bambu_host_is_dump_path(path)) {
+            ok = callback(path, context);
+        }
+    }
+    stage = bambu_alloc_stage(BambuStageLoad);
+    bambu_mem_free(allocator, names, (count ? count : 1) * sizeof(char*));
+    bambu_mem_free(allocator, pool, pool_capacity);
+    bambu_alloc_stage(stage);
+    return ok;
+}
+
+// Visit command-line inputs in order: files are passed through,
+// directories are searched recursively for *.nfc, *.bin and *.mfd dumps,
+// and "-" reads one path per line from stdin
+// (e.g. `find archive -name '*.nfc' | tool -`)
+static inline bool bambu_host_for_each_input(
+    char* const* inputs,
+    int count,
+    BambuInputCallback callback,
+    void* context) {
+    for(int i = 0; i < count; i++) {
+        if(strcmp(inputs[i], "-") == 0) {
+            char line[4096];
+            while(fgets(line, sizeof(line), stdin)) {
+                line[strcspn(line, "\r\n")] = '\0';
+                if(line[0] && !callback(line, context)) return false;
+            }
+            continue;
+        }
+
+        struct stat st;
+        if(stat(inputs[i], &st) == 0 && S_ISDIR(st.st_mode)) {
+            if(!bambu_host_walk_dir(inputs[i], callback, context)) return false;
+        } else if(!callback(inputs[i], context)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// ============================================================================
+// Record output
+// ============================================================================
+
+// True if the record has a tray UID (not all zero)
+static inline bool bambu_record_has_tray_uid(const BambuSpoolRecord* record) {
+    for(size_t i = 0; i < sizeof(record->tray_uid); i++) {
+        if(record->tray_uid[i]) return true;
+    }
+    return false;
+}
+
+// Format a UID as uppercase hex without separators (out: 2*len+1 bytes)
+static inline void bambu_uid_to_hex(const uint8_t* uid, size_t len, char* out) {
+    static const char hex[] = "0123456789ABCDEF";
+    for(size_t i = 0; i < len; i++) {
+        out[i * 2] = hex[uid[i] >> 4];
+        out[i * 2 + 1] = hex[uid[i] & 0x0F];
+    }
+    out[len * 2] = '\0';
+}
+
+#define BAMBU_TSV_HEADER                                                                  \
+    "uid\tvariant_id\tmaterial_id\tfilament_type\tdetailed_type\tcolor_rgba\tweight_g\t" \
+    "diameter_mm\tdrying_temp_c\tdrying_hours\thotend_min_c\thotend_max_c\t"            \
+    "nozzle_diameter_mm\tspool_width_mm\tfilament_length_m\tproduction_date\tscan_time\t"  \
+    "tray_uid\n"
+
+// Print one record as a tab-separated line matching BAMBU_TSV_HEADER
+static inline void bambu_record_print_tsv(
+    FILE* out,
+    const BambuSpoolRecord* record,
+    uint32_t scan_time) {
+    char uid_hex[sizeof(record->uid) * 2 + 1];
+    char tray_hex[sizeof(record->tray_uid) * 2 + 1];
+    bambu_uid_to_hex(record->uid, record->uid_len, uid_hex);
+    bambu_uid_to_hex(record->tray_uid, sizeof(record->tray_uid), tray_hex);
+    fprintf(
+        out,
+        "%s\t%s\t%s\t%s\t%s\t%02X%02X%02X%02X\t%u\t%u.%02u\t%u\t%u\t%u\t%u\t%u.%02u\t%u.%02u\t%u\t%s\t%u\t%s\n",
+        uid_hex,
+        record->variant_id,
+        record->material_id,
+        record->filament_type,
+        record->detailed_type,
+        record->color_r,
+        record->color_g,
+        record->color_b,
+        record->color_a,
+        record->weight_grams,
+        record->diameter_mm_x100 / 100,
+        record->diameter_mm_x100 % 100,
+        record->drying_temp_c,
+        record->drying_hours,
+        record->hotend_min_c,
+        record->hotend_max_c,
+        record->nozzle_diameter_mm_x100 / 100,
+        record->nozzle_diameter_mm_x100 % 100,
+        record->spool_width_mm_x100 / 100,
+        record->spool_width_mm_x100 % 100,
+        record->filament_length_m,
+        record->production_date,
+        scan_time,
+        tray_hex);
+}
+
+#endif // BAMBU_HOST_H
@@ -0,0 +1,231 @@
+/**
+ * bambu_keygen - Build a Flipper user key dictionary for known spool UIDs
+ *
+ * Derives Key A and Key B of all 16 sectors for every UID in a supplier
+ * manifest (host/bambu_keygen.h) and writes them, deduplicated, in the
+ * format of Flipper's mf_classic_dict_user.nfc: one 12-digit hex key per
+ * line. Copy the result to /ext/nfc/assets/mf_classic_dict_user.nfc so
+ * reads of those spools hit their keys immediately.
+ *
+ * Usage: bambu_keygen [-o OUT] [-a DICT] [-t THREADS] [--scalar] [UIDS...]
+ *   UIDS        Files with one UID per line (default "-" = stdin). Hex
+ *               bytes may be separated by spaces, ':' or '-'; anything
+ *               after a ',' or tab is ignored, '#' starts a comment.
+ *   -o OUT      Output dictionary (default stdout)
+ *   -a DICT     Merge an existing dictionary: its keys are kept first
+ *               and never repeated
+ *   -t THREADS  Worker threads (default: online CPUs)
+ *   --scalar    Use the one-UID-at-a-time reference path
+ */
+
+#include "bambu_host.h"
+#include "bambu_keygen.h"
+
+#include <ctype.h>
+#include <time.h>
+#include <unistd.h>
+
+typedef struct {
+    BambuKeygenUid* uids;
+    size_t count;
+    size_t capacity;
+    size_t invalid;
+} UidList;
+
+typedef struct {
+    BambuHashIndex seen;
+    uint64_t* keys;  // In output order
+    size_t count;
+    size_t capacity;
+} KeyDict;
+
+// Helper: Parse one manifest line into a UID. Returns false for blank,
+// comment and malformed lines (*blank tells them apart).
+static bool parse_uid_line(const char* line, BambuKeygenUid* uid, bool* blank) {
+    uid->uid_len = 0;
+    *blank = true;
+    for(const char* p = line; *p && *p != ',' && *p != '\t' && *p != '#'; p++) {
+        if(*p == ' ' || *p == ':' || *p == '-' || *p == '\r' || *p == '\n') continue;
+        *blank = false;
+        int byte = isxdigit((unsigned char)p[1]) ? bambu_host_hex_byte(p) : -1;
+        if(byte < 0 || uid->uid_len == BAMBU_KEYGEN_UID_MAX) return false;
+        uid->uid[uid->uid_len++] = (uint8_t)byte;
+        p++;
+    }
+    return uid->uid_len == 4 || uid->uid_len == 7 || uid->uid_len == 10;
+}
+
+static bool read_uids(FILE* in, const char* name, UidList* list) {
+    char line[256];
+    size_t line_no = 0;
+    while(fgets(line, sizeof(line), in)) {
+        line_no++;
+        BambuKeygenUid uid;
+        bool blank;
+        if(!parse_uid_line(line, &uid, &blank)) {
+            if(!blank) {
+                fprintf(stderr, "%s:%zu: not a 4, 7 or 10 byte UID\n", name, line_no);
+                list->invalid++;
+            }
+            continue;
+        }
+        if(list->count == list->capacity) {
+            size_t capacity = list->capacity ? list->capacity * 2 : 1024;
+            BambuKeygenUid* grown = realloc(list->uids, capacity * sizeof(BambuKeygenUid));
+            if(!grown) return false;
+            list->uids = grown;
+            list->capacity = capacity;
+        }
+        list->uids[list->count++] = uid;
+    }
+    return true;
+}
+
+static bool dict_add(KeyDict* dict, uint64_t key) {
+    uint32_t index = bambu_hash_index_put(&dict->seen, key, (uint32_t)dict->count);
+    if(index == BAMBU_HASH_INDEX_EMPTY) return false;
+    if(index != dict->count) return true;  // Already present
+
+    if(dict->count == dict->capacity) {
+        size_t capacity = dict->capacity ? dict->capacity * 2 : 4096;
+        uint64_t* grown = realloc(dict->keys, capacity * sizeof(uint64_t));
+        if(!grown) return false;
+        dict->keys = grown;
+        dict->capacity = capacity;
+    }
+    dict->keys[dict->count++] = key;
+    return true;
+}
+
+// Helper: Load keys from an existing dictionary (comments are dropped)
+static bool dict_load(KeyDict* dict, const char* path) {
+    FILE* in = fopen(path, "r");
+    if(!in) {
+        fprintf(stderr, "Failed to open: %s\n", path);
+        return false;
+    }
+    char line[256];
+    bool ok = true;
+    while(ok && fgets(line, sizeof(line), in)) {
+        uint8_t key[BAMBU_KEY_LEN];
+        if(line[0] == '#') continue;
+        if(bambu_host_parse_hex_bytes(line, line + strcspn(line, "\r\n"), key, sizeof(key)) != sizeof(key)) {
+            continue;
+        }
+        ok = dict_add(dict, bambu_key_to_u64(key));
+    }
+    fclose(in);
+    return ok;
+}
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static int usage(void) {
+    fprintf(stderr, "Usage: bambu_keygen [-o OUT] [-a DICT] [-t THREADS] [--scalar] [UIDS...]\n");
+    return 1;
+}
+
+int main(int argc, char* argv[]) {
+    const char* out_path = NULL;
+    const char* merge_path = NULL;
+    long threads = sysconf(_SC_NPROCESSORS_ONLN);
+    bool scalar = false;
+    char* inputs[argc];
+    int input_count = 0;
+
+    for(int i = 1; i < argc; i++) {
+        if(strcmp(argv[i], "--scalar") == 0) {
+            scalar = true;
+        } else if(strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+            out_path = argv[++i];
+        } else if(strcmp(argv[i], "-a") == 0 && i + 1 < argc) {
+            merge_path = argv[++i];
+        } else if(strcmp(argv[i], "-t") == 0 && i + 1 < argc) {
+            threads = atol(argv[++i]);
+        } else if(argv[i][0] == '-' && argv[i][1] != '\0') {
+            return usage();
+        } else {
+            inputs[input_count++] = argv[i];
+        }
+    }
+    if(threads < 1) threads = 1;
+    if(input_count == 0) inputs[input_count++] = "-";
+
+    UidList list = {0};
+    for(int i = 0; i < input_count; i++) {
+        bool is_stdin = strcmp(inputs[i], "-") == 0;
+        FILE* in = is_stdin ? stdin : fopen(inputs[i], "r");
+        if(!in) {
+            fprintf(stderr, "Failed to open: %s\n", inputs[i]);
+            return 1;
+        }
+        bool ok = read_uids(in, is_stdin ? "stdin" : inputs[i], &list);
+        if(!is_stdin) fclose(in);
+        if(!ok) {
+            fprintf(stderr, "Out of memory\n");
+            return 1;
+        }
+    }
+
+    BambuKeygenKeys* derived = malloc((list.count ? list.count : 1) * sizeof(BambuKeygenKeys));
+    KeyDict dict = {0};
+    if(!derived || !bambu_hash_index_init(&dict.seen, list.count * 2 * BAMBU_KEY_SECTORS)) {
+        fprintf(stderr, "Out of memory\n");
+        return 1;
+    }
+    if(merge_path && !dict_load(&dict, merge_path)) return 1;
+    size_t merged = dict.count;
+
+    double start = now_seconds();
+    if(!bambu_keygen_derive(list.uids, list.count, (unsigned)threads, scalar, derived)) {
+        fprintf(stderr, "Failed to start worker threads\n");
+        return 1;
+    }
+    double elapsed = now_seconds() - start;
+
+    // Key A before Key B, sector order: the order Flipper tries them in
+    for(size_t i = 0; i < list.count; i++) {
+        for(size_t type = 0; type < 2; type++) {
+            for(size_t sector = 0; sector < BAMBU_KEY_SECTORS; sector++) {
+                if(!dict_add(&dict, bambu_key_to_u64(&derived[i].keys[type][sector * BAMBU_KEY_LEN]))) {
+                    fprintf(stderr, "Out of memory\n");
+                    return 1;
+                }
+            }
+        }
+    }
+
+    FILE* out = out_path ? fopen(out_path, "w") : stdout;
+    if(!out) {
+        fprintf(stderr, "Failed to open: %s\n", out_path);
+        return 1;
+    }
+    for(size_t i = 0; i < dict.count; i++) {
+        fprintf(out, "%012llX\n", (unsigned long long)dict.keys[i]);
+    }
+    bool write_ok = !ferror(out);
+    if(out != stdout && fclose(out) != 0) write_ok = false;
+
+    fprintf(
+        stderr,
+        "%zu UIDs (%zu invalid lines), %zu keys written (%zu merged, %zu new), "
+        "%.0f UIDs/s on %ld threads (%s)\n",
+        list.count,
+        list.invalid,
+        dict.count,
+        merged,
+        dict.count - merged,
+        elapsed > 0 ? (double)list.count / elapsed : 0.0,
+        threads,
+        scalar ? "scalar" : "8-lane");
+
+    free(derived);
+    free(dict.keys);
+    free(list.uids);
+    bambu_hash_index_free(&dict.seen);
+    return write_ok ? 0 : 1;
+}
@@ -0,0 +1,270 @@
+// Bambu Lab NFC Parser - Bulk Key Derivation
+// Derives Key A and Key B for all 16 sectors of many tag UIDs at once
+// (the HKDF-SHA256 scheme in plugin/bambu_keys.h):
+//   - multi-buffer SHA-256: 8 UIDs are hashed in lockstep, one UID per
+//     vector lane (GCC vector extensions; the compiler maps them to
+//     SSE2/AVX2/NEON as available)
+//   - the HMAC pad states for the fixed salt are computed once, and every
+//     HMAC message fits a single block, so one UID costs 16 compressions
+//     for both key types
+//   - batches are spread over worker threads
+//
+// Requires bambu_host.h to be included first.
+
+#ifndef BAMBU_KEYGEN_H
+#define BAMBU_KEYGEN_H
+
+#include <pthread.h>
+
+#include "bambu_hash.h"
+#include "../plugin/bambu_keys.h"
+
+#define BAMBU_KEYGEN_LANES  8
+#define BAMBU_KEYGEN_UID_MAX 10
+
+typedef uint32_t BambuU32x8 __attribute__((vector_size(32)));
+
+// One UID to derive keys for
+typedef struct {
+    uint8_t uid[BAMBU_KEYGEN_UID_MAX];
+    uint8_t uid_len;
+} BambuKeygenUid;
+
+// Derived keys of one UID: [BambuKeyType][sector * 6]
+typedef struct {
+    uint8_t keys[2][BAMBU_KEYS_LEN];
+} BambuKeygenKeys;
+
+// Vector helpers are macros: functions returning vectors wider than the
+// baseline ISA trigger ABI warnings on x86-64 without -mavx
+#define BAMBU_U32X8(v)        ((BambuU32x8){0} + (uint32_t)(v))  // Every lane set to v
+#define BAMBU_ROTR32X8(x, n)  (((x) >> (n)) | ((x) << (32 - (n))))
+
+// SHA-256 compression of one block per lane
+static inline void bambu_sha256_compress_x8(BambuU32x8 state[8], const BambuU32x8 block[16]) {
+    BambuU32x8 w[64];
+    for(size_t i = 0; i < 16; i++) w[i] = block[i];
+    for(size_t i = 16; i < 64; i++) {
+        BambuU32x8 s0 = BAMBU_ROTR32X8(w[i - 15], 7) ^ BAMBU_ROTR32X8(w[i - 15], 18) ^ (w[i - 15] >> 3);
+        BambuU32x8 s1 = BAMBU_ROTR32X8(w[i - 2], 17) ^ BAMBU_ROTR32X8(w[i - 2], 19) ^ (w[i - 2] >> 10);
+        w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+    }
+
+    BambuU32x8 a = state[0], b = state[1], c = state[2], d = state[3];
+    BambuU32x8 e = state[4], f = state[5], g = state[6], h = state[7];
+    for(size_t i = 0; i < 64; i++) {
+        BambuU32x8 t1 = h + (BAMBU_ROTR32X8(e, 6) ^ BAMBU_ROTR32X8(e, 11) ^ BAMBU_ROTR32X8(e, 25)) +
+                        ((e & f) ^ (~e & g)) + BAMBU_U32X8(BAMBU_SHA256_K[i]) + w[i];
+        BambuU32x8 t2 = (BAMBU_ROTR32X8(a, 2) ^ BAMBU_ROTR32X8(a, 13) ^ BAMBU_ROTR32X8(a, 22)) +
+                        ((a & b) ^ (a & c) ^ (b & c));
+        h = g;
+        g = f;
+        f = e;
+        e = d + t1;
+        d = c;
+        c = b;
+        b = a;
+        a = t1 + t2;
+    }
+    state[0] += a;
+    state[1] += b;
+    state[2] += c;
+    state[3] += d;
+    state[4] += e;
+    state[5] += f;
+    state[6] += g;
+    state[7] += h;
+}
+
+// Helper: Broadcast a scalar state to every lane
+static inline void bambu_sha256_broadcast(BambuU32x8 out[8], const uint32_t state[8]) {
+    for(size_t i = 0; i < 8; i++) out[i] = BAMBU_U32X8(state[i]);
+}
+
+// Helper: HMAC step "hash(pad_state, digest)" where the message is a
+// previous 32-byte digest: one block, total length 64 + 32 bytes
+static inline void bambu_sha256_digest_block_x8(
+    BambuU32x8 state[8],
+    const BambuU32x8 pad_state[8],
+    const BambuU32x8 digest[8]) {
+    BambuU32x8 block[16];
+    for(size_t i = 0; i < 8; i++) block[i] = digest[i];
+    block[8] = BAMBU_U32X8(0x80000000u);
+    for(size_t i = 9; i < 15; i++) block[i] = BAMBU_U32X8(0);
+    block[15] = BAMBU_U32X8((64 + 32) * 8);
+    memcpy(state, pad_state, 8 * sizeof(BambuU32x8));
+    bambu_sha256_compress_x8(state, block);
+}
+
+// HMAC pad states for the fixed salt, computed once
+typedef struct {
+    uint32_t inner[8];
+    uint32_t outer[8];
+} BambuKeygenSaltState;
+
+static inline void bambu_keygen_salt_state(BambuKeygenSaltState* salt) {
+    BambuHmacSha256 hmac;
+    bambu_hmac_sha256_init(&hmac, BAMBU_KEY_SALT, sizeof(BAMBU_KEY_SALT));
+    memcpy(salt->inner, hmac.inner.state, sizeof(salt->inner));
+    memcpy(salt->outer, hmac.outer.state, sizeof(salt->outer));
+}
+
+// Derive both key types for up to 8 UIDs (unused lanes repeat lane 0)
+static inline void bambu_keygen_derive_x8(
+    const BambuKeygenSaltState* salt,
+    const BambuKeygenUid* uids,
+    size_t count,
+    BambuKeygenKeys* out) {
+    BambuU32x8 block[16];
+    BambuU32x8 state[8];
+    BambuU32x8 pad[8];
+
+    // Extract, inner hash: salt_ipad || UID (padded per lane)
+    uint8_t lane_blocks[BAMBU_KEYGEN_LANES][BAMBU_SHA256_BLOCK_LEN];
+    for(size_t lane = 0; lane < BAMBU_KEYGEN_LANES; lane++) {
+        const BambuKeygenUid* uid = &uids[lane < count ? lane : 0];
+        uint8_t* b = lane_blocks[lane];
+        memset(b, 0, BAMBU_SHA256_BLOCK_LEN);
+        memcpy(b, uid->uid, uid->uid_len);
+        b[uid->uid_len] = 0x80;
+        uint32_t bits = (BAMBU_SHA256_BLOCK_LEN + uid->uid_len) * 8;
+        bambu_write_be32(&b[60], bits);
+    }
+    for(size_t i = 0; i < 16; i++) {
+        for(size_t lane = 0; lane < BAMBU_KEYGEN_LANES; lane++) {
+            block[i][lane] = bambu_read_be32(&lane_blocks[lane][i * 4]);
+        }
+    }
+    bambu_sha256_broadcast(state, salt->inner);
+    bambu_sha256_compress_x8(state, block);
+
+    // Extract, outer hash -> PRK
+    BambuU32x8 prk[8];
+    bambu_sha256_broadcast(pad, salt->outer);
+    bambu_sha256_digest_block_x8(prk, pad, state);
+
+    // PRK pad states
+    BambuU32x8 prk_inner[8];
+    BambuU32x8 prk_outer[8];
+    for(size_t i = 0; i < 16; i++) {
+        block[i] = (i < 8 ? prk[i] : BAMBU_U32X8(0)) ^ BAMBU_U32X8(0x36363636u);
+    }
+    bambu_sha256_broadcast(prk_inner, BAMBU_SHA256_IV);
+    bambu_sha256_compress_x8(prk_inner, block);
+    for(size_t i = 0; i < 16; i++) {
+        block[i] = (i < 8 ? prk[i] : BAMBU_U32X8(0)) ^ BAMBU_U32X8(0x5c5c5c5cu);
+    }
+    bambu_sha256_broadcast(prk_outer, BAMBU_SHA256_IV);
+    bambu_sha256_compress_x8(prk_outer, block);
+
+    // Expand: T(n) = HMAC(PRK, T(n-1) || info || n), 3 x 32 bytes >= 96
+    for(size_t type = 0; type < 2; type++) {
+        const uint8_t* info = BAMBU_KEY_INFO[type];
+        uint32_t info_word = bambu_read_be32(info);
+        BambuU32x8 t[8];
+        for(uint32_t counter = 1; counter <= 3; counter++) {
+            uint32_t tail_word = ((uint32_t)info[4] << 24) | ((uint32_t)info[5] << 16) |
+                                 ((uint32_t)info[6] << 8) | counter;
+            size_t w = 0;
+            if(counter > 1) {
+                for(; w < 8; w++) block[w] = t[w];
+            }
+            block[w++] = BAMBU_U32X8(info_word);
+            block[w++] = BAMBU_U32X8(tail_word);
+            block[w++] = BAMBU_U32X8(0x80000000u);
+            for(; w < 15; w++) block[w] = BAMBU_U32X8(0);
+            uint32_t message_len = (counter > 1 ? 32 : 0) + 8;
+            block[15] = BAMBU_U32X8((BAMBU_SHA256_BLOCK_LEN + message_len) * 8);
+
+            memcpy(state, prk_inner, sizeof(state));
+            bambu_sha256_compress_x8(state, block);
+            bambu_sha256_digest_block_x8(t, prk_outer, state);
+
+            size_t offset = (counter - 1) * BAMBU_SHA256_DIGEST_LEN;
+            for(size_t lane = 0; lane < count; lane++) {
+                uint8_t digest[BAMBU_SHA256_DIGEST_LEN];
+                for(size_t i = 0; i < 8; i++) bambu_write_be32(&digest[i * 4], t[i][lane]);
+                size_t take = BAMBU_KEYS_LEN - offset;
+                if(take > BAMBU_SHA256_DIGEST_LEN) take = BAMBU_SHA256_DIGEST_LEN;
+                memcpy(&out[lane].keys[type][offset], digest, take);
+            }
+        }
+    }
+}
+
+// Scalar reference path (one UID at a time via plugin/bambu_keys.h)
+static inline void bambu_keygen_derive_scalar(const BambuKeygenUid* uid, BambuKeygenKeys* out) {
+    bambu_derive_keys(uid->uid, uid->uid_len, BambuKeyTypeA, out->keys[BambuKeyTypeA]);
+    bambu_derive_keys(uid->uid, uid->uid_len, BambuKeyTypeB, out->keys[BambuKeyTypeB]);
+}
+
+// ============================================================================
+// Threaded bulk derivation
+// ============================================================================
+
+typedef struct {
+    const BambuKeygenSaltState* salt;
+    const BambuKeygenUid* uids;
+    BambuKeygenKeys* out;
+    size_t begin;
+    size_t end;
+    bool scalar;
+} BambuKeygenJob;
+
+// Helper: Worker thread body
+static inline void* bambu_keygen_worker(void* arg) {
+    const BambuKeygenJob* job = arg;
+    for(size_t i = job->begin; i < job->end;) {
+        if(job->scalar) {
+            bambu_keygen_derive_scalar(&job->uids[i], &job->out[i]);
+            i++;
+            continue;
+        }
+        size_t count = job->end - i;
+        if(count > BAMBU_KEYGEN_LANES) count = BAMBU_KEYGEN_LANES;
+        bambu_keygen_derive_x8(job->salt, &job->uids[i], count, &job->out[i]);
+        i += count;
+    }
+    return NULL;
+}
+
+// Derive keys for count UIDs into out[count] using up to threads workers.
+// Returns false if threads could not be started.
+static inline bool bambu_keygen_derive(
+    const BambuKeygenUid* uids,
+    size_t count,
+    unsigned threads,
+    bool scalar,
+    BambuKeygenKeys* out) {
+    BambuKeygenSaltState salt;
+    bambu_keygen_salt_state(&salt);
+
+    if(threads < 1) threads = 1;
+    // Keep every worker on whole 8-UID batches
+    size_t batches = (count + BAMBU_KEYGEN_LANES - 1) / BAMBU_KEYGEN_LANES;
+    if(threads > batches) threads = batches ? (unsigned)batches : 1;
+
+    pthread_t tids[threads];
+    BambuKeygenJob jobs[threads];
+    size_t per_thread = (batches + threads - 1) / threads * BAMBU_KEYGEN_LANES;
+    unsigned started = 0;
+    bool ok = true;
+    for(unsigned t = 0; t < threads; t++) {
+        size_t begin = t * per_thread;
+        size_t end = begin + per_thread;
+        if(begin > count) begin = count;
+        if(end > count) end = count;
+        jobs[t] = (BambuKeygenJob){&salt, uids, out, begin, end, scalar};
+        if(t == threads - 1) break;  // Last range runs on the calling thread
+        if(pthread_create(&tids[t], NULL, bambu_keygen_worker, &jobs[t]) != 0) {
+            ok = false;
+            break;
+        }
+        started++;
+    }
+    if(ok) bambu_keygen_worker(&jobs[threads - 1]);
+    for(unsigned t = 0; t < started; t++) pthread_join(tids[t], NULL);
+    return ok;
+}
+
+#endif // BAMBU_KEYGEN_H
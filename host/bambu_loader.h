@@ -0,0 +1,574 @@
+// Bambu Lab NFC Parser - Asynchronous Dump Loader
+// Overlaps dump file I/O with decoding for batch ingestion:
+//   - a fixed pool of depth slots, each with a BAMBU_DUMP_MAX_SIZE buffer,
+//     bounds the files in flight; bambu_loader_add() blocks while every
+//     slot is busy
+//   - I/O backend: io_uring, driven through raw syscalls by one thread that
+//     submits the openat/read/close requests of all queued files in
+//     batches; or, where io_uring is unavailable (old kernel, seccomp,
+//     kernel.io_uring_disabled), a pool of threads doing blocking reads.
+//     Should io_uring fail later, its thread finishes with blocking reads:
+//     the files it held are read again and no added path is lost
+//   - decode workers are handed the slot buffer itself (no copy) and the
+//     slot returns to the pool when their callback returns
+// Callbacks run concurrently on the worker threads, in completion order.
+//
+// Requires bambu_host.h to be included first.
+
+#ifndef BAMBU_LOADER_H
+#define BAMBU_LOADER_H
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+
+#include "bambu_alloc.h"
+
+#define BAMBU_LOADER_DEPTH      64  // Default files in flight
+#define BAMBU_LOADER_IO_THREADS 8   // Default threads of the fallback backend
+#define BAMBU_LOADER_PATH_MAX   4096
+
+typedef enum {
+    BambuLoaderAuto,     // io_uring if the kernel allows it, else threads
+    BambuLoaderIoUring,
+    BambuLoaderThreads,
+} BambuLoaderBackend;
+
+static const char* const BAMBU_LOADER_BACKEND_NAMES[] = {
+    [BambuLoaderAuto] = "auto",
+    [BambuLoaderIoUring] = "io_uring",
+    [BambuLoaderThreads] = "threads",
+};
+
+// Called on a worker thread for every added path with the file contents
+// (at most BAMBU_DUMP_MAX_SIZE bytes), or with error set to an errno
+// value. data is only valid until the callback returns.
+typedef void (*BambuLoaderCallback)(const char* path, const char* data, size_t len, int error, void* context);
+
+typedef struct {
+    uint32_t depth;       // Files in flight (0 = BAMBU_LOADER_DEPTH)
+    uint32_t workers;     // Decode threads (0 = 1)
+    uint32_t io_threads;  // Threads backend only (0 = BAMBU_LOADER_IO_THREADS)
+    BambuLoaderBackend backend;
+    BambuLoaderCallback on_dump;
+    void (*on_worker_exit)(void* context);  // Optional, on each worker thread
+    void* context;
+} BambuLoaderConfig;
+
+typedef struct {
+    char path[BAMBU_LOADER_PATH_MAX];
+    char* data;  // BAMBU_DUMP_MAX_SIZE bytes
+    size_t len;
+    int error;
+    int fd;        // Open file while io_uring reads it, else -1
+    bool in_ring;  // io_uring requests of this slot outstanding (I/O thread only)
+} BambuLoaderSlot;
+
+// Bounded FIFO of slot numbers
+typedef struct {
+    uint32_t* items;
+    uint32_t head;
+    uint32_t count;
+    pthread_cond_t cond;  // Signaled when an item is pushed
+} BambuLoaderQueue;
+
+typedef struct {
+    int fd;
+    uint32_t sq_entries;
+    uint32_t *sq_head, *sq_tail, *sq_mask, *sq_array;
+    uint32_t *cq_head, *cq_tail, *cq_mask;
+    struct io_uring_sqe* sqes;
+    struct io_uring_cqe* cqes;
+    void* sq_map;
+    size_t sq_map_size;
+    void* cq_map;  // Same as sq_map with IORING_FEAT_SINGLE_MMAP
+    size_t cq_map_size;
+    size_t sqes_size;
+    uint32_t to_submit;
+    uint32_t in_flight;  // Requests submitted and not yet completed
+} BambuUring;
+
+typedef struct {
+    BambuLoaderConfig config;
+    BambuLoaderBackend backend;  // Resolved: io_uring or threads
+    const BambuAllocator* allocator;
+    BambuLoaderSlot* slots;
+    char* buffers;
+    pthread_mutex_t lock;
+    BambuLoaderQueue free;     // Slots ready for a path
+    BambuLoaderQueue pending;  // Paths waiting for I/O
+    BambuLoaderQueue ready;    // Filled buffers waiting for a worker
+    bool closing;              // bambu_loader_finish() called
+    uint32_t io_active;        // I/O threads still running
+    pthread_t* io;
+    uint32_t io_count;
+    pthread_t* workers;
+    uint32_t worker_count;
+    BambuUring ring;
+    // Statistics (under lock)
+    uint64_t files;
+    uint64_t bytes;
+    uint64_t errors;
+    int uring_error;  // errno that made io_uring fall back to blocking reads
+} BambuLoader;
+
+// ============================================================================
+// Queues (callers hold the loader lock)
+// ============================================================================
+
+static inline void bambu_loader_push(BambuLoader* loader, BambuLoaderQueue* queue, uint32_t slot) {
+    queue->items[(queue->head + queue->count++) % loader->config.depth] = slot;
+    pthread_cond_signal(&queue->cond);
+}
+
+static inline uint32_t bambu_loader_pop(BambuLoader* loader, BambuLoaderQueue* queue) {
+    uint32_t slot = queue->items[queue->head];
+    queue->head = (queue->head + 1) % loader->config.depth;
+    queue->count--;
+    return slot;
+}
+
+// Helper: Hand a filled (or failed) slot to the workers
+static inline void bambu_loader_complete(BambuLoader* loader, uint32_t slot) {
+    pthread_mutex_lock(&loader->lock);
+    bambu_loader_push(loader, &loader->ready, slot);
+    pthread_mutex_unlock(&loader->lock);
+}
+
+// Helper: Wait for pending paths. Returns false once the loader is closing
+// and nothing is pending. *count receives the number taken (up to max).
+static inline bool bambu_loader_take_pending(BambuLoader* loader, uint32_t* slots, uint32_t max, bool wait, uint32_t* count) {
+    pthread_mutex_lock(&loader->lock);
+    while(wait && loader->pending.count == 0 && !loader->closing) {
+        pthread_cond_wait(&loader->pending.cond, &loader->lock);
+    }
+    *count = 0;
+    while(*count < max && loader->pending.count > 0) {
+        slots[(*count)++] = bambu_loader_pop(loader, &loader->pending);
+    }
+    bool more = *count > 0 || !loader->closing;
+    pthread_mutex_unlock(&loader->lock);
+    return more;
+}
+
+// Helper: Mark an I/O thread finished so idle workers can exit
+static inline void bambu_loader_io_exit(BambuLoader* loader) {
+    pthread_mutex_lock(&loader->lock);
+    loader->io_active--;
+    pthread_cond_broadcast(&loader->ready.cond);
+    pthread_mutex_unlock(&loader->lock);
+}
+
+// ============================================================================
+// Thread pool backend
+// ============================================================================
+
+// Helper: Read a slot's file with blocking calls and hand it to the workers
+static inline void bambu_loader_read(BambuLoader* loader, uint32_t slot_id) {
+    BambuLoaderSlot* slot = &loader->slots[slot_id];
+    slot->error = 0;
+    errno = 0;
+    if(!bambu_dump_read(slot->path, slot->data, &slot->len)) slot->error = errno ? errno : EIO;
+    bambu_loader_complete(loader, slot_id);
+}
+
+// Helper: Read pending paths one at a time until the loader is closing
+static inline void bambu_loader_read_pending(BambuLoader* loader) {
+    uint32_t slot_id;
+    uint32_t count;
+    while(bambu_loader_take_pending(loader, &slot_id, 1, true, &count)) {
+        if(count > 0) bambu_loader_read(loader, slot_id);
+    }
+}
+
+static inline void* bambu_loader_io_thread(void* arg) {
+    BambuLoader* loader = arg;
+    bambu_loader_read_pending(loader);
+    bambu_loader_io_exit(loader);
+    return NULL;
+}
+
+// ============================================================================
+// io_uring backend (raw syscalls; Linux 5.6+ for openat/read/close)
+// ============================================================================
+
+enum {
+    BambuUringOpen = 1,
+    BambuUringRead,
+    BambuUringClose,
+};
+
+static inline void bambu_uring_free(BambuUring* ring) {
+    if(ring->sqes) munmap(ring->sqes, ring->sqes_size);
+    if(ring->cq_map && ring->cq_map != ring->sq_map) munmap(ring->cq_map, ring->cq_map_size);
+    if(ring->sq_map) munmap(ring->sq_map, ring->sq_map_size);
+    if(ring->fd > 0) close(ring->fd);
+    memset(ring, 0, sizeof(BambuUring));
+}
+
+// Helper: True if the kernel supports every opcode the loader uses
+static inline bool bambu_uring_probe(int fd) {
+    size_t size = sizeof(struct io_uring_probe) + 256 * sizeof(struct io_uring_probe_op);
+    const BambuAllocator* allocator = bambu_allocator();
+    struct io_uring_probe* probe = bambu_mem_calloc(allocator, 1, size);
+    if(!probe) return false;
+    bool ok = syscall(__NR_io_uring_register, fd, IORING_REGISTER_PROBE, probe, 256) == 0;
+    static const uint8_t ops[] = {IORING_OP_OPENAT, IORING_OP_READ, IORING_OP_CLOSE};
+    for(size_t i = 0; ok && i < sizeof(ops); i++) {
+        ok = ops[i] <= probe->last_op && (probe->ops[ops[i]].flags & IO_URING_OP_SUPPORTED);
+    }
+    bambu_mem_free(allocator, probe, size);
+    return ok;
+}
+
+// Set up a ring for entries requests in flight. Returns false if io_uring
+// is unavailable.
+static inline bool bambu_uring_init(BambuUring* ring, uint32_t entries) {
+    memset(ring, 0, sizeof(BambuUring));
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    int fd = (int)syscall(__NR_io_uring_setup, entries, &params);
+    if(fd < 0) return false;
+    ring->fd = fd;
+    if(!bambu_uring_probe(fd)) {
+        bambu_uring_free(ring);
+        return false;
+    }
+
+    ring->sq_map_size = params.sq_off.array + params.sq_entries * sizeof(uint32_t);
+    ring->cq_map_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    bool single = params.features & IORING_FEAT_SINGLE_MMAP;
+    if(single && ring->cq_map_size > ring->sq_map_size) ring->sq_map_size = ring->cq_map_size;
+    void* sq = mmap(NULL, ring->sq_map_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+    if(sq == MAP_FAILED) {
+        bambu_uring_free(ring);
+        return false;
+    }
+    ring->sq_map = sq;
+    void* cq = sq;
+    if(!single) {
+        cq = mmap(NULL, ring->cq_map_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+        if(cq == MAP_FAILED) {
+            bambu_uring_free(ring);
+            return false;
+        }
+    }
+    ring->cq_map = cq;
+    ring->sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+    void* sqes = mmap(NULL, ring->sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+    if(sqes == MAP_FAILED) {
+        bambu_uring_free(ring);
+        return false;
+    }
+    ring->sqes = sqes;
+
+    uint8_t* sq_base = sq;
+    uint8_t* cq_base = cq;
+    ring->sq_entries = params.sq_entries;
+    ring->sq_head = (uint32_t*)(sq_base + params.sq_off.head);
+    ring->sq_tail = (uint32_t*)(sq_base + params.sq_off.tail);
+    ring->sq_mask = (uint32_t*)(sq_base + params.sq_off.ring_mask);
+    ring->sq_array = (uint32_t*)(sq_base + params.sq_off.array);
+    ring->cq_head = (uint32_t*)(cq_base + params.cq_off.head);
+    ring->cq_tail = (uint32_t*)(cq_base + params.cq_off.tail);
+    ring->cq_mask = (uint32_t*)(cq_base + params.cq_off.ring_mask);
+    ring->cqes = (struct io_uring_cqe*)(cq_base + params.cq_off.cqes);
+    return true;
+}
+
+// Helper: Submit queued requests and wait for at least min_complete
+static inline bool bambu_uring_enter(BambuUring* ring, uint32_t min_complete) {
+    while(ring->to_submit > 0 || min_complete > 0) {
+        long done = syscall(
+            __NR_io_uring_enter, ring->fd, ring->to_submit, min_complete, IORING_ENTER_GETEVENTS, NULL, 0);
+        if(done < 0) {
+            if(errno == EINTR) continue;
+            return false;
+        }
+        ring->to_submit -= (uint32_t)done;
+        min_complete = 0;
+    }
+    return true;
+}
+
+// Helper: Queue one request (the caller bounds requests in flight below
+// the ring size, so the submission queue never overflows)
+static inline void bambu_uring_push(
+    BambuUring* ring,
+    uint8_t opcode,
+    int fd,
+    const void* addr,
+    uint32_t len,
+    uint64_t offset,
+    uint32_t op,
+    uint32_t slot) {
+    uint32_t tail = *ring->sq_tail;
+    uint32_t index = tail & *ring->sq_mask;
+    struct io_uring_sqe* sqe = &ring->sqes[index];
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode = opcode;
+    sqe->fd = fd;
+    sqe->addr = (uint64_t)(uintptr_t)addr;
+    sqe->len = len;
+    sqe->off = offset;
+    sqe->user_data = (uint64_t)op << 32 | slot;
+    if(opcode == IORING_OP_OPENAT) sqe->open_flags = O_RDONLY | O_CLOEXEC;
+    ring->sq_array[index] = index;
+    __atomic_store_n(ring->sq_tail, tail + 1, __ATOMIC_RELEASE);
+    ring->to_submit++;
+    ring->in_flight++;
+}
+
+// Helper: Advance a slot after one of its requests completed
+static inline void bambu_uring_advance(BambuLoader* loader, uint32_t op, uint32_t slot_id, int32_t res) {
+    BambuUring* ring = &loader->ring;
+    BambuLoaderSlot* slot = &loader->slots[slot_id];
+    if(op == BambuUringOpen) {
+        if(res < 0) {
+            slot->error = -res;
+            slot->in_ring = false;
+            bambu_loader_complete(loader, slot_id);
+            return;
+        }
+        slot->fd = res;
+        bambu_uring_push(ring, IORING_OP_READ, res, slot->data, BAMBU_DUMP_MAX_SIZE, 0, BambuUringRead, slot_id);
+    } else if(op == BambuUringRead) {
+        if(res > 0 && slot->len + (size_t)res < BAMBU_DUMP_MAX_SIZE) {
+            // Short read (network file systems): continue where it stopped
+            slot->len += (size_t)res;
+            bambu_uring_push(
+                ring,
+                IORING_OP_READ,
+                slot->fd,
+                slot->data + slot->len,
+                (uint32_t)(BAMBU_DUMP_MAX_SIZE - slot->len),
+                slot->len,
+                BambuUringRead,
+                slot_id);
+            return;
+        }
+        if(res < 0) slot->error = -res;
+        if(res > 0) slot->len += (size_t)res;
+        // The slot may be reused before the close completes; the request
+        // carries the descriptor
+        bambu_uring_push(ring, IORING_OP_CLOSE, slot->fd, NULL, 0, 0, BambuUringClose, slot_id);
+        slot->fd = -1;
+        slot->in_ring = false;
+        bambu_loader_complete(loader, slot_id);
+    }
+}
+
+// Helper: io_uring failed; finish with blocking reads on this thread. The
+// ring is torn down (the kernel cancels what it still holds), files it was
+// reading are read again from the start, then pending paths are served.
+static inline void bambu_loader_uring_fallback(BambuLoader* loader, int error) {
+    pthread_mutex_lock(&loader->lock);
+    loader->uring_error = error;
+    pthread_mutex_unlock(&loader->lock);
+    bambu_uring_free(&loader->ring);
+    for(uint32_t i = 0; i < loader->config.depth; i++) {
+        BambuLoaderSlot* slot = &loader->slots[i];
+        if(!slot->in_ring) continue;
+        slot->in_ring = false;
+        if(slot->fd >= 0) close(slot->fd);
+        slot->fd = -1;
+        bambu_loader_read(loader, i);
+    }
+    bambu_loader_read_pending(loader);
+}
+
+static inline void* bambu_loader_uring_thread(void* arg) {
+    BambuLoader* loader = arg;
+    BambuUring* ring = &loader->ring;
+    uint32_t* batch = bambu_mem_alloc(loader->allocator, loader->config.depth * sizeof(uint32_t));
+    int error = batch ? 0 : ENOMEM;
+
+    while(!error) {
+        // Block for new paths only while no request is outstanding
+        uint32_t count;
+        bool more = bambu_loader_take_pending(loader, batch, loader->config.depth, ring->in_flight == 0, &count);
+        if(!more && ring->in_flight == 0) break;
+        for(uint32_t i = 0; i < count; i++) {
+            BambuLoaderSlot* slot = &loader->slots[batch[i]];
+            slot->fd = -1;
+            slot->in_ring = true;
+            bambu_uring_push(ring, IORING_OP_OPENAT, AT_FDCWD, slot->path, 0, 0, BambuUringOpen, batch[i]);
+        }
+        if(!bambu_uring_enter(ring, count == 0 && ring->in_flight > 0 ? 1 : 0)) {
+            error = errno ? errno : EIO;
+            break;
+        }
+
+        uint32_t head = *ring->cq_head;
+        uint32_t tail = __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE);
+        for(; head != tail; head++) {
+            const struct io_uring_cqe* cqe = &ring->cqes[head & *ring->cq_mask];
+            ring->in_flight--;
+            bambu_uring_advance(loader, (uint32_t)(cqe->user_data >> 32), (uint32_t)cqe->user_data, cqe->res);
+        }
+        __atomic_store_n(ring->cq_head, head, __ATOMIC_RELEASE);
+    }
+
+    bambu_mem_free(loader->allocator, batch, loader->config.depth * sizeof(uint32_t));
+    if(error) bambu_loader_uring_fallback(loader, error);
+    bambu_loader_io_exit(loader);
+    return NULL;
+}
+
+// ============================================================================
+// Workers
+// ============================================================================
+
+static inline void* bambu_loader_worker(void* arg) {
+    BambuLoader* loader = arg;
+    pthread_mutex_lock(&loader->lock);
+    for(;;) {
+        while(loader->ready.count == 0 && loader->io_active > 0) {
+            pthread_cond_wait(&loader->ready.cond, &loader->lock);
+        }
+        if(loader->ready.count == 0) break;
+        uint32_t slot_id = bambu_loader_pop(loader, &loader->ready);
+        pthread_mutex_unlock(&loader->lock);
+
+        BambuLoaderSlot* slot = &loader->slots[slot_id];
+        loader->config.on_dump(slot->path, slot->data, slot->len, slot->error, loader->config.context);
+
+        pthread_mutex_lock(&loader->lock);
+        loader->files++;
+        loader->bytes += slot->len;
+        if(slot->error) loader->errors++;
+        bambu_loader_push(loader, &loader->free, slot_id);
+    }
+    pthread_mutex_unlock(&loader->lock);
+    if(loader->config.on_worker_exit) loader->config.on_worker_exit(loader->config.context);
+    return NULL;
+}
+
+// ============================================================================
+// API
+// ============================================================================
+
+// Helper: Release everything bambu_loader_start() allocated
+static inline void bambu_loader_release(BambuLoader* loader) {
+    uint32_t depth = loader->config.depth;
+    BambuLoaderQueue* queues[] = {&loader->free, &loader->pending, &loader->ready};
+    for(size_t i = 0; i < 3; i++) {
+        bambu_mem_free(loader->allocator, queues[i]->items, depth * sizeof(uint32_t));
+        pthread_cond_destroy(&queues[i]->cond);
+    }
+    bambu_mem_free(loader->allocator, loader->slots, depth * sizeof(BambuLoaderSlot));
+    bambu_mem_free(loader->allocator, loader->buffers, (size_t)depth * BAMBU_DUMP_MAX_SIZE);
+    bambu_mem_free(loader->allocator, loader->io, loader->config.io_threads * sizeof(pthread_t));
+    bambu_mem_free(loader->allocator, loader->workers, loader->config.workers * sizeof(pthread_t));
+    bambu_uring_free(&loader->ring);
+    pthread_mutex_destroy(&loader->lock);
+}
+
+// Stop accepting paths, wait until every added path went through a
+// worker and release the loader. Statistics stay readable.
+static inline void bambu_loader_finish(BambuLoader* loader) {
+    pthread_mutex_lock(&loader->lock);
+    loader->closing = true;
+    pthread_cond_broadcast(&loader->pending.cond);
+    pthread_mutex_unlock(&loader->lock);
+    for(uint32_t i = 0; i < loader->io_count; i++) pthread_join(loader->io[i], NULL);
+    for(uint32_t i = 0; i < loader->worker_count; i++) pthread_join(loader->workers[i], NULL);
+    bambu_loader_release(loader);
+}
+
+// Allocate the slots and start the I/O and worker threads. Returns false
+// if that fails, or if io_uring was requested explicitly and is unavailable.
+static inline bool bambu_loader_start(BambuLoader* loader, const BambuLoaderConfig* config) {
+    memset(loader, 0, sizeof(BambuLoader));
+    loader->config = *config;
+    BambuLoaderConfig* c = &loader->config;
+    if(!c->depth) c->depth = BAMBU_LOADER_DEPTH;
+    if(!c->workers) c->workers = 1;
+    if(!c->io_threads) c->io_threads = BAMBU_LOADER_IO_THREADS;
+    if(!c->on_dump) return false;
+
+    loader->backend = BambuLoaderThreads;
+    if(c->backend != BambuLoaderThreads) {
+        // Each slot has at most two requests in flight: its own and the
+        // close of the file it held before
+        if(bambu_uring_init(&loader->ring, 2 * c->depth)) {
+            loader->backend = BambuLoaderIoUring;
+        } else if(c->backend == BambuLoaderIoUring) {
+            return false;
+        }
+    }
+    if(loader->backend == BambuLoaderIoUring) c->io_threads = 1;
+
+    const BambuAllocator* allocator = bambu_allocator();
+    loader->allocator = allocator;
+    pthread_mutex_init(&loader->lock, NULL);
+    bool ok = true;
+    BambuLoaderQueue* queues[] = {&loader->free, &loader->pending, &loader->ready};
+    for(size_t i = 0; i < 3; i++) {
+        queues[i]->items = bambu_mem_alloc(allocator, c->depth * sizeof(uint32_t));
+        pthread_cond_init(&queues[i]->cond, NULL);
+        ok = ok && queues[i]->items;
+    }
+    loader->slots = bambu_mem_calloc(allocator, c->depth, sizeof(BambuLoaderSlot));
+    loader->buffers = bambu_mem_alloc(allocator, (size_t)c->depth * BAMBU_DUMP_MAX_SIZE);
+    loader->io = bambu_mem_alloc(allocator, c->io_threads * sizeof(pthread_t));
+    loader->workers = bambu_mem_alloc(allocator, c->workers * sizeof(pthread_t));
+    if(!ok || !loader->slots || !loader->buffers || !loader->io || !loader->workers) {
+        bambu_loader_release(loader);
+        return false;
+    }
+    for(uint32_t i = 0; i < c->depth; i++) {
+        loader->slots[i].data = loader->buffers + (size_t)i * BAMBU_DUMP_MAX_SIZE;
+        loader->free.items[i] = i;
+    }
+    loader->free.count = c->depth;
+
+    void* (*io_main)(void*) =
+        loader->backend == BambuLoaderIoUring ? bambu_loader_uring_thread : bambu_loader_io_thread;
+    loader->io_active = c->io_threads;
+    for(; loader->io_count < c->io_threads; loader->io_count++) {
+        if(pthread_create(&loader->io[loader->io_count], NULL, io_main, loader) != 0) break;
+    }
+    for(; loader->worker_count < c->workers && loader->io_count == c->io_threads; loader->worker_count++) {
+        if(pthread_create(&loader->workers[loader->worker_count], NULL, bambu_loader_worker, loader) != 0) break;
+    }
+    if(loader->io_count < c->io_threads || loader->worker_count == 0) {
+        // Let the threads that did start drain and exit
+        pthread_mutex_lock(&loader->lock);
+        loader->io_active -= c->io_threads - loader->io_count;
+        pthread_mutex_unlock(&loader->lock);
+        bambu_loader_finish(loader);
+        return false;
+    }
+    return true;
+}
+
+// Queue a path for loading, blocking while all slots are in flight. Paths
+// longer than BAMBU_LOADER_PATH_MAX reach the callback with ENAMETOOLONG.
+// Must not be called from a callback.
+static inline void bambu_loader_add(BambuLoader* loader, const char* path) {
+    pthread_mutex_lock(&loader->lock);
+    while(loader->free.count == 0) pthread_cond_wait(&loader->free.cond, &loader->lock);
+    uint32_t slot_id = bambu_loader_pop(loader, &loader->free);
+    pthread_mutex_unlock(&loader->lock);
+
+    BambuLoaderSlot* slot = &loader->slots[slot_id];
+    slot->len = 0;
+    slot->error = 0;
+    size_t len = strlen(path);
+    bool fits = len < sizeof(slot->path);
+    memcpy(slot->path, path, fits ? len + 1 : 0);
+    if(!fits) {
+        slot->path[0] = '\0';
+        slot->error = ENAMETOOLONG;
+    }
+
+    pthread_mutex_lock(&loader->lock);
+    bambu_loader_push(loader, fits ? &loader->pending : &loader->ready, slot_id);
+    pthread_mutex_unlock(&loader->lock);
+}
+
+#endif // BAMBU_LOADER_H
@@ -0,0 +1,138 @@
+/**
+ * bambu_merge - Consolidate scan histories from many devices
+ *
+ * Sorts the records of any number of inventory logs by tag UID (or tray
+ * UID) in bounded memory (host/bambu_merge.h) and keeps the latest scan of
+ * each tag, so inputs larger than RAM merge with sequential I/O only.
+ *
+ * Usage: bambu_merge [-k uid|tray] [-m MB] [-T DIR] [-o OUT.log] [INPUT...]
+ *   INPUT       .log frame log (bambu_receive -l) or .bspc file
+ *               (bambu_export -o), or "-" for a stdin path list
+ *               (default "-")
+ *   -k uid      One record per tag UID (default)
+ *   -k tray     One record per spool (tray UID); tags without a tray UID
+ *               stay one record per tag
+ *   -m MB       Memory for buffered records and run I/O (default 256)
+ *   -T DIR      Directory for temporary runs (default $TMPDIR or /tmp)
+ *   -o OUT.log  Write the merged records as a frame log, sorted by key;
+ *               without it they are printed as TSV (BAMBU_TSV_HEADER)
+ */
+
+#include "bambu_host.h"
+#include "bambu_columnar.h"
+#include "bambu_merge.h"
+
+typedef struct {
+    BambuMergeSorter sorter;
+    size_t inputs;
+    bool failed;
+} MergeContext;
+
+static bool add_record(const BambuSpoolRecord* record, uint32_t scan_time, void* context) {
+    MergeContext* ctx = context;
+    return bambu_merge_add(&ctx->sorter, record, scan_time);
+}
+
+static bool on_input(const char* path, void* context) {
+    MergeContext* ctx = context;
+    ctx->inputs++;
+    bool ok = bambu_record_file_load(path, add_record, ctx);
+    if(!ok) ctx->failed = true;
+    return ok;
+}
+
+static bool write_frame(const uint8_t* payload, size_t len, void* context) {
+    uint8_t frame[BAMBU_FRAME_MAX_SIZE];
+    size_t frame_len = bambu_frame_encode(BambuFrameTypeRecord, payload, (uint8_t)len, frame);
+    return fwrite(frame, 1, frame_len, context) == frame_len;
+}
+
+static bool print_record(const uint8_t* payload, size_t len, void* context) {
+    BambuSpoolRecord record;
+    uint32_t scan_time;
+    if(!bambu_record_unpack(payload, len, &record, &scan_time)) return false;
+    bambu_record_print_tsv(context, &record, scan_time);
+    return true;
+}
+
+static int usage(void) {
+    fprintf(stderr, "Usage: bambu_merge [-k uid|tray] [-m MB] [-T DIR] [-o OUT.log] [INPUT...]\n");
+    return 1;
+}
+
+int main(int argc, char* argv[]) {
+    BambuMergeKey key = BambuMergeByUid;
+    size_t memory_mb = 256;
+    const char* tmp_dir = getenv("TMPDIR");
+    const char* out_path = NULL;
+    char* inputs[argc];
+    int input_count = 0;
+
+    for(int i = 1; i < argc; i++) {
+        if(strcmp(argv[i], "-k") == 0 && i + 1 < argc) {
+            const char* name = argv[++i];
+            if(strcmp(name, "uid") == 0) {
+                key = BambuMergeByUid;
+            } else if(strcmp(name, "tray") == 0) {
+                key = BambuMergeByTray;
+            } else {
+                return usage();
+            }
+        } else if(strcmp(argv[i], "-m") == 0 && i + 1 < argc) {
+            memory_mb = strtoul(argv[++i], NULL, 10);
+            if(memory_mb == 0) return usage();
+        } else if(strcmp(argv[i], "-T") == 0 && i + 1 < argc) {
+            tmp_dir = argv[++i];
+        } else if(strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+            out_path = argv[++i];
+        } else if(argv[i][0] == '-' && argv[i][1] != '\0') {
+            return usage();
+        } else {
+            inputs[input_count++] = argv[i];
+        }
+    }
+    if(input_count == 0) inputs[input_count++] = "-";
+    if(!tmp_dir || !tmp_dir[0]) tmp_dir = "/tmp";
+
+    MergeContext ctx = {0};
+    if(!bambu_merge_init(&ctx.sorter, key, memory_mb << 20, tmp_dir)) {
+        fprintf(stderr, "Out of memory\n");
+        return 1;
+    }
+    bambu_host_for_each_input(inputs, input_count, on_input, &ctx);
+    if(ctx.failed) {
+        fprintf(stderr, "Failed to read all inputs (or to write a run to %s)\n", tmp_dir);
+        bambu_merge_free(&ctx.sorter);
+        return 1;
+    }
+
+    FILE* out = stdout;
+    if(out_path) {
+        out = fopen(out_path, "wb");
+        if(!out) {
+            perror(out_path);
+            bambu_merge_free(&ctx.sorter);
+            return 1;
+        }
+        setvbuf(out, NULL, _IOFBF, BAMBU_MERGE_IO_BUFFER);
+    } else {
+        printf(BAMBU_TSV_HEADER);
+    }
+    bool ok = bambu_merge_finish(&ctx.sorter, out_path ? write_frame : print_record, out);
+    if(out_path && fclose(out) != 0) ok = false;
+
+    fprintf(
+        stderr,
+        "%zu inputs, %llu records -> %llu (%llu older scans dropped, %zu runs)\n",
+        ctx.inputs,
+        (unsigned long long)ctx.sorter.records,
+        (unsigned long long)ctx.sorter.output,
+        (unsigned long long)ctx.sorter.duplicates,
+        ctx.sorter.runs_written);
+    bambu_merge_free(&ctx.sorter);
+    if(!ok) {
+        fprintf(stderr, "Merge failed\n");
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,375 @@
+// Bambu Lab NFC Parser - External Merge of Scan Histories
+// Sorts packed spool records (plugin/bambu_frame.h payloads) by tag UID
+// or tray UID in bounded memory and keeps only the latest scan per key:
+//   - run generation: records are buffered up to the memory limit, sorted,
+//     deduplicated and written as one sequential run to an unlinked
+//     temporary file
+//   - k-way merge: a binary heap over the run heads streams the runs back
+//     in key order, emitting the first (latest) record of every key
+//   - intermediate merges while runs are written: every run has a level
+//     (0 when spilled, one more than its inputs when merged); once the
+//     newest runs of one level fill a tier (a quarter of the fan-in) they
+//     are merged into one run of the next level, and all runs are merged
+//     into one whenever the fan-in is reached. At most fan-in runs are
+//     open, each record is rewritten about log(runs)/log(tier) times, and
+//     runs stay in arrival order so scan time ties resolve as in one pass.
+// All file I/O is sequential through stdio buffers sized so that the
+// fan-in runs plus a merge output fit in a quarter of the memory limit;
+// the records buffer gets the rest. Buffers come from the allocator
+// current at bambu_merge_init() (host/bambu_alloc.h).
+//
+// Requires bambu_host.h to be included first.
+
+#ifndef BAMBU_MERGE_H
+#define BAMBU_MERGE_H
+
+#include <unistd.h>
+
+#include "../plugin/bambu_frame.h"
+
+#define BAMBU_MERGE_KEY_LEN   18   // Kind + length + 16 ID bytes, compared with memcmp
+#define BAMBU_MERGE_FAN_IN    64   // Most runs open (and merged) at once
+#define BAMBU_MERGE_IO_BUFFER (1 << 20)  // Largest run I/O buffer
+#define BAMBU_MERGE_MIN_MEMORY (1 << 20)
+
+typedef enum {
+    BambuMergeByUid,   // One record per tag
+    BambuMergeByTray,  // One record per spool (tags without tray UID stay per tag)
+} BambuMergeKey;
+
+// Called for every record of the merged output, in key order; return
+// false to stop
+typedef bool (*BambuMergeOutput)(const uint8_t* payload, size_t len, void* context);
+
+// Buffered record: payload lives in the sorter's payload arena
+typedef struct {
+    uint8_t key[BAMBU_MERGE_KEY_LEN];
+    uint8_t len;
+    uint32_t scan_time;
+    uint32_t seq;     // Arrival order, breaks scan time ties
+    size_t offset;
+} BambuMergeEntry;
+
+// Temporary run file and its stdio buffer
+typedef struct {
+    FILE* file;
+    uint8_t* buffer;
+    uint8_t level;
+} BambuMergeRun;
+
+typedef struct {
+    BambuMergeKey key;
+    const char* tmp_dir;
+    const BambuAllocator* allocator;
+    BambuMergeEntry* entries;
+    size_t count;
+    size_t capacity;
+    uint8_t* payloads;
+    size_t payload_fill;
+    size_t payload_capacity;
+    BambuMergeRun runs[BAMBU_MERGE_FAN_IN];  // Oldest first
+    size_t run_count;
+    size_t fan_in;     // BAMBU_MERGE_FAN_IN; may be lowered (>= 2) before the first add
+    size_t io_buffer;  // Bytes of stdio buffer per run file
+    uint32_t seq;
+    // Statistics
+    uint64_t records;     // Records added
+    uint64_t duplicates;  // Older scans dropped
+    uint64_t output;      // Records emitted
+    size_t runs_written;  // Including intermediate merge runs
+    size_t runs_peak;     // Most runs held at once
+} BambuMergeSorter;
+
+// Use up to memory_limit bytes (at least BAMBU_MERGE_MIN_MEMORY) for the
+// records buffer and the run I/O buffers; runs go to unlinked temporary
+// files in tmp_dir
+static inline bool bambu_merge_init(
+    BambuMergeSorter* sorter,
+    BambuMergeKey key,
+    size_t memory_limit,
+    const char* tmp_dir) {
+    memset(sorter, 0, sizeof(BambuMergeSorter));
+    if(memory_limit < BAMBU_MERGE_MIN_MEMORY) memory_limit = BAMBU_MERGE_MIN_MEMORY;
+    sorter->key = key;
+    sorter->tmp_dir = tmp_dir;
+    sorter->fan_in = BAMBU_MERGE_FAN_IN;
+    // A quarter for the fan-in runs and a merge output, in whole pages
+    sorter->io_buffer = memory_limit / 4 / (BAMBU_MERGE_FAN_IN + 1) / 4096 * 4096;
+    if(sorter->io_buffer > BAMBU_MERGE_IO_BUFFER) sorter->io_buffer = BAMBU_MERGE_IO_BUFFER;
+    if(sorter->io_buffer < 4096) sorter->io_buffer = 4096;
+    memory_limit -= (BAMBU_MERGE_FAN_IN + 1) * sorter->io_buffer;
+    // A typical payload is ~90 bytes: split the rest so both fill together
+    sorter->capacity = memory_limit / 3 / sizeof(BambuMergeEntry);
+    sorter->payload_capacity = memory_limit - sorter->capacity * sizeof(BambuMergeEntry);
+    sorter->allocator = bambu_allocator();
+    sorter->entries = bambu_mem_alloc(sorter->allocator, sorter->capacity * sizeof(BambuMergeEntry));
+    sorter->payloads = bambu_mem_alloc(sorter->allocator, sorter->payload_capacity);
+    if(!sorter->entries || !sorter->payloads) {
+        bambu_mem_free(sorter->allocator, sorter->entries, sorter->capacity * sizeof(BambuMergeEntry));
+        bambu_mem_free(sorter->allocator, sorter->payloads, sorter->payload_capacity);
+        return false;
+    }
+    return true;
+}
+
+// Helper: Close a run file and free its buffer
+static inline void bambu_merge_close_run(const BambuMergeSorter* sorter, BambuMergeRun* run) {
+    fclose(run->file);
+    bambu_mem_free(sorter->allocator, run->buffer, sorter->io_buffer);
+}
+
+static inline void bambu_merge_free(BambuMergeSorter* sorter) {
+    const BambuAllocator* allocator = sorter->allocator;
+    for(size_t i = 0; i < sorter->run_count; i++) bambu_merge_close_run(sorter, &sorter->runs[i]);
+    bambu_mem_free(allocator, sorter->entries, sorter->capacity * sizeof(BambuMergeEntry));
+    bambu_mem_free(allocator, sorter->payloads, sorter->payload_capacity);
+    memset(sorter, 0, sizeof(BambuMergeSorter));
+}
+
+// Helper: Sort key of a record
+static inline void bambu_merge_make_key(BambuMergeKey mode, const BambuSpoolRecord* record, uint8_t* key) {
+    memset(key, 0, BAMBU_MERGE_KEY_LEN);
+    if(mode == BambuMergeByTray && bambu_record_has_tray_uid(record)) {
+        memcpy(&key[2], record->tray_uid, sizeof(record->tray_uid));
+        return;
+    }
+    key[0] = 1;
+    key[1] = record->uid_len;
+    memcpy(&key[2], record->uid, record->uid_len);
+}
+
+// Helper: Scan time of a packed payload
+static inline uint32_t bambu_merge_scan_time(const uint8_t* payload) {
+    return (uint32_t)payload[1] | ((uint32_t)payload[2] << 8) | ((uint32_t)payload[3] << 16) |
+           ((uint32_t)payload[4] << 24);
+}
+
+// Helper: qsort order: key, then latest scan first, then arrival
+static inline int bambu_merge_compare_entries(const void* a, const void* b) {
+    const BambuMergeEntry* x = a;
+    const BambuMergeEntry* y = b;
+    int cmp = memcmp(x->key, y->key, BAMBU_MERGE_KEY_LEN);
+    if(cmp) return cmp;
+    if(x->scan_time != y->scan_time) return x->scan_time > y->scan_time ? -1 : 1;
+    return x->seq < y->seq ? -1 : x->seq > y->seq;
+}
+
+// Helper: Create an unlinked temporary run file
+static inline bool bambu_merge_tmpfile(const BambuMergeSorter* sorter, BambuMergeRun* run) {
+    char path[4096];
+    snprintf(path, sizeof(path), "%s/bambu_merge_XXXXXX", sorter->tmp_dir);
+    run->buffer = bambu_mem_alloc(sorter->allocator, sorter->io_buffer);
+    if(!run->buffer) return false;
+    int fd = mkstemp(path);
+    if(fd >= 0) unlink(path);
+    run->file = fd >= 0 ? fdopen(fd, "w+b") : NULL;
+    if(!run->file) {
+        if(fd >= 0) close(fd);
+        bambu_mem_free(sorter->allocator, run->buffer, sorter->io_buffer);
+        return false;
+    }
+    setvbuf(run->file, (char*)run->buffer, _IOFBF, sorter->io_buffer);
+    run->level = 0;
+    return true;
+}
+
+// Helper: Write one run entry: key, payload length, payload
+static inline bool bambu_merge_write_entry(FILE* run, const uint8_t* key, const uint8_t* payload, uint8_t len) {
+    return fwrite(key, 1, BAMBU_MERGE_KEY_LEN, run) == BAMBU_MERGE_KEY_LEN && fputc(len, run) != EOF &&
+           fwrite(payload, 1, len, run) == len;
+}
+
+// ============================================================================
+// K-way merge
+// ============================================================================
+
+typedef struct {
+    FILE* file;
+    size_t run;  // Position in the merge, breaks ties
+    uint8_t key[BAMBU_MERGE_KEY_LEN];
+    uint8_t len;
+    uint8_t payload[BAMBU_FRAME_MAX_PAYLOAD];
+} BambuMergeCursor;
+
+// Helper: Load the next entry of a run, false at its end
+static inline bool bambu_merge_cursor_next(BambuMergeCursor* cursor) {
+    if(fread(cursor->key, 1, BAMBU_MERGE_KEY_LEN, cursor->file) != BAMBU_MERGE_KEY_LEN) return false;
+    int len = fgetc(cursor->file);
+    if(len == EOF) return false;
+    cursor->len = (uint8_t)len;
+    return fread(cursor->payload, 1, cursor->len, cursor->file) == cursor->len;
+}
+
+// Helper: Heap order, same as bambu_merge_compare_entries
+static inline bool bambu_merge_cursor_less(const BambuMergeCursor* a, const BambuMergeCursor* b) {
+    int cmp = memcmp(a->key, b->key, BAMBU_MERGE_KEY_LEN);
+    if(cmp) return cmp < 0;
+    uint32_t time_a = bambu_merge_scan_time(a->payload);
+    uint32_t time_b = bambu_merge_scan_time(b->payload);
+    if(time_a != time_b) return time_a > time_b;
+    return a->run < b->run;
+}
+
+// Helper: Restore the heap property below slot i
+static inline void bambu_merge_sift_down(BambuMergeCursor** heap, size_t size, size_t i) {
+    for(;;) {
+        size_t smallest = i;
+        size_t left = 2 * i + 1;
+        size_t right = left + 1;
+        if(left < size && bambu_merge_cursor_less(heap[left], heap[smallest])) smallest = left;
+        if(right < size && bambu_merge_cursor_less(heap[right], heap[smallest])) smallest = right;
+        if(smallest == i) return;
+        BambuMergeCursor* swap = heap[i];
+        heap[i] = heap[smallest];
+        heap[smallest] = swap;
+        i = smallest;
+    }
+}
+
+// Helper: Merge runs[0..count) into out (a run file when out_run is set,
+// the output callback otherwise), keeping the first entry of every key.
+// The merged runs are closed.
+static inline bool bambu_merge_runs(
+    BambuMergeSorter* sorter,
+    BambuMergeRun* runs,
+    size_t count,
+    FILE* out_run,
+    BambuMergeOutput output,
+    void* context) {
+    BambuMergeCursor* cursors = bambu_mem_alloc(sorter->allocator, count * sizeof(BambuMergeCursor));
+    BambuMergeCursor** heap = bambu_mem_alloc(sorter->allocator, count * sizeof(BambuMergeCursor*));
+    bool ok = cursors && heap;
+    size_t size = 0;
+    for(size_t i = 0; ok && i < count; i++) {
+        cursors[i].file = runs[i].file;
+        cursors[i].run = i;
+        if(bambu_merge_cursor_next(&cursors[i])) heap[size++] = &cursors[i];
+    }
+    for(size_t i = size; ok && i-- > 0;) bambu_merge_sift_down(heap, size, i);
+
+    uint8_t last_key[BAMBU_MERGE_KEY_LEN];
+    bool have_last = false;
+    while(ok && size > 0) {
+        BambuMergeCursor* top = heap[0];
+        if(have_last && memcmp(top->key, last_key, BAMBU_MERGE_KEY_LEN) == 0) {
+            sorter->duplicates++;
+        } else {
+            memcpy(last_key, top->key, BAMBU_MERGE_KEY_LEN);
+            have_last = true;
+            if(out_run) {
+                ok = bambu_merge_write_entry(out_run, top->key, top->payload, top->len);
+            } else {
+                ok = output(top->payload, top->len, context);
+                sorter->output++;
+            }
+        }
+        if(!bambu_merge_cursor_next(top)) heap[0] = heap[--size];
+        bambu_merge_sift_down(heap, size, 0);
+    }
+
+    for(size_t i = 0; i < count; i++) bambu_merge_close_run(sorter, &runs[i]);
+    bambu_mem_free(sorter->allocator, cursors, count * sizeof(BambuMergeCursor));
+    bambu_mem_free(sorter->allocator, heap, count * sizeof(BambuMergeCursor*));
+    return ok;
+}
+
+// Helper: Merge runs[first..run_count) into one run of the given level in
+// their place
+static inline bool bambu_merge_collapse(BambuMergeSorter* sorter, size_t first, uint8_t level) {
+    BambuMergeRun merged;
+    if(!bambu_merge_tmpfile(sorter, &merged)) return false;
+    bool ok = bambu_merge_runs(sorter, &sorter->runs[first], sorter->run_count - first, merged.file, NULL, NULL);
+    sorter->run_count = first;
+    if(!ok || fflush(merged.file) != 0 || fseek(merged.file, 0, SEEK_SET) != 0) {
+        bambu_merge_close_run(sorter, &merged);
+        return false;
+    }
+    merged.level = level;
+    sorter->runs[sorter->run_count++] = merged;
+    sorter->runs_written++;
+    return true;
+}
+
+// Helper: Append a finished run (rewound for reading), then merge full tiers
+// and, at the fan-in, all runs
+static inline bool bambu_merge_push_run(BambuMergeSorter* sorter, BambuMergeRun* run) {
+    if(fflush(run->file) != 0 || fseek(run->file, 0, SEEK_SET) != 0) {
+        bambu_merge_close_run(sorter, run);
+        return false;
+    }
+    sorter->runs[sorter->run_count++] = *run;
+    sorter->runs_written++;
+    if(sorter->run_count > sorter->runs_peak) sorter->runs_peak = sorter->run_count;
+
+    size_t tier = sorter->fan_in / 4 > 2 ? sorter->fan_in / 4 : 2;
+    for(;;) {
+        uint8_t level = sorter->runs[sorter->run_count - 1].level;
+        size_t first = sorter->run_count - 1;
+        while(first > 0 && sorter->runs[first - 1].level == level) first--;
+        if(sorter->run_count - first >= tier && level < UINT8_MAX) {
+            if(!bambu_merge_collapse(sorter, first, level + 1)) return false;
+        } else if(sorter->run_count >= sorter->fan_in) {
+            level = sorter->runs[0].level;
+            if(!bambu_merge_collapse(sorter, 0, level < UINT8_MAX ? level + 1 : level)) return false;
+        } else {
+            return true;
+        }
+    }
+}
+
+// ============================================================================
+// Run generation
+// ============================================================================
+
+// Helper: Sort the buffered records and write them as a run
+static inline bool bambu_merge_spill(BambuMergeSorter* sorter) {
+    if(sorter->count == 0) return true;
+    qsort(sorter->entries, sorter->count, sizeof(BambuMergeEntry), bambu_merge_compare_entries);
+    BambuMergeRun run;
+    if(!bambu_merge_tmpfile(sorter, &run)) return false;
+    bool ok = true;
+    for(size_t i = 0; ok && i < sorter->count; i++) {
+        const BambuMergeEntry* entry = &sorter->entries[i];
+        if(i > 0 && memcmp(entry->key, sorter->entries[i - 1].key, BAMBU_MERGE_KEY_LEN) == 0) {
+            sorter->duplicates++;
+            continue;
+        }
+        ok = bambu_merge_write_entry(run.file, entry->key, &sorter->payloads[entry->offset], entry->len);
+    }
+    sorter->count = 0;
+    sorter->payload_fill = 0;
+    if(!ok) {
+        bambu_merge_close_run(sorter, &run);
+        return false;
+    }
+    return bambu_merge_push_run(sorter, &run);
+}
+
+// Add one record. Returns false if a run could not be written.
+static inline bool bambu_merge_add(BambuMergeSorter* sorter, const BambuSpoolRecord* record, uint32_t scan_time) {
+    if(sorter->count == sorter->capacity ||
+       sorter->payload_fill + BAMBU_FRAME_MAX_PAYLOAD > sorter->payload_capacity) {
+        if(!bambu_merge_spill(sorter)) return false;
+    }
+    BambuMergeEntry* entry = &sorter->entries[sorter->count++];
+    bambu_merge_make_key(sorter->key, record, entry->key);
+    entry->offset = sorter->payload_fill;
+    entry->len = (uint8_t)bambu_record_pack(record, scan_time, &sorter->payloads[entry->offset]);
+    entry->scan_time = scan_time;
+    entry->seq = sorter->seq++;
+    sorter->payload_fill += entry->len;
+    sorter->records++;
+    return true;
+}
+
+// Sort everything added so far and pass each key's latest record to
+// output in key order. Returns false on I/O or allocation failure, or if
+// output stopped the merge.
+static inline bool bambu_merge_finish(BambuMergeSorter* sorter, BambuMergeOutput output, void* context) {
+    if(!bambu_merge_spill(sorter)) return false;
+    size_t count = sorter->run_count;
+    sorter->run_count = 0;
+    return bambu_merge_runs(sorter, sorter->runs, count, NULL, output, context);
+}
+
+#endif // BAMBU_MERGE_H
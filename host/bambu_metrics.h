@@ -0,0 +1,357 @@
+// Bambu Lab NFC Parser - Ingest Metrics
+// Counters and latency histograms for host ingest jobs, exported in the
+// Prometheus text format:
+//   - every thread records into its own shard (claimed once with
+//     bambu_metrics_shard()); a shard has a single writer, so updates are
+//     plain relaxed atomic stores with no locked instructions, and the
+//     exporter sums all shards without stopping the writers
+//   - latencies of each ingest stage (BambuStage, bambu_alloc.h) go into
+//     log-linear (HDR-style) histograms: 8 linear sub-buckets per power of
+//     two, so any value is within 12.5% of its bucket bound from 1 ns up
+//     to about 9 minutes. Buckets include their upper bound, as
+//     Prometheus "le" buckets do
+//   - every sample carries a "tool" label naming the program; "job" is
+//     left to the Prometheus scrape configuration
+//   - bambu_metrics_write_file() atomically replaces a file (for the
+//     node_exporter textfile collector); bambu_metrics_serve() answers
+//     every connection on a unix socket with the current metrics
+//
+// Requires bambu_host.h to be included first.
+
+#ifndef BAMBU_METRICS_H
+#define BAMBU_METRICS_H
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#define BAMBU_METRICS_MAX_SHARDS 64
+#define BAMBU_METRICS_SUB_BITS   3
+#define BAMBU_METRICS_SUB        (1u << BAMBU_METRICS_SUB_BITS)
+#define BAMBU_METRICS_MAX_EXP    39  // Largest power of two tracked (~550 s in ns)
+#define BAMBU_METRICS_BUCKETS    ((BAMBU_METRICS_MAX_EXP - BAMBU_METRICS_SUB_BITS + 2) * BAMBU_METRICS_SUB + 1)
+
+typedef enum {
+    BambuCounterInputs,          // Inputs seen
+    BambuCounterLoadFailures,    // Unreadable or not a Mifare Classic dump
+    BambuCounterRejected,        // Not a Bambu tag (validation failed)
+    BambuCounterDecodeFailures,  // Valid tag that failed to decode
+    BambuCounterCatalogHits,     // Variant found in the catalog
+    BambuCounterCatalogMisses,   // Variant missing from the catalog
+    BambuCounterRecords,         // Records written
+    BambuCounterOutputFailures,  // Records that could not be written
+    BambuCounterCount,
+} BambuCounter;
+
+static const char* const BAMBU_COUNTER_NAMES[BambuCounterCount] = {
+    [BambuCounterInputs] = "inputs",
+    [BambuCounterLoadFailures] = "load_failures",
+    [BambuCounterRejected] = "rejected",
+    [BambuCounterDecodeFailures] = "decode_failures",
+    [BambuCounterCatalogHits] = "catalog_hits",
+    [BambuCounterCatalogMisses] = "catalog_misses",
+    [BambuCounterRecords] = "records",
+    [BambuCounterOutputFailures] = "output_failures",
+};
+
+typedef struct {
+    atomic_uint_fast64_t counts[BAMBU_METRICS_BUCKETS];
+    atomic_uint_fast64_t sum_ns;
+} BambuHistogram;
+
+// One per thread, on its own cache lines. BambuStageOther is not timed.
+typedef struct {
+    _Alignas(64) atomic_uint_fast64_t counters[BambuCounterCount];
+    BambuHistogram latency[BambuStageCount];
+} BambuMetricsShard;
+
+typedef struct {
+    const char* tool;  // "tool" label on every sample
+    BambuMetricsShard* shards;
+    atomic_uint shard_count;
+    int listen_fd;
+    pthread_t server;
+    char socket_path[108];
+} BambuMetrics;
+
+static inline bool bambu_metrics_init(BambuMetrics* metrics, const char* tool) {
+    memset(metrics, 0, sizeof(BambuMetrics));
+    metrics->shards = aligned_alloc(64, BAMBU_METRICS_MAX_SHARDS * sizeof(BambuMetricsShard));
+    if(!metrics->shards) return false;
+    memset(metrics->shards, 0, BAMBU_METRICS_MAX_SHARDS * sizeof(BambuMetricsShard));
+    metrics->tool = tool;
+    atomic_init(&metrics->shard_count, 0);
+    metrics->listen_fd = -1;
+    return true;
+}
+
+// Stops serving and frees the shards; no thread may still record
+static inline void bambu_metrics_free(BambuMetrics* metrics) {
+    if(metrics->listen_fd >= 0) {
+        shutdown(metrics->listen_fd, SHUT_RDWR);  // Wakes the server from accept()
+        pthread_join(metrics->server, NULL);
+        close(metrics->listen_fd);
+        unlink(metrics->socket_path);
+    }
+    free(metrics->shards);
+    memset(metrics, 0, sizeof(BambuMetrics));
+}
+
+// Shard for the calling thread, or NULL once BAMBU_METRICS_MAX_SHARDS
+// threads have claimed one
+static inline BambuMetricsShard* bambu_metrics_shard(BambuMetrics* metrics) {
+    unsigned id = atomic_fetch_add(&metrics->shard_count, 1);
+    return id < BAMBU_METRICS_MAX_SHARDS ? &metrics->shards[id] : NULL;
+}
+
+// ============================================================================
+// Recording (single writer per shard)
+// ============================================================================
+
+static inline uint64_t bambu_metrics_now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+// Helper: Add to a value only the owning thread writes
+static inline void bambu_metrics_bump(atomic_uint_fast64_t* value, uint64_t delta) {
+    atomic_store_explicit(value, atomic_load_explicit(value, memory_order_relaxed) + delta, memory_order_relaxed);
+}
+
+static inline void bambu_metrics_count(BambuMetricsShard* shard, BambuCounter counter) {
+    bambu_metrics_bump(&shard->counters[counter], 1);
+}
+
+// Histogram bucket of a value: values up to 2^SUB_BITS have their own
+// bucket, larger ones are bucketed by the top SUB_BITS + 1 significant
+// bits of value - 1, so every bucket ends on its largest value (a power of
+// two is the last value of its bucket, not the first)
+static inline size_t bambu_histogram_bucket(uint64_t value) {
+    if(value <= BAMBU_METRICS_SUB) return (size_t)value;
+    uint64_t below = value - 1;
+    unsigned exp = 63 - (unsigned)__builtin_clzll(below);
+    if(exp > BAMBU_METRICS_MAX_EXP) return BAMBU_METRICS_BUCKETS - 1;
+    unsigned sub = (unsigned)(below >> (exp - BAMBU_METRICS_SUB_BITS)) & (BAMBU_METRICS_SUB - 1);
+    return (size_t)(exp - BAMBU_METRICS_SUB_BITS + 1) * BAMBU_METRICS_SUB + sub + 1;
+}
+
+// Largest value that lands in bucket
+static inline uint64_t bambu_histogram_bucket_max(size_t bucket) {
+    if(bucket <= BAMBU_METRICS_SUB) return bucket;
+    bucket--;
+    unsigned exp = (unsigned)(bucket / BAMBU_METRICS_SUB) + BAMBU_METRICS_SUB_BITS - 1;
+    uint64_t sub = bucket % BAMBU_METRICS_SUB;
+    return (BAMBU_METRICS_SUB + sub + 1) << (exp - BAMBU_METRICS_SUB_BITS);
+}
+
+// Record a latency of elapsed_ns in stage
+static inline void bambu_metrics_observe(BambuMetricsShard* shard, BambuStage stage, uint64_t elapsed_ns) {
+    BambuHistogram* histogram = &shard->latency[stage];
+    bambu_metrics_bump(&histogram->counts[bambu_histogram_bucket(elapsed_ns)], 1);
+    bambu_metrics_bump(&histogram->sum_ns, elapsed_ns);
+}
+
+// Record the time since start_ns in stage; returns now so stages chain
+static inline uint64_t bambu_metrics_time(BambuMetricsShard* shard, BambuStage stage, uint64_t start_ns) {
+    uint64_t now = bambu_metrics_now_ns();
+    bambu_metrics_observe(shard, stage, now - start_ns);
+    return now;
+}
+
+// Leave the calling thread's current stage (bambu_alloc_stage()),
+// recording its time since start_ns unless it is BambuStageOther, and
+// count allocations in next from here on. Returns now so stages chain.
+static inline uint64_t bambu_metrics_stage(BambuMetricsShard* shard, BambuStage next, uint64_t start_ns) {
+    BambuStage stage = bambu_alloc_stage(next);
+    if(stage == BambuStageOther) return bambu_metrics_now_ns();
+    return bambu_metrics_time(shard, stage, start_ns);
+}
+
+// ============================================================================
+// Export
+// ============================================================================
+
+typedef struct {
+    uint64_t counters[BambuCounterCount];
+    uint64_t counts[BambuStageCount][BAMBU_METRICS_BUCKETS];
+    uint64_t sum_ns[BambuStageCount];
+} BambuMetricsTotals;
+
+// Sum all shards; writers keep running, so totals are per-value exact but
+// not one instant across values
+static inline void bambu_metrics_collect(BambuMetrics* metrics, BambuMetricsTotals* totals) {
+    memset(totals, 0, sizeof(BambuMetricsTotals));
+    unsigned shards = atomic_load(&metrics->shard_count);
+    if(shards > BAMBU_METRICS_MAX_SHARDS) shards = BAMBU_METRICS_MAX_SHARDS;
+    for(unsigned s = 0; s < shards; s++) {
+        BambuMetricsShard* shard = &metrics->shards[s];
+        for(size_t c = 0; c < BambuCounterCount; c++) {
+            totals->counters[c] += atomic_load_explicit(&shard->counters[c], memory_order_relaxed);
+        }
+        for(size_t stage = BambuStageLoad; stage < BambuStageCount; stage++) {
+            BambuHistogram* histogram = &shard->latency[stage];
+            for(size_t b = 0; b < BAMBU_METRICS_BUCKETS; b++) {
+                totals->counts[stage][b] += atomic_load_explicit(&histogram->counts[b], memory_order_relaxed);
+            }
+            totals->sum_ns[stage] += atomic_load_explicit(&histogram->sum_ns, memory_order_relaxed);
+        }
+    }
+}
+
+// Value at quantile q (0-1) of a stage, as its bucket's upper bound in ns
+static inline uint64_t bambu_metrics_quantile(const BambuMetricsTotals* totals, BambuStage stage, double q) {
+    uint64_t total = 0;
+    for(size_t b = 0; b < BAMBU_METRICS_BUCKETS; b++) total += totals->counts[stage][b];
+    if(total == 0) return 0;
+    uint64_t rank = (uint64_t)(q * (double)(total - 1)) + 1;
+    uint64_t seen = 0;
+    for(size_t b = 0; b < BAMBU_METRICS_BUCKETS; b++) {
+        seen += totals->counts[stage][b];
+        if(seen >= rank) return bambu_histogram_bucket_max(b);
+    }
+    return bambu_histogram_bucket_max(BAMBU_METRICS_BUCKETS - 1);
+}
+
+// Write all metrics in the Prometheus text format. The histogram is
+// exported at power-of-two bounds from 128 ns to 2^37 ns (~137 s); the
+// quantiles come from the full-resolution buckets.
+static inline void bambu_metrics_write(BambuMetrics* metrics, FILE* out) {
+    static const double quantiles[] = {0.5, 0.9, 0.99, 0.999};
+    BambuMetricsTotals totals;
+    bambu_metrics_collect(metrics, &totals);
+
+    for(size_t c = 0; c < BambuCounterCount; c++) {
+        fprintf(out, "# TYPE bambu_%s_total counter\n", BAMBU_COUNTER_NAMES[c]);
+        fprintf(
+            out,
+            "bambu_%s_total{tool=\"%s\"} %llu\n",
+            BAMBU_COUNTER_NAMES[c],
+            metrics->tool,
+            (unsigned long long)totals.counters[c]);
+    }
+
+    fprintf(out, "# TYPE bambu_stage_seconds histogram\n");
+    for(size_t stage = BambuStageLoad; stage < BambuStageCount; stage++) {
+        const char* name = BAMBU_STAGE_NAMES[stage];
+        uint64_t cumulative = 0;
+        size_t b = 0;
+        for(unsigned exp = 7; exp <= 37; exp++) {
+            uint64_t bound = 1ULL << exp;
+            while(b < BAMBU_METRICS_BUCKETS && bambu_histogram_bucket_max(b) <= bound) {
+                cumulative += totals.counts[stage][b++];
+            }
+            fprintf(
+                out,
+                "bambu_stage_seconds_bucket{tool=\"%s\",stage=\"%s\",le=\"%.9g\"} %llu\n",
+                metrics->tool,
+                name,
+                (double)bound / 1e9,
+                (unsigned long long)cumulative);
+        }
+        while(b < BAMBU_METRICS_BUCKETS) cumulative += totals.counts[stage][b++];
+        fprintf(
+            out,
+            "bambu_stage_seconds_bucket{tool=\"%s\",stage=\"%s\",le=\"+Inf\"} %llu\n",
+            metrics->tool,
+            name,
+            (unsigned long long)cumulative);
+        fprintf(
+            out,
+            "bambu_stage_seconds_sum{tool=\"%s\",stage=\"%s\"} %.9f\n",
+            metrics->tool,
+            name,
+            (double)totals.sum_ns[stage] / 1e9);
+        fprintf(
+            out,
+            "bambu_stage_seconds_count{tool=\"%s\",stage=\"%s\"} %llu\n",
+            metrics->tool,
+            name,
+            (unsigned long long)cumulative);
+    }
+
+    fprintf(out, "# TYPE bambu_stage_quantile_seconds gauge\n");
+    for(size_t stage = BambuStageLoad; stage < BambuStageCount; stage++) {
+        for(size_t q = 0; q < sizeof(quantiles) / sizeof(quantiles[0]); q++) {
+            fprintf(
+                out,
+                "bambu_stage_quantile_seconds{tool=\"%s\",stage=\"%s\",quantile=\"%g\"} %.9f\n",
+                metrics->tool,
+                BAMBU_STAGE_NAMES[stage],
+                quantiles[q],
+                (double)bambu_metrics_quantile(&totals, stage, quantiles[q]) / 1e9);
+        }
+    }
+}
+
+// Replace path with the current metrics (written to path.tmp, then
+// renamed, so readers never see a partial file)
+static inline bool bambu_metrics_write_file(BambuMetrics* metrics, const char* path) {
+    char tmp_path[4096];
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path);
+    FILE* out = fopen(tmp_path, "w");
+    if(!out) return false;
+    bambu_metrics_write(metrics, out);
+    bool ok = fclose(out) == 0;
+    if(ok) ok = rename(tmp_path, path) == 0;
+    if(!ok) remove(tmp_path);
+    return ok;
+}
+
+// Helper: Answer each connection with the current metrics, then close it
+static inline void* bambu_metrics_serve_thread(void* context) {
+    BambuMetrics* metrics = context;
+    for(;;) {
+        int client = accept(metrics->listen_fd, NULL, NULL);
+        if(client < 0) {
+            if(errno == EINTR || errno == ECONNABORTED) continue;
+            return NULL;  // Socket shut down by bambu_metrics_free()
+        }
+        char* text = NULL;
+        size_t len = 0;
+        FILE* out = open_memstream(&text, &len);
+        if(out) {
+            bambu_metrics_write(metrics, out);
+            fclose(out);
+            // MSG_NOSIGNAL: a client that hung up must not kill the job
+            for(size_t sent = 0; sent < len;) {
+                ssize_t n = send(client, text + sent, len - sent, MSG_NOSIGNAL);
+                if(n <= 0) break;
+                sent += (size_t)n;
+            }
+            free(text);
+        }
+        close(client);
+    }
+}
+
+// Serve the metrics on a unix socket at path (replacing a stale socket)
+// from a background thread, e.g. `socat - UNIX-CONNECT:path`
+static inline bool bambu_metrics_serve(BambuMetrics* metrics, const char* path) {
+    struct sockaddr_un addr = {.sun_family = AF_UNIX};
+    if(strlen(path) >= sizeof(addr.sun_path)) return false;
+    strcpy(addr.sun_path, path);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if(fd < 0) return false;
+    unlink(path);
+    if(bind(fd, (struct sockaddr*)&addr, sizeof(addr)) != 0 || listen(fd, 8) != 0) {
+        close(fd);
+        return false;
+    }
+    metrics->listen_fd = fd;
+    strcpy(metrics->socket_path, path);
+    if(pthread_create(&metrics->server, NULL, bambu_metrics_serve_thread, metrics) != 0) {
+        close(fd);
+        unlink(path);
+        metrics->listen_fd = -1;
+        return false;
+    }
+    return true;
+}
+
+#endif // BAMBU_METRICS_H
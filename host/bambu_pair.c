@@ -0,0 +1,123 @@
+/**
+ * bambu_pair - Group the two tags of each spool into one spool record
+ *
+ * Joins decoded tags on their tray UID (host/bambu_pair.h) in a single
+ * pass over the inputs and prints one line per physical spool, so
+ * inventories stop counting each spool twice.
+ *
+ * Usage: bambu_pair [-s STATUS] [INPUT...]
+ *   INPUT      .bspc file (bambu_export -o), .log frame log
+ *              (bambu_receive -l), dump file, directory or "-" for a stdin
+ *              path list (default "-")
+ *   -s STATUS  Only print spools with this status (repeatable):
+ *              SINGLE, PAIRED, MISMATCH, EXTRA, NO_TRAY
+ *
+ * Output: TSV with the spool status, its tag count and second tag UID in
+ * front of the first tag's record (BAMBU_TSV_HEADER columns).
+ */
+
+#include "bambu_host.h"
+#include "bambu_columnar.h"
+#include "bambu_pair.h"
+
+typedef struct {
+    BambuPairIndex index;
+    size_t tags;
+    size_t skipped;
+    bool failed;
+} PairContext;
+
+static bool add_record(const BambuSpoolRecord* record, uint32_t scan_time, void* context) {
+    PairContext* ctx = context;
+    ctx->tags++;
+    if(!bambu_pair_add(&ctx->index, record, scan_time)) ctx->failed = true;
+    return !ctx->failed;
+}
+
+static bool on_input(const char* path, void* context) {
+    PairContext* ctx = context;
+
+    if(bambu_host_has_suffix(path, ".bspc") || bambu_host_has_suffix(path, ".log")) {
+        if(!bambu_record_file_load(path, add_record, ctx)) ctx->failed = true;
+        return !ctx->failed;
+    }
+
+    MfClassicData data;
+    BambuSpoolRecord record;
+    if(!bambu_nfc_load(path, &data) || !bambu_decode(&data, &record)) {
+        ctx->skipped++;
+        return true;
+    }
+    return add_record(&record, 0, ctx);
+}
+
+static int usage(void) {
+    fprintf(stderr, "Usage: bambu_pair [-s SINGLE|PAIRED|MISMATCH|EXTRA|NO_TRAY] [INPUT...]\n");
+    return 1;
+}
+
+int main(int argc, char* argv[]) {
+    bool show[BambuPairStatusCount] = {false};
+    bool filtered = false;
+    char* inputs[argc];
+    int input_count = 0;
+
+    for(int i = 1; i < argc; i++) {
+        if(strcmp(argv[i], "-s") == 0 && i + 1 < argc) {
+            const char* name = argv[++i];
+            size_t status = 0;
+            while(status < BambuPairStatusCount && strcasecmp(name, BAMBU_PAIR_STATUS_NAMES[status]) != 0) {
+                status++;
+            }
+            if(status == BambuPairStatusCount) return usage();
+            show[status] = true;
+            filtered = true;
+        } else if(argv[i][0] == '-' && argv[i][1] != '\0') {
+            return usage();
+        } else {
+            inputs[input_count++] = argv[i];
+        }
+    }
+    if(input_count == 0) inputs[input_count++] = "-";
+
+    PairContext ctx = {0};
+    if(!bambu_pair_init(&ctx.index, 4096)) {
+        fprintf(stderr, "Out of memory\n");
+        return 1;
+    }
+    bambu_host_for_each_input(inputs, input_count, on_input, &ctx);
+
+    size_t counts[BambuPairStatusCount] = {0};
+    printf("status\ttags\tsecond_uid\t" BAMBU_TSV_HEADER);
+    for(size_t i = 0; i < ctx.index.count; i++) {
+        const BambuSpool* spool = &ctx.index.spools[i];
+        counts[spool->status]++;
+        if(filtered && !show[spool->status]) continue;
+
+        char second_hex[sizeof(spool->second_uid) * 2 + 1];
+        bambu_uid_to_hex(spool->second_uid, spool->second_uid_len, second_hex);
+        printf("%s\t%u\t%s\t", BAMBU_PAIR_STATUS_NAMES[spool->status], spool->tags, second_hex);
+        bambu_record_print_tsv(stdout, &spool->record, spool->scan_time);
+    }
+
+    fprintf(
+        stderr,
+        "%zu tags -> %zu spools: %zu paired, %zu single, %zu mismatched, %zu extra, %zu without "
+        "tray UID (%zu rescans, %zu skipped)\n",
+        ctx.tags,
+        ctx.index.count,
+        counts[BambuPairPaired],
+        counts[BambuPairSingle],
+        counts[BambuPairMismatch],
+        counts[BambuPairExtra],
+        counts[BambuPairNoTray],
+        ctx.index.rescans,
+        ctx.skipped);
+
+    bambu_pair_free(&ctx.index);
+    if(ctx.failed) {
+        fprintf(stderr, "Failed to read all inputs\n");
+        return 1;
+    }
+    return 0;
+}
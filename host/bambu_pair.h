@@ -0,0 +1,182 @@
+// Bambu Lab NFC Parser - Two-Tag Spool Pairing
+// Every spool carries one tag per flange. Both tags hold the same payload
+// and the same tray UID (block 9) under different tag UIDs. This joins
+// decoded records on the tray UID with a hash index in a single pass, so
+// an archive yields one spool per physical spool:
+//   SINGLE    only one tag of the spool seen so far
+//   PAIRED    both tags seen, payloads agree
+//   MISMATCH  both tags seen, payloads disagree (rewritten or damaged tag)
+//   EXTRA     more than two tag UIDs share the tray UID (cloned tags)
+//   NO_TRAY   no tray UID on the tag, cannot be paired
+// A tag UID seen again is the same tag rescanned: it only refreshes the
+// spool's scan time. The first two tag UIDs are kept in the spool; those of
+// EXTRA tags are kept as hashes of tray UID and tag UID in a second index.
+//
+// Requires bambu_host.h to be included first.
+
+#ifndef BAMBU_PAIR_H
+#define BAMBU_PAIR_H
+
+#include "bambu_hash.h"
+
+typedef enum {
+    BambuPairSingle,
+    BambuPairPaired,
+    BambuPairMismatch,
+    BambuPairExtra,
+    BambuPairNoTray,
+    BambuPairStatusCount,
+} BambuPairStatus;
+
+static const char* const BAMBU_PAIR_STATUS_NAMES[BambuPairStatusCount] = {
+    [BambuPairSingle] = "SINGLE",
+    [BambuPairPaired] = "PAIRED",
+    [BambuPairMismatch] = "MISMATCH",
+    [BambuPairExtra] = "EXTRA",
+    [BambuPairNoTray] = "NO_TRAY",
+};
+
+typedef struct {
+    BambuSpoolRecord record;  // First tag seen; its uid is the first tag UID
+    uint8_t second_uid[10];   // Second tag UID (tags >= 2)
+    uint8_t second_uid_len;
+    uint8_t tags;             // Distinct tag UIDs, saturating at 255
+    BambuPairStatus status;
+    uint64_t payload_hash;
+    uint32_t scan_time;       // Latest scan of any of its tags
+} BambuSpool;
+
+typedef struct {
+    BambuHashIndex by_tray;
+    BambuHashIndex by_extra_tag;  // Tags after the second: hash -> spool id
+    BambuSpool* spools;
+    size_t count;
+    size_t capacity;
+    size_t rescans;  // Records of a tag UID already seen
+} BambuPairIndex;
+
+// Hash of everything on the tag except the tag UID
+static inline uint64_t bambu_record_payload_hash(const BambuSpoolRecord* record) {
+    const char* strings[] = {
+        record->material_id,
+        record->variant_id,
+        record->filament_type,
+        record->detailed_type,
+        record->production_date,
+    };
+    const uint16_t numbers[] = {
+        record->weight_grams,
+        record->diameter_mm_x100,
+        record->drying_temp_c,
+        record->drying_hours,
+        record->hotend_max_c,
+        record->hotend_min_c,
+        record->nozzle_diameter_mm_x100,
+        record->spool_width_mm_x100,
+        record->filament_length_m,
+    };
+    const uint8_t color[4] = {record->color_r, record->color_g, record->color_b, record->color_a};
+
+    uint64_t h = BAMBU_HASH_SEED;
+    for(size_t i = 0; i < sizeof(strings) / sizeof(strings[0]); i++) {
+        h = bambu_hash_bytes(h, strings[i], strlen(strings[i]) + 1);  // NUL separates fields
+    }
+    h = bambu_hash_bytes(h, numbers, sizeof(numbers));
+    h = bambu_hash_bytes(h, color, sizeof(color));
+    return bambu_hash_bytes(h, record->tray_uid, sizeof(record->tray_uid));
+}
+
+static inline bool bambu_pair_init(BambuPairIndex* index, size_t expected) {
+    memset(index, 0, sizeof(BambuPairIndex));
+    if(!bambu_hash_index_init(&index->by_tray, expected)) return false;
+    if(!bambu_hash_index_init(&index->by_extra_tag, 0)) {
+        bambu_hash_index_free(&index->by_tray);
+        return false;
+    }
+    return true;
+}
+
+static inline void bambu_pair_free(BambuPairIndex* index) {
+    // The spools share the tray index's allocator
+    if(index->spools) bambu_mem_free(index->by_tray.allocator, index->spools, index->capacity * sizeof(BambuSpool));
+    bambu_hash_index_free(&index->by_tray);
+    bambu_hash_index_free(&index->by_extra_tag);
+    memset(index, 0, sizeof(BambuPairIndex));
+}
+
+// Helper: Append a new spool for record
+static inline BambuSpool* bambu_pair_new_spool(
+    BambuPairIndex* index,
+    const BambuSpoolRecord* record,
+    uint32_t scan_time,
+    uint64_t payload_hash) {
+    if(index->count == index->capacity) {
+        size_t capacity = index->capacity ? index->capacity * 2 : 1024;
+        BambuSpool* grown = bambu_mem_resize(
+            index->by_tray.allocator, index->spools, index->capacity * sizeof(BambuSpool), capacity * sizeof(BambuSpool));
+        if(!grown) return NULL;
+        index->spools = grown;
+        index->capacity = capacity;
+    }
+    BambuSpool* spool = &index->spools[index->count++];
+    memset(spool, 0, sizeof(BambuSpool));
+    spool->record = *record;
+    spool->tags = 1;
+    spool->status = bambu_record_has_tray_uid(record) ? BambuPairSingle : BambuPairNoTray;
+    spool->payload_hash = payload_hash;
+    spool->scan_time = scan_time;
+    return spool;
+}
+
+// Add one decoded tag record. Returns false on allocation failure.
+static inline bool bambu_pair_add(BambuPairIndex* index, const BambuSpoolRecord* record, uint32_t scan_time) {
+    uint64_t payload_hash = bambu_record_payload_hash(record);
+    if(!bambu_record_has_tray_uid(record)) {
+        return bambu_pair_new_spool(index, record, scan_time, payload_hash) != NULL;
+    }
+
+    // Re-probe with a remixed key on the rare 64-bit hash collision
+    uint64_t key = bambu_hash_bytes(BAMBU_HASH_SEED, record->tray_uid, sizeof(record->tray_uid));
+    for(;;) {
+        uint32_t id = (uint32_t)index->count;
+        uint32_t owner = bambu_hash_index_put(&index->by_tray, key, id);
+        if(owner == BAMBU_HASH_INDEX_EMPTY) return false;
+        if(owner == id) return bambu_pair_new_spool(index, record, scan_time, payload_hash) != NULL;
+
+        BambuSpool* spool = &index->spools[owner];
+        if(memcmp(spool->record.tray_uid, record->tray_uid, sizeof(record->tray_uid)) != 0) {
+            key = bambu_hash_mix(key + 1);
+            continue;
+        }
+
+        if(scan_time > spool->scan_time) spool->scan_time = scan_time;
+        bool first = spool->record.uid_len == record->uid_len &&
+                     memcmp(spool->record.uid, record->uid, record->uid_len) == 0;
+        bool second = spool->second_uid_len == record->uid_len &&
+                      memcmp(spool->second_uid, record->uid, record->uid_len) == 0;
+        if(first || second) {
+            index->rescans++;
+            return true;
+        }
+
+        if(spool->tags == 1) {
+            memcpy(spool->second_uid, record->uid, record->uid_len);
+            spool->second_uid_len = record->uid_len;
+            spool->status = payload_hash == spool->payload_hash ? BambuPairPaired : BambuPairMismatch;
+        } else {
+            // The key covers the tray UID: a known key is a tag of this spool
+            size_t known = index->by_extra_tag.count;
+            uint64_t tag_key = bambu_hash_mix(bambu_hash_bytes(key, record->uid, record->uid_len));
+            if(bambu_hash_index_put(&index->by_extra_tag, tag_key, owner) == BAMBU_HASH_INDEX_EMPTY) return false;
+            if(index->by_extra_tag.count == known) {
+                index->rescans++;
+                return true;
+            }
+            spool->status = BambuPairExtra;
+        }
+        if(spool->tags < UINT8_MAX) spool->tags++;
+        return true;
+    }
+}
+
+#endif // BAMBU_PAIR_H
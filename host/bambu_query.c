@@ -0,0 +1,153 @@
+/**
+ * bambu_query - Filter and aggregate decoded spool inventories
+ *
+ * Loads a columnar export (bambu_export -o) or Bambu dumps, indexes them
+ * (host/bambu_query.h) and prints the matching records as TSV followed by
+ * an aggregate line on stderr.
+ *
+ * Usage: bambu_query [OPTION...] [INPUT...]
+ *   INPUT                  .bspc file, dump file, directory or "-" for a
+ *                          stdin path list (default "-")
+ *   -t, --type T           Filament type (e.g. PETG); repeat to OR
+ *   -d, --detailed D       Detailed type (e.g. "PETG HF"); repeat to OR
+ *   -c, --color C          Catalog color name or #RRGGBB; repeat to OR
+ *   --produced-after DATE  Produced on/after DATE (YYYY-MM-DD[_HH_MM])
+ *   --produced-before DATE Produced on/before DATE
+ *   --older-than-months N  Produced at least N months before --now
+ *   --now DATE             Reference date for --older-than-months
+ *                          (default: current time)
+ *   --min-weight G         Spool weight >= G grams
+ *   --max-weight G         Spool weight <= G grams
+ *   --count                Only print the aggregate
+ *
+ * Example: all PETG over 6 months old with more than 500 g
+ *   bambu_query -t PETG --older-than-months 6 --min-weight 501 inventory.bspc
+ */
+
+#include "bambu_host.h"
+#include "bambu_columnar.h"
+#include "bambu_query.h"
+
+#include <time.h>
+
+typedef struct {
+    BambuInventory inventory;
+    size_t skipped;
+    bool failed;
+} QueryContext;
+
+static bool load_columnar(QueryContext* ctx, const char* path) {
+    BambuColumnarReader reader;
+    if(!bambu_columnar_open(&reader, path)) {
+        fprintf(stderr, "Not a readable columnar file: %s\n", path);
+        return false;
+    }
+    bool ok = bambu_inventory_reserve(&ctx->inventory, ctx->inventory.rows + reader.rows);
+    for(uint32_t row = 0; ok && row < reader.rows; row++) {
+        BambuSpoolRecord record;
+        uint32_t scan_time;
+        bambu_columnar_get_record(&reader, row, &record, &scan_time);
+        ok = bambu_inventory_add(&ctx->inventory, &record, scan_time);
+    }
+    bambu_columnar_close(&reader);
+    return ok;
+}
+
+static bool on_input(const char* path, void* context) {
+    QueryContext* ctx = context;
+
+    if(bambu_host_has_suffix(path, ".bspc")) {
+        if(!load_columnar(ctx, path)) ctx->failed = true;
+        return !ctx->failed;
+    }
+
+    MfClassicData data;
+    BambuSpoolRecord record;
+    if(!bambu_nfc_load(path, &data) || !bambu_decode(&data, &record)) {
+        ctx->skipped++;
+        return true;
+    }
+    if(!bambu_inventory_add(&ctx->inventory, &record, 0)) {
+        ctx->failed = true;
+        return false;
+    }
+    return true;
+}
+
+static int usage(void) {
+    fprintf(stderr, "Usage: bambu_query [OPTION...] [INPUT...]\n");
+    fprintf(stderr, "  -t TYPE  -d DETAILED  -c COLOR  --count\n");
+    fprintf(stderr, "  --produced-after DATE  --produced-before DATE\n");
+    fprintf(stderr, "  --older-than-months N  --now DATE\n");
+    fprintf(stderr, "  --min-weight G  --max-weight G\n");
+    return 1;
+}
+
+int main(int argc, char* argv[]) {
+    static char* const stdin_input[] = {"-"};
+
+    BambuQueryOptions options;
+    bambu_query_options_init(&options, (uint32_t)(time(NULL) / 60));
+    char* inputs[argc];
+    int input_count = 0;
+
+    for(int i = 1; i < argc; i++) {
+        int parsed = bambu_query_parse_option(&options, argc, argv, &i);
+        if(parsed < 0) return usage();
+        if(parsed > 0) continue;
+        if(argv[i][0] == '-' && argv[i][1] != '\0') return usage();
+        inputs[input_count++] = argv[i];
+    }
+    bambu_query_options_finish(&options);
+
+    QueryContext ctx = {0};
+    if(!bambu_inventory_init(&ctx.inventory)) {
+        fprintf(stderr, "Out of memory\n");
+        return 1;
+    }
+    if(input_count > 0) {
+        bambu_host_for_each_input(inputs, input_count, on_input, &ctx);
+    } else {
+        bambu_host_for_each_input(stdin_input, 1, on_input, &ctx);
+    }
+
+    int status = 1;
+    uint64_t* matches = NULL;
+    size_t matches_size = 0;
+    BambuQueryAggregate aggregate;
+    if(!ctx.failed && bambu_inventory_build_indexes(&ctx.inventory)) {
+        matches_size = (ctx.inventory.bitmap_words ? ctx.inventory.bitmap_words : 1) * sizeof(uint64_t);
+        matches = bambu_mem_alloc(ctx.inventory.allocator, matches_size);
+    }
+    if(matches && bambu_inventory_query(&ctx.inventory, &options.query, matches, &aggregate)) {
+        if(!options.count_only) {
+            printf(BAMBU_TSV_HEADER);
+            for(uint32_t row = 0; row < ctx.inventory.rows; row++) {
+                if(!(matches[row / 64] & (1ULL << (row % 64)))) continue;
+                bambu_record_print_tsv(stdout, &ctx.inventory.records[row], ctx.inventory.scan_time[row]);
+            }
+        }
+
+        char oldest[17] = "-";
+        char newest[17] = "-";
+        if(aggregate.oldest_minutes) bambu_date_format(aggregate.oldest_minutes, oldest);
+        if(aggregate.newest_minutes) bambu_date_format(aggregate.newest_minutes, newest);
+        fprintf(
+            options.count_only ? stdout : stderr,
+            "%u of %u spools match, %llu g, %llu m, produced %s .. %s (%zu inputs skipped)\n",
+            aggregate.count,
+            ctx.inventory.rows,
+            (unsigned long long)aggregate.total_weight_grams,
+            (unsigned long long)aggregate.total_length_m,
+            oldest,
+            newest,
+            ctx.skipped);
+        status = 0;
+    } else {
+        fprintf(stderr, "Query failed\n");
+    }
+
+    bambu_mem_free(ctx.inventory.allocator, matches, matches_size);
+    bambu_inventory_free(&ctx.inventory);
+    return status;
+}
@@ -0,0 +1,440 @@
+// Bambu Lab NFC Parser - Indexed Inventory Queries
+// Loads decoded spool records into compact per-field arrays and answers
+// filter/aggregate queries without scanning every record:
+//   - bitmap index per distinct filament type, detailed type and color
+//     (catalog color name, or "#RRGGBB" when the variant is not in the
+//     catalog); values within a field are ORed, fields are ANDed
+//   - row ids sorted by production date, range-searched by bisection
+//   - weight is checked only for rows that survive the indexed filters
+// An inventory allocates through the allocator current when it is
+// initialized (host/bambu_alloc.h).
+//
+// Requires bambu_host.h to be included first.
+
+#ifndef BAMBU_QUERY_H
+#define BAMBU_QUERY_H
+
+#include "bambu_hash.h"
+
+typedef enum {
+    BambuQueryFieldType,
+    BambuQueryFieldDetailedType,
+    BambuQueryFieldColor,
+    BambuQueryFieldCount,
+} BambuQueryField;
+
+typedef struct {
+    const BambuAllocator* allocator;
+    uint32_t rows;
+    uint32_t capacity;
+
+    // Compact columns, indexed by row
+    uint16_t* codes[BambuQueryFieldCount];
+    uint16_t* weight_grams;
+    uint16_t* filament_length_m;
+    uint32_t* production_minutes;  // 0 = unknown date
+    uint32_t* scan_time;
+    BambuSpoolRecord* records;     // Full records, only touched for output
+
+    BambuStringDict dicts[BambuQueryFieldCount];
+
+    // Built by bambu_inventory_build_indexes()
+    size_t bitmap_words;
+    size_t bitmap_values[BambuQueryFieldCount];  // Codes indexed per field
+    uint64_t** bitmaps[BambuQueryFieldCount];    // [field][code] -> row bitmap
+    uint32_t* by_date;                           // Row ids, oldest first
+    size_t by_date_size;
+    bool indexed;
+} BambuInventory;
+
+#define BAMBU_QUERY_MAX_VALUES 16
+
+typedef struct {
+    // Accepted values per field (empty = any)
+    const char* values[BambuQueryFieldCount][BAMBU_QUERY_MAX_VALUES];
+    size_t value_count[BambuQueryFieldCount];
+    // Production date range in minutes since epoch, inclusive (0 = open)
+    uint32_t produced_from;
+    uint32_t produced_to;
+    // Weight range in grams, inclusive (max 0 = open)
+    uint16_t min_weight_grams;
+    uint16_t max_weight_grams;
+} BambuQuery;
+
+typedef struct {
+    uint32_t count;
+    uint64_t total_weight_grams;
+    uint64_t total_length_m;
+    uint32_t oldest_minutes;
+    uint32_t newest_minutes;
+} BambuQueryAggregate;
+
+static inline bool bambu_inventory_init(BambuInventory* inventory) {
+    memset(inventory, 0, sizeof(BambuInventory));
+    inventory->allocator = bambu_allocator();
+    for(size_t f = 0; f < BambuQueryFieldCount; f++) {
+        if(!bambu_string_dict_init(&inventory->dicts[f])) return false;
+    }
+    return true;
+}
+
+// Helper: Drop the indexes (rebuilt on demand after more rows are added)
+static inline void bambu_inventory_drop_indexes(BambuInventory* inventory) {
+    const BambuAllocator* allocator = inventory->allocator;
+    size_t words = inventory->bitmap_words ? inventory->bitmap_words : 1;
+    for(size_t f = 0; f < BambuQueryFieldCount; f++) {
+        size_t values = inventory->bitmap_values[f];
+        if(inventory->bitmaps[f]) {
+            for(size_t c = 0; c < values; c++) {
+                bambu_mem_free(allocator, inventory->bitmaps[f][c], words * sizeof(uint64_t));
+            }
+            bambu_mem_free(allocator, inventory->bitmaps[f], (values ? values : 1) * sizeof(uint64_t*));
+            inventory->bitmaps[f] = NULL;
+        }
+    }
+    bambu_mem_free(allocator, inventory->by_date, inventory->by_date_size);
+    inventory->by_date = NULL;
+    inventory->indexed = false;
+}
+
+static inline void bambu_inventory_free(BambuInventory* inventory) {
+    if(!inventory->allocator) return;  // Never initialized
+    bambu_inventory_drop_indexes(inventory);
+    const BambuAllocator* allocator = inventory->allocator;
+    size_t capacity = inventory->capacity;
+    for(size_t f = 0; f < BambuQueryFieldCount; f++) {
+        bambu_mem_free(allocator, inventory->codes[f], capacity * sizeof(uint16_t));
+        bambu_string_dict_free(&inventory->dicts[f]);
+    }
+    bambu_mem_free(allocator, inventory->weight_grams, capacity * sizeof(uint16_t));
+    bambu_mem_free(allocator, inventory->filament_length_m, capacity * sizeof(uint16_t));
+    bambu_mem_free(allocator, inventory->production_minutes, capacity * sizeof(uint32_t));
+    bambu_mem_free(allocator, inventory->scan_time, capacity * sizeof(uint32_t));
+    bambu_mem_free(allocator, inventory->records, capacity * sizeof(BambuSpoolRecord));
+    memset(inventory, 0, sizeof(BambuInventory));
+}
+
+// Helper: Color key used by the color index
+static inline void bambu_query_color_key(const BambuSpoolRecord* record, char* out, size_t size) {
+    const BambuFilamentInfo* info = bambu_lookup_filament(record->variant_id);
+    if(info) {
+        snprintf(out, size, "%s", info->color_name);
+    } else {
+        snprintf(out, size, "#%02X%02X%02X", record->color_r, record->color_g, record->color_b);
+    }
+}
+
+// Helper: Grow every column to hold capacity rows
+static inline bool bambu_inventory_reserve(BambuInventory* inventory, uint32_t capacity) {
+    if(capacity <= inventory->capacity) return true;
+#define BAMBU_INVENTORY_GROW(field)                                         \
+    do {                                                                  \
+        size_t element = sizeof(*inventory->field);                       \
+        void* grown = bambu_mem_resize(                                   \
+            inventory->allocator,                                         \
+            inventory->field,                                             \
+            inventory->capacity * element,                                \
+            capacity * element);                                          \
+        if(!grown) return false;                                          \
+        inventory->field = grown;                                         \
+    } while(0)
+    for(size_t f = 0; f < BambuQueryFieldCount; f++) BAMBU_INVENTORY_GROW(codes[f]);
+    BAMBU_INVENTORY_GROW(weight_grams);
+    BAMBU_INVENTORY_GROW(filament_length_m);
+    BAMBU_INVENTORY_GROW(production_minutes);
+    BAMBU_INVENTORY_GROW(scan_time);
+    BAMBU_INVENTORY_GROW(records);
+#undef BAMBU_INVENTORY_GROW
+    inventory->capacity = capacity;
+    return true;
+}
+
+// Write a record into row (an existing row, or rows to append one).
+// Returns false on allocation failure.
+static inline bool bambu_inventory_set(
+    BambuInventory* inventory,
+    uint32_t row,
+    const BambuSpoolRecord* record,
+    uint32_t scan_time) {
+    if(row == inventory->capacity &&
+       !bambu_inventory_reserve(inventory, inventory->capacity ? inventory->capacity * 2 : 1024)) {
+        return false;
+    }
+
+    char color[32];
+    bambu_query_color_key(record, color, sizeof(color));
+    const char* keys[BambuQueryFieldCount] = {
+        [BambuQueryFieldType] = record->filament_type,
+        [BambuQueryFieldDetailedType] = record->detailed_type,
+        [BambuQueryFieldColor] = color,
+    };
+
+    for(size_t f = 0; f < BambuQueryFieldCount; f++) {
+        int32_t code = bambu_string_dict_code(&inventory->dicts[f], keys[f]);
+        if(code < 0) return false;
+        inventory->codes[f][row] = (uint16_t)code;
+    }
+    inventory->weight_grams[row] = record->weight_grams;
+    inventory->filament_length_m[row] = record->filament_length_m;
+    inventory->production_minutes[row] = 0;
+    bambu_date_parse(record->production_date, &inventory->production_minutes[row]);
+    inventory->scan_time[row] = scan_time;
+    inventory->records[row] = *record;
+    if(row == inventory->rows) inventory->rows++;
+
+    if(inventory->indexed) bambu_inventory_drop_indexes(inventory);
+    return true;
+}
+
+// Append one record. Returns false on allocation failure.
+static inline bool bambu_inventory_add(
+    BambuInventory* inventory,
+    const BambuSpoolRecord* record,
+    uint32_t scan_time) {
+    return bambu_inventory_set(inventory, inventory->rows, record, scan_time);
+}
+
+// Helper: Sort state for the date index (qsort has no context argument)
+static const uint32_t* bambu_query_sort_dates;
+
+static inline int bambu_query_compare_dates(const void* a, const void* b) {
+    uint32_t da = bambu_query_sort_dates[*(const uint32_t*)a];
+    uint32_t db = bambu_query_sort_dates[*(const uint32_t*)b];
+    if(da != db) return da < db ? -1 : 1;
+    return *(const uint32_t*)a < *(const uint32_t*)b ? -1 : 1;  // Stable by row
+}
+
+// Build the bitmap and date indexes. Returns false on allocation failure.
+static inline bool bambu_inventory_build_indexes(BambuInventory* inventory) {
+    bambu_inventory_drop_indexes(inventory);
+    size_t words = (inventory->rows + 63) / 64;
+    inventory->bitmap_words = words;
+
+    for(size_t f = 0; f < BambuQueryFieldCount; f++) {
+        size_t values = inventory->dicts[f].count;
+        inventory->bitmap_values[f] = values;
+        inventory->bitmaps[f] = bambu_mem_calloc(inventory->allocator, values ? values : 1, sizeof(uint64_t*));
+        if(!inventory->bitmaps[f]) return false;
+        for(size_t c = 0; c < values; c++) {
+            inventory->bitmaps[f][c] = bambu_mem_calloc(inventory->allocator, words ? words : 1, sizeof(uint64_t));
+            if(!inventory->bitmaps[f][c]) return false;
+        }
+        for(uint32_t row = 0; row < inventory->rows; row++) {
+            inventory->bitmaps[f][inventory->codes[f][row]][row / 64] |= 1ULL << (row % 64);
+        }
+    }
+
+    inventory->by_date_size = (inventory->rows ? inventory->rows : 1) * sizeof(uint32_t);
+    inventory->by_date = bambu_mem_alloc(inventory->allocator, inventory->by_date_size);
+    if(!inventory->by_date) return false;
+    for(uint32_t row = 0; row < inventory->rows; row++) inventory->by_date[row] = row;
+    bambu_query_sort_dates = inventory->production_minutes;
+    qsort(inventory->by_date, inventory->rows, sizeof(uint32_t), bambu_query_compare_dates);
+
+    inventory->indexed = true;
+    return true;
+}
+
+// Helper: First position in by_date whose date is >= minutes
+static inline uint32_t bambu_query_lower_bound(const BambuInventory* inventory, uint32_t minutes) {
+    uint32_t lo = 0;
+    uint32_t hi = inventory->rows;
+    while(lo < hi) {
+        uint32_t mid = lo + (hi - lo) / 2;
+        if(inventory->production_minutes[inventory->by_date[mid]] < minutes) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+// Evaluate a query into result (bitmap_words words, one bit per row) and
+// fill the aggregate. Indexes are built on first use.
+// Returns false on allocation failure.
+static inline bool bambu_inventory_query(
+    BambuInventory* inventory,
+    const BambuQuery* query,
+    uint64_t* result,
+    BambuQueryAggregate* aggregate) {
+    if(!inventory->indexed && !bambu_inventory_build_indexes(inventory)) return false;
+    size_t words = inventory->bitmap_words;
+    memset(aggregate, 0, sizeof(BambuQueryAggregate));
+
+    // Start from all rows
+    for(size_t w = 0; w < words; w++) result[w] = ~0ULL;
+    if(inventory->rows % 64) result[words - 1] = (1ULL << (inventory->rows % 64)) - 1;
+
+    size_t scratch_words = words ? words : 1;
+    uint64_t* scratch = bambu_mem_calloc(inventory->allocator, scratch_words, sizeof(uint64_t));
+    if(!scratch) return false;
+
+    // Indexed string fields: OR within a field, AND across fields
+    for(size_t f = 0; f < BambuQueryFieldCount; f++) {
+        if(query->value_count[f] == 0) continue;
+        memset(scratch, 0, words * sizeof(uint64_t));
+        for(size_t v = 0; v < query->value_count[f]; v++) {
+            int32_t code = bambu_string_dict_find(&inventory->dicts[f], query->values[f][v]);
+            if(code < 0) continue;  // Value never seen: matches nothing
+            const uint64_t* bitmap = inventory->bitmaps[f][code];
+            for(size_t w = 0; w < words; w++) scratch[w] |= bitmap[w];
+        }
+        for(size_t w = 0; w < words; w++) result[w] &= scratch[w];
+    }
+
+    // Date range from the sorted index
+    if(query->produced_from || query->produced_to) {
+        memset(scratch, 0, words * sizeof(uint64_t));
+        uint32_t from = query->produced_from ? query->produced_from : 1;  // Skip unknown dates
+        uint32_t begin = bambu_query_lower_bound(inventory, from);
+        uint32_t end = query->produced_to ?
+                           bambu_query_lower_bound(inventory, query->produced_to + 1) :
+                           inventory->rows;
+        for(uint32_t i = begin; i < end; i++) {
+            uint32_t row = inventory->by_date[i];
+            scratch[row / 64] |= 1ULL << (row % 64);
+        }
+        for(size_t w = 0; w < words; w++) result[w] &= scratch[w];
+    }
+    bambu_mem_free(inventory->allocator, scratch, scratch_words * sizeof(uint64_t));
+
+    // Residual weight filter and aggregates over surviving rows only
+    bool weight_filter = query->min_weight_grams || query->max_weight_grams;
+    for(size_t w = 0; w < words; w++) {
+        uint64_t bits = result[w];
+        while(bits) {
+            uint32_t row = (uint32_t)(w * 64 + (size_t)__builtin_ctzll(bits));
+            uint64_t bit = bits & -bits;
+            bits ^= bit;
+
+            uint16_t weight = inventory->weight_grams[row];
+            if(weight_filter && (weight < query->min_weight_grams ||
+                                 (query->max_weight_grams && weight > query->max_weight_grams))) {
+                result[w] ^= bit;
+                continue;
+            }
+
+            uint32_t minutes = inventory->production_minutes[row];
+            aggregate->count++;
+            aggregate->total_weight_grams += weight;
+            aggregate->total_length_m += inventory->filament_length_m[row];
+            if(minutes && (!aggregate->oldest_minutes || minutes < aggregate->oldest_minutes)) {
+                aggregate->oldest_minutes = minutes;
+            }
+            if(minutes > aggregate->newest_minutes) aggregate->newest_minutes = minutes;
+        }
+    }
+    return true;
+}
+
+// Add a value to a query field. Returns false if the field is full.
+static inline bool bambu_query_add_value(BambuQuery* query, BambuQueryField field, const char* value) {
+    if(query->value_count[field] >= BAMBU_QUERY_MAX_VALUES) return false;
+    query->values[field][query->value_count[field]++] = value;
+    return true;
+}
+
+// ============================================================================
+// Command-line query options (shared by bambu_query and bambu_shard)
+// ============================================================================
+
+typedef struct {
+    BambuQuery query;
+    bool count_only;
+    long older_months;  // -1 = not given
+    uint32_t now;       // Reference date for older_months, minutes since epoch
+} BambuQueryOptions;
+
+static inline void bambu_query_options_init(BambuQueryOptions* options, uint32_t now) {
+    memset(options, 0, sizeof(BambuQueryOptions));
+    options->older_months = -1;
+    options->now = now;
+}
+
+// Helper: Parse YYYY-MM-DD or a full YYYY_MM_DD_HH_MM date
+static inline bool bambu_query_parse_date(const char* arg, bool end_of_day, uint32_t* minutes) {
+    char full[17];
+    if(strlen(arg) == 10) {
+        snprintf(full, sizeof(full), "%s_%s", arg, end_of_day ? "23_59" : "00_00");
+        arg = full;
+    }
+    return bambu_date_parse(arg, minutes);
+}
+
+// Helper: Same wall-clock time N calendar months earlier (day clamped to
+// the length of that month)
+static inline uint32_t bambu_query_months_before(uint32_t minutes, unsigned months) {
+    char date[17];
+    bambu_date_format(minutes, date);
+    int32_t month = atoi(date + 5) - 1 - (int32_t)months;
+    int32_t year = atoi(date) + (month >= 0 ? month : month - 11) / 12;
+    month = ((month % 12) + 12) % 12 + 1;
+    if(year < 1970) return 0;
+    int32_t first = bambu_days_from_civil(year, (uint32_t)month, 1);
+    int32_t next = month == 12 ? bambu_days_from_civil(year + 1, 1, 1)
+                               : bambu_days_from_civil(year, (uint32_t)month + 1, 1);
+    int32_t day = atoi(date + 8);
+    if(day > next - first) day = next - first;
+    return (uint32_t)(first + day - 1) * 1440u + minutes % 1440u;
+}
+
+// Parse the query option at argv[*i], advancing *i past its argument.
+// Returns 1 if it was consumed, 0 if argv[*i] is not a query option and
+// -1 if it is invalid. Values are referenced, not copied.
+static inline int bambu_query_parse_option(BambuQueryOptions* options, int argc, char** argv, int* i) {
+    const char* opt = argv[*i];
+    const char* arg = *i + 1 < argc ? argv[*i + 1] : NULL;
+    BambuQuery* query = &options->query;
+    BambuQueryField field = BambuQueryFieldCount;
+
+    if(strcmp(opt, "-t") == 0 || strcmp(opt, "--type") == 0) {
+        field = BambuQueryFieldType;
+    } else if(strcmp(opt, "-d") == 0 || strcmp(opt, "--detailed") == 0) {
+        field = BambuQueryFieldDetailedType;
+    } else if(strcmp(opt, "-c") == 0 || strcmp(opt, "--color") == 0) {
+        field = BambuQueryFieldColor;
+    } else if(strcmp(opt, "--count") == 0) {
+        options->count_only = true;
+        return 1;
+    } else if(strcmp(opt, "--produced-after") != 0 && strcmp(opt, "--produced-before") != 0 &&
+              strcmp(opt, "--now") != 0 && strcmp(opt, "--older-than-months") != 0 &&
+              strcmp(opt, "--min-weight") != 0 && strcmp(opt, "--max-weight") != 0) {
+        return 0;
+    }
+
+    if(!arg) return -1;
+    (*i)++;
+    if(field != BambuQueryFieldCount) {
+        if(!bambu_query_add_value(query, field, arg)) {
+            fprintf(stderr, "Too many values for %s\n", opt);
+            return -1;
+        }
+    } else if(strcmp(opt, "--produced-after") == 0) {
+        if(!bambu_query_parse_date(arg, false, &query->produced_from)) return -1;
+    } else if(strcmp(opt, "--produced-before") == 0) {
+        if(!bambu_query_parse_date(arg, true, &query->produced_to)) return -1;
+    } else if(strcmp(opt, "--now") == 0) {
+        if(!bambu_query_parse_date(arg, false, &options->now)) return -1;
+    } else if(strcmp(opt, "--older-than-months") == 0) {
+        options->older_months = atol(arg);
+        if(options->older_months < 0) return -1;
+    } else if(strcmp(opt, "--min-weight") == 0) {
+        query->min_weight_grams = (uint16_t)atoi(arg);
+    } else {
+        query->max_weight_grams = (uint16_t)atoi(arg);
+    }
+    return 1;
+}
+
+// Fold --older-than-months into the production date range
+static inline void bambu_query_options_finish(BambuQueryOptions* options) {
+    if(options->older_months < 0) return;
+    uint32_t cutoff = bambu_query_months_before(options->now, (unsigned)options->older_months);
+    if(cutoff == 0) cutoff = 1;  // Nothing qualifies; keep the range non-open
+    if(!options->query.produced_to || cutoff < options->query.produced_to) {
+        options->query.produced_to = cutoff;
+    }
+}
+
+#endif // BAMBU_QUERY_H
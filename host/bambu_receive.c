@@ -0,0 +1,153 @@
+/**
+ * bambu_receive - Receive spool records streamed by the Flipper plugin
+ *
+ * Reads record frames from the Flipper's USB CDC serial port (plugin built
+ * with `make build STREAM_CDC=1`) and prints one tab-separated line per
+ * scanned spool. Optionally appends the raw frames to an inventory log.
+ *
+ * Usage: bambu_receive [-l LOG] [-c CATALOG] DEVICE
+ *   DEVICE      Serial device (e.g. /dev/ttyACM0), pipe or "-" for stdin
+ *   -l LOG      Append every received record frame to LOG
+ *   -c CATALOG  Prepend a color_name column from a catalog file
+ *               (host/bambu_catalog.h); send SIGHUP to reload it without
+ *               interrupting reception
+ */
+
+#include "bambu_host.h"
+#include "bambu_stream.h"
+#include "bambu_catalog.h"
+
+#include <signal.h>
+
+typedef struct {
+    FILE* log;
+    const char* catalog_path;
+    BambuCatalog catalog;
+    int catalog_reader;
+} ReceiveContext;
+
+// Reloads the catalog on every SIGHUP (blocked in all other threads)
+static void* catalog_reload_thread(void* context) {
+    ReceiveContext* ctx = context;
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGHUP);
+    for(;;) {
+        int signal;
+        if(sigwait(&signals, &signal) != 0) continue;
+        size_t bad_line;
+        if(bambu_catalog_reload(&ctx->catalog, ctx->catalog_path, &bad_line)) {
+            fprintf(stderr, "Catalog reloaded (version %llu)\n", (unsigned long long)ctx->catalog.published);
+        } else {
+            fprintf(stderr, "Catalog reload failed at line %zu, keeping the current one\n", bad_line);
+        }
+    }
+    return NULL;
+}
+
+static bool start_catalog(ReceiveContext* ctx) {
+    size_t bad_line;
+    BambuCatalogSnapshot* snapshot = bambu_catalog_snapshot_load(ctx->catalog_path, &bad_line);
+    if(!snapshot) {
+        fprintf(stderr, "Cannot load catalog %s (line %zu)\n", ctx->catalog_path, bad_line);
+        return false;
+    }
+    if(!bambu_catalog_init(&ctx->catalog, snapshot)) {
+        bambu_catalog_snapshot_free(snapshot);
+        return false;
+    }
+    ctx->catalog_reader = bambu_catalog_reader_register(&ctx->catalog);
+
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGHUP);
+    pthread_sigmask(SIG_BLOCK, &signals, NULL);
+    pthread_t thread;
+    if(pthread_create(&thread, NULL, catalog_reload_thread, ctx) != 0) return false;
+    pthread_detach(thread);
+    return true;
+}
+
+static void on_record(const BambuSpoolRecord* record, uint32_t scan_time, void* context) {
+    ReceiveContext* ctx = context;
+
+    if(ctx->catalog_path) {
+        const BambuCatalogSnapshot* snapshot = bambu_catalog_enter(&ctx->catalog, ctx->catalog_reader);
+        const BambuFilamentInfo* info = bambu_catalog_snapshot_lookup(snapshot, record->variant_id);
+        printf("%s\t", info ? info->color_name : "");
+        bambu_catalog_exit(&ctx->catalog, ctx->catalog_reader);
+    }
+    bambu_record_print_tsv(stdout, record, scan_time);
+    fflush(stdout);
+
+    if(ctx->log) {
+        uint8_t payload[BAMBU_FRAME_MAX_PAYLOAD];
+        uint8_t frame[BAMBU_FRAME_MAX_SIZE];
+        size_t payload_len = bambu_record_pack(record, scan_time, payload);
+        size_t frame_len =
+            bambu_frame_encode(BambuFrameTypeRecord, payload, (uint8_t)payload_len, frame);
+        fwrite(frame, 1, frame_len, ctx->log);
+        fflush(ctx->log);
+    }
+}
+
+static void usage(void) {
+    fprintf(stderr, "Usage: bambu_receive [-l LOG] [-c CATALOG] DEVICE\n");
+}
+
+int main(int argc, char* argv[]) {
+    ReceiveContext ctx = {0};
+    const char* device = NULL;
+
+    for(int i = 1; i < argc; i++) {
+        if(strcmp(argv[i], "-l") == 0 && i + 1 < argc) {
+            ctx.log = fopen(argv[++i], "ab");
+            if(!ctx.log) {
+                perror(argv[i]);
+                return 1;
+            }
+        } else if(strcmp(argv[i], "-c") == 0 && i + 1 < argc) {
+            ctx.catalog_path = argv[++i];
+        } else if(!device) {
+            device = argv[i];
+        } else {
+            usage();
+            return 1;
+        }
+    }
+    if(!device) {
+        usage();
+        return 1;
+    }
+    if(ctx.catalog_path && !start_catalog(&ctx)) return 1;
+
+    int fd = strcmp(device, "-") == 0 ? STDIN_FILENO : bambu_stream_open(device);
+    if(fd < 0) {
+        perror(device);
+        return 1;
+    }
+
+    BambuStream stream;
+    bambu_stream_init(&stream, on_record, &ctx);
+
+    if(ctx.catalog_path) printf("color_name\t");
+    printf(BAMBU_TSV_HEADER);
+    fflush(stdout);
+    ssize_t n;
+    while((n = bambu_stream_pump(&stream, fd)) > 0) {
+    }
+    if(n < 0 && errno != EIO) {  // EIO: serial device unplugged
+        perror(device);
+    }
+
+    fprintf(
+        stderr,
+        "%u records, %u CRC errors, %u malformed\n",
+        stream.records,
+        stream.rx.crc_errors,
+        stream.bad_records);
+
+    if(fd != STDIN_FILENO) close(fd);
+    if(ctx.log) fclose(ctx.log);
+    return 0;
+}
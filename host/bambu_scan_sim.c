@@ -0,0 +1,200 @@
+/**
+ * bambu_scan_sim - Compare read strategies on a simulated Mifare Classic
+ *
+ * Loads every dump as a simulated card (host/bambu_sim.h) and scans it
+ * with the plugin's verify/read/parse path (plugin/bambu_read.h), RUNS
+ * times per strategy. Reports simulated wall time per scan, so strategy
+ * or timing changes can be judged without hardware.
+ *
+ * Usage: bambu_scan_sim [OPTION...] [PATH...]
+ *   PATH              dump file, directory (searched recursively) or "-"
+ *                     to read paths from stdin. Defaults to "-".
+ *   -s STRATEGY       dictionary, derived, sector-limited or all (default)
+ *   -n RUNS           Scans per dump and strategy (default 10)
+ *   --seed N          Failure generator seed (default 1)
+ *   --dict-uids N     Spools in the modelled user dictionary (default 100)
+ *   --fail-rate R     Transient failure probability of every operation
+ *   --setup-us, --select-us, --auth-us, --auth-fail-us, --read-us US
+ *                     Per-operation costs (defaults in bambu_sim.h)
+ *
+ * Output: one tab-separated line per strategy:
+ *   STRATEGY  SCANS  DECODED%  MEAN_MS  P50_MS  P95_MS  MAX_MS  AUTHS/SCAN  READS/SCAN
+ */
+
+#include "bambu_host.h"
+#include "bambu_sim.h"
+
+#define SIM_NUM_STRATEGIES 3
+
+typedef struct {
+    uint64_t* elapsed_us;  // One entry per scan
+    size_t count;
+    size_t capacity;
+    size_t decoded;
+    uint64_t auths;
+    uint64_t reads;
+} StrategyResults;
+
+typedef struct {
+    BambuSimTiming timing;
+    bool enabled[SIM_NUM_STRATEGIES];
+    size_t runs;
+    size_t dict_uids;
+    size_t dumps;
+    size_t unreadable;
+    StrategyResults results[SIM_NUM_STRATEGIES];
+} SimContext;
+
+static bool results_add(StrategyResults* results, const BambuSimScan* scan) {
+    if(results->count == results->capacity) {
+        size_t capacity = results->capacity ? results->capacity * 2 : 1024;
+        uint64_t* grown = realloc(results->elapsed_us, capacity * sizeof(uint64_t));
+        if(!grown) return false;
+        results->elapsed_us = grown;
+        results->capacity = capacity;
+    }
+    results->elapsed_us[results->count++] = scan->elapsed_us;
+    if(scan->decoded) results->decoded++;
+    results->auths += scan->verify_stats.auths + scan->read_stats.auths;
+    results->reads += scan->verify_stats.reads + scan->read_stats.reads;
+    return true;
+}
+
+static bool on_input(const char* path, void* context) {
+    SimContext* ctx = context;
+
+    MfClassicData data;
+    if(!bambu_nfc_load(path, &data)) {
+        ctx->unreadable++;
+        return true;
+    }
+
+    // Each dump gets its own failure sequence, independent of input order
+    BambuSimTiming timing = ctx->timing;
+    timing.seed = bambu_hash_mix(ctx->timing.seed ^ bambu_hash_bytes(BAMBU_HASH_SEED, path, strlen(path)));
+
+    for(size_t strategy = 0; strategy < SIM_NUM_STRATEGIES; strategy++) {
+        if(!ctx->enabled[strategy]) continue;
+        BambuSimCard card;
+        bambu_sim_card_init(&card, &data, &timing);
+        BambuSimDictionary dict;
+        BambuReadDictionary source;
+        bambu_sim_dictionary_init(&dict, &source, &card, ctx->dict_uids);
+
+        for(size_t run = 0; run < ctx->runs; run++) {
+            BambuSimScan scan;
+            bambu_sim_scan(&card, (BambuReadStrategy)strategy, &source, &scan);
+            if(!results_add(&ctx->results[strategy], &scan)) return false;
+        }
+    }
+    ctx->dumps++;
+    return true;
+}
+
+static int compare_u64(const void* a, const void* b) {
+    uint64_t x = *(const uint64_t*)a;
+    uint64_t y = *(const uint64_t*)b;
+    return (x > y) - (x < y);
+}
+
+// Helper: Nearest-rank percentile of sorted values
+static uint64_t percentile(const uint64_t* sorted, size_t count, unsigned pct) {
+    size_t rank = (count * pct + 99) / 100;
+    return sorted[rank ? rank - 1 : 0];
+}
+
+static void print_results(const char* name, StrategyResults* results) {
+    if(results->count == 0) return;
+    qsort(results->elapsed_us, results->count, sizeof(uint64_t), compare_u64);
+    uint64_t total = 0;
+    for(size_t i = 0; i < results->count; i++) total += results->elapsed_us[i];
+
+    printf(
+        "%s\t%zu\t%.1f\t%.1f\t%.1f\t%.1f\t%.1f\t%.1f\t%.1f\n",
+        name,
+        results->count,
+        100.0 * (double)results->decoded / (double)results->count,
+        (double)total / (double)results->count / 1000.0,
+        (double)percentile(results->elapsed_us, results->count, 50) / 1000.0,
+        (double)percentile(results->elapsed_us, results->count, 95) / 1000.0,
+        (double)results->elapsed_us[results->count - 1] / 1000.0,
+        (double)results->auths / (double)results->count,
+        (double)results->reads / (double)results->count);
+}
+
+static int usage(void) {
+    fprintf(stderr, "Usage: bambu_scan_sim [-s STRATEGY|all] [-n RUNS] [--seed N] [--dict-uids N]\n");
+    fprintf(stderr, "                      [--fail-rate R] [--setup-us US] [--select-us US]\n");
+    fprintf(stderr, "                      [--auth-us US] [--auth-fail-us US] [--read-us US] [PATH...]\n");
+    return 1;
+}
+
+int main(int argc, char* argv[]) {
+    SimContext ctx;
+    memset(&ctx, 0, sizeof(ctx));
+    ctx.timing = (BambuSimTiming)BAMBU_SIM_TIMING_DEFAULT;
+    ctx.runs = 10;
+    ctx.dict_uids = 100;
+    const char* strategy = "all";
+    char* inputs[argc];
+    int input_count = 0;
+
+    for(int i = 1; i < argc; i++) {
+        const char* opt = argv[i];
+        if(opt[0] != '-' || opt[1] == '\0') {
+            inputs[input_count++] = argv[i];
+            continue;
+        }
+        if(i + 1 >= argc) return usage();
+        const char* arg = argv[++i];
+
+        if(strcmp(opt, "-s") == 0) {
+            strategy = arg;
+        } else if(strcmp(opt, "-n") == 0) {
+            ctx.runs = strtoull(arg, NULL, 10);
+        } else if(strcmp(opt, "--seed") == 0) {
+            ctx.timing.seed = strtoull(arg, NULL, 0);
+        } else if(strcmp(opt, "--dict-uids") == 0) {
+            ctx.dict_uids = strtoull(arg, NULL, 10);
+        } else if(strcmp(opt, "--fail-rate") == 0) {
+            double rate = atof(arg);
+            if(rate < 0.0 || rate >= 1.0) return usage();
+            ctx.timing.select_fail_rate = rate;
+            ctx.timing.auth_fail_rate = rate;
+            ctx.timing.read_fail_rate = rate;
+        } else if(strcmp(opt, "--setup-us") == 0) {
+            ctx.timing.setup_us = (uint32_t)strtoul(arg, NULL, 10);
+        } else if(strcmp(opt, "--select-us") == 0) {
+            ctx.timing.select_us = (uint32_t)strtoul(arg, NULL, 10);
+        } else if(strcmp(opt, "--auth-us") == 0) {
+            ctx.timing.auth_us = (uint32_t)strtoul(arg, NULL, 10);
+        } else if(strcmp(opt, "--auth-fail-us") == 0) {
+            ctx.timing.auth_fail_us = (uint32_t)strtoul(arg, NULL, 10);
+        } else if(strcmp(opt, "--read-us") == 0) {
+            ctx.timing.read_us = (uint32_t)strtoul(arg, NULL, 10);
+        } else {
+            return usage();
+        }
+    }
+
+    bool known = strcmp(strategy, "all") == 0;
+    for(size_t s = 0; s < SIM_NUM_STRATEGIES; s++) {
+        ctx.enabled[s] = known || strcmp(strategy, BAMBU_READ_STRATEGY_NAMES[s]) == 0;
+        if(ctx.enabled[s]) known = true;
+    }
+    if(!known || ctx.runs == 0) return usage();
+    if(input_count == 0) inputs[input_count++] = "-";
+
+    if(!bambu_host_for_each_input(inputs, input_count, on_input, &ctx)) {
+        fprintf(stderr, "Out of memory\n");
+        return 1;
+    }
+
+    printf("STRATEGY\tSCANS\tDECODED%%\tMEAN_MS\tP50_MS\tP95_MS\tMAX_MS\tAUTHS/SCAN\tREADS/SCAN\n");
+    for(size_t s = 0; s < SIM_NUM_STRATEGIES; s++) {
+        print_results(BAMBU_READ_STRATEGY_NAMES[s], &ctx.results[s]);
+        free(ctx.results[s].elapsed_us);
+    }
+    fprintf(stderr, "%zu dumps simulated, %zu unreadable\n", ctx.dumps, ctx.unreadable);
+    return 0;
+}
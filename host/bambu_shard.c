@@ -0,0 +1,160 @@
+/**
+ * bambu_shard - Query an inventory partitioned across worker processes
+ *
+ * Starts one worker process per shard, routes every record to the shard
+ * owning its tag UID on a consistent hash ring (host/bambu_shard.h), then
+ * fans the query out to all shards and prints the merged result the way
+ * bambu_query does: matching records as TSV (in no particular order)
+ * followed by an aggregate line on stderr. Each shard keeps only the
+ * latest scan of its tags. The per-shard distribution goes to stderr.
+ *
+ * Usage: bambu_shard [-n SHARDS] [--vnodes V] [OPTION...] [INPUT...]
+ *   INPUT       .log frame log (bambu_receive -l), .bspc file, dump file,
+ *               directory or "-" for a stdin path list (default "-")
+ *   -n SHARDS   Worker processes (default: number of online CPUs)
+ *   --vnodes V  Ring points per shard (default 64)
+ *   OPTION      Any bambu_query filter, or --count
+ *
+ * Example: PETG over 500 g across 8 workers
+ *   bambu_shard -n 8 -t PETG --min-weight 501 inventory.log
+ */
+
+#include "bambu_host.h"
+#include "bambu_columnar.h"
+#include "bambu_shard.h"
+
+#include <time.h>
+
+typedef struct {
+    BambuShardRouter router;
+    size_t skipped;
+    bool failed;
+} ShardContext;
+
+static bool add_record(const BambuSpoolRecord* record, uint32_t scan_time, void* context) {
+    ShardContext* ctx = context;
+    return bambu_shard_router_add(&ctx->router, record, scan_time);
+}
+
+static bool on_input(const char* path, void* context) {
+    ShardContext* ctx = context;
+
+    if(bambu_host_has_suffix(path, ".log") || bambu_host_has_suffix(path, ".bspc")) {
+        bool ok = bambu_record_file_load(path, add_record, ctx);
+        if(!ok) ctx->failed = true;
+        return ok;
+    }
+
+    MfClassicData data;
+    BambuSpoolRecord record;
+    if(!bambu_nfc_load(path, &data) || !bambu_decode(&data, &record)) {
+        ctx->skipped++;
+        return true;
+    }
+    if(!add_record(&record, 0, ctx)) {
+        ctx->failed = true;
+        return false;
+    }
+    return true;
+}
+
+static bool print_row(const BambuSpoolRecord* record, uint32_t scan_time, void* context) {
+    bambu_record_print_tsv(context, record, scan_time);
+    return true;
+}
+
+static int usage(void) {
+    fprintf(stderr, "Usage: bambu_shard [-n SHARDS] [--vnodes V] [OPTION...] [INPUT...]\n");
+    fprintf(stderr, "  OPTION: any bambu_query filter, or --count\n");
+    return 1;
+}
+
+int main(int argc, char* argv[]) {
+    static char* const stdin_input[] = {"-"};
+
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    uint32_t shards = cpus > 0 ? (uint32_t)cpus : 1;
+    uint32_t vnodes = BAMBU_SHARD_VNODES;
+    BambuQueryOptions options;
+    bambu_query_options_init(&options, (uint32_t)(time(NULL) / 60));
+    char* inputs[argc];
+    int input_count = 0;
+
+    for(int i = 1; i < argc; i++) {
+        int parsed = bambu_query_parse_option(&options, argc, argv, &i);
+        if(parsed < 0) return usage();
+        if(parsed > 0) continue;
+        if(strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+            shards = (uint32_t)strtoul(argv[++i], NULL, 10);
+            if(shards == 0 || shards > 1024) return usage();
+        } else if(strcmp(argv[i], "--vnodes") == 0 && i + 1 < argc) {
+            vnodes = (uint32_t)strtoul(argv[++i], NULL, 10);
+            if(vnodes == 0 || vnodes > 4096) return usage();
+        } else if(argv[i][0] == '-' && argv[i][1] != '\0') {
+            return usage();
+        } else {
+            inputs[input_count++] = argv[i];
+        }
+    }
+    bambu_query_options_finish(&options);
+
+    ShardContext ctx = {0};
+    fflush(NULL);
+    if(!bambu_shard_router_start(&ctx.router, shards, vnodes)) {
+        fprintf(stderr, "Failed to start %u workers\n", shards);
+        return 1;
+    }
+    if(input_count > 0) {
+        bambu_host_for_each_input(inputs, input_count, on_input, &ctx);
+    } else {
+        bambu_host_for_each_input(stdin_input, 1, on_input, &ctx);
+    }
+
+    int status = 1;
+    BambuQueryAggregate aggregate;
+    uint32_t rows;
+    if(!options.count_only) printf(BAMBU_TSV_HEADER);
+    if(!ctx.failed && bambu_shard_router_query(
+                          &ctx.router,
+                          &options.query,
+                          options.count_only ? NULL : print_row,
+                          stdout,
+                          &aggregate,
+                          &rows)) {
+        char oldest[17] = "-";
+        char newest[17] = "-";
+        if(aggregate.oldest_minutes) bambu_date_format(aggregate.oldest_minutes, oldest);
+        if(aggregate.newest_minutes) bambu_date_format(aggregate.newest_minutes, newest);
+        fflush(stdout);
+        fprintf(
+            options.count_only ? stdout : stderr,
+            "%u of %u spools match, %llu g, %llu m, produced %s .. %s (%zu inputs skipped)\n",
+            aggregate.count,
+            rows,
+            (unsigned long long)aggregate.total_weight_grams,
+            (unsigned long long)aggregate.total_length_m,
+            oldest,
+            newest,
+            ctx.skipped);
+        fflush(stdout);
+        for(uint32_t i = 0; i < ctx.router.count; i++) {
+            const BambuShardWorker* worker = &ctx.router.workers[i];
+            fprintf(
+                stderr,
+                "shard %u: %llu records, %u tags, %u matches\n",
+                i,
+                (unsigned long long)worker->routed,
+                worker->last.rows,
+                worker->last.aggregate.count);
+        }
+        status = 0;
+    } else {
+        fprintf(stderr, "Query failed\n");
+    }
+
+    if(!bambu_shard_router_stop(&ctx.router)) {
+        fprintf(stderr, "A worker failed\n");
+        status = 1;
+    }
+    return status;
+}
@@ -0,0 +1,561 @@
+// Bambu Lab NFC Parser - Sharded Inventory
+// Partitions an inventory across worker processes by tag UID:
+//   - consistent hash ring: every shard owns BAMBU_SHARD_VNODES points on a
+//     64-bit ring and a tag belongs to the first point at or after the hash
+//     of its UID, so adding a shard moves only ~1/N of the tags
+//   - partition: one BambuInventory per worker holding the latest scan of
+//     each of its tags (ties keep the first record, as bambu_merge does)
+//   - router: batches records per shard over a SOCK_SEQPACKET socket pair,
+//     fans every query out to all workers and merges their aggregates
+// Workers are forked local processes; the message protocol carries only
+// packed records (plugin/bambu_frame.h) and fixed-size fields, so a worker
+// could equally sit behind a stream socket on another node.
+//
+// Requires bambu_host.h to be included first.
+
+#ifndef BAMBU_SHARD_H
+#define BAMBU_SHARD_H
+
+#include <errno.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "../plugin/bambu_frame.h"
+#include "bambu_hash.h"
+#include "bambu_query.h"
+
+#define BAMBU_SHARD_VNODES      64     // Ring points per shard
+#define BAMBU_SHARD_MESSAGE_MAX 65536  // Largest socket message
+
+// ============================================================================
+// Consistent hash ring
+// ============================================================================
+
+typedef struct {
+    uint64_t hash;
+    uint32_t shard;
+} BambuRingPoint;
+
+typedef struct {
+    const BambuAllocator* allocator;
+    BambuRingPoint* points;  // Sorted by hash
+    size_t count;
+    uint32_t shards;
+} BambuRing;
+
+// Helper: qsort order of ring points
+static inline int bambu_ring_compare(const void* a, const void* b) {
+    const BambuRingPoint* x = a;
+    const BambuRingPoint* y = b;
+    if(x->hash != y->hash) return x->hash < y->hash ? -1 : 1;
+    return x->shard < y->shard ? -1 : x->shard > y->shard;
+}
+
+// Place vnodes points for each of shards shards. A shard's points depend
+// only on its number, so rings of N and N+1 shards share N shards' points.
+static inline bool bambu_ring_init(BambuRing* ring, uint32_t shards, uint32_t vnodes) {
+    memset(ring, 0, sizeof(BambuRing));
+    if(shards == 0 || vnodes == 0) return false;
+    ring->allocator = bambu_allocator();
+    ring->points = bambu_mem_alloc(ring->allocator, (size_t)shards * vnodes * sizeof(BambuRingPoint));
+    if(!ring->points) return false;
+    for(uint32_t shard = 0; shard < shards; shard++) {
+        for(uint32_t v = 0; v < vnodes; v++) {
+            BambuRingPoint* point = &ring->points[ring->count++];
+            point->hash = bambu_hash_mix(((uint64_t)shard << 32 | v) + BAMBU_HASH_SEED);
+            point->shard = shard;
+        }
+    }
+    qsort(ring->points, ring->count, sizeof(BambuRingPoint), bambu_ring_compare);
+    ring->shards = shards;
+    return true;
+}
+
+static inline void bambu_ring_free(BambuRing* ring) {
+    bambu_mem_free(ring->allocator, ring->points, ring->count * sizeof(BambuRingPoint));
+    memset(ring, 0, sizeof(BambuRing));
+}
+
+// Helper: Ring position of a tag UID
+static inline uint64_t bambu_shard_uid_hash(const uint8_t* uid, size_t uid_len) {
+    return bambu_hash_mix(bambu_hash_bytes(BAMBU_HASH_SEED, uid, uid_len));
+}
+
+// Shard owning a tag UID: first ring point at or after its hash (wrapping)
+static inline uint32_t bambu_ring_shard(const BambuRing* ring, const uint8_t* uid, size_t uid_len) {
+    uint64_t hash = bambu_shard_uid_hash(uid, uid_len);
+    size_t lo = 0;
+    size_t hi = ring->count;
+    while(lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if(ring->points[mid].hash < hash) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return ring->points[lo == ring->count ? 0 : lo].shard;
+}
+
+// ============================================================================
+// Partition: latest scan per tag UID
+// ============================================================================
+
+typedef struct {
+    BambuInventory inventory;
+    BambuHashIndex by_uid;  // UID hash -> row
+    uint64_t added;         // Records received
+    uint64_t replaced;      // Rows overwritten by a later scan
+} BambuShardPartition;
+
+static inline bool bambu_shard_partition_init(BambuShardPartition* partition) {
+    memset(partition, 0, sizeof(BambuShardPartition));
+    if(!bambu_inventory_init(&partition->inventory)) return false;
+    return bambu_hash_index_init(&partition->by_uid, 1024);
+}
+
+static inline void bambu_shard_partition_free(BambuShardPartition* partition) {
+    bambu_inventory_free(&partition->inventory);
+    if(partition->by_uid.slots) bambu_hash_index_free(&partition->by_uid);
+    memset(partition, 0, sizeof(BambuShardPartition));
+}
+
+// Insert a record, or replace its tag's row if it was scanned later.
+// Returns false on allocation failure.
+static inline bool bambu_shard_partition_put(
+    BambuShardPartition* partition,
+    const BambuSpoolRecord* record,
+    uint32_t scan_time) {
+    BambuInventory* inventory = &partition->inventory;
+    uint64_t key = bambu_hash_bytes(BAMBU_HASH_SEED, record->uid, record->uid_len);
+    uint32_t row = bambu_hash_index_put(&partition->by_uid, key, inventory->rows);
+    if(row == BAMBU_HASH_INDEX_EMPTY) return false;
+    partition->added++;
+    if(row < inventory->rows) {
+        if(scan_time <= inventory->scan_time[row]) return true;
+        partition->replaced++;
+    }
+    return bambu_inventory_set(inventory, row, record, scan_time);
+}
+
+// ============================================================================
+// Messages
+// ============================================================================
+// Every message starts with a type byte. Record batches carry a u16 count
+// followed by count (u8 length, packed record) entries.
+
+typedef enum {
+    BambuShardMsgAdd = 'A',     // Router -> worker: record batch
+    BambuShardMsgQuery = 'Q',   // Router -> worker: query
+    BambuShardMsgRows = 'R',    // Worker -> router: matching record batch
+    BambuShardMsgDone = 'D',    // Worker -> router: BambuShardDone
+} BambuShardMsgType;
+
+// Query end marker, sent by every worker after its matching rows
+typedef struct {
+    BambuQueryAggregate aggregate;
+    uint32_t rows;      // Partition size (distinct tags)
+    uint64_t added;     // Records received
+    uint64_t replaced;  // Rows overwritten by a later scan
+} BambuShardDone;
+
+typedef struct {
+    uint8_t data[BAMBU_SHARD_MESSAGE_MAX];
+    size_t len;
+    uint16_t count;
+} BambuShardBatch;
+
+static inline void bambu_shard_batch_reset(BambuShardBatch* batch, BambuShardMsgType type) {
+    batch->data[0] = (uint8_t)type;
+    batch->len = 3;
+    batch->count = 0;
+}
+
+// Helper: Write a message; SOCK_SEQPACKET keeps it in one piece
+static inline bool bambu_shard_send(int fd, const void* data, size_t len) {
+    ssize_t sent;
+    do {
+        sent = send(fd, data, len, MSG_NOSIGNAL);
+    } while(sent < 0 && errno == EINTR);
+    return sent == (ssize_t)len;
+}
+
+static inline bool bambu_shard_batch_send(int fd, BambuShardBatch* batch) {
+    if(batch->count == 0) return true;
+    batch->data[1] = (uint8_t)(batch->count & 0xFF);
+    batch->data[2] = (uint8_t)(batch->count >> 8);
+    BambuShardMsgType type = batch->data[0];
+    bool ok = bambu_shard_send(fd, batch->data, batch->len);
+    bambu_shard_batch_reset(batch, type);
+    return ok;
+}
+
+// Append a record, sending the batch first if it is full
+static inline bool bambu_shard_batch_add(
+    int fd,
+    BambuShardBatch* batch,
+    const BambuSpoolRecord* record,
+    uint32_t scan_time) {
+    if(batch->len + 1 + BAMBU_FRAME_MAX_PAYLOAD > sizeof(batch->data) || batch->count == UINT16_MAX) {
+        if(!bambu_shard_batch_send(fd, batch)) return false;
+    }
+    size_t len = bambu_record_pack(record, scan_time, &batch->data[batch->len + 1]);
+    batch->data[batch->len] = (uint8_t)len;
+    batch->len += 1 + len;
+    batch->count++;
+    return true;
+}
+
+// Helper: Pass every record of a batch message to put. Returns false if
+// the message is malformed or put fails.
+static inline bool bambu_shard_batch_each(
+    const uint8_t* msg,
+    size_t len,
+    bool (*put)(const BambuSpoolRecord* record, uint32_t scan_time, void* context),
+    void* context) {
+    if(len < 3) return false;
+    uint16_t count = (uint16_t)(msg[1] | (msg[2] << 8));
+    size_t pos = 3;
+    for(uint16_t i = 0; i < count; i++) {
+        if(pos >= len || pos + 1 + msg[pos] > len) return false;
+        BambuSpoolRecord record;
+        uint32_t scan_time;
+        if(!bambu_record_unpack(&msg[pos + 1], msg[pos], &record, &scan_time)) return false;
+        if(!put(&record, scan_time, context)) return false;
+        pos += 1 + msg[pos];
+    }
+    return pos == len;
+}
+
+// Helper: Serialize a query: want_rows, then per field a value count and
+// length-prefixed values, then the date and weight ranges
+static inline size_t bambu_shard_query_encode(const BambuQuery* query, bool want_rows, uint8_t* out) {
+    size_t pos = 0;
+    out[pos++] = BambuShardMsgQuery;
+    out[pos++] = want_rows;
+    for(size_t f = 0; f < BambuQueryFieldCount; f++) {
+        out[pos++] = (uint8_t)query->value_count[f];
+        for(size_t v = 0; v < query->value_count[f]; v++) {
+            size_t len = strlen(query->values[f][v]);
+            if(len > UINT8_MAX) len = UINT8_MAX;  // Longer than any dictionary value
+            out[pos++] = (uint8_t)len;
+            memcpy(&out[pos], query->values[f][v], len);
+            pos += len;
+        }
+    }
+    memcpy(&out[pos], &query->produced_from, sizeof(uint32_t));
+    memcpy(&out[pos + 4], &query->produced_to, sizeof(uint32_t));
+    memcpy(&out[pos + 8], &query->min_weight_grams, sizeof(uint16_t));
+    memcpy(&out[pos + 10], &query->max_weight_grams, sizeof(uint16_t));
+    return pos + 12;
+}
+
+// Helper: Inverse of bambu_shard_query_encode. Values are copied into text
+// (at least len bytes) and referenced from query.
+static inline bool bambu_shard_query_decode(
+    const uint8_t* msg,
+    size_t len,
+    BambuQuery* query,
+    bool* want_rows,
+    char* text) {
+    memset(query, 0, sizeof(BambuQuery));
+    if(len < 2) return false;
+    *want_rows = msg[1] != 0;
+    size_t pos = 2;
+    for(size_t f = 0; f < BambuQueryFieldCount; f++) {
+        if(pos >= len || msg[pos] > BAMBU_QUERY_MAX_VALUES) return false;
+        size_t count = msg[pos++];
+        for(size_t v = 0; v < count; v++) {
+            if(pos >= len || pos + 1 + msg[pos] > len) return false;
+            size_t value_len = msg[pos++];
+            memcpy(text, &msg[pos], value_len);
+            text[value_len] = '\0';
+            bambu_query_add_value(query, f, text);
+            text += value_len + 1;
+            pos += value_len;
+        }
+    }
+    if(pos + 12 != len) return false;
+    memcpy(&query->produced_from, &msg[pos], sizeof(uint32_t));
+    memcpy(&query->produced_to, &msg[pos + 4], sizeof(uint32_t));
+    memcpy(&query->min_weight_grams, &msg[pos + 8], sizeof(uint16_t));
+    memcpy(&query->max_weight_grams, &msg[pos + 10], sizeof(uint16_t));
+    return true;
+}
+
+// ============================================================================
+// Worker
+// ============================================================================
+
+// Helper: Batch callback storing records into the partition
+static inline bool bambu_shard_worker_put(const BambuSpoolRecord* record, uint32_t scan_time, void* context) {
+    return bambu_shard_partition_put(context, record, scan_time);
+}
+
+// Helper: Answer one query with matching rows (if wanted) and a Done message
+static inline bool bambu_shard_worker_query(
+    int fd,
+    BambuShardPartition* partition,
+    const uint8_t* msg,
+    size_t len,
+    BambuShardBatch* batch) {
+    char text[BAMBU_SHARD_MESSAGE_MAX];
+    BambuQuery query;
+    bool want_rows;
+    if(!bambu_shard_query_decode(msg, len, &query, &want_rows, text)) return false;
+
+    BambuInventory* inventory = &partition->inventory;
+    size_t matches_size = (inventory->rows / 64 + 1) * sizeof(uint64_t);
+    uint64_t* matches = bambu_mem_alloc(inventory->allocator, matches_size);
+    BambuShardDone done = {
+        .rows = inventory->rows,
+        .added = partition->added,
+        .replaced = partition->replaced,
+    };
+    bool ok = matches && bambu_inventory_query(inventory, &query, matches, &done.aggregate);
+    bambu_shard_batch_reset(batch, BambuShardMsgRows);
+    for(uint32_t row = 0; ok && want_rows && row < inventory->rows; row++) {
+        if(!(matches[row / 64] & (1ULL << (row % 64)))) continue;
+        ok = bambu_shard_batch_add(fd, batch, &inventory->records[row], inventory->scan_time[row]);
+    }
+    ok = ok && bambu_shard_batch_send(fd, batch);
+    bambu_mem_free(inventory->allocator, matches, matches_size);
+    if(!ok) return false;
+
+    uint8_t out[1 + sizeof(BambuShardDone)];
+    out[0] = BambuShardMsgDone;
+    memcpy(&out[1], &done, sizeof(done));
+    return bambu_shard_send(fd, out, sizeof(out));
+}
+
+// Serve one partition over fd until the router closes it.
+// Returns the process exit status (0 on a clean shutdown).
+static inline int bambu_shard_worker_run(int fd) {
+    BambuShardPartition partition;
+    const BambuAllocator* allocator = bambu_allocator();
+    BambuShardBatch* batch = bambu_mem_alloc(allocator, sizeof(BambuShardBatch));
+    uint8_t* msg = bambu_mem_alloc(allocator, BAMBU_SHARD_MESSAGE_MAX);
+    bool ok = batch && msg && bambu_shard_partition_init(&partition);
+    if(!ok) {
+        bambu_mem_free(allocator, batch, sizeof(BambuShardBatch));
+        bambu_mem_free(allocator, msg, BAMBU_SHARD_MESSAGE_MAX);
+        return 1;
+    }
+
+    while(ok) {
+        ssize_t len = recv(fd, msg, BAMBU_SHARD_MESSAGE_MAX, 0);
+        if(len < 0 && errno == EINTR) continue;
+        if(len <= 0) {
+            ok = len == 0;
+            break;
+        }
+        if(msg[0] == BambuShardMsgAdd) {
+            ok = bambu_shard_batch_each(msg, (size_t)len, bambu_shard_worker_put, &partition);
+        } else if(msg[0] == BambuShardMsgQuery) {
+            ok = bambu_shard_worker_query(fd, &partition, msg, (size_t)len, batch);
+        } else {
+            ok = false;
+        }
+    }
+
+    bambu_shard_partition_free(&partition);
+    bambu_mem_free(allocator, batch, sizeof(BambuShardBatch));
+    bambu_mem_free(allocator, msg, BAMBU_SHARD_MESSAGE_MAX);
+    close(fd);
+    return ok ? 0 : 1;
+}
+
+// ============================================================================
+// Router
+// ============================================================================
+
+typedef struct {
+    int fd;
+    pid_t pid;
+    BambuShardBatch batch;  // Pending records for this shard
+    uint64_t routed;        // Records sent to this shard
+    BambuShardDone last;    // Statistics from the last query
+} BambuShardWorker;
+
+typedef struct {
+    const BambuAllocator* allocator;
+    BambuRing ring;
+    BambuShardWorker* workers;
+    uint32_t count;
+    uint32_t capacity;  // Entries allocated in workers
+} BambuShardRouter;
+
+// Called for every matching record; return false to abort the query
+typedef bool (*BambuShardRowCallback)(const BambuSpoolRecord* record, uint32_t scan_time, void* context);
+
+// Stop all workers started so far. Returns false if any failed.
+static inline bool bambu_shard_router_stop(BambuShardRouter* router) {
+    bool ok = true;
+    for(uint32_t i = 0; i < router->count; i++) {
+        close(router->workers[i].fd);
+        int status;
+        if(waitpid(router->workers[i].pid, &status, 0) < 0 || !WIFEXITED(status) ||
+           WEXITSTATUS(status) != 0) {
+            ok = false;
+        }
+    }
+    bambu_mem_free(router->allocator, router->workers, router->capacity * sizeof(BambuShardWorker));
+    bambu_ring_free(&router->ring);
+    memset(router, 0, sizeof(BambuShardRouter));
+    return ok;
+}
+
+// Fork one worker process per shard. Flush stdio before calling: workers
+// inherit unwritten buffers. Returns false if any could not be started.
+static inline bool bambu_shard_router_start(BambuShardRouter* router, uint32_t shards, uint32_t vnodes) {
+    memset(router, 0, sizeof(BambuShardRouter));
+    router->allocator = bambu_allocator();
+    router->capacity = shards ? shards : 1;
+    router->workers = bambu_mem_calloc(router->allocator, router->capacity, sizeof(BambuShardWorker));
+    if(!router->workers || !bambu_ring_init(&router->ring, shards, vnodes)) {
+        bambu_mem_free(router->allocator, router->workers, router->capacity * sizeof(BambuShardWorker));
+        router->workers = NULL;
+        return false;
+    }
+
+    for(uint32_t i = 0; i < shards; i++) {
+        int pair[2];
+        if(socketpair(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0, pair) != 0) break;
+        pid_t pid = fork();
+        if(pid < 0) {
+            close(pair[0]);
+            close(pair[1]);
+            break;
+        }
+        if(pid == 0) {
+            // Only this worker's end stays open, so every worker sees EOF
+            // as soon as the router closes its socket
+            for(uint32_t j = 0; j < i; j++) close(router->workers[j].fd);
+            close(pair[0]);
+            _exit(bambu_shard_worker_run(pair[1]));
+        }
+        close(pair[1]);
+        BambuShardWorker* worker = &router->workers[router->count++];
+        worker->fd = pair[0];
+        worker->pid = pid;
+        bambu_shard_batch_reset(&worker->batch, BambuShardMsgAdd);
+    }
+
+    if(router->count < shards) {
+        bambu_shard_router_stop(router);
+        return false;
+    }
+    return true;
+}
+
+// Route a record to the shard owning its UID (batched; see
+// bambu_shard_router_flush). Returns false if the worker is gone.
+static inline bool bambu_shard_router_add(
+    BambuShardRouter* router,
+    const BambuSpoolRecord* record,
+    uint32_t scan_time) {
+    uint32_t shard = bambu_ring_shard(&router->ring, record->uid, record->uid_len);
+    BambuShardWorker* worker = &router->workers[shard];
+    worker->routed++;
+    return bambu_shard_batch_add(worker->fd, &worker->batch, record, scan_time);
+}
+
+// Send all pending records
+static inline bool bambu_shard_router_flush(BambuShardRouter* router) {
+    bool ok = true;
+    for(uint32_t i = 0; i < router->count; i++) {
+        BambuShardWorker* worker = &router->workers[i];
+        if(!bambu_shard_batch_send(worker->fd, &worker->batch)) ok = false;
+    }
+    return ok;
+}
+
+// Helper: Batch callback adapter for the row callback
+typedef struct {
+    BambuShardRowCallback on_row;
+    void* context;
+} BambuShardRowSink;
+
+static inline bool bambu_shard_router_row(const BambuSpoolRecord* record, uint32_t scan_time, void* context) {
+    BambuShardRowSink* sink = context;
+    return sink->on_row(record, scan_time, sink->context);
+}
+
+// Run a query on every shard and merge the aggregates. Matching records
+// are passed to on_row (may be NULL for aggregates only) as they arrive,
+// in no particular order across shards. *total_rows receives the number
+// of distinct tags. Pending records are flushed first. After a failure
+// the workers are out of step and the router must be stopped.
+static inline bool bambu_shard_router_query(
+    BambuShardRouter* router,
+    const BambuQuery* query,
+    BambuShardRowCallback on_row,
+    void* context,
+    BambuQueryAggregate* aggregate,
+    uint32_t* total_rows) {
+    memset(aggregate, 0, sizeof(BambuQueryAggregate));
+    *total_rows = 0;
+    if(!bambu_shard_router_flush(router)) return false;
+
+    uint8_t* msg = bambu_mem_alloc(router->allocator, BAMBU_SHARD_MESSAGE_MAX);
+    struct pollfd* fds = bambu_mem_calloc(router->allocator, router->count, sizeof(struct pollfd));
+    if(!msg || !fds) {
+        bambu_mem_free(router->allocator, msg, BAMBU_SHARD_MESSAGE_MAX);
+        bambu_mem_free(router->allocator, fds, router->count * sizeof(struct pollfd));
+        return false;
+    }
+    size_t len = bambu_shard_query_encode(query, on_row != NULL, msg);
+    bool ok = true;
+    for(uint32_t i = 0; i < router->count; i++) {
+        fds[i].fd = router->workers[i].fd;
+        fds[i].events = POLLIN;
+        if(!bambu_shard_send(fds[i].fd, msg, len)) ok = false;
+    }
+
+    // Drain all workers concurrently so none blocks on a full socket
+    BambuShardRowSink sink = {on_row, context};
+    uint32_t pending = ok ? router->count : 0;
+    while(ok && pending > 0) {
+        if(poll(fds, router->count, -1) < 0) {
+            ok = errno == EINTR;
+            continue;
+        }
+        for(uint32_t i = 0; ok && i < router->count; i++) {
+            if(fds[i].fd < 0 || !fds[i].revents) continue;
+            ssize_t n = recv(fds[i].fd, msg, BAMBU_SHARD_MESSAGE_MAX, 0);
+            if(n < 0 && errno == EINTR) continue;
+            if(n <= 0) {
+                ok = false;
+            } else if(msg[0] == BambuShardMsgRows && on_row) {
+                ok = bambu_shard_batch_each(msg, (size_t)n, bambu_shard_router_row, &sink);
+            } else if(msg[0] == BambuShardMsgDone && (size_t)n == 1 + sizeof(BambuShardDone)) {
+                BambuShardDone* done = &router->workers[i].last;
+                memcpy(done, &msg[1], sizeof(BambuShardDone));
+                const BambuQueryAggregate* part = &done->aggregate;
+                aggregate->count += part->count;
+                aggregate->total_weight_grams += part->total_weight_grams;
+                aggregate->total_length_m += part->total_length_m;
+                if(part->oldest_minutes &&
+                   (!aggregate->oldest_minutes || part->oldest_minutes < aggregate->oldest_minutes)) {
+                    aggregate->oldest_minutes = part->oldest_minutes;
+                }
+                if(part->newest_minutes > aggregate->newest_minutes) {
+                    aggregate->newest_minutes = part->newest_minutes;
+                }
+                *total_rows += done->rows;
+                fds[i].fd = -1;  // poll() skips negative descriptors
+                pending--;
+            } else {
+                ok = false;
+            }
+        }
+    }
+
+    bambu_mem_free(router->allocator, msg, BAMBU_SHARD_MESSAGE_MAX);
+    bambu_mem_free(router->allocator, fds, router->count * sizeof(struct pollfd));
+    return ok;
+}
+
+#endif // BAMBU_SHARD_H
@@ -0,0 +1,214 @@
+// Bambu Lab NFC Parser - Simulated Mifare Classic Target
+// A host-side card loaded from a dump that answers the BambuReadOps of
+// plugin/bambu_read.h. Every operation advances a simulated clock by its
+// configured cost, and transient failures (tag at the edge of the field)
+// are drawn from a seeded generator, so a run is reproducible.
+//
+// The card enforces Mifare Classic rules that decide read latency: reads
+// need an authenticated session for the block's sector, and a failed
+// auth or read halts the card until the next select. Sector keys are the
+// UID-derived Bambu keys (plugin/bambu_keys.h), whatever the dump's
+// trailers contain.
+
+#ifndef BAMBU_SIM_H
+#define BAMBU_SIM_H
+
+#include "bambu_host.h"
+#include "bambu_encode.h"
+#include "../plugin/bambu_read.h"
+#include "../plugin/spool_registry.h"
+
+// Per-operation costs in microseconds and failure probabilities (0-1).
+// Defaults approximate a Flipper Zero at 106 kbit/s.
+typedef struct {
+    uint32_t setup_us;      // Field on + protocol detection, once per scan
+    uint32_t select_us;     // REQA, anticollision, SELECT
+    uint32_t auth_us;       // Three-pass authentication
+    uint32_t auth_fail_us;  // Extra wait for the timeout of a rejected auth
+    uint32_t read_us;       // Encrypted READ of one block
+    double select_fail_rate;
+    double auth_fail_rate;
+    double read_fail_rate;
+    uint64_t seed;
+} BambuSimTiming;
+
+#define BAMBU_SIM_TIMING_DEFAULT {20000, 2500, 1500, 5000, 1000, 0.0, 0.0, 0.0, 1}
+
+typedef struct {
+    MfClassicData data;
+    uint8_t keys[2][BAMBU_KEYS_LEN];  // [BambuKeyType][sector * 6]
+    BambuSimTiming timing;
+    uint64_t rng;
+    uint64_t elapsed_us;
+    bool selected;
+    int8_t authed_sector;  // -1 = none
+} BambuSimCard;
+
+static inline void bambu_sim_card_init(BambuSimCard* card, const MfClassicData* data, const BambuSimTiming* timing) {
+    memset(card, 0, sizeof(BambuSimCard));
+    card->data = *data;
+    card->timing = *timing;
+    card->rng = timing->seed;
+    card->authed_sector = -1;
+
+    size_t uid_len;
+    const uint8_t* uid = mf_classic_get_uid(data, &uid_len);
+    bambu_derive_keys(uid, uid_len, BambuKeyTypeA, card->keys[BambuKeyTypeA]);
+    bambu_derive_keys(uid, uid_len, BambuKeyTypeB, card->keys[BambuKeyTypeB]);
+}
+
+// Start a new scan: the card leaves and re-enters the field
+static inline void bambu_sim_card_reset(BambuSimCard* card) {
+    card->elapsed_us = card->timing.setup_us;
+    card->selected = false;
+    card->authed_sector = -1;
+}
+
+// Helper: Draw a transient failure; a failed operation halts the card
+static inline bool bambu_sim_fails(BambuSimCard* card, double rate) {
+    if(rate <= 0.0) return false;
+    bool fails = (double)(bambu_rng_next(&card->rng) >> 11) * 0x1.0p-53 < rate;
+    if(fails) {
+        card->selected = false;
+        card->authed_sector = -1;
+    }
+    return fails;
+}
+
+static inline bool bambu_sim_select(void* context, uint8_t* uid, uint8_t* uid_len) {
+    BambuSimCard* card = context;
+    card->elapsed_us += card->timing.select_us;
+    card->authed_sector = -1;
+    card->selected = !bambu_sim_fails(card, card->timing.select_fail_rate);
+    if(!card->selected) return false;
+
+    size_t len;
+    const uint8_t* card_uid = mf_classic_get_uid(&card->data, &len);
+    memcpy(uid, card_uid, len);
+    *uid_len = (uint8_t)len;
+    return true;
+}
+
+static inline bool bambu_sim_auth(void* context, uint8_t block, const uint8_t key[BAMBU_KEY_LEN], BambuKeyType type) {
+    BambuSimCard* card = context;
+    uint8_t sector = block / 4;
+    if(!card->selected || sector >= BAMBU_KEY_SECTORS) return false;
+
+    card->elapsed_us += card->timing.auth_us;
+    if(memcmp(key, &card->keys[type][sector * BAMBU_KEY_LEN], BAMBU_KEY_LEN) != 0) {
+        card->elapsed_us += card->timing.auth_fail_us;
+        card->selected = false;
+        card->authed_sector = -1;
+        return false;
+    }
+    if(bambu_sim_fails(card, card->timing.auth_fail_rate)) {
+        card->elapsed_us += card->timing.auth_fail_us;
+        return false;
+    }
+    card->authed_sector = (int8_t)sector;
+    return true;
+}
+
+static inline bool bambu_sim_read_block(void* context, uint8_t block, uint8_t data[16]) {
+    BambuSimCard* card = context;
+    if(!card->selected || card->authed_sector != block / 4) return false;
+
+    card->elapsed_us += card->timing.read_us;
+    if(bambu_sim_fails(card, card->timing.read_fail_rate)) return false;
+    memcpy(data, card->data.block[block].data, 16);
+    return true;
+}
+
+static inline BambuReadOps bambu_sim_ops(BambuSimCard* card) {
+    BambuReadOps ops = {card, bambu_sim_select, bambu_sim_auth, bambu_sim_read_block};
+    return ops;
+}
+
+// ============================================================================
+// Dictionary model
+// ============================================================================
+
+// A user dictionary as bambu_keygen writes it for a manifest of uid_count
+// spools: 32 keys per UID (Key A sectors 0-15, then Key B). The scanned
+// tag sits at a UID-dependent slot; every other key is filler that
+// matches nothing.
+typedef struct {
+    uint8_t keys[2][BAMBU_KEYS_LEN];  // The scanned tag's keys
+    size_t slot;                      // Manifest position of the tag
+    uint64_t seed;
+} BambuSimDictionary;
+
+static inline void bambu_sim_dictionary_key_at(void* context, size_t index, uint8_t key[BAMBU_KEY_LEN]) {
+    const BambuSimDictionary* dict = context;
+    size_t slot = index / (2 * BAMBU_KEY_SECTORS);
+    size_t entry = index % (2 * BAMBU_KEY_SECTORS);
+    if(slot == dict->slot) {
+        memcpy(key, &dict->keys[entry / BAMBU_KEY_SECTORS][(entry % BAMBU_KEY_SECTORS) * BAMBU_KEY_LEN], BAMBU_KEY_LEN);
+        return;
+    }
+    uint64_t filler = bambu_hash_mix(dict->seed ^ index);
+    for(size_t i = 0; i < BAMBU_KEY_LEN; i++) key[i] = (uint8_t)(filler >> (8 * i));
+}
+
+// Build the dictionary model for card; the tag's slot is a hash of its UID
+static inline void bambu_sim_dictionary_init(
+    BambuSimDictionary* dict,
+    BambuReadDictionary* source,
+    const BambuSimCard* card,
+    size_t uid_count) {
+    size_t uid_len;
+    const uint8_t* uid = mf_classic_get_uid(&card->data, &uid_len);
+    memcpy(dict->keys, card->keys, sizeof(dict->keys));
+    dict->seed = card->timing.seed;
+    dict->slot = uid_count ? bambu_hash_mix(bambu_hash_bytes(BAMBU_HASH_SEED, uid, uid_len)) % uid_count : 0;
+
+    source->context = dict;
+    source->count = uid_count * 2 * BAMBU_KEY_SECTORS;
+    source->key_at = bambu_sim_dictionary_key_at;
+}
+
+// ============================================================================
+// Scan harness
+// ============================================================================
+
+typedef struct {
+    bool verified;  // Verify accepted the card (always true for Dictionary)
+    bool read;      // Every planned sector was read
+    bool decoded;   // The registry decoded the result
+    uint64_t elapsed_us;
+    BambuReadStats verify_stats;
+    BambuReadStats read_stats;
+    BambuSpoolRecord record;
+} BambuSimScan;
+
+// Run the plugin path against the card: verify (strategies with a custom
+// read only; the firmware's default reader has none), read with the
+// strategy's plan, then registry decode.
+static inline void bambu_sim_scan(
+    BambuSimCard* card,
+    BambuReadStrategy strategy,
+    const BambuReadDictionary* dictionary,
+    BambuSimScan* scan) {
+    memset(scan, 0, sizeof(BambuSimScan));
+    bambu_sim_card_reset(card);
+    BambuReadOps ops = bambu_sim_ops(card);
+
+    scan->verified = strategy == BambuReadStrategyDictionary || bambu_read_verify(&ops, &scan->verify_stats);
+    if(scan->verified) {
+        size_t uid_len;
+        const uint8_t* uid = mf_classic_get_uid(&card->data, &uid_len);
+        BambuReadPlan plan;
+        bambu_read_plan(strategy, uid, uid_len, &plan);
+        plan.dictionary = dictionary;
+
+        MfClassicData result;
+        memset(&result, 0, sizeof(result));
+        result.iso14443_3a_data = card->data.iso14443_3a_data;
+        result.type = MfClassicType1k;
+        scan->read = bambu_read_execute(&ops, &plan, &result, &scan->read_stats);
+        scan->decoded = spool_registry_decode(&result, &scan->record) != NULL;
+    }
+    scan->elapsed_us = card->elapsed_us;
+}
+
+#endif // BAMBU_SIM_H
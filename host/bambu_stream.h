@@ -0,0 +1,100 @@
+// Bambu Lab NFC Parser - USB CDC Stream Receiver
+// Reads record frames (plugin/bambu_frame.h) from a serial device such as
+// /dev/ttyACM0, or from any file descriptor (pipes, pseudo-terminals).
+//
+// Requires bambu_host.h to be included first.
+
+#ifndef BAMBU_STREAM_H
+#define BAMBU_STREAM_H
+
+#include <errno.h>
+#include <fcntl.h>
+#include <termios.h>
+#include <unistd.h>
+
+#include "../plugin/bambu_frame.h"
+
+// Called for every record frame that passes the CRC and unpacks cleanly
+typedef void (*BambuStreamRecordCallback)(
+    const BambuSpoolRecord* record,
+    uint32_t scan_time,
+    void* context);
+
+typedef struct {
+    BambuFrameRx rx;
+    BambuStreamRecordCallback callback;
+    void* context;
+    uint32_t records;
+    uint32_t bad_records;  // Valid CRC but malformed or unknown payload
+} BambuStream;
+
+static inline void bambu_stream_init(
+    BambuStream* stream,
+    BambuStreamRecordCallback callback,
+    void* context) {
+    memset(stream, 0, sizeof(BambuStream));
+    bambu_frame_rx_init(&stream->rx);
+    stream->callback = callback;
+    stream->context = context;
+}
+
+// Open a serial device in raw mode. Non-tty paths are opened as-is.
+// Returns the file descriptor, or -1 with errno set.
+static inline int bambu_stream_open(const char* path) {
+    int fd = open(path, O_RDONLY | O_NOCTTY);
+    if(fd < 0) return -1;
+
+    if(isatty(fd)) {
+        struct termios tio;
+        if(tcgetattr(fd, &tio) != 0) {
+            close(fd);
+            return -1;
+        }
+        cfmakeraw(&tio);
+        tio.c_cc[VMIN] = 1;
+        tio.c_cc[VTIME] = 0;
+        if(tcsetattr(fd, TCSANOW, &tio) != 0) {
+            close(fd);
+            return -1;
+        }
+    }
+    return fd;
+}
+
+// Helper: Dispatch the frame currently held by the receiver
+static inline void bambu_stream_dispatch(BambuStream* stream) {
+    if(stream->rx.type != BambuFrameTypeRecord) return;
+
+    BambuSpoolRecord record;
+    uint32_t scan_time = 0;
+    if(!bambu_record_unpack(stream->rx.payload, stream->rx.len, &record, &scan_time)) {
+        stream->bad_records++;
+        return;
+    }
+    stream->records++;
+    if(stream->callback) stream->callback(&record, scan_time, stream->context);
+}
+
+// Feed a chunk of received bytes, invoking the callback per record
+static inline void bambu_stream_feed(BambuStream* stream, const uint8_t* data, size_t len) {
+    for(size_t i = 0; i < len; i++) {
+        if(!bambu_frame_rx_push(&stream->rx, data[i])) continue;
+        do {
+            bambu_stream_dispatch(stream);
+        } while(bambu_frame_rx_next(&stream->rx));
+    }
+}
+
+// Perform one blocking read and feed the result
+// Returns bytes read, 0 at end of stream, -1 on error
+static inline ssize_t bambu_stream_pump(BambuStream* stream, int fd) {
+    uint8_t buf[512];
+    ssize_t n;
+    do {
+        n = read(fd, buf, sizeof(buf));
+    } while(n < 0 && errno == EINTR);
+    if(n > 0) bambu_stream_feed(stream, buf, (size_t)n);
+    return n;
+}
+
+#endif // BAMBU_STREAM_H
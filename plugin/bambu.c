@@ -2,14 +2,126 @@
 #include <flipper_application/flipper_application.h>
 #include <nfc/nfc_device.h>
 #include <nfc/protocols/mf_classic/mf_classic.h>
+#include <nfc/protocols/mf_classic/mf_classic_poller_sync.h>
+#include <nfc/protocols/iso14443_3a/iso14443_3a_poller_sync.h>
 #include <furi.h>
 #include <string.h>
 
 #include "bambu_filaments.h"
 #include "bambu_parser.h"
+#include "spool_registry.h"
+#include "bambu_read.h"
+#include "bambu_flipper_card.h"
 
 #define TAG "Bambu"
 
+// How the plugin reads a tag, a BambuReadStrategy value (see bambu_read.h;
+// compare them with host/bambu_scan_sim):
+//   0  no custom read, the firmware's dictionary attack reads the tag
+//   1  UID-derived keys, all sectors (full dump, signature included)
+//   2  UID-derived keys, data sectors 0-3 only
+// 0 is the default: the derived-key verify/read callbacks are not yet
+// tested on hardware and are opt-in (`make build READ_STRATEGY=1`).
+#ifndef BAMBU_READ_STRATEGY
+#define BAMBU_READ_STRATEGY 0
+#endif
+
+// Stream each decoded record as a binary frame (see bambu_frame.h) over
+// USB CDC. Enable with `make build STREAM_CDC=1`.
+#ifndef BAMBU_STREAM_CDC
+#define BAMBU_STREAM_CDC 0
+#endif
+
+// CDC interface the frames are written to (0 is shared with the CLI)
+#ifndef BAMBU_STREAM_CDC_IF
+#define BAMBU_STREAM_CDC_IF 0
+#endif
+
+#if BAMBU_STREAM_CDC
+#include <furi_hal.h>
+#include "bambu_frame.h"
+
+// Send a record frame in CDC packet-sized chunks. Bytes written while no
+// host is listening are dropped by the USB stack, and the host receiver
+// resynchronizes on the next start-of-frame byte.
+static void bambu_stream_record(const BambuSpoolRecord* record) {
+    if(!furi_hal_usb_is_connected()) {
+        return;
+    }
+
+    uint8_t payload[BAMBU_FRAME_MAX_PAYLOAD];
+    uint8_t frame[BAMBU_FRAME_MAX_SIZE];
+    size_t payload_len = bambu_record_pack(record, furi_hal_rtc_get_timestamp(), payload);
+    size_t frame_len = bambu_frame_encode(BambuFrameTypeRecord, payload, (uint8_t)payload_len, frame);
+
+    for(size_t sent = 0; sent < frame_len; sent += CDC_DATA_SZ) {
+        size_t chunk = frame_len - sent;
+        if(chunk > CDC_DATA_SZ) chunk = CDC_DATA_SZ;
+        furi_hal_cdc_send(BAMBU_STREAM_CDC_IF, &frame[sent], (uint16_t)chunk);
+        furi_delay_ms(2);  // Let the endpoint drain before the next packet
+    }
+    FURI_LOG_D(TAG, "Streamed %u byte frame", (unsigned)frame_len);
+}
+#endif
+
+#if BAMBU_READ_STRATEGY != 0
+// Verify: one auth + block read with the UID-derived key instead of
+// leaving every Mifare Classic card to the dictionary attack
+static bool bambu_verify(Nfc* nfc) {
+    furi_assert(nfc);
+
+    BambuFlipperCard card = {.nfc = nfc};
+    BambuReadOps ops = bambu_flipper_ops(&card);
+    BambuReadStats stats;
+    bool verified = bambu_read_verify(&ops, &stats);
+    FURI_LOG_D(TAG, "Verify: %s (%lu auths)", verified ? "ok" : "no", (unsigned long)stats.auths);
+    return verified;
+}
+
+// Read: the firmware's sector reader with the plan's UID-derived keys
+static bool bambu_read(Nfc* nfc, NfcDevice* device) {
+    furi_assert(nfc);
+    furi_assert(device);
+
+    MfClassicData* data = mf_classic_alloc();
+    nfc_device_copy_data(device, NfcProtocolMfClassic, data);
+    bool is_read = false;
+
+    do {
+        MfClassicType type = MfClassicType1k;
+        if(mf_classic_poller_sync_detect_type(nfc, &type) != MfClassicErrorNone) break;
+        if(type != MfClassicType1k) break;
+        data->type = type;
+
+        size_t uid_len;
+        const uint8_t* uid = mf_classic_get_uid(data, &uid_len);
+        BambuReadPlan plan;
+        bambu_read_plan((BambuReadStrategy)BAMBU_READ_STRATEGY, uid, uid_len, &plan);
+
+        MfClassicDeviceKeys keys = {};
+        for(size_t sector = 0; sector < plan.sectors; sector++) {
+            memcpy(keys.key_a[sector].data, &plan.key_a[sector * BAMBU_KEY_LEN], BAMBU_KEY_LEN);
+            memcpy(keys.key_b[sector].data, &plan.key_b[sector * BAMBU_KEY_LEN], BAMBU_KEY_LEN);
+            FURI_BIT_SET(keys.key_a_mask, sector);
+            FURI_BIT_SET(keys.key_b_mask, sector);
+        }
+
+        MfClassicError error = mf_classic_poller_sync_read(nfc, &keys, data);
+        if(error != MfClassicErrorNone && error != MfClassicErrorPartialRead) break;
+
+        // Partial reads are expected when only the data sectors are planned
+        is_read = true;
+        for(size_t sector = 0; sector < plan.sectors; sector++) {
+            if(!mf_classic_is_sector_read(data, sector)) is_read = false;
+        }
+        if(is_read) nfc_device_set_data(device, NfcProtocolMfClassic, data);
+    } while(false);
+
+    mf_classic_free(data);
+    return is_read;
+}
+#endif
+
 // Main parse function: Extract and format all Bambu spool data
 static bool bambu_parse(const NfcDevice* device, FuriString* parsed_data) {
     furi_assert(device);
@@ -17,65 +129,17 @@ static bool bambu_parse(const NfcDevice* device, FuriString* parsed_data) {
 
     const MfClassicData* data = nfc_device_get_data(device, NfcProtocolMfClassic);
 
-    // Quick type check
-    if(data->type != MfClassicType1k) {
-        return false;
-    }
-
-    // Verify this is a Bambu tag using our detection logic
-    if(!bambu_tag_is_valid(data)) {
+    // Signature dispatch: only the matching vendor's decoder runs
+    BambuSpoolRecord record;
+    const SpoolVendor* vendor = spool_registry_decode(data, &record);
+    if(vendor == NULL) {
         return false;
     }
 
-    // Parse Material ID and Variant ID from Block 1
-    const uint8_t* block1 = data->block[BLOCK_MATERIAL_IDS].data;
-    char material_id[7] = {0};  // "GFxxx" + null
-    char variant_id[8] = {0};   // "xxx-Rx" + null
-    bambu_copy_ascii_string(material_id, &block1[8], 6);
-    bambu_copy_ascii_string(variant_id, &block1[0], 7);
-
-    // Parse Filament Type from Block 2
-    const uint8_t* block2 = data->block[BLOCK_FILAMENT_TYPE].data;
-    char filament_type[17] = {0};
-    bambu_copy_ascii_string(filament_type, block2, 16);
-
-    // Parse Detailed Type from Block 4
-    const uint8_t* block4 = data->block[BLOCK_DETAILED_TYPE].data;
-    char detailed_type[17] = {0};
-    bambu_copy_ascii_string(detailed_type, block4, 16);
-
-    // Parse Color, Weight, Diameter from Block 5
-    const uint8_t* block5 = data->block[BLOCK_COLOR_WEIGHT].data;
-    uint8_t color_r = block5[0];
-    uint8_t color_g = block5[1];
-    uint8_t color_b = block5[2];
-    uint8_t color_a = block5[3];
-    uint16_t weight_grams = bambu_read_le16(&block5[4]);
-    float diameter_mm = bambu_read_le_float(&block5[8]);
-
-    // Parse Temperatures from Block 6
-    const uint8_t* block6 = data->block[BLOCK_TEMPERATURES].data;
-    uint16_t drying_temp = bambu_read_le16(&block6[0]);
-    uint16_t drying_hours = bambu_read_le16(&block6[2]);
-    uint16_t hotend_max = bambu_read_le16(&block6[8]);
-    uint16_t hotend_min = bambu_read_le16(&block6[10]);
-
-    // Parse Nozzle Diameter from Block 8 (float at bytes 12-15)
-    const uint8_t* block8 = data->block[BLOCK_NOZZLE].data;
-    float nozzle_diameter = bambu_read_le_float(&block8[12]);
-
-    // Parse Spool Width from Block 10 (uint16 at bytes 4-5, value in mm*100)
-    const uint8_t* block10 = data->block[BLOCK_SPOOL_WIDTH].data;
-    uint16_t spool_width_raw = bambu_read_le16(&block10[4]);
-    float spool_width_mm = (float)spool_width_raw / 100.0f;
-
-    // Parse Production Date from Block 12 (ASCII YYYY_MM_DD_HH_MM)
-    const uint8_t* block12 = data->block[BLOCK_PRODUCTION_DATE].data;
-    char production_date[17] = {0};
-    bambu_copy_ascii_string(production_date, block12, 16);
-
     // Format production date from "YYYY_MM_DD_HH_MM" to "YYYY-MM-DD HH:MM"
     // Only format if underscores are present at expected positions
+    char production_date[17];
+    memcpy(production_date, record.production_date, sizeof(production_date));
     if(production_date[4] == '_' &&
        production_date[7] == '_' &&
        production_date[10] == '_' &&
@@ -86,69 +150,88 @@ static bool bambu_parse(const NfcDevice* device, FuriString* parsed_data) {
         production_date[13] = ':';
     }
 
-    // Parse Filament Length from Block 14 (uint16 at bytes 4-5, meters)
-    const uint8_t* block14 = data->block[BLOCK_FILAMENT_LENGTH].data;
-    uint16_t filament_length = bambu_read_le16(&block14[4]);
-
     // Look up filament info from variant_id
-    const BambuFilamentInfo* filament_info = bambu_lookup_filament(variant_id);
+    const BambuFilamentInfo* filament_info = bambu_lookup_filament(record.variant_id);
 
     // Build formatted output
-    furi_string_cat_printf(parsed_data, "\e#Bambu Lab Filament\n");
+    furi_string_cat_printf(parsed_data, "\e#%s Filament\n", vendor->name);
     // furi_string_cat_printf(parsed_data, "Type: %s\n", filament_type);
-    furi_string_cat_printf(parsed_data, "Type: %s\n", detailed_type);
+    furi_string_cat_printf(parsed_data, "Type: %s\n", record.detailed_type);
 
     // Display color: show name with hex if available, otherwise just hex
     // For hex code: show 6-digit if fully opaque, otherwise show "#RRGGBB @ XX%"
     if(filament_info != NULL) {
-        if(color_a == 0xFF) {
+        if(record.color_a == 0xFF) {
             furi_string_cat_printf(parsed_data, "Color: %s (#%02X%02X%02X)\n",
-                                  filament_info->color_name, color_r, color_g, color_b);
+                                  filament_info->color_name,
+                                  record.color_r, record.color_g, record.color_b);
         } else {
-            uint8_t alpha_percent = (color_a * 100) / 255;
+            uint8_t alpha_percent = (record.color_a * 100) / 255;
             furi_string_cat_printf(parsed_data, "Color: %s (#%02X%02X%02X @ %u%%)\n",
-                                  filament_info->color_name, color_r, color_g, color_b, alpha_percent);
+                                  filament_info->color_name,
+                                  record.color_r, record.color_g, record.color_b, alpha_percent);
         }
     } else {
-        if(color_a == 0xFF) {
+        if(record.color_a == 0xFF) {
             furi_string_cat_printf(parsed_data, "Color: #%02X%02X%02X\n",
-                                  color_r, color_g, color_b);
+                                  record.color_r, record.color_g, record.color_b);
         } else {
-            uint8_t alpha_percent = (color_a * 100) / 255;
+            uint8_t alpha_percent = (record.color_a * 100) / 255;
             furi_string_cat_printf(parsed_data, "Color: #%02X%02X%02X @ %u%%\n",
-                                  color_r, color_g, color_b, alpha_percent);
+                                  record.color_r, record.color_g, record.color_b, alpha_percent);
         }
     }
 
     if(filament_info != NULL) {
         furi_string_cat_printf(parsed_data, "Filament Code: %s\n", filament_info->filament_code);
     } else {
-        furi_string_cat_printf(parsed_data, "Material ID: %s\n", material_id);
+        furi_string_cat_printf(parsed_data, "Material ID: %s\n", record.material_id);
     }
 
     furi_string_cat_printf(parsed_data, "Prod: %s\n", production_date);
 
 
     furi_string_cat_printf(parsed_data, "\n\e#Configurations\n");
-    furi_string_cat_printf(parsed_data, "Hotend: %u-%u C\n", hotend_min, hotend_max);
-    furi_string_cat_printf(parsed_data, "Drying: %u C for %uh\n", drying_temp, drying_hours);
-    furi_string_cat_printf(parsed_data, "Nozzle: >= %.2fmm\n", (double)nozzle_diameter);
+    furi_string_cat_printf(parsed_data, "Hotend: %u-%u C\n",
+                          record.hotend_min_c, record.hotend_max_c);
+    furi_string_cat_printf(parsed_data, "Drying: %u C for %uh\n",
+                          record.drying_temp_c, record.drying_hours);
+    furi_string_cat_printf(parsed_data, "Nozzle: >= %u.%02umm\n",
+                          record.nozzle_diameter_mm_x100 / 100, record.nozzle_diameter_mm_x100 % 100);
 
     furi_string_cat_printf(parsed_data, "\n\e#Specifications\n");
-    furi_string_cat_printf(parsed_data, "Weight: %ug\n", weight_grams);
-    furi_string_cat_printf(parsed_data, "Diameter: %.2fmm\n", (double)diameter_mm);
-    furi_string_cat_printf(parsed_data, "Spool Width: %.2fmm\n", (double)spool_width_mm);
-    if(filament_length > 0) {
-        furi_string_cat_printf(parsed_data, "Length: %um\n", filament_length);
+    furi_string_cat_printf(parsed_data, "Weight: %ug\n", record.weight_grams);
+    furi_string_cat_printf(parsed_data, "Diameter: %u.%02umm\n",
+                          record.diameter_mm_x100 / 100, record.diameter_mm_x100 % 100);
+    furi_string_cat_printf(parsed_data, "Spool Width: %u.%02umm\n",
+                          record.spool_width_mm_x100 / 100, record.spool_width_mm_x100 % 100);
+    if(record.filament_length_m > 0) {
+        furi_string_cat_printf(parsed_data, "Length: %um\n", record.filament_length_m);
     }
 
+    // Both tags of a spool share the tray UID; it identifies the spool
+    furi_string_cat_printf(parsed_data, "Tray UID: ");
+    for(size_t i = 0; i < sizeof(record.tray_uid); i++) {
+        furi_string_cat_printf(parsed_data, "%02X", record.tray_uid[i]);
+    }
+    furi_string_cat_printf(parsed_data, "\n");
+
+#if BAMBU_STREAM_CDC
+    bambu_stream_record(&record);
+#endif
+
     return true;
 }
 
 static const NfcSupportedCardsPlugin bambu_plugin = {
     .protocol = NfcProtocolMfClassic,
+#if BAMBU_READ_STRATEGY != 0
+    .verify = bambu_verify,
+    .read = bambu_read,
+#else
     .verify = NULL,  // No early verify - validation done in parse()
     .read = NULL,    // No custom read - uses default MfClassic reader
+#endif
     .parse = bambu_parse,
 };
 
@@ -0,0 +1,49 @@
+// Bambu Lab NFC Parser - Build Profiles
+// Selects which parts of bambu_parser.h and bambu_filaments.h are
+// compiled. Define BAMBU_PROFILE before including either header:
+//   BAMBU_PROFILE_VALIDATOR  bambu_tag_is_valid() only: no record, no
+//                            decoder, no catalog, no floating point.
+//                            For fast triage (e.g. a .verify callback).
+//   BAMBU_PROFILE_NOFLOAT    Validator + bambu_decode(), integer-only (the
+//                            IEEE 754 fields are converted bit by bit); no
+//                            catalog. For scanners without an FPU or with
+//                            tight flash.
+//   BAMBU_PROFILE_FULL       Everything, including the filament catalog
+//                            (default).
+// Individual features can also be overridden with BAMBU_WITH_DECODE,
+// BAMBU_WITH_FLOAT and BAMBU_WITH_CATALOG (0 or 1).
+// `make size-report` prints the code and data size of each profile.
+
+#ifndef BAMBU_CONFIG_H
+#define BAMBU_CONFIG_H
+
+#define BAMBU_PROFILE_VALIDATOR 1
+#define BAMBU_PROFILE_NOFLOAT   2
+#define BAMBU_PROFILE_FULL      3
+
+#ifndef BAMBU_PROFILE
+#define BAMBU_PROFILE BAMBU_PROFILE_FULL
+#endif
+
+#if BAMBU_PROFILE < BAMBU_PROFILE_VALIDATOR || BAMBU_PROFILE > BAMBU_PROFILE_FULL
+#error "BAMBU_PROFILE must be BAMBU_PROFILE_VALIDATOR, _NOFLOAT or _FULL"
+#endif
+
+// Decoder and BambuSpoolRecord
+#ifndef BAMBU_WITH_DECODE
+#define BAMBU_WITH_DECODE (BAMBU_PROFILE >= BAMBU_PROFILE_NOFLOAT)
+#endif
+
+// Float helpers (bambu_read_le_float, bambu_mm_to_x100); without them
+// bambu_decode() uses the integer conversion
+#ifndef BAMBU_WITH_FLOAT
+#define BAMBU_WITH_FLOAT (BAMBU_PROFILE == BAMBU_PROFILE_FULL)
+#endif
+
+// Filament table (bambu_filaments.h); without it bambu_lookup_filament()
+// always returns NULL
+#ifndef BAMBU_WITH_CATALOG
+#define BAMBU_WITH_CATALOG (BAMBU_PROFILE == BAMBU_PROFILE_FULL)
+#endif
+
+#endif // BAMBU_CONFIG_H
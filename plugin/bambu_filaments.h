@@ -9,12 +9,18 @@
 #ifndef BAMBU_FILAMENTS_H
 #define BAMBU_FILAMENTS_H
 
+#include <stddef.h>
+#include <string.h>
+
+#include "bambu_config.h"
+
 typedef struct {
     const char* variant_id;     // e.g., "A00-R3"
     const char* filament_code;  // e.g., "10204"
     const char* color_name;     // e.g., "Hot Pink"
 } BambuFilamentInfo;
 
+#if BAMBU_WITH_CATALOG
 // Lookup table - sorted by variant_id for easier maintenance
 static const BambuFilamentInfo bambu_filament_table[] = {
     // PLA Basic (A00-xxx) - Material ID: GFA00
@@ -289,5 +295,14 @@ static inline const BambuFilamentInfo* bambu_lookup_filament(const char* variant
     }
     return NULL;
 }
+#else
+#define BAMBU_FILAMENT_TABLE_SIZE 0
+
+// Catalog excluded from this profile: every variant is unknown
+static inline const BambuFilamentInfo* bambu_lookup_filament(const char* variant_id) {
+    (void)variant_id;
+    return NULL;
+}
+#endif // BAMBU_WITH_CATALOG
 
 #endif // BAMBU_FILAMENTS_H
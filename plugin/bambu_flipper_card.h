@@ -0,0 +1,62 @@
+// Bambu Lab NFC Parser - Flipper Card Access
+// BambuReadOps (bambu_read.h) over the Flipper NFC sync pollers, shared by
+// the NFC app plugin (bambu.c) and the scan app (bambu_scan_app.c). The
+// sync pollers authenticate as part of every block read, so auth() only
+// records the key to use.
+//
+// Usage: Flipper builds only; include after bambu_read.h.
+
+#ifndef BAMBU_FLIPPER_CARD_H
+#define BAMBU_FLIPPER_CARD_H
+
+#include <nfc/nfc.h>
+#include <nfc/protocols/mf_classic/mf_classic.h>
+#include <nfc/protocols/mf_classic/mf_classic_poller_sync.h>
+#include <nfc/protocols/iso14443_3a/iso14443_3a_poller_sync.h>
+
+#include "bambu_read.h"
+
+typedef struct {
+    Nfc* nfc;
+    MfClassicKey key;
+    MfClassicKeyType key_type;
+} BambuFlipperCard;
+
+static inline bool bambu_flipper_select(void* context, uint8_t* uid, uint8_t* uid_len) {
+    BambuFlipperCard* card = context;
+    Iso14443_3aData* iso_data = iso14443_3a_alloc();
+    bool selected = iso14443_3a_poller_sync_read(card->nfc, iso_data) == Iso14443_3aErrorNone;
+    if(selected) {
+        size_t len;
+        const uint8_t* card_uid = iso14443_3a_get_uid(iso_data, &len);
+        memcpy(uid, card_uid, len);
+        *uid_len = (uint8_t)len;
+    }
+    iso14443_3a_free(iso_data);
+    return selected;
+}
+
+static inline bool bambu_flipper_auth(void* context, uint8_t block, const uint8_t key[BAMBU_KEY_LEN], BambuKeyType type) {
+    UNUSED(block);
+    BambuFlipperCard* card = context;
+    memcpy(card->key.data, key, BAMBU_KEY_LEN);
+    card->key_type = type == BambuKeyTypeA ? MfClassicKeyTypeA : MfClassicKeyTypeB;
+    return true;
+}
+
+static inline bool bambu_flipper_read_block(void* context, uint8_t block, uint8_t data[16]) {
+    BambuFlipperCard* card = context;
+    MfClassicBlock block_data;
+    MfClassicError error =
+        mf_classic_poller_sync_read_block(card->nfc, block, &card->key, card->key_type, &block_data);
+    if(error != MfClassicErrorNone) return false;
+    memcpy(data, block_data.data, sizeof(block_data.data));
+    return true;
+}
+
+static inline BambuReadOps bambu_flipper_ops(BambuFlipperCard* card) {
+    BambuReadOps ops = {card, bambu_flipper_select, bambu_flipper_auth, bambu_flipper_read_block};
+    return ops;
+}
+
+#endif // BAMBU_FLIPPER_CARD_H
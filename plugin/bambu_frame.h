@@ -0,0 +1,256 @@
+// Bambu Lab NFC Parser - Compact Binary Framing
+// Serializes decoded spool records into small self-delimiting frames so
+// they can be streamed over USB CDC (or appended to a log file) and
+// reassembled on the host from an arbitrary byte stream.
+//
+// Frame layout (all multi-byte fields little-endian):
+//   [SOF 0xB5] [type] [len] [payload: len bytes] [crc16 lo] [crc16 hi]
+// The CRC is CRC-16/CCITT-FALSE over type, len and payload.
+//
+// Requires bambu_parser.h to be included first (BambuSpoolRecord).
+
+#ifndef BAMBU_FRAME_H
+#define BAMBU_FRAME_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+
+#define BAMBU_FRAME_SOF          0xB5
+#define BAMBU_FRAME_MAX_PAYLOAD  255
+#define BAMBU_FRAME_OVERHEAD     5    // SOF + type + len + crc16
+#define BAMBU_FRAME_MAX_SIZE     (BAMBU_FRAME_MAX_PAYLOAD + BAMBU_FRAME_OVERHEAD)
+
+// Packed record layout version (first payload byte of a record frame)
+// 1: initial layout; 2: adds the 16-byte tray UID at the end
+#define BAMBU_RECORD_VERSION     2
+#define BAMBU_RECORD_VERSION_MIN 1  // Oldest layout still unpacked
+
+typedef enum {
+    BambuFrameTypeRecord = 0x01,  // Packed BambuSpoolRecord + scan time
+} BambuFrameType;
+
+// CRC-16/CCITT-FALSE (poly 0x1021), chainable via crc argument
+static inline uint16_t bambu_crc16(uint16_t crc, const uint8_t* data, size_t len) {
+    for(size_t i = 0; i < len; i++) {
+        crc ^= (uint16_t)(data[i] << 8);
+        for(int bit = 0; bit < 8; bit++) {
+            crc = (crc & 0x8000) ? (uint16_t)((crc << 1) ^ 0x1021) : (uint16_t)(crc << 1);
+        }
+    }
+    return crc;
+}
+
+#define BAMBU_CRC16_INIT 0xFFFF
+
+// Encode one frame into out (must hold len + BAMBU_FRAME_OVERHEAD bytes)
+// Returns the number of bytes written
+static inline size_t bambu_frame_encode(
+    uint8_t type,
+    const uint8_t* payload,
+    uint8_t len,
+    uint8_t* out) {
+    out[0] = BAMBU_FRAME_SOF;
+    out[1] = type;
+    out[2] = len;
+    memcpy(&out[3], payload, len);
+    uint16_t crc = bambu_crc16(BAMBU_CRC16_INIT, &out[1], (size_t)len + 2);
+    out[3 + len] = (uint8_t)(crc & 0xFF);
+    out[4 + len] = (uint8_t)(crc >> 8);
+    return (size_t)len + BAMBU_FRAME_OVERHEAD;
+}
+
+// Helper: Append a length-prefixed string to a packed buffer
+static inline size_t bambu_pack_string(uint8_t* out, const char* str) {
+    size_t len = strlen(str);
+    out[0] = (uint8_t)len;
+    memcpy(&out[1], str, len);
+    return len + 1;
+}
+
+// Helper: Append a little-endian uint16 to a packed buffer
+static inline size_t bambu_pack_le16(uint8_t* out, uint16_t value) {
+    out[0] = (uint8_t)(value & 0xFF);
+    out[1] = (uint8_t)(value >> 8);
+    return 2;
+}
+
+// Pack a record (plus the Unix time it was scanned, 0 if unknown) into a
+// record frame payload. Returns the payload length (always < 255).
+static inline size_t bambu_record_pack(
+    const BambuSpoolRecord* record,
+    uint32_t scan_time,
+    uint8_t* out) {
+    size_t pos = 0;
+    out[pos++] = BAMBU_RECORD_VERSION;
+    out[pos++] = (uint8_t)(scan_time & 0xFF);
+    out[pos++] = (uint8_t)((scan_time >> 8) & 0xFF);
+    out[pos++] = (uint8_t)((scan_time >> 16) & 0xFF);
+    out[pos++] = (uint8_t)(scan_time >> 24);
+    out[pos++] = record->uid_len;
+    memcpy(&out[pos], record->uid, record->uid_len);
+    pos += record->uid_len;
+    pos += bambu_pack_string(&out[pos], record->material_id);
+    pos += bambu_pack_string(&out[pos], record->variant_id);
+    pos += bambu_pack_string(&out[pos], record->filament_type);
+    pos += bambu_pack_string(&out[pos], record->detailed_type);
+    pos += bambu_pack_string(&out[pos], record->production_date);
+    out[pos++] = record->color_r;
+    out[pos++] = record->color_g;
+    out[pos++] = record->color_b;
+    out[pos++] = record->color_a;
+    pos += bambu_pack_le16(&out[pos], record->weight_grams);
+    pos += bambu_pack_le16(&out[pos], record->diameter_mm_x100);
+    pos += bambu_pack_le16(&out[pos], record->drying_temp_c);
+    pos += bambu_pack_le16(&out[pos], record->drying_hours);
+    pos += bambu_pack_le16(&out[pos], record->hotend_max_c);
+    pos += bambu_pack_le16(&out[pos], record->hotend_min_c);
+    pos += bambu_pack_le16(&out[pos], record->nozzle_diameter_mm_x100);
+    pos += bambu_pack_le16(&out[pos], record->spool_width_mm_x100);
+    pos += bambu_pack_le16(&out[pos], record->filament_length_m);
+    memcpy(&out[pos], record->tray_uid, sizeof(record->tray_uid));
+    pos += sizeof(record->tray_uid);
+    return pos;
+}
+
+// Helper: Read a length-prefixed string, bounded by both the payload and
+// the destination size. Returns false on truncated or oversized input.
+static inline bool bambu_unpack_string(
+    const uint8_t* in,
+    size_t len,
+    size_t* pos,
+    char* dest,
+    size_t dest_size) {
+    if(*pos >= len) return false;
+    size_t str_len = in[*pos];
+    if(str_len >= dest_size || *pos + 1 + str_len > len) return false;
+    memcpy(dest, &in[*pos + 1], str_len);
+    dest[str_len] = '\0';
+    *pos += 1 + str_len;
+    return true;
+}
+
+// Unpack a record frame payload. scan_time may be NULL. Version 1
+// payloads (older logs) unpack with a zero tray UID.
+// Returns false if the payload is malformed or of an unknown version.
+static inline bool bambu_record_unpack(
+    const uint8_t* in,
+    size_t len,
+    BambuSpoolRecord* record,
+    uint32_t* scan_time) {
+    memset(record, 0, sizeof(BambuSpoolRecord));
+    if(len < 6 || in[0] < BAMBU_RECORD_VERSION_MIN || in[0] > BAMBU_RECORD_VERSION) return false;
+    size_t tray_len = in[0] >= 2 ? sizeof(record->tray_uid) : 0;
+
+    if(scan_time) {
+        *scan_time = (uint32_t)in[1] | ((uint32_t)in[2] << 8) | ((uint32_t)in[3] << 16) |
+                     ((uint32_t)in[4] << 24);
+    }
+
+    size_t pos = 5;
+    record->uid_len = in[pos++];
+    if(record->uid_len > sizeof(record->uid) || pos + record->uid_len > len) return false;
+    memcpy(record->uid, &in[pos], record->uid_len);
+    pos += record->uid_len;
+
+    if(!bambu_unpack_string(in, len, &pos, record->material_id, sizeof(record->material_id)) ||
+       !bambu_unpack_string(in, len, &pos, record->variant_id, sizeof(record->variant_id)) ||
+       !bambu_unpack_string(in, len, &pos, record->filament_type, sizeof(record->filament_type)) ||
+       !bambu_unpack_string(in, len, &pos, record->detailed_type, sizeof(record->detailed_type)) ||
+       !bambu_unpack_string(
+           in, len, &pos, record->production_date, sizeof(record->production_date))) {
+        return false;
+    }
+
+    // 4 color bytes + 9 uint16 fields + tray UID (version 2)
+    if(pos + 4 + 9 * 2 + tray_len != len) return false;
+    record->color_r = in[pos++];
+    record->color_g = in[pos++];
+    record->color_b = in[pos++];
+    record->color_a = in[pos++];
+    uint16_t* fields[] = {
+        &record->weight_grams,
+        &record->diameter_mm_x100,
+        &record->drying_temp_c,
+        &record->drying_hours,
+        &record->hotend_max_c,
+        &record->hotend_min_c,
+        &record->nozzle_diameter_mm_x100,
+        &record->spool_width_mm_x100,
+        &record->filament_length_m,
+    };
+    for(size_t i = 0; i < sizeof(fields) / sizeof(fields[0]); i++) {
+        *fields[i] = (uint16_t)(in[pos] | (in[pos + 1] << 8));
+        pos += 2;
+    }
+    memcpy(record->tray_uid, &in[pos], tray_len);
+    return true;
+}
+
+// ============================================================================
+// Receiver: reassembles frames from a byte stream one byte at a time
+// ============================================================================
+
+typedef struct {
+    uint8_t buf[BAMBU_FRAME_MAX_SIZE];  // Bytes from a candidate SOF onwards
+    size_t fill;
+    uint8_t type;
+    uint8_t len;
+    uint8_t payload[BAMBU_FRAME_MAX_PAYLOAD];
+    uint32_t frames_ok;
+    uint32_t crc_errors;
+} BambuFrameRx;
+
+static inline void bambu_frame_rx_init(BambuFrameRx* rx) {
+    memset(rx, 0, sizeof(BambuFrameRx));
+}
+
+// Helper: Drop count bytes from the front of the receive buffer
+static inline void bambu_frame_rx_consume(BambuFrameRx* rx, size_t count) {
+    memmove(rx->buf, &rx->buf[count], rx->fill - count);
+    rx->fill -= count;
+}
+
+// Extract the next complete frame from buffered bytes. Returns true with
+// the frame in rx->type / rx->payload / rx->len (valid until the next call).
+// On a CRC mismatch only the SOF byte is dropped and the buffered bytes are
+// rescanned, so a false start (0xB5 inside other traffic) never swallows
+// the real frame that follows it.
+static inline bool bambu_frame_rx_next(BambuFrameRx* rx) {
+    for(;;) {
+        size_t skip = 0;
+        while(skip < rx->fill && rx->buf[skip] != BAMBU_FRAME_SOF) skip++;
+        bambu_frame_rx_consume(rx, skip);
+
+        if(rx->fill < 3) return false;
+        size_t frame_len = (size_t)rx->buf[2] + BAMBU_FRAME_OVERHEAD;
+        if(rx->fill < frame_len) return false;
+
+        uint16_t crc = bambu_crc16(BAMBU_CRC16_INIT, &rx->buf[1], frame_len - 3);
+        uint16_t received =
+            (uint16_t)(rx->buf[frame_len - 2] | (rx->buf[frame_len - 1] << 8));
+        if(crc == received) {
+            rx->type = rx->buf[1];
+            rx->len = rx->buf[2];
+            memcpy(rx->payload, &rx->buf[3], rx->len);
+            bambu_frame_rx_consume(rx, frame_len);
+            rx->frames_ok++;
+            return true;
+        }
+
+        rx->crc_errors++;
+        bambu_frame_rx_consume(rx, 1);
+    }
+}
+
+// Feed one byte. Returns true when a frame is complete (see
+// bambu_frame_rx_next). After a true return, keep calling
+// bambu_frame_rx_next() until it returns false to drain frames that were
+// recovered from the buffer during resynchronization.
+static inline bool bambu_frame_rx_push(BambuFrameRx* rx, uint8_t byte) {
+    rx->buf[rx->fill++] = byte;
+    return bambu_frame_rx_next(rx);
+}
+
+#endif // BAMBU_FRAME_H
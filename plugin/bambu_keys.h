@@ -0,0 +1,248 @@
+// Bambu Lab NFC Parser - Sector Key Derivation
+// Bambu spool tags use per-tag Mifare Classic keys derived from the UID:
+//   keys = HKDF-SHA256(IKM = UID, salt = BAMBU_KEY_SALT,
+//                      info = "RFID-A\0" or "RFID-B\0", L = 16 * 6)
+// Key n (6 bytes at offset 6 * n) opens sector n.
+// Source: https://github.com/Bambu-Research-Group/RFID-Tag-Guide
+//
+// Portable scalar SHA-256 / HMAC / HKDF shared by the plugin and host
+// tools. No dynamic allocation.
+
+#ifndef BAMBU_KEYS_H
+#define BAMBU_KEYS_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+
+#define BAMBU_KEY_LEN      6
+#define BAMBU_KEY_SECTORS  16  // Mifare Classic 1K
+#define BAMBU_KEYS_LEN     (BAMBU_KEY_LEN * BAMBU_KEY_SECTORS)
+
+static const uint8_t BAMBU_KEY_SALT[16] = {
+    0x9a, 0x75, 0x9c, 0xf2, 0xc4, 0xf7, 0xca, 0xff,
+    0x22, 0x2c, 0xb9, 0x76, 0x9b, 0x41, 0xbc, 0x96,
+};
+
+typedef enum {
+    BambuKeyTypeA,
+    BambuKeyTypeB,
+} BambuKeyType;
+
+// HKDF info strings, including the trailing NUL
+static const uint8_t BAMBU_KEY_INFO[2][7] = {
+    {'R', 'F', 'I', 'D', '-', 'A', '\0'},
+    {'R', 'F', 'I', 'D', '-', 'B', '\0'},
+};
+
+// ============================================================================
+// SHA-256 (FIPS 180-4)
+// ============================================================================
+
+#define BAMBU_SHA256_BLOCK_LEN  64
+#define BAMBU_SHA256_DIGEST_LEN 32
+
+static const uint32_t BAMBU_SHA256_K[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+};
+
+static const uint32_t BAMBU_SHA256_IV[8] = {
+    0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19,
+};
+
+typedef struct {
+    uint32_t state[8];
+    uint64_t length;  // Bytes hashed so far
+    uint8_t buffer[BAMBU_SHA256_BLOCK_LEN];
+    size_t buffered;
+} BambuSha256;
+
+// Helper: Rotate right
+static inline uint32_t bambu_rotr32(uint32_t x, unsigned n) {
+    return (x >> n) | (x << (32 - n));
+}
+
+// Helper: Big-endian load/store
+static inline uint32_t bambu_read_be32(const uint8_t* p) {
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+}
+
+static inline void bambu_write_be32(uint8_t* p, uint32_t v) {
+    p[0] = (uint8_t)(v >> 24);
+    p[1] = (uint8_t)(v >> 16);
+    p[2] = (uint8_t)(v >> 8);
+    p[3] = (uint8_t)v;
+}
+
+// Compress one 64-byte block into state
+static inline void bambu_sha256_compress(uint32_t state[8], const uint8_t block[BAMBU_SHA256_BLOCK_LEN]) {
+    uint32_t w[64];
+    for(size_t i = 0; i < 16; i++) w[i] = bambu_read_be32(&block[i * 4]);
+    for(size_t i = 16; i < 64; i++) {
+        uint32_t s0 = bambu_rotr32(w[i - 15], 7) ^ bambu_rotr32(w[i - 15], 18) ^ (w[i - 15] >> 3);
+        uint32_t s1 = bambu_rotr32(w[i - 2], 17) ^ bambu_rotr32(w[i - 2], 19) ^ (w[i - 2] >> 10);
+        w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+    }
+
+    uint32_t a = state[0], b = state[1], c = state[2], d = state[3];
+    uint32_t e = state[4], f = state[5], g = state[6], h = state[7];
+    for(size_t i = 0; i < 64; i++) {
+        uint32_t t1 = h + (bambu_rotr32(e, 6) ^ bambu_rotr32(e, 11) ^ bambu_rotr32(e, 25)) +
+                      ((e & f) ^ (~e & g)) + BAMBU_SHA256_K[i] + w[i];
+        uint32_t t2 = (bambu_rotr32(a, 2) ^ bambu_rotr32(a, 13) ^ bambu_rotr32(a, 22)) +
+                      ((a & b) ^ (a & c) ^ (b & c));
+        h = g;
+        g = f;
+        f = e;
+        e = d + t1;
+        d = c;
+        c = b;
+        b = a;
+        a = t1 + t2;
+    }
+    state[0] += a;
+    state[1] += b;
+    state[2] += c;
+    state[3] += d;
+    state[4] += e;
+    state[5] += f;
+    state[6] += g;
+    state[7] += h;
+}
+
+static inline void bambu_sha256_init(BambuSha256* ctx) {
+    memcpy(ctx->state, BAMBU_SHA256_IV, sizeof(ctx->state));
+    ctx->length = 0;
+    ctx->buffered = 0;
+}
+
+static inline void bambu_sha256_update(BambuSha256* ctx, const void* data, size_t len) {
+    const uint8_t* bytes = data;
+    ctx->length += len;
+    while(len > 0) {
+        size_t take = BAMBU_SHA256_BLOCK_LEN - ctx->buffered;
+        if(take > len) take = len;
+        memcpy(&ctx->buffer[ctx->buffered], bytes, take);
+        ctx->buffered += take;
+        bytes += take;
+        len -= take;
+        if(ctx->buffered == BAMBU_SHA256_BLOCK_LEN) {
+            bambu_sha256_compress(ctx->state, ctx->buffer);
+            ctx->buffered = 0;
+        }
+    }
+}
+
+static inline void bambu_sha256_final(BambuSha256* ctx, uint8_t digest[BAMBU_SHA256_DIGEST_LEN]) {
+    uint64_t bits = ctx->length * 8;
+    uint8_t pad = 0x80;
+    bambu_sha256_update(ctx, &pad, 1);
+    pad = 0;
+    while(ctx->buffered != BAMBU_SHA256_BLOCK_LEN - 8) bambu_sha256_update(ctx, &pad, 1);
+    uint8_t length_be[8];
+    for(size_t i = 0; i < 8; i++) length_be[i] = (uint8_t)(bits >> (56 - 8 * i));
+    bambu_sha256_update(ctx, length_be, 8);
+    for(size_t i = 0; i < 8; i++) bambu_write_be32(&digest[i * 4], ctx->state[i]);
+}
+
+// ============================================================================
+// HMAC-SHA256 (RFC 2104) and HKDF (RFC 5869)
+// ============================================================================
+
+typedef struct {
+    BambuSha256 inner;
+    BambuSha256 outer;
+} BambuHmacSha256;
+
+static inline void bambu_hmac_sha256_init(BambuHmacSha256* ctx, const uint8_t* key, size_t key_len) {
+    uint8_t block[BAMBU_SHA256_BLOCK_LEN] = {0};
+    if(key_len > BAMBU_SHA256_BLOCK_LEN) {
+        BambuSha256 hash;
+        bambu_sha256_init(&hash);
+        bambu_sha256_update(&hash, key, key_len);
+        bambu_sha256_final(&hash, block);
+    } else {
+        memcpy(block, key, key_len);
+    }
+
+    for(size_t i = 0; i < sizeof(block); i++) block[i] ^= 0x36;
+    bambu_sha256_init(&ctx->inner);
+    bambu_sha256_update(&ctx->inner, block, sizeof(block));
+    for(size_t i = 0; i < sizeof(block); i++) block[i] ^= 0x36 ^ 0x5c;
+    bambu_sha256_init(&ctx->outer);
+    bambu_sha256_update(&ctx->outer, block, sizeof(block));
+}
+
+static inline void bambu_hmac_sha256_final(BambuHmacSha256* ctx, uint8_t mac[BAMBU_SHA256_DIGEST_LEN]) {
+    uint8_t inner[BAMBU_SHA256_DIGEST_LEN];
+    bambu_sha256_final(&ctx->inner, inner);
+    bambu_sha256_update(&ctx->outer, inner, sizeof(inner));
+    bambu_sha256_final(&ctx->outer, mac);
+}
+
+// HKDF-SHA256 extract + expand. out_len must be at most 255 * 32.
+static inline void bambu_hkdf_sha256(
+    const uint8_t* ikm,
+    size_t ikm_len,
+    const uint8_t* salt,
+    size_t salt_len,
+    const uint8_t* info,
+    size_t info_len,
+    uint8_t* out,
+    size_t out_len) {
+    uint8_t prk[BAMBU_SHA256_DIGEST_LEN];
+    BambuHmacSha256 hmac;
+    bambu_hmac_sha256_init(&hmac, salt, salt_len);
+    bambu_sha256_update(&hmac.inner, ikm, ikm_len);
+    bambu_hmac_sha256_final(&hmac, prk);
+
+    uint8_t t[BAMBU_SHA256_DIGEST_LEN];
+    size_t t_len = 0;
+    for(uint8_t counter = 1; out_len > 0; counter++) {
+        bambu_hmac_sha256_init(&hmac, prk, sizeof(prk));
+        bambu_sha256_update(&hmac.inner, t, t_len);
+        bambu_sha256_update(&hmac.inner, info, info_len);
+        bambu_sha256_update(&hmac.inner, &counter, 1);
+        bambu_hmac_sha256_final(&hmac, t);
+        t_len = sizeof(t);
+
+        size_t take = out_len < t_len ? out_len : t_len;
+        memcpy(out, t, take);
+        out += take;
+        out_len -= take;
+    }
+}
+
+// Derive the 16 sector keys of one type for a tag UID
+static inline void bambu_derive_keys(
+    const uint8_t* uid,
+    size_t uid_len,
+    BambuKeyType type,
+    uint8_t keys[BAMBU_KEYS_LEN]) {
+    bambu_hkdf_sha256(
+        uid,
+        uid_len,
+        BAMBU_KEY_SALT,
+        sizeof(BAMBU_KEY_SALT),
+        BAMBU_KEY_INFO[type],
+        sizeof(BAMBU_KEY_INFO[type]),
+        keys,
+        BAMBU_KEYS_LEN);
+}
+
+// Helper: Key as the uint64 form used by Flipper's MfClassicKey helpers
+static inline uint64_t bambu_key_to_u64(const uint8_t key[BAMBU_KEY_LEN]) {
+    uint64_t value = 0;
+    for(size_t i = 0; i < BAMBU_KEY_LEN; i++) value = (value << 8) | key[i];
+    return value;
+}
+
+#endif // BAMBU_KEYS_H
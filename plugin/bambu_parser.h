@@ -4,7 +4,9 @@
 //
 // Usage:
 // - For Flipper: Include after mf_classic.h (types already defined)
-// - For tests: Define BAMBU_PARSER_TEST_MODE and mock types before including
+// - For tests and host tools: Define mock types (see host/bambu_host.h)
+//   before including
+// - Define BAMBU_PROFILE first for a reduced build (see bambu_config.h)
 
 #ifndef BAMBU_PARSER_H
 #define BAMBU_PARSER_H
@@ -14,6 +16,8 @@
 #include <stddef.h>
 #include <string.h>
 
+#include "bambu_config.h"
+
 // Block layout for Bambu Lab spool RFID tags (Mifare Classic 1K)
 // Skip blocks 3,7,11,15,... (sector trailers with MIFARE keys)
 #define BLOCK_MATERIAL_IDS      1   // Material ID (GFxxx) + Variant ID (xxx-Rx)
@@ -22,24 +26,48 @@
 #define BLOCK_COLOR_WEIGHT      5   // RGBA color, weight (g), diameter (mm)
 #define BLOCK_TEMPERATURES      6   // Drying temp/hours, hotend max/min temps
 #define BLOCK_NOZZLE            8   // Nozzle diameter (float at bytes 12-15)
+#define BLOCK_TRAY_UID          9   // Tray UID, shared by both tags of a spool
 #define BLOCK_SPOOL_WIDTH      10   // Spool width (uint16 at bytes 4-5, mm*100)
 #define BLOCK_PRODUCTION_DATE  12   // Production date (ASCII YYYY_MM_DD_HH_MM)
 #define BLOCK_FILAMENT_LENGTH  14   // Filament length (uint16 at bytes 4-5, meters)
+#define BLOCK_SIGNATURE_FIRST  40   // RSA signature area (sectors 10-15)
+#define BLOCK_SIGNATURE_LAST   62
+
+// Helper: Check if a block is a sector trailer (keys + access bits)
+static inline bool bambu_is_sector_trailer(size_t block) {
+    return (block % 4) == 3;
+}
 
 // Helper: Read little-endian uint16
 static inline uint16_t bambu_read_le16(const uint8_t* data) {
     return (uint16_t)(data[0] | (data[1] << 8));
 }
 
+// Helper: Read little-endian uint32
+static inline uint32_t bambu_read_le32(const uint8_t* data) {
+    return (uint32_t)data[0] | ((uint32_t)data[1] << 8) | ((uint32_t)data[2] << 16) |
+           ((uint32_t)data[3] << 24);
+}
+
+#if BAMBU_WITH_FLOAT
 // Helper: Read little-endian uint32 as float (IEEE 754)
 static inline float bambu_read_le_float(const uint8_t* data) {
     union {
         uint32_t u;
         float f;
     } val;
-    val.u = (uint32_t)(data[0] | (data[1] << 8) | (data[2] << 16) | (data[3] << 24));
+    val.u = bambu_read_le32(data);
     return val.f;
 }
+#endif
+
+// IEEE 754 bit patterns of the diameter limits. Positive floats order
+// like their bit patterns read as unsigned integers, and negative values
+// and NaN fall outside every range, so the check needs no float math.
+#define BAMBU_FLOAT_BITS_1_6   0x3FCCCCCDu  // 1.6f
+#define BAMBU_FLOAT_BITS_2_0   0x40000000u  // 2.0f
+#define BAMBU_FLOAT_BITS_2_7   0x402CCCCDu  // 2.7f
+#define BAMBU_FLOAT_BITS_3_0   0x40400000u  // 3.0f
 
 // Helper: Check if block contains printable ASCII (with null padding allowed)
 static inline bool bambu_is_printable_ascii(const uint8_t* data, size_t len) {
@@ -52,6 +80,7 @@ static inline bool bambu_is_printable_ascii(const uint8_t* data, size_t len) {
     return found_printable;
 }
 
+#if BAMBU_WITH_DECODE
 // Helper: Copy null-terminated ASCII string from block data
 static inline void bambu_copy_ascii_string(char* dest, const uint8_t* src, size_t max_len) {
     size_t i;
@@ -60,6 +89,7 @@ static inline void bambu_copy_ascii_string(char* dest, const uint8_t* src, size_
     }
     dest[i] = '\0';
 }
+#endif
 
 // Known filament types for validation
 static const char* const BAMBU_KNOWN_FILAMENT_TYPES[] = {
@@ -104,9 +134,9 @@ static inline bool bambu_tag_is_valid(const MfClassicData* data) {
 
     // Block 5: Check diameter is plausible (1.6-2.0mm or 2.7-3.0mm range)
     const uint8_t* block5 = data->block[BLOCK_COLOR_WEIGHT].data;
-    float diameter = bambu_read_le_float(&block5[8]);
-    bool valid_diameter = (diameter >= 1.6f && diameter <= 2.0f) ||
-                          (diameter >= 2.7f && diameter <= 3.0f);
+    uint32_t diameter = bambu_read_le32(&block5[8]);
+    bool valid_diameter = (diameter >= BAMBU_FLOAT_BITS_1_6 && diameter <= BAMBU_FLOAT_BITS_2_0) ||
+                          (diameter >= BAMBU_FLOAT_BITS_2_7 && diameter <= BAMBU_FLOAT_BITS_3_0);
     if(!valid_diameter) {
         return false;
     }
@@ -114,4 +144,148 @@ static inline bool bambu_tag_is_valid(const MfClassicData* data) {
     return true;
 }
 
+#if BAMBU_WITH_DECODE
+// Decoded spool record: every field bambu_parse() displays, in a flat
+// struct that can be framed, exported or indexed by host tools.
+// Lengths are stored in hundredths of a millimetre to keep the record
+// integer-only.
+typedef struct {
+    uint8_t uid[10];
+    uint8_t uid_len;
+    char material_id[7];        // "GFxxx"
+    char variant_id[8];         // "xxx-Rx"
+    char filament_type[17];     // "PLA"
+    char detailed_type[17];     // "PLA Basic"
+    char production_date[17];   // Raw "YYYY_MM_DD_HH_MM"
+    uint8_t color_r;
+    uint8_t color_g;
+    uint8_t color_b;
+    uint8_t color_a;
+    uint16_t weight_grams;
+    uint16_t diameter_mm_x100;
+    uint16_t drying_temp_c;
+    uint16_t drying_hours;
+    uint16_t hotend_max_c;
+    uint16_t hotend_min_c;
+    uint16_t nozzle_diameter_mm_x100;
+    uint16_t spool_width_mm_x100;
+    uint16_t filament_length_m;
+    uint8_t tray_uid[16];       // Same on both tags of a spool, all zero if absent
+} BambuSpoolRecord;
+
+#if BAMBU_WITH_FLOAT
+// Helper: Convert a millimetre float to hundredths, clamped to uint16
+static inline uint16_t bambu_mm_to_x100(float mm) {
+    if(!(mm > 0.0f)) return 0;  // Also catches NaN
+    if(mm >= 655.35f) return UINT16_MAX;
+    return (uint16_t)(mm * 100.0f + 0.5f);
+}
+#endif
+
+// Helper: Round v to d fewer bits, ties to even (IEEE 754 default)
+static inline uint64_t bambu_round_even(uint64_t v, unsigned d) {
+    if(d == 0) return v;
+    uint64_t q = v >> d;
+    uint64_t rem = v & ((1ULL << d) - 1);
+    uint64_t half = 1ULL << (d - 1);
+    if(rem > half || (rem == half && (q & 1))) q++;
+    return q;
+}
+
+// Helper: Number of significant bits
+static inline unsigned bambu_bit_length(uint64_t v) {
+    unsigned n = 0;
+    for(; v; v >>= 1) n++;
+    return n;
+}
+
+#define BAMBU_FLOAT_BITS_655_35 0x4423D666u  // 655.35f
+
+// Integer-only bambu_mm_to_x100() on the bit pattern of the float. It
+// replays the float path's two roundings (mm * 100, then + 0.5) and gives
+// the same result for every one of the 2^32 inputs.
+static inline uint16_t bambu_mm_bits_to_x100(uint32_t bits) {
+    uint32_t exponent = (bits >> 23) & 0xFF;
+    uint32_t mantissa = bits & 0x7FFFFF;
+    if((bits >> 31) || exponent == 0) return 0;  // Negative, zero, denormal
+    if(exponent == 0xFF && mantissa) return 0;   // NaN
+    if(bits >= BAMBU_FLOAT_BITS_655_35) return UINT16_MAX;
+
+    // mm * 100 rounded to a 24-bit significand: product * 2^-frac
+    uint64_t product = (uint64_t)(mantissa | 0x800000) * 100;
+    unsigned drop = bambu_bit_length(product) - 24;
+    product = bambu_round_even(product, drop);
+    int frac = 150 - (int)exponent - (int)drop;  // >= 8 below 655.35
+    if(frac > 60) return 0;
+
+    // + 0.5, rounded to 24 bits again, then truncated
+    uint64_t sum = product + (1ULL << (frac - 1));
+    unsigned length = bambu_bit_length(sum);
+    if(length > 24) sum = bambu_round_even(sum, length - 24) << (length - 24);
+    return (uint16_t)(sum >> frac);
+}
+
+// Helper: Millimetre float field at data to hundredths
+static inline uint16_t bambu_read_mm_x100(const uint8_t* data) {
+#if BAMBU_WITH_FLOAT
+    return bambu_mm_to_x100(bambu_read_le_float(data));
+#else
+    return bambu_mm_bits_to_x100(bambu_read_le32(data));
+#endif
+}
+
+// Bumped whenever bambu_decode() fills a record differently for the same
+// dump, so host caches of decode results (host/bambu_cache.h) are rebuilt
+#define BAMBU_DECODER_VERSION 1
+
+// Decode: Validate and extract all spool fields into a record
+// Returns false if this is not a Bambu Lab spool tag
+// Requires mf_classic_get_uid() (Flipper API, or mocked for host builds)
+static inline bool bambu_decode(const MfClassicData* data, BambuSpoolRecord* record) {
+    if(!bambu_tag_is_valid(data)) {
+        return false;
+    }
+
+    memset(record, 0, sizeof(BambuSpoolRecord));
+
+    size_t uid_len = 0;
+    const uint8_t* uid = mf_classic_get_uid(data, &uid_len);
+    if(uid_len > sizeof(record->uid)) uid_len = sizeof(record->uid);
+    memcpy(record->uid, uid, uid_len);
+    record->uid_len = (uint8_t)uid_len;
+
+    // Block 1: Variant ID (bytes 0-7) and Material ID (bytes 8-15)
+    const uint8_t* block1 = data->block[BLOCK_MATERIAL_IDS].data;
+    bambu_copy_ascii_string(record->material_id, &block1[8], 6);
+    bambu_copy_ascii_string(record->variant_id, &block1[0], 7);
+
+    bambu_copy_ascii_string(record->filament_type, data->block[BLOCK_FILAMENT_TYPE].data, 16);
+    bambu_copy_ascii_string(record->detailed_type, data->block[BLOCK_DETAILED_TYPE].data, 16);
+
+    // Block 5: RGBA color, weight, diameter
+    const uint8_t* block5 = data->block[BLOCK_COLOR_WEIGHT].data;
+    record->color_r = block5[0];
+    record->color_g = block5[1];
+    record->color_b = block5[2];
+    record->color_a = block5[3];
+    record->weight_grams = bambu_read_le16(&block5[4]);
+    record->diameter_mm_x100 = bambu_read_mm_x100(&block5[8]);
+
+    // Block 6: Drying temp/hours, hotend max/min
+    const uint8_t* block6 = data->block[BLOCK_TEMPERATURES].data;
+    record->drying_temp_c = bambu_read_le16(&block6[0]);
+    record->drying_hours = bambu_read_le16(&block6[2]);
+    record->hotend_max_c = bambu_read_le16(&block6[8]);
+    record->hotend_min_c = bambu_read_le16(&block6[10]);
+
+    record->nozzle_diameter_mm_x100 = bambu_read_mm_x100(&data->block[BLOCK_NOZZLE].data[12]);
+    record->spool_width_mm_x100 = bambu_read_le16(&data->block[BLOCK_SPOOL_WIDTH].data[4]);
+    bambu_copy_ascii_string(record->production_date, data->block[BLOCK_PRODUCTION_DATE].data, 16);
+    record->filament_length_m = bambu_read_le16(&data->block[BLOCK_FILAMENT_LENGTH].data[4]);
+    memcpy(record->tray_uid, data->block[BLOCK_TRAY_UID].data, sizeof(record->tray_uid));
+
+    return true;
+}
+#endif // BAMBU_WITH_DECODE
+
 #endif // BAMBU_PARSER_H
@@ -0,0 +1,238 @@
+// Bambu Lab NFC Parser - Read Strategies
+// Portable card-access logic shared by the plugin's verify/read callbacks
+// and the host read simulator (host/bambu_sim.h). The card is reached
+// through BambuReadOps, so the same sequence of select/auth/read
+// operations runs against the Flipper NFC stack or a simulated target.
+//
+// Strategies:
+// - Dictionary: the firmware's default read. Keys are swept from a
+//   dictionary for every sector; each miss halts the card and costs a
+//   re-select. Bambu keys are only found if they are in the user
+//   dictionary (see bambu_keygen).
+// - Derived: UID-derived keys (bambu_keys.h) for all 16 sectors.
+// - SectorLimited: UID-derived keys for sectors 0-3 only, which hold
+//   every block bambu_decode() reads (1-14). The signature sectors are
+//   skipped.
+//
+// Usage: include after bambu_parser.h (Flipper or host mock types).
+
+#ifndef BAMBU_READ_H
+#define BAMBU_READ_H
+
+#include "bambu_parser.h"
+#include "bambu_keys.h"
+
+#define BAMBU_READ_SECTORS_ALL     16
+#define BAMBU_READ_SECTORS_LIMITED 4   // Sectors 0-3 = blocks 0-15
+#define BAMBU_READ_RETRIES         2   // Extra attempts after a failed operation
+
+// Numbered explicitly: plugin/bambu.c selects one at build time by value
+typedef enum {
+    BambuReadStrategyDictionary = 0,
+    BambuReadStrategyDerived = 1,
+    BambuReadStrategySectorLimited = 2,
+} BambuReadStrategy;
+
+static const char* const BAMBU_READ_STRATEGY_NAMES[] = {
+    [BambuReadStrategyDictionary] = "dictionary",
+    [BambuReadStrategyDerived] = "derived",
+    [BambuReadStrategySectorLimited] = "sector-limited",
+};
+
+// Card access. Every call returns false on failure; a failed auth or read
+// leaves the card halted until the next select, as on real Mifare Classic.
+typedef struct {
+    void* context;
+    bool (*select)(void* context, uint8_t* uid, uint8_t* uid_len);  // uid: 10 bytes
+    bool (*auth)(void* context, uint8_t block, const uint8_t key[BAMBU_KEY_LEN], BambuKeyType type);
+    bool (*read_block)(void* context, uint8_t block, uint8_t data[16]);
+} BambuReadOps;
+
+// Key source for the dictionary strategy: key_at() yields key index of
+// count (a callback, so multi-million key dictionaries need no copy)
+typedef struct {
+    void* context;
+    size_t count;
+    void (*key_at)(void* context, size_t index, uint8_t key[BAMBU_KEY_LEN]);
+} BambuReadDictionary;
+
+typedef struct {
+    BambuReadStrategy strategy;
+    uint8_t sectors;  // Sectors 0..sectors-1 are read
+    uint8_t key_a[BAMBU_KEYS_LEN];  // Sector n at n * BAMBU_KEY_LEN
+    uint8_t key_b[BAMBU_KEYS_LEN];
+    const BambuReadDictionary* dictionary;  // Dictionary strategy only
+} BambuReadPlan;
+
+typedef struct {
+    uint32_t selects;
+    uint32_t auths;
+    uint32_t auth_failures;
+    uint32_t reads;
+    uint32_t read_failures;
+    uint16_t sectors_read;
+} BambuReadStats;
+
+// Build the plan for a strategy. Derived strategies need the UID.
+static inline void bambu_read_plan(
+    BambuReadStrategy strategy,
+    const uint8_t* uid,
+    size_t uid_len,
+    BambuReadPlan* plan) {
+    memset(plan, 0, sizeof(BambuReadPlan));
+    plan->strategy = strategy;
+    plan->sectors = strategy == BambuReadStrategySectorLimited ? BAMBU_READ_SECTORS_LIMITED :
+                                                                 BAMBU_READ_SECTORS_ALL;
+    if(strategy != BambuReadStrategyDictionary) {
+        bambu_derive_keys(uid, uid_len, BambuKeyTypeA, plan->key_a);
+        bambu_derive_keys(uid, uid_len, BambuKeyTypeB, plan->key_b);
+    }
+}
+
+// Helper: Select the card again after a halt, retrying transient failures
+static inline bool bambu_read_select(const BambuReadOps* ops, BambuReadStats* stats) {
+    uint8_t uid[10];
+    uint8_t uid_len;
+    for(size_t attempt = 0; attempt <= BAMBU_READ_RETRIES; attempt++) {
+        stats->selects++;
+        if(ops->select(ops->context, uid, &uid_len)) return true;
+    }
+    return false;
+}
+
+// Helper: Authenticate a sector. A failure halts the card; the caller
+// re-selects before the next operation.
+static inline bool bambu_read_auth(
+    const BambuReadOps* ops,
+    BambuReadStats* stats,
+    uint8_t sector,
+    const uint8_t key[BAMBU_KEY_LEN],
+    BambuKeyType type) {
+    stats->auths++;
+    if(ops->auth(ops->context, (uint8_t)(sector * 4), key, type)) return true;
+    stats->auth_failures++;
+    return false;
+}
+
+typedef struct {
+    uint8_t key[BAMBU_KEY_LEN];
+    BambuKeyType type;
+} BambuReadKey;
+
+// Helper: Find the key that opens a sector and leave the sector
+// authenticated. Known keys: Key A, then Key B. Dictionary: sweep Key A
+// candidates in order, as the firmware does first.
+static inline bool bambu_read_find_key(
+    const BambuReadOps* ops,
+    BambuReadStats* stats,
+    const BambuReadPlan* plan,
+    uint8_t sector,
+    BambuReadKey* found) {
+    if(plan->strategy != BambuReadStrategyDictionary) {
+        memcpy(found->key, &plan->key_a[sector * BAMBU_KEY_LEN], BAMBU_KEY_LEN);
+        found->type = BambuKeyTypeA;
+        if(bambu_read_auth(ops, stats, sector, found->key, found->type)) return true;
+        if(!bambu_read_select(ops, stats)) return false;
+        memcpy(found->key, &plan->key_b[sector * BAMBU_KEY_LEN], BAMBU_KEY_LEN);
+        found->type = BambuKeyTypeB;
+        return bambu_read_auth(ops, stats, sector, found->key, found->type);
+    }
+
+    if(plan->dictionary == NULL) return false;
+    found->type = BambuKeyTypeA;
+    for(size_t i = 0; i < plan->dictionary->count; i++) {
+        plan->dictionary->key_at(plan->dictionary->context, i, found->key);
+        if(bambu_read_auth(ops, stats, sector, found->key, found->type)) return true;
+        if(!bambu_read_select(ops, stats)) return false;
+    }
+    return false;
+}
+
+// Helper: Read the data blocks of one sector into data. A transient
+// failure costs a re-select and re-auth with the key already found;
+// blocks read before the failure are kept.
+static inline bool bambu_read_sector(
+    const BambuReadOps* ops,
+    BambuReadStats* stats,
+    const BambuReadPlan* plan,
+    uint8_t sector,
+    MfClassicData* data) {
+    BambuReadKey key;
+    bool have_key = false;
+    uint8_t block = sector * 4;
+    uint8_t trailer = sector * 4 + 3;
+
+    for(size_t attempt = 0; attempt <= BAMBU_READ_RETRIES; attempt++) {
+        if(attempt > 0 && !bambu_read_select(ops, stats)) return false;
+        if(!have_key) {
+            have_key = bambu_read_find_key(ops, stats, plan, sector, &key);
+            // A dictionary sweep is not worth repeating
+            if(!have_key && plan->strategy == BambuReadStrategyDictionary) return false;
+            if(!have_key) continue;
+        } else if(!bambu_read_auth(ops, stats, sector, key.key, key.type)) {
+            continue;
+        }
+
+        while(block < trailer) {
+            stats->reads++;
+            if(!ops->read_block(ops->context, block, data->block[block].data)) {
+                stats->read_failures++;
+                break;
+            }
+            block++;
+        }
+        if(block == trailer) return true;
+    }
+    return false;
+}
+
+// Execute a plan: select, then per sector authenticate and read its data
+// blocks into data. Blocks of sectors that could not be read are left
+// untouched. Returns true if every planned sector was read.
+static inline bool bambu_read_execute(
+    const BambuReadOps* ops,
+    const BambuReadPlan* plan,
+    MfClassicData* data,
+    BambuReadStats* stats) {
+    memset(stats, 0, sizeof(BambuReadStats));
+    if(!bambu_read_select(ops, stats)) return false;
+
+    bool halted = false;
+    for(uint8_t sector = 0; sector < plan->sectors; sector++) {
+        // Sectors after a failed one start from a fresh select
+        if(halted && !bambu_read_select(ops, stats)) break;
+        halted = !bambu_read_sector(ops, stats, plan, sector, data);
+        if(!halted) stats->sectors_read++;
+    }
+    return stats->sectors_read == plan->sectors;
+}
+
+// Cheap verify: select, authenticate sector 0 with the UID-derived key A
+// and check the "GF" signature in block 1. Three operations instead of a
+// full read decide whether a card is a Bambu spool. Failures are retried:
+// a wrong key and a tag at the edge of the field look the same, and
+// rejecting a genuine spool costs far more than a retry.
+static inline bool bambu_read_verify(const BambuReadOps* ops, BambuReadStats* stats) {
+    memset(stats, 0, sizeof(BambuReadStats));
+    for(size_t attempt = 0; attempt <= BAMBU_READ_RETRIES; attempt++) {
+        uint8_t uid[10];
+        uint8_t uid_len = 0;
+        stats->selects++;
+        if(!ops->select(ops->context, uid, &uid_len)) continue;
+
+        uint8_t keys[BAMBU_KEYS_LEN];
+        bambu_derive_keys(uid, uid_len, BambuKeyTypeA, keys);
+        if(!bambu_read_auth(ops, stats, 0, &keys[0], BambuKeyTypeA)) continue;
+
+        uint8_t block[16];
+        stats->reads++;
+        if(!ops->read_block(ops->context, BLOCK_MATERIAL_IDS, block)) {
+            stats->read_failures++;
+            continue;
+        }
+        return block[8] == 'G' && block[9] == 'F';
+    }
+    return false;
+}
+
+#endif // BAMBU_READ_H
@@ -0,0 +1,172 @@
+// Bambu Lab NFC Parser - Continuous Scan
+// Portable state machine behind the scan app (bambu_scan_app.c): poll the
+// field, read every new tag once, report it, and ignore it until it has
+// left. The card is reached through BambuReadOps (bambu_read.h), so host
+// tests drive the same code with a simulated card (host/bambu_sim.h).
+//
+// - A poll is one select. While the same UID answers, nothing is read.
+// - A new UID is read with UID-derived keys from sectors 0-1 only: blocks
+//   1-6 hold everything bambu_tag_is_valid() checks and the summary shows
+//   (type, color, weight). Record fields from later sectors stay zero.
+// - A tag has left after BAMBU_SCAN_ABSENT_POLLS polls without an answer,
+//   so a spool wobbling at the edge of the field is not logged twice.
+// - A failed read is retried on the following polls, up to
+//   BAMBU_SCAN_READ_ATTEMPTS reads, before the tag is reported unreadable.
+//
+// Usage: include after bambu_parser.h and bambu_filaments.h (Flipper or
+// host mock types); needs the decoder (BAMBU_PROFILE_NOFLOAT or _FULL).
+
+#ifndef BAMBU_SCAN_H
+#define BAMBU_SCAN_H
+
+#include <stdio.h>
+
+#include "bambu_parser.h"
+#include "bambu_read.h"
+#include "spool_registry.h"
+
+#define BAMBU_SCAN_SECTORS       2   // Sectors 0-1 = blocks 0-7
+#define BAMBU_SCAN_ABSENT_POLLS  3
+#define BAMBU_SCAN_READ_ATTEMPTS 3
+
+// Summary lines fit the 128 px screen in FontSecondary (about 25 characters):
+// a 16 character type plus a 5 digit weight, or the longest color name
+#define BAMBU_SCAN_LINE_LEN 26
+
+// Columns of a scan log line (bambu_scan_log_line())
+#define BAMBU_SCAN_LOG_HEADER "time\tuid\tvariant_id\tmaterial_id\ttype\tcolor\tcolor_name\tweight_g\n"
+
+typedef enum {
+    BambuScanEventNone,      // Field empty, or a read will be retried
+    BambuScanEventHeld,      // The reported tag is still in the field
+    BambuScanEventSpool,     // New spool read: the record is filled
+    BambuScanEventNotSpool,  // New tag read, but not a spool tag
+    BambuScanEventFailed,    // New tag could not be read (no Bambu keys, or out of range)
+    BambuScanEventLeft,      // The reported tag left the field
+} BambuScanEvent;
+
+typedef struct {
+    uint8_t uid[10];      // Tag in the field
+    uint8_t uid_len;      // 0 = none
+    bool reported;        // The tag's event was returned; it is not read again
+    uint8_t misses;       // Polls since it last answered
+    uint8_t attempts;     // Failed reads of it
+    uint32_t spools;      // Spools reported since bambu_scan_init()
+    BambuReadStats stats; // Last read
+} BambuScanner;
+
+static inline void bambu_scan_init(BambuScanner* scanner) {
+    memset(scanner, 0, sizeof(BambuScanner));
+}
+
+// Helper: Forget the tag in the field
+static inline void bambu_scan_forget(BambuScanner* scanner) {
+    scanner->uid_len = 0;
+    scanner->reported = false;
+    scanner->misses = 0;
+    scanner->attempts = 0;
+}
+
+// Poll once. data is scratch space for the read (its blocks are cleared;
+// on Flipper pass an mf_classic_alloc() instance); record is filled for
+// BambuScanEventSpool, with the UID of the tag.
+static inline BambuScanEvent bambu_scan_poll(
+    BambuScanner* scanner,
+    const BambuReadOps* ops,
+    MfClassicData* data,
+    BambuSpoolRecord* record) {
+    uint8_t uid[10];
+    uint8_t uid_len = 0;
+    if(!ops->select(ops->context, uid, &uid_len)) {
+        if(scanner->uid_len == 0) return BambuScanEventNone;
+        if(++scanner->misses < BAMBU_SCAN_ABSENT_POLLS) {
+            return scanner->reported ? BambuScanEventHeld : BambuScanEventNone;
+        }
+        bool reported = scanner->reported;
+        bambu_scan_forget(scanner);
+        return reported ? BambuScanEventLeft : BambuScanEventNone;
+    }
+
+    if(uid_len > sizeof(uid)) uid_len = sizeof(uid);
+    if(uid_len != scanner->uid_len || memcmp(uid, scanner->uid, uid_len) != 0) {
+        // A new tag, possibly swapped in between two polls
+        bambu_scan_forget(scanner);
+        memcpy(scanner->uid, uid, uid_len);
+        scanner->uid_len = uid_len;
+    }
+    scanner->misses = 0;
+    if(scanner->reported) return BambuScanEventHeld;
+
+    BambuReadPlan plan;
+    bambu_read_plan(BambuReadStrategyDerived, uid, uid_len, &plan);
+    plan.sectors = BAMBU_SCAN_SECTORS;
+    memset(data->block, 0, sizeof(data->block));
+    data->type = MfClassicType1k;
+    if(!bambu_read_execute(ops, &plan, data, &scanner->stats)) {
+        if(++scanner->attempts < BAMBU_SCAN_READ_ATTEMPTS) return BambuScanEventNone;
+        scanner->reported = true;
+        return BambuScanEventFailed;
+    }
+
+    scanner->reported = true;
+    if(spool_registry_decode(data, record) == NULL) return BambuScanEventNotSpool;
+    // data carries no UID of its own (only blocks were read)
+    memcpy(record->uid, uid, uid_len);
+    record->uid_len = uid_len;
+    scanner->spools++;
+    return BambuScanEventSpool;
+}
+
+// Helper: Color as "#RRGGBB", or "#RRGGBBAA" if not opaque
+static inline void bambu_scan_color_hex(const BambuSpoolRecord* record, char hex[10]) {
+    if(record->color_a == 0xFF) {
+        snprintf(hex, 10, "#%02X%02X%02X", record->color_r, record->color_g, record->color_b);
+    } else {
+        snprintf(
+            hex, 10, "#%02X%02X%02X%02X", record->color_r, record->color_g, record->color_b, record->color_a);
+    }
+}
+
+// Two-line summary: "PLA Matte 1000g" and "Ivory White" (the hex color
+// without a catalog entry)
+static inline void bambu_scan_summary(
+    const BambuSpoolRecord* record,
+    char type_line[BAMBU_SCAN_LINE_LEN],
+    char color_line[BAMBU_SCAN_LINE_LEN]) {
+    const BambuFilamentInfo* info = bambu_lookup_filament(record->variant_id);
+    snprintf(type_line, BAMBU_SCAN_LINE_LEN, "%s %ug", record->detailed_type, record->weight_grams);
+    if(info) {
+        snprintf(color_line, BAMBU_SCAN_LINE_LEN, "%s", info->color_name);
+    } else {
+        bambu_scan_color_hex(record, color_line);
+    }
+}
+
+// Log line in BAMBU_SCAN_LOG_HEADER columns, newline included; timestamp
+// is Unix time. Returns the length written (truncated to size - 1).
+static inline size_t bambu_scan_log_line(const BambuSpoolRecord* record, uint32_t timestamp, char* line, size_t size) {
+    char uid_hex[21];
+    for(size_t i = 0; i < record->uid_len && i < 10; i++) {
+        snprintf(&uid_hex[i * 2], 3, "%02X", record->uid[i]);
+    }
+    uid_hex[record->uid_len * 2] = '\0';
+    char hex[10];
+    bambu_scan_color_hex(record, hex);
+    const BambuFilamentInfo* info = bambu_lookup_filament(record->variant_id);
+    int len = snprintf(
+        line,
+        size,
+        "%lu\t%s\t%s\t%s\t%s\t%s\t%s\t%u\n",
+        (unsigned long)timestamp,
+        uid_hex,
+        record->variant_id,
+        record->material_id,
+        record->detailed_type,
+        hex,
+        info ? info->color_name : "",
+        record->weight_grams);
+    if(len < 0) return 0;
+    return (size_t)len < size ? (size_t)len : size - 1;
+}
+
+#endif // BAMBU_SCAN_H
@@ -0,0 +1,184 @@
+// Bambu Scan - continuous check-in of many spools in a row
+// Keeps the NFC field polling: every new spool is read from its two data
+// sectors (bambu_scan.h), shown as two summary lines, confirmed with a
+// blink and beep, and appended to /ext/apps_data/bambu_scan/scan_log.tsv.
+// The same tag is ignored until it leaves the field. Back exits.
+
+#include <furi.h>
+#include <furi_hal_rtc.h>
+#include <gui/gui.h>
+#include <input/input.h>
+#include <notification/notification_messages.h>
+#include <storage/storage.h>
+#include <nfc/nfc.h>
+#include <string.h>
+
+#include "bambu_filaments.h"
+#include "bambu_parser.h"
+#include "bambu_scan.h"
+#include "bambu_flipper_card.h"
+
+#define TAG "BambuScan"
+
+#define BAMBU_SCAN_POLL_MS  100
+#define BAMBU_SCAN_LOG_PATH APP_DATA_PATH("scan_log.tsv")
+
+typedef struct {
+    Gui* gui;
+    ViewPort* view_port;
+    FuriMessageQueue* input_queue;
+    NotificationApp* notifications;
+    Storage* storage;
+    Nfc* nfc;
+    FuriThread* worker;
+    volatile bool running;
+
+    // Screen state, written by the worker under lock
+    FuriMutex* lock;
+    const char* status;
+    char last_type[BAMBU_SCAN_LINE_LEN];
+    char last_color[BAMBU_SCAN_LINE_LEN];
+    uint32_t spools;
+    uint32_t log_errors;
+} BambuScanApp;
+
+static void bambu_scan_app_draw(Canvas* canvas, void* context) {
+    BambuScanApp* app = context;
+    furi_mutex_acquire(app->lock, FuriWaitForever);
+
+    canvas_clear(canvas);
+    canvas_set_font(canvas, FontPrimary);
+    canvas_draw_str(canvas, 2, 10, "Bambu Spool Scan");
+    canvas_set_font(canvas, FontSecondary);
+    canvas_draw_str(canvas, 2, 22, app->status);
+    canvas_draw_str(canvas, 2, 34, app->last_type);
+    canvas_draw_str(canvas, 2, 45, app->last_color);
+
+    char counts[BAMBU_SCAN_LINE_LEN];
+    if(app->log_errors) {
+        snprintf(
+            counts,
+            sizeof(counts),
+            "Spools: %lu Unlogged: %lu",
+            (unsigned long)app->spools,
+            (unsigned long)app->log_errors);
+    } else {
+        snprintf(counts, sizeof(counts), "Spools: %lu", (unsigned long)app->spools);
+    }
+    canvas_draw_str(canvas, 2, 60, counts);
+
+    furi_mutex_release(app->lock);
+}
+
+static void bambu_scan_app_input(InputEvent* event, void* context) {
+    BambuScanApp* app = context;
+    furi_message_queue_put(app->input_queue, event, FuriWaitForever);
+}
+
+// Helper: Append a record to the scan log, writing the header to a new log
+static bool bambu_scan_app_log(BambuScanApp* app, const BambuSpoolRecord* record) {
+    char line[160];
+    size_t len = bambu_scan_log_line(record, furi_hal_rtc_get_timestamp(), line, sizeof(line));
+    File* file = storage_file_alloc(app->storage);
+    bool ok = storage_file_open(file, BAMBU_SCAN_LOG_PATH, FSAM_WRITE, FSOM_OPEN_APPEND);
+    if(ok && storage_file_size(file) == 0) {
+        size_t header_len = strlen(BAMBU_SCAN_LOG_HEADER);
+        ok = storage_file_write(file, BAMBU_SCAN_LOG_HEADER, header_len) == header_len;
+    }
+    if(ok) ok = storage_file_write(file, line, len) == len;
+    storage_file_close(file);
+    storage_file_free(file);
+    return ok;
+}
+
+// Helper: Update the screen; record may be NULL to keep the last spool
+static void bambu_scan_app_show(BambuScanApp* app, const char* status, const BambuSpoolRecord* record, bool logged) {
+    furi_mutex_acquire(app->lock, FuriWaitForever);
+    app->status = status;
+    if(record) {
+        bambu_scan_summary(record, app->last_type, app->last_color);
+        app->spools++;
+        if(!logged) app->log_errors++;
+    }
+    furi_mutex_release(app->lock);
+    view_port_update(app->view_port);
+}
+
+static int32_t bambu_scan_app_worker(void* context) {
+    BambuScanApp* app = context;
+    BambuFlipperCard card = {.nfc = app->nfc};
+    BambuReadOps ops = bambu_flipper_ops(&card);
+    MfClassicData* data = mf_classic_alloc();
+    BambuScanner scanner;
+    bambu_scan_init(&scanner);
+
+    while(app->running) {
+        BambuSpoolRecord record;
+        BambuScanEvent event = bambu_scan_poll(&scanner, &ops, data, &record);
+        if(event == BambuScanEventSpool) {
+            bool logged = bambu_scan_app_log(app, &record);
+            FURI_LOG_I(
+                TAG, "%s %s (%lu auths)", record.detailed_type, record.variant_id, (unsigned long)scanner.stats.auths);
+            notification_message(app->notifications, logged ? &sequence_success : &sequence_error);
+            bambu_scan_app_show(app, logged ? "Logged. Next spool" : "Not logged: SD error", &record, logged);
+        } else if(event == BambuScanEventNotSpool) {
+            notification_message(app->notifications, &sequence_error);
+            bambu_scan_app_show(app, "Not a Bambu spool", NULL, true);
+        } else if(event == BambuScanEventFailed) {
+            notification_message(app->notifications, &sequence_error);
+            bambu_scan_app_show(app, "Read failed: hold still", NULL, true);
+        } else if(event == BambuScanEventLeft) {
+            bambu_scan_app_show(app, "Place next spool", NULL, true);
+        }
+        furi_delay_ms(BAMBU_SCAN_POLL_MS);
+    }
+
+    mf_classic_free(data);
+    return 0;
+}
+
+int32_t bambu_scan_app(void* p) {
+    UNUSED(p);
+    BambuScanApp* app = malloc(sizeof(BambuScanApp));
+    memset(app, 0, sizeof(BambuScanApp));
+    app->lock = furi_mutex_alloc(FuriMutexTypeNormal);
+    app->status = "Hold a spool to the back";
+    strlcpy(app->last_type, "-", sizeof(app->last_type));
+
+    app->input_queue = furi_message_queue_alloc(8, sizeof(InputEvent));
+    app->view_port = view_port_alloc();
+    view_port_draw_callback_set(app->view_port, bambu_scan_app_draw, app);
+    view_port_input_callback_set(app->view_port, bambu_scan_app_input, app);
+    app->gui = furi_record_open(RECORD_GUI);
+    gui_add_view_port(app->gui, app->view_port, GuiLayerFullscreen);
+    app->notifications = furi_record_open(RECORD_NOTIFICATION);
+    app->storage = furi_record_open(RECORD_STORAGE);
+    app->nfc = nfc_alloc();
+
+    // Check-in sessions are long; keep the screen readable
+    notification_message(app->notifications, &sequence_display_backlight_enforce_on);
+    app->running = true;
+    app->worker = furi_thread_alloc_ex(TAG, 4096, bambu_scan_app_worker, app);
+    furi_thread_start(app->worker);
+
+    InputEvent event;
+    while(furi_message_queue_get(app->input_queue, &event, FuriWaitForever) == FuriStatusOk) {
+        if(event.type == InputTypeShort && event.key == InputKeyBack) break;
+    }
+
+    app->running = false;
+    furi_thread_join(app->worker);
+    furi_thread_free(app->worker);
+    notification_message(app->notifications, &sequence_display_backlight_enforce_auto);
+
+    nfc_free(app->nfc);
+    furi_record_close(RECORD_STORAGE);
+    furi_record_close(RECORD_NOTIFICATION);
+    gui_remove_view_port(app->gui, app->view_port);
+    furi_record_close(RECORD_GUI);
+    view_port_free(app->view_port);
+    furi_message_queue_free(app->input_queue);
+    furi_mutex_free(app->lock);
+    free(app);
+    return 0;
+}
@@ -0,0 +1,131 @@
+// Spool Tag Registry - Vendor Dispatch
+// One NFC plugin serves every supported spool vendor. Each vendor declares
+// a cheap signature: two bytes at a fixed block/offset of a given card
+// type. Dispatch reads the signature bytes once, finds the single vendor
+// owning them in a small hash table and runs only that vendor's full
+// validation and decode. Cost is constant in the number of vendors; only
+// the number of distinct signature locations matters (one per card layout).
+//
+// Decoders fill the shared BambuSpoolRecord (vendor-neutral fields:
+// material, color, weight, temperatures, dimensions, production date).
+//
+// Adding a vendor: write a SpoolVendorDecode decoder
+// (full validation included) and append an entry to SPOOL_VENDORS.
+//
+// Usage: include after bambu_parser.h (Flipper or host mock types).
+
+#ifndef SPOOL_REGISTRY_H
+#define SPOOL_REGISTRY_H
+
+#include "bambu_parser.h"
+
+// Full validation + decode. Returns false if the tag is not this vendor's.
+typedef bool (*SpoolVendorDecode)(const MfClassicData* data, BambuSpoolRecord* record);
+
+typedef struct {
+    const char* name;          // Display name, e.g. "Bambu Lab"
+    MfClassicType card_type;   // Card layout the signature applies to
+    uint8_t signature_block;
+    uint8_t signature_offset;  // Byte offset within the block (0-14)
+    uint8_t signature[2];
+    SpoolVendorDecode decode;
+} SpoolVendor;
+
+static const SpoolVendor SPOOL_VENDORS[] = {
+    // Bambu Lab: Material ID "GFxxx" at block 1 bytes 8-9
+    {"Bambu Lab", MfClassicType1k, BLOCK_MATERIAL_IDS, 8, {'G', 'F'}, bambu_decode},
+};
+#define SPOOL_NUM_VENDORS (sizeof(SPOOL_VENDORS) / sizeof(SPOOL_VENDORS[0]))
+
+// Distinct signature locations, filled when the table is built
+#define SPOOL_REGISTRY_MAX_PROBES 4
+#define SPOOL_REGISTRY_SLOTS      16  // Power of two, at least 2x the vendor count
+
+typedef struct {
+    uint32_t keys[SPOOL_REGISTRY_SLOTS];
+    uint8_t vendors[SPOOL_REGISTRY_SLOTS];  // Vendor index + 1, 0 = empty
+    struct {
+        MfClassicType card_type;
+        uint8_t block;
+        uint8_t offset;
+    } probes[SPOOL_REGISTRY_MAX_PROBES];
+    uint8_t probe_count;
+    bool ready;
+} SpoolRegistry;
+
+static SpoolRegistry spool_registry;
+
+// Helper: Table key for a probe index and the two signature bytes
+static inline uint32_t spool_registry_key(size_t probe, const uint8_t* bytes) {
+    return ((uint32_t)probe << 16) | ((uint32_t)bytes[0] << 8) | bytes[1];
+}
+
+// Helper: Slot holding key, or the empty slot where it would go
+static inline size_t spool_registry_slot(const SpoolRegistry* registry, uint32_t key) {
+    size_t i = (size_t)((key * 0x9E3779B1u) >> 16) & (SPOOL_REGISTRY_SLOTS - 1);
+    while(registry->vendors[i] != 0 && registry->keys[i] != key) {
+        i = (i + 1) & (SPOOL_REGISTRY_SLOTS - 1);
+    }
+    return i;
+}
+
+// Build the dispatch table (done once, on first use)
+static inline void spool_registry_build(SpoolRegistry* registry) {
+    memset(registry, 0, sizeof(SpoolRegistry));
+    for(size_t v = 0; v < SPOOL_NUM_VENDORS && v * 2 < SPOOL_REGISTRY_SLOTS; v++) {
+        const SpoolVendor* vendor = &SPOOL_VENDORS[v];
+
+        size_t probe = 0;
+        while(probe < registry->probe_count &&
+              (registry->probes[probe].card_type != vendor->card_type ||
+               registry->probes[probe].block != vendor->signature_block ||
+               registry->probes[probe].offset != vendor->signature_offset)) {
+            probe++;
+        }
+        if(probe == registry->probe_count) {
+            if(probe == SPOOL_REGISTRY_MAX_PROBES) continue;
+            registry->probes[probe].card_type = vendor->card_type;
+            registry->probes[probe].block = vendor->signature_block;
+            registry->probes[probe].offset = vendor->signature_offset;
+            registry->probe_count++;
+        }
+
+        uint32_t key = spool_registry_key(probe, vendor->signature);
+        size_t slot = spool_registry_slot(registry, key);
+        if(registry->vendors[slot] == 0) {  // First vendor claiming a signature wins
+            registry->keys[slot] = key;
+            registry->vendors[slot] = (uint8_t)(v + 1);
+        }
+    }
+    registry->ready = true;
+}
+
+// Find the vendor whose signature matches, without full validation.
+// Returns NULL if no vendor claims the tag.
+static inline const SpoolVendor* spool_registry_match(const MfClassicData* data) {
+    if(!spool_registry.ready) spool_registry_build(&spool_registry);
+
+    for(size_t probe = 0; probe < spool_registry.probe_count; probe++) {
+        if(data->type != spool_registry.probes[probe].card_type) continue;
+        const uint8_t* bytes = &data->block[spool_registry.probes[probe].block]
+                                    .data[spool_registry.probes[probe].offset];
+        size_t slot = spool_registry_slot(&spool_registry, spool_registry_key(probe, bytes));
+        if(spool_registry.vendors[slot] != 0) {
+            return &SPOOL_VENDORS[spool_registry.vendors[slot] - 1];
+        }
+    }
+    return NULL;
+}
+
+// Dispatch to the matching vendor's decoder.
+// Returns the vendor, or NULL if no vendor claims the tag or it fails
+// that vendor's validation.
+static inline const SpoolVendor* spool_registry_decode(const MfClassicData* data, BambuSpoolRecord* record) {
+    const SpoolVendor* vendor = spool_registry_match(data);
+    if(vendor == NULL || !vendor->decode(data, record)) {
+        return NULL;
+    }
+    return vendor;
+}
+
+#endif // SPOOL_REGISTRY_H
@@ -0,0 +1,53 @@
+/**
+ * Bambu Lab NFC Parser - Profile Size Probe
+ *
+ * Compiled once per build profile (plugin/bambu_config.h) by
+ * `make size-report`: each object holds what a consumer of that profile
+ * links in, so `size` shows its code and data cost. Not linked or run.
+ *
+ * Build: gcc -Os -c -DBAMBU_PROFILE=1 profile_size.c
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// Mock Flipper Zero types (as in test_bambu.c)
+typedef enum {
+    MfClassicType1k,
+    MfClassicType4k,
+} MfClassicType;
+
+typedef struct {
+    uint8_t data[16];
+} MfClassicBlock;
+
+typedef struct {
+    MfClassicType type;
+    MfClassicBlock block[64];
+    uint8_t uid[10];
+    size_t uid_len;
+} MfClassicData;
+
+static inline const uint8_t* mf_classic_get_uid(const MfClassicData* data, size_t* uid_len) {
+    *uid_len = data->uid_len;
+    return data->uid;
+}
+
+#include "../plugin/bambu_parser.h"
+#include "../plugin/bambu_filaments.h"
+
+bool bambu_probe_validate(const MfClassicData* data) {
+    return bambu_tag_is_valid(data);
+}
+
+#if BAMBU_WITH_DECODE
+bool bambu_probe_decode(const MfClassicData* data, BambuSpoolRecord* record) {
+    return bambu_decode(data, record);
+}
+
+const char* bambu_probe_color(const BambuSpoolRecord* record) {
+    const BambuFilamentInfo* info = bambu_lookup_filament(record->variant_id);
+    return info ? info->color_name : NULL;
+}
+#endif
@@ -33,14 +33,23 @@ typedef struct {
 typedef struct {
     MfClassicType type;
     MfClassicBlock block[64];  // 1K has 64 blocks
+    uint8_t uid[10];
+    size_t uid_len;
 } MfClassicData;
 
+static const uint8_t* mf_classic_get_uid(const MfClassicData* data, size_t* uid_len) {
+    *uid_len = data->uid_len;
+    return data->uid;
+}
+
 // ============================================================================
 // Include the actual production code being tested
 // ============================================================================
 
 #include "../plugin/bambu_parser.h"
 #include "../plugin/bambu_filaments.h"
+#include "../plugin/spool_registry.h"
+#include "../plugin/bambu_keys.h"
 
 // ============================================================================
 // NFC file parser
@@ -89,6 +98,17 @@ static bool load_nfc_file(const char* path, MfClassicData* data) {
             data->type = MfClassicType4k;
             found_type = true;
         }
+        // Parse UID
+        else if (strncmp(line, "UID: ", 5) == 0) {
+            char* ptr = line + 5;
+            while (data->uid_len < sizeof(data->uid) && *ptr && *ptr != '\n') {
+                while (*ptr == ' ') ptr++;
+                int byte = parse_hex_byte(ptr);
+                if (byte < 0) break;
+                data->uid[data->uid_len++] = (uint8_t)byte;
+                ptr += 2;
+            }
+        }
         // Parse block data
         else if (strncmp(line, "Block ", 6) == 0) {
             int block_num;
@@ -420,6 +440,44 @@ static bool test_parse_file(const char* test_dir, const ExpectedValues* expected
     return true;
 }
 
+// Test the combined decode path used by the plugin and host tools
+static bool test_decode_file(const char* test_dir, const ExpectedValues* expected) {
+    char path[512];
+    snprintf(path, sizeof(path), "%s/%s", test_dir, expected->filename);
+
+    MfClassicData data;
+    if (!load_nfc_file(path, &data)) {
+        printf("  FAIL: Could not load file %s\n", path);
+        return false;
+    }
+
+    BambuSpoolRecord record;
+    TEST_ASSERT(bambu_decode(&data, &record), "bambu_decode should return true");
+    TEST_ASSERT_EQ_INT(4, record.uid_len, "uid_len");
+    TEST_ASSERT(memcmp(record.uid, data.uid, 4) == 0, "uid");
+    TEST_ASSERT_EQ_STR(expected->material_id, record.material_id, "material_id");
+    TEST_ASSERT_EQ_STR(expected->variant_id, record.variant_id, "variant_id");
+    TEST_ASSERT_EQ_STR(expected->filament_type, record.filament_type, "filament_type");
+    TEST_ASSERT_EQ_STR(expected->detailed_type, record.detailed_type, "detailed_type");
+    TEST_ASSERT_EQ_STR(expected->production_date, record.production_date, "production_date");
+    TEST_ASSERT_EQ_INT(expected->color_r, record.color_r, "color_r");
+    TEST_ASSERT_EQ_INT(expected->color_g, record.color_g, "color_g");
+    TEST_ASSERT_EQ_INT(expected->color_b, record.color_b, "color_b");
+    TEST_ASSERT_EQ_INT(expected->color_a, record.color_a, "color_a");
+    TEST_ASSERT_EQ_INT(expected->weight_grams, record.weight_grams, "weight_grams");
+    TEST_ASSERT_EQ_INT((int)(expected->diameter_mm * 100.0f + 0.5f), record.diameter_mm_x100, "diameter_mm_x100");
+    TEST_ASSERT_EQ_INT(expected->drying_temp_c, record.drying_temp_c, "drying_temp_c");
+    TEST_ASSERT_EQ_INT(expected->drying_hours, record.drying_hours, "drying_hours");
+    TEST_ASSERT_EQ_INT(expected->hotend_max_c, record.hotend_max_c, "hotend_max_c");
+    TEST_ASSERT_EQ_INT(expected->hotend_min_c, record.hotend_min_c, "hotend_min_c");
+    TEST_ASSERT_EQ_INT((int)(expected->nozzle_diameter_mm * 100.0f + 0.5f), record.nozzle_diameter_mm_x100, "nozzle_diameter_mm_x100");
+    TEST_ASSERT_EQ_INT((int)(expected->spool_width_mm * 100.0f + 0.5f), record.spool_width_mm_x100, "spool_width_mm_x100");
+    TEST_ASSERT_EQ_INT(expected->filament_length_m, record.filament_length_m, "filament_length_m");
+    TEST_ASSERT(memcmp(record.tray_uid, data.block[BLOCK_TRAY_UID].data, 16) == 0, "tray_uid");
+
+    return true;
+}
+
 // Test rejection cases - tags that should NOT be detected as Bambu
 static bool test_rejection_missing_gf_prefix(void) {
     MfClassicData data;
@@ -557,6 +615,38 @@ static bool test_read_le_float(void) {
     return true;
 }
 
+static bool test_mm_to_x100(void) {
+    TEST_ASSERT_EQ_INT(175, bambu_mm_to_x100(1.75f), "1.75mm");
+    TEST_ASSERT_EQ_INT(20, bambu_mm_to_x100(0.2f), "0.2mm");
+    TEST_ASSERT_EQ_INT(0, bambu_mm_to_x100(-1.0f), "negative");
+    TEST_ASSERT_EQ_INT(0, bambu_mm_to_x100(NAN), "NaN");
+    TEST_ASSERT_EQ_INT(UINT16_MAX, bambu_mm_to_x100(1e9f), "overflow");
+    return true;
+}
+
+static bool test_mm_bits_to_x100(void) {
+    // Matches the float path exactly, including the half-way cases where
+    // mm * 100.0f rounds onto .5 (0.005f -> 1, 0.015f -> 2)
+    static const float samples[] = {1.75f, 2.85f, 0.2f, 0.4f, 32.12f, 0.005f, 0.015f, 0.045f,
+                                    655.34f, 655.35f, 1e-30f, -1.0f, 1e9f, INFINITY, NAN};
+    for (size_t i = 0; i < sizeof(samples) / sizeof(samples[0]); i++) {
+        uint32_t bits;
+        memcpy(&bits, &samples[i], sizeof(bits));
+        TEST_ASSERT_EQ_INT(bambu_mm_to_x100(samples[i]), bambu_mm_bits_to_x100(bits), "sample");
+    }
+    // Strided sweep over all bit patterns (the full sweep also passes)
+    for (uint64_t bits = 0; bits <= UINT32_MAX; bits += 4099) {
+        float mm;
+        uint32_t pattern = (uint32_t)bits;
+        memcpy(&mm, &pattern, sizeof(mm));
+        if (bambu_mm_to_x100(mm) != bambu_mm_bits_to_x100(pattern)) {
+            printf("  FAIL: bits %08X\n", pattern);
+            return false;
+        }
+    }
+    return true;
+}
+
 static bool test_is_printable_ascii(void) {
     uint8_t printable[] = "PLA Basic\x00\x00\x00\x00\x00\x00";
     TEST_ASSERT(bambu_is_printable_ascii(printable, 16) == true, "should accept printable ASCII");
@@ -594,6 +684,102 @@ static bool test_filament_lookup(void) {
     return true;
 }
 
+static bool test_registry_dispatch(const char* test_dir) {
+    char filepath[512];
+    snprintf(filepath, sizeof(filepath), "%s/%s", test_dir, expected_values[0].filename);
+
+    MfClassicData data;
+    TEST_ASSERT(load_nfc_file(filepath, &data), "Failed to load NFC file");
+
+    // Bambu dump dispatches to the Bambu decoder
+    BambuSpoolRecord via_registry;
+    BambuSpoolRecord direct;
+    const SpoolVendor* vendor = spool_registry_decode(&data, &via_registry);
+    TEST_ASSERT(vendor != NULL, "registry should claim Bambu dump");
+    TEST_ASSERT_EQ_STR("Bambu Lab", vendor->name, "vendor name");
+    TEST_ASSERT(bambu_decode(&data, &direct), "direct decode");
+    TEST_ASSERT(memcmp(&via_registry, &direct, sizeof(direct)) == 0, "registry decode matches direct decode");
+
+    // Signature matches but full validation fails: claimed, not decoded
+    MfClassicData broken = data;
+    memcpy(broken.block[BLOCK_FILAMENT_TYPE].data, "UNKNOWN\x00", 8);
+    TEST_ASSERT(spool_registry_match(&broken) == vendor, "signature still matches");
+    TEST_ASSERT(spool_registry_decode(&broken, &via_registry) == NULL, "validation rejects");
+
+    // No signature: no vendor, no decoder runs
+    MfClassicData unknown = data;
+    unknown.block[BLOCK_MATERIAL_IDS].data[9] = 'X';
+    TEST_ASSERT(spool_registry_match(&unknown) == NULL, "unknown signature");
+
+    // Signature bytes on the wrong card type
+    MfClassicData wrong_type = data;
+    wrong_type.type = MfClassicType4k;
+    TEST_ASSERT(spool_registry_match(&wrong_type) == NULL, "wrong card type");
+    return true;
+}
+
+// Helper: Compare bytes against a hex string
+static bool bytes_equal_hex(const uint8_t* bytes, const char* hex) {
+    for (size_t i = 0; hex[i * 2]; i++) {
+        if (parse_hex_byte(&hex[i * 2]) != bytes[i]) return false;
+    }
+    return true;
+}
+
+static bool test_sha256(void) {
+    uint8_t digest[BAMBU_SHA256_DIGEST_LEN];
+    BambuSha256 ctx;
+    bambu_sha256_init(&ctx);
+    bambu_sha256_update(&ctx, "abc", 3);
+    bambu_sha256_final(&ctx, digest);
+    TEST_ASSERT(bytes_equal_hex(digest, "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad"), "SHA-256(abc)");
+
+    // Two-block message (FIPS 180-4 example)
+    const char* msg = "abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq";
+    bambu_sha256_init(&ctx);
+    bambu_sha256_update(&ctx, msg, strlen(msg));
+    bambu_sha256_final(&ctx, digest);
+    TEST_ASSERT(bytes_equal_hex(digest, "248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1"), "SHA-256(448 bits)");
+    return true;
+}
+
+static bool test_hkdf_rfc5869(void) {
+    uint8_t ikm[22];
+    uint8_t salt[13];
+    uint8_t info[10];
+    uint8_t okm[42];
+    memset(ikm, 0x0b, sizeof(ikm));
+    for (size_t i = 0; i < sizeof(salt); i++) salt[i] = (uint8_t)i;
+    for (size_t i = 0; i < sizeof(info); i++) info[i] = (uint8_t)(0xf0 + i);
+
+    // Test Case 1
+    bambu_hkdf_sha256(ikm, sizeof(ikm), salt, sizeof(salt), info, sizeof(info), okm, sizeof(okm));
+    TEST_ASSERT(bytes_equal_hex(okm,
+        "3cb25f25faacd57a90434f64d0362f2a2d2d0a90cf1a5a4c5db02d56ecc4c5bf34007208d5b887185865"),
+        "RFC 5869 test case 1");
+
+    // Test Case 3: empty salt and info
+    bambu_hkdf_sha256(ikm, sizeof(ikm), NULL, 0, NULL, 0, okm, sizeof(okm));
+    TEST_ASSERT(bytes_equal_hex(okm,
+        "8da4e775a563c18f715f802a063c5a31b8a11f5c5ee1879ec3454e5f3c738d2d9d201395faa4b61a96c8"),
+        "RFC 5869 test case 3");
+    return true;
+}
+
+static bool test_derive_keys(void) {
+    // Expected values cross-checked with Python's hmac/hashlib HKDF
+    const uint8_t uid[4] = {0x37, 0xE4, 0x2B, 0x2A};
+    uint8_t keys[BAMBU_KEYS_LEN];
+    bambu_derive_keys(uid, sizeof(uid), BambuKeyTypeA, keys);
+    TEST_ASSERT(bytes_equal_hex(&keys[0], "02FBFE54F26B"), "sector 0 key A");
+    TEST_ASSERT(bytes_equal_hex(&keys[6], "7DC884A538EF"), "sector 1 key A");
+    TEST_ASSERT_EQ_INT(1, bambu_key_to_u64(&keys[0]) == 0x02FBFE54F26BULL, "key as uint64");
+    bambu_derive_keys(uid, sizeof(uid), BambuKeyTypeB, keys);
+    TEST_ASSERT(bytes_equal_hex(&keys[0], "BC55613583ED"), "sector 0 key B");
+    TEST_ASSERT(bytes_equal_hex(&keys[6], "0DBB85AC0BA8"), "sector 1 key B");
+    return true;
+}
+
 // ============================================================================
 // Main test runner
 // ============================================================================
@@ -620,12 +806,16 @@ int main(int argc, char* argv[]) {
     printf("Testing actual production code from:\n");
     printf("  - plugin/bambu_parser.h\n");
     printf("  - plugin/bambu_filaments.h\n");
+    printf("  - plugin/spool_registry.h\n");
+    printf("  - plugin/bambu_keys.h\n");
     printf("========================================\n\n");
 
     // Helper function tests (from production code)
     printf("Helper Functions (from bambu_parser.h):\n");
     run_test("bambu_read_le16", test_read_le16());
     run_test("bambu_read_le_float", test_read_le_float());
+    run_test("bambu_mm_to_x100", test_mm_to_x100());
+    run_test("bambu_mm_bits_to_x100", test_mm_bits_to_x100());
     run_test("bambu_is_printable_ascii", test_is_printable_ascii());
     run_test("bambu_copy_ascii_string", test_copy_ascii_string());
     printf("\n");
@@ -644,6 +834,18 @@ int main(int argc, char* argv[]) {
     run_test("reject_wrong_card_type", test_rejection_wrong_card_type());
     printf("\n");
 
+    // Vendor registry (from spool_registry.h)
+    printf("Vendor Registry (from spool_registry.h):\n");
+    run_test("registry_dispatch", test_registry_dispatch(test_data_dir));
+    printf("\n");
+
+    // Key derivation (from bambu_keys.h)
+    printf("Key Derivation (from bambu_keys.h):\n");
+    run_test("sha256", test_sha256());
+    run_test("hkdf_rfc5869", test_hkdf_rfc5869());
+    run_test("bambu_derive_keys", test_derive_keys());
+    printf("\n");
+
     // File parsing tests (full integration with production code)
     printf("NFC File Parsing Tests:\n");
     printf("  Test data directory: %s\n", test_data_dir);
@@ -651,6 +853,8 @@ int main(int argc, char* argv[]) {
         char test_name[64];
         snprintf(test_name, sizeof(test_name), "parse_%s", expected_values[i].filename);
         run_test(test_name, test_parse_file(test_data_dir, &expected_values[i]));
+        snprintf(test_name, sizeof(test_name), "decode_%s", expected_values[i].filename);
+        run_test(test_name, test_decode_file(test_data_dir, &expected_values[i]));
     }
     printf("\n");
 
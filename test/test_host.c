@@ -0,0 +1,1746 @@
+/**
+ * Bambu Lab Host Tools Tests
+ *
+ * Standalone C test suite for the host-side libraries in host/ and the
+ * portable encoders they share with the plugin. Uses the real NFC dumps
+ * in test/data/.
+ *
+ * Build: gcc -o test_host test_host.c -lm -pthread \
+ *            -Wl,--wrap=malloc,--wrap=calloc,--wrap=realloc
+ * Run: ./test_host
+ */
+
+#define _GNU_SOURCE  // posix_openpt() and friends
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <poll.h>
+
+#include "../host/bambu_host.h"
+#include "../host/bambu_stream.h"
+#include "../host/bambu_dupes.h"
+#include "../host/bambu_columnar.h"
+#include "../host/bambu_query.h"
+#include "../host/bambu_encode.h"
+#include "../host/bambu_keygen.h"
+#include "../host/bambu_sim.h"
+#include "../host/bambu_pair.h"
+#include "../host/bambu_catalog.h"
+#include "../host/bambu_metrics.h"
+#include "../host/bambu_merge.h"
+#include "../host/bambu_cache.h"
+#include "../host/bambu_shard.h"
+#include "../host/bambu_alloc.h"
+#include "../host/bambu_loader.h"
+#include "../plugin/bambu_scan.h"
+
+// ============================================================================
+// Test framework
+// ============================================================================
+
+static int tests_passed = 0;
+static int tests_failed = 0;
+static const char* test_data_dir = "test/data";
+
+#define TEST_ASSERT(cond, msg) do { \
+    if (!(cond)) { \
+        printf("  FAIL: %s\n", msg); \
+        return false; \
+    } \
+} while(0)
+
+#define TEST_ASSERT_EQ_STR(expected, actual, field) do { \
+    if (strcmp(expected, actual) != 0) { \
+        printf("  FAIL: %s - expected '%s', got '%s'\n", field, expected, actual); \
+        return false; \
+    } \
+} while(0)
+
+#define TEST_ASSERT_EQ_INT(expected, actual, field) do { \
+    if ((expected) != (actual)) { \
+        printf("  FAIL: %s - expected %d, got %d\n", field, (int)(expected), (int)(actual)); \
+        return false; \
+    } \
+} while(0)
+
+// Heap calls of this thread, counted by the linker wraps (--wrap=malloc
+// etc.) so allocation tests see every call, not only bambu_mem_*()
+static _Thread_local uint64_t heap_calls = 0;
+
+void* __real_malloc(size_t size);
+void* __real_calloc(size_t count, size_t size);
+void* __real_realloc(void* ptr, size_t size);
+
+void* __wrap_malloc(size_t size) {
+    heap_calls++;
+    return __real_malloc(size);
+}
+
+void* __wrap_calloc(size_t count, size_t size) {
+    heap_calls++;
+    return __real_calloc(count, size);
+}
+
+void* __wrap_realloc(void* ptr, size_t size) {
+    heap_calls++;
+    return __real_realloc(ptr, size);
+}
+
+static const char* const test_files[] = {
+    "Bambu_pink.nfc",
+    "Bambu_red.nfc",
+    "Bambu_wood.nfc",
+    "Bambu_abs.nfc",
+    "Bambu_petg.nfc",
+    "Bambu_translucent_blu.nfc",
+};
+#define NUM_TEST_FILES (sizeof(test_files) / sizeof(test_files[0]))
+
+// Helper: Load and decode test/data/<name>
+static bool load_record(const char* name, MfClassicData* data, BambuSpoolRecord* record) {
+    char path[512];
+    snprintf(path, sizeof(path), "%s/%s", test_data_dir, name);
+    if (!bambu_nfc_load(path, data)) return false;
+    return bambu_decode(data, record);
+}
+
+// ============================================================================
+// Host loader
+// ============================================================================
+
+static bool test_nfc_load(void) {
+    MfClassicData data;
+    BambuSpoolRecord record;
+    TEST_ASSERT(load_record("Bambu_red.nfc", &data, &record), "load and decode Bambu_red.nfc");
+
+    char uid_hex[21];
+    bambu_uid_to_hex(record.uid, record.uid_len, uid_hex);
+    TEST_ASSERT_EQ_STR("FDEE5A3E", uid_hex, "uid");
+    TEST_ASSERT_EQ_INT(0x08, data.iso14443_3a_data.sak, "sak");
+    TEST_ASSERT_EQ_INT(0x04, data.iso14443_3a_data.atqa[1], "atqa");
+    TEST_ASSERT_EQ_STR("A01-R4", record.variant_id, "variant_id");
+    // Trailer "??" bytes stay zero, known access bits are kept
+    TEST_ASSERT_EQ_INT(0x00, data.block[3].data[0], "unknown trailer byte");
+    TEST_ASSERT_EQ_INT(0x87, data.block[3].data[6], "access bits");
+
+    const char* not_classic = "Filetype: Flipper NFC device\nDevice type: NTAG/Ultralight\n";
+    TEST_ASSERT(!bambu_nfc_parse(not_classic, strlen(not_classic), &data), "reject non-Classic dump");
+    return true;
+}
+
+static bool test_date_parse(void) {
+    uint32_t minutes = 0;
+    TEST_ASSERT(bambu_date_parse("2025_07_21_14_17", &minutes), "parse");
+    // 2025-07-21 14:17 UTC = 1753107420 seconds since epoch
+    TEST_ASSERT(minutes == 1753107420u / 60u, "minutes since epoch");
+
+    char out[17];
+    bambu_date_format(minutes, out);
+    TEST_ASSERT_EQ_STR("2025_07_21_14_17", out, "format round-trip");
+    TEST_ASSERT(bambu_date_parse("2024-02-29 23:59", &minutes), "leap day, display separators");
+    bambu_date_format(minutes, out);
+    TEST_ASSERT_EQ_STR("2024_02_29_23_59", out, "leap day round-trip");
+
+    TEST_ASSERT(!bambu_date_parse("2025_13_01_00_00", &minutes), "reject month 13");
+    TEST_ASSERT(!bambu_date_parse("A251006004000000", &minutes), "reject non-date");
+    TEST_ASSERT(!bambu_date_parse("2025_07_21", &minutes), "reject short");
+    return true;
+}
+
+// ============================================================================
+// Framing (plugin/bambu_frame.h)
+// ============================================================================
+
+static bool test_crc16(void) {
+    // CRC-16/CCITT-FALSE check value
+    TEST_ASSERT_EQ_INT(0x29B1, bambu_crc16(BAMBU_CRC16_INIT, (const uint8_t*)"123456789", 9), "check value");
+    return true;
+}
+
+static bool test_record_pack_roundtrip(void) {
+    for (size_t i = 0; i < NUM_TEST_FILES; i++) {
+        MfClassicData data;
+        BambuSpoolRecord record;
+        TEST_ASSERT(load_record(test_files[i], &data, &record), test_files[i]);
+
+        uint8_t payload[BAMBU_FRAME_MAX_PAYLOAD];
+        size_t len = bambu_record_pack(&record, 1760000000u, payload);
+        TEST_ASSERT(len < BAMBU_FRAME_MAX_PAYLOAD, "payload fits in one frame");
+
+        BambuSpoolRecord decoded;
+        uint32_t scan_time = 0;
+        TEST_ASSERT(bambu_record_unpack(payload, len, &decoded, &scan_time), "unpack");
+        TEST_ASSERT(memcmp(&record, &decoded, sizeof(record)) == 0, "record round-trips");
+        TEST_ASSERT(scan_time == 1760000000u, "scan_time round-trips");
+
+        // Version 1 payloads (no tray UID) from older logs still unpack
+        payload[0] = 1;
+        TEST_ASSERT(bambu_record_unpack(payload, len - sizeof(record.tray_uid), &decoded, NULL), "unpack v1");
+        TEST_ASSERT(strcmp(decoded.variant_id, record.variant_id) == 0, "v1 fields");
+        static const uint8_t no_tray[16] = {0};
+        TEST_ASSERT(memcmp(decoded.tray_uid, no_tray, sizeof(no_tray)) == 0, "v1 has no tray UID");
+        TEST_ASSERT(!bambu_record_unpack(payload, len, &decoded, NULL), "v1 length enforced");
+        payload[0] = BAMBU_RECORD_VERSION;
+
+        // Every truncation must be rejected rather than read out of bounds
+        for (size_t cut = 0; cut < len; cut++) {
+            TEST_ASSERT(!bambu_record_unpack(payload, cut, &decoded, NULL), "reject truncated payload");
+        }
+    }
+    return true;
+}
+
+typedef struct {
+    BambuSpoolRecord records[16];
+    uint32_t scan_times[16];
+    size_t count;
+} Collected;
+
+static void collect_record(const BambuSpoolRecord* record, uint32_t scan_time, void* context) {
+    Collected* collected = context;
+    if (collected->count < 16) {
+        memcpy(&collected->records[collected->count], record, sizeof(BambuSpoolRecord));
+        collected->scan_times[collected->count] = scan_time;
+        collected->count++;
+    }
+}
+
+// Builds a byte stream: noise, frame 0, a corrupted copy of frame 1,
+// frame 1, ... so the receiver has to skip garbage and resynchronize
+static size_t build_test_stream(uint8_t* out, BambuSpoolRecord* expected, size_t* expected_count) {
+    size_t pos = 0;
+    const char* noise = "\r\n>: cli prompt noise \xB5\x01";
+    memcpy(out, noise, strlen(noise));
+    pos += strlen(noise);
+
+    *expected_count = 0;
+    for (size_t i = 0; i < NUM_TEST_FILES; i++) {
+        MfClassicData data;
+        BambuSpoolRecord record;
+        if (!load_record(test_files[i], &data, &record)) return 0;
+
+        uint8_t payload[BAMBU_FRAME_MAX_PAYLOAD];
+        size_t len = bambu_record_pack(&record, (uint32_t)i, payload);
+        size_t frame_len = bambu_frame_encode(BambuFrameTypeRecord, payload, (uint8_t)len, &out[pos]);
+        if (i == 1) {
+            // Corrupt this copy, then send it again intact
+            out[pos + 10] ^= 0xFF;
+            pos += frame_len;
+            frame_len = bambu_frame_encode(BambuFrameTypeRecord, payload, (uint8_t)len, &out[pos]);
+        }
+        pos += frame_len;
+        memcpy(&expected[(*expected_count)++], &record, sizeof(BambuSpoolRecord));
+    }
+    return pos;
+}
+
+static bool test_frame_rx_resync(void) {
+    uint8_t stream_bytes[4096];
+    BambuSpoolRecord expected[NUM_TEST_FILES];
+    size_t expected_count = 0;
+    size_t len = build_test_stream(stream_bytes, expected, &expected_count);
+    TEST_ASSERT(len > 0, "build stream");
+
+    Collected collected = {0};
+    BambuStream stream;
+    bambu_stream_init(&stream, collect_record, &collected);
+    // Feed in awkward chunk sizes to exercise reassembly across reads
+    for (size_t pos = 0; pos < len; pos += 7) {
+        size_t chunk = len - pos < 7 ? len - pos : 7;
+        bambu_stream_feed(&stream, &stream_bytes[pos], chunk);
+    }
+
+    TEST_ASSERT_EQ_INT(expected_count, collected.count, "records received");
+    TEST_ASSERT(stream.rx.crc_errors >= 1, "corrupted frame counted");
+    for (size_t i = 0; i < expected_count; i++) {
+        TEST_ASSERT(memcmp(&expected[i], &collected.records[i], sizeof(BambuSpoolRecord)) == 0, "record matches");
+        TEST_ASSERT_EQ_INT(i, collected.scan_times[i], "scan_time");
+    }
+    return true;
+}
+
+// Stand-in for the Flipper's CDC port: write frames into a pseudo-terminal
+// master and receive them through the slave with bambu_stream_open()
+static bool test_stream_pty(void) {
+    int master = posix_openpt(O_RDWR | O_NOCTTY);
+    TEST_ASSERT(master >= 0, "posix_openpt");
+    TEST_ASSERT(grantpt(master) == 0 && unlockpt(master) == 0, "grantpt/unlockpt");
+
+    int slave = bambu_stream_open(ptsname(master));
+    TEST_ASSERT(slave >= 0, "bambu_stream_open");
+
+    uint8_t stream_bytes[4096];
+    BambuSpoolRecord expected[NUM_TEST_FILES];
+    size_t expected_count = 0;
+    size_t len = build_test_stream(stream_bytes, expected, &expected_count);
+    TEST_ASSERT(write(master, stream_bytes, len) == (ssize_t)len, "write to pty master");
+
+    Collected collected = {0};
+    BambuStream stream;
+    bambu_stream_init(&stream, collect_record, &collected);
+    while (collected.count < expected_count) {
+        struct pollfd pfd = {.fd = slave, .events = POLLIN};
+        if (poll(&pfd, 1, 2000) <= 0) break;
+        if (bambu_stream_pump(&stream, slave) <= 0) break;
+    }
+    close(slave);
+    close(master);
+
+    TEST_ASSERT_EQ_INT(expected_count, collected.count, "records received over pty");
+    for (size_t i = 0; i < expected_count; i++) {
+        TEST_ASSERT(memcmp(&expected[i], &collected.records[i], sizeof(BambuSpoolRecord)) == 0, "record matches");
+    }
+    return true;
+}
+
+// ============================================================================
+// Clone and duplicate detection (host/bambu_hash.h, host/bambu_dupes.h)
+// ============================================================================
+
+static bool test_hash_index(void) {
+    BambuHashIndex index;
+    TEST_ASSERT(bambu_hash_index_init(&index, 4), "init");
+    // Push well past the initial capacity to exercise growth
+    for (uint32_t i = 0; i < 10000; i++) {
+        TEST_ASSERT(bambu_hash_index_put(&index, (uint64_t)i * 7919, i) == i, "insert new key");
+    }
+    TEST_ASSERT(bambu_hash_index_put(&index, 7919, 42) == 1, "existing key keeps its value");
+    TEST_ASSERT_EQ_INT(10000, index.count, "count");
+    for (uint32_t i = 0; i < 10000; i++) {
+        TEST_ASSERT(bambu_hash_index_get(&index, (uint64_t)i * 7919) == i, "lookup");
+    }
+    TEST_ASSERT(bambu_hash_index_get(&index, 3) == BAMBU_HASH_INDEX_EMPTY, "missing key");
+    bambu_hash_index_free(&index);
+    return true;
+}
+
+static bool test_dupes_classification(void) {
+    MfClassicData red, pink, copy;
+    BambuSpoolRecord record;
+    TEST_ASSERT(load_record("Bambu_red.nfc", &red, &record), "load red");
+    TEST_ASSERT(load_record("Bambu_pink.nfc", &pink, &record), "load pink");
+
+    BambuDupeIndex index;
+    BambuDupeResult result;
+    TEST_ASSERT(bambu_dupes_init(&index, 0), "init");
+
+    TEST_ASSERT(bambu_dupes_add(&index, &red, &result), "add red");
+    TEST_ASSERT_EQ_INT(BambuDupeNew, result.kind, "red is new");
+    TEST_ASSERT(bambu_dupes_add(&index, &pink, &result), "add pink");
+    TEST_ASSERT_EQ_INT(BambuDupeNew, result.kind, "pink is new");
+
+    // Identical dump, with a different (unknown) sector trailer: duplicate
+    copy = red;
+    memset(copy.block[3].data, 0xFF, 6);
+    TEST_ASSERT(bambu_dupes_add(&index, &copy, &result), "add copy");
+    TEST_ASSERT_EQ_INT(BambuDupeExact, result.kind, "exact duplicate");
+    TEST_ASSERT_EQ_INT(0, result.other, "matches red");
+
+    // Same UID, different weight: conflict
+    copy = red;
+    copy.block[BLOCK_COLOR_WEIGHT].data[4] ^= 0x01;
+    TEST_ASSERT(bambu_dupes_add(&index, &copy, &result), "add conflict");
+    TEST_ASSERT_EQ_INT(BambuDupeUidConflict, result.kind, "uid conflict");
+    TEST_ASSERT_EQ_INT(0, result.other, "conflicts with red");
+
+    // The same conflicting dump again: duplicate of the conflict, not of red
+    TEST_ASSERT(bambu_dupes_add(&index, &copy, &result), "add conflict again");
+    TEST_ASSERT_EQ_INT(BambuDupeExact, result.kind, "repeated conflict is exact");
+    TEST_ASSERT_EQ_INT(3, result.other, "matches the conflict");
+
+    // Same payload written onto another card: clone
+    copy = pink;
+    copy.iso14443_3a_data.uid[0] ^= 0x55;
+    TEST_ASSERT(bambu_dupes_add(&index, &copy, &result), "add clone");
+    TEST_ASSERT_EQ_INT(BambuDupeClone, result.kind, "clone");
+    TEST_ASSERT_EQ_INT(1, result.other, "clone of pink");
+
+    // Clone with a tampered signature is no longer the same payload
+    copy.iso14443_3a_data.uid[0] ^= 0xAA;
+    copy.block[BLOCK_SIGNATURE_LAST].data[0] ^= 0x01;
+    TEST_ASSERT(bambu_dupes_add(&index, &copy, &result), "add tampered");
+    TEST_ASSERT_EQ_INT(BambuDupeNew, result.kind, "signature is fingerprinted");
+
+    bambu_dupes_free(&index);
+    return true;
+}
+
+// ============================================================================
+// Columnar export (host/bambu_columnar.h)
+// ============================================================================
+
+static bool test_columnar_roundtrip(void) {
+    const char* path = "test_columnar.bspc";
+    BambuColumnarWriter writer;
+    TEST_ASSERT(bambu_columnar_writer_init(&writer), "writer init");
+
+    // Every dump three times so dictionaries see repeats
+    BambuSpoolRecord expected[NUM_TEST_FILES];
+    for (size_t rep = 0; rep < 3; rep++) {
+        for (size_t i = 0; i < NUM_TEST_FILES; i++) {
+            MfClassicData data;
+            TEST_ASSERT(load_record(test_files[i], &data, &expected[i]), test_files[i]);
+            TEST_ASSERT(bambu_columnar_writer_add(&writer, &expected[i], (uint32_t)(rep * 100 + i)), "add");
+        }
+    }
+    TEST_ASSERT_EQ_INT(3, writer.dicts[BambuColumnFilamentType].count, "PLA/ABS/PETG dictionary");
+    TEST_ASSERT(bambu_columnar_writer_save(&writer, path), "save");
+    bambu_columnar_writer_free(&writer);
+
+    BambuColumnarReader reader;
+    TEST_ASSERT(bambu_columnar_open(&reader, path), "open");
+    TEST_ASSERT_EQ_INT(3 * NUM_TEST_FILES, reader.rows, "rows");
+    for (uint32_t row = 0; row < reader.rows; row++) {
+        BambuSpoolRecord record;
+        uint32_t scan_time;
+        bambu_columnar_get_record(&reader, row, &record, &scan_time);
+        TEST_ASSERT(memcmp(&expected[row % NUM_TEST_FILES], &record, sizeof(record)) == 0, "record round-trips");
+        TEST_ASSERT_EQ_INT((row / NUM_TEST_FILES) * 100 + row % NUM_TEST_FILES, scan_time, "scan_time");
+    }
+
+    const BambuColumn* color = bambu_columnar_find(&reader, "color_name");
+    const BambuColumn* weight = bambu_columnar_find(&reader, "weight_g");
+    TEST_ASSERT(color && weight, "find columns by name");
+    TEST_ASSERT_EQ_STR("Dark Red", bambu_column_string(color, 1), "color_name dictionary");
+    TEST_ASSERT_EQ_INT(1000, bambu_column_uint(weight, 2), "weight column");
+    TEST_ASSERT(bambu_columnar_find(&reader, "nope") == NULL, "unknown column");
+    bambu_columnar_close(&reader);
+
+    // Corrupt the row count: the reader must reject rather than overrun
+    FILE* f = fopen(path, "r+b");
+    TEST_ASSERT(f != NULL, "reopen");
+    fseek(f, 8, SEEK_SET);
+    fputc(0xFF, f);
+    fclose(f);
+    TEST_ASSERT(!bambu_columnar_open(&reader, path), "reject inconsistent row count");
+    remove(path);
+    return true;
+}
+
+typedef struct {
+    BambuSpoolRecord expected[NUM_TEST_FILES];
+    uint32_t count;
+    uint32_t stop_after;  // 0 = never stop
+    bool matched;
+} RecordFileTest;
+
+static bool on_file_record(const BambuSpoolRecord* record, uint32_t scan_time, void* context) {
+    RecordFileTest* test = context;
+    uint32_t i = test->count++;
+    if (memcmp(record, &test->expected[i % NUM_TEST_FILES], sizeof(*record)) != 0 || scan_time != 1000 + i) {
+        test->matched = false;
+    }
+    return test->count != test->stop_after;
+}
+
+static bool test_record_file_load(void) {
+    // The same records as a columnar file and as a frame log
+    RecordFileTest test = {.matched = true};
+    BambuColumnarWriter writer;
+    FILE* log = fopen("test_records.log", "wb");
+    TEST_ASSERT(log && bambu_columnar_writer_init(&writer), "create files");
+    for (uint32_t i = 0; i < NUM_TEST_FILES; i++) {
+        MfClassicData data;
+        uint8_t payload[BAMBU_FRAME_MAX_PAYLOAD];
+        uint8_t frame[BAMBU_FRAME_MAX_SIZE];
+        TEST_ASSERT(load_record(test_files[i], &data, &test.expected[i]), test_files[i]);
+        TEST_ASSERT(bambu_columnar_writer_add(&writer, &test.expected[i], 1000 + i), "add");
+        size_t len = bambu_record_pack(&test.expected[i], 1000 + i, payload);
+        size_t frame_len = bambu_frame_encode(BambuFrameTypeRecord, payload, (uint8_t)len, frame);
+        TEST_ASSERT(fwrite(frame, 1, frame_len, log) == frame_len, "write frame");
+    }
+    fclose(log);
+    TEST_ASSERT(bambu_columnar_writer_save(&writer, "test_records.bspc"), "save");
+    bambu_columnar_writer_free(&writer);
+
+    const char* paths[] = {"test_records.bspc", "test_records.log"};
+    for (size_t p = 0; p < 2; p++) {
+        test.count = 0;
+        test.stop_after = 0;
+        TEST_ASSERT(bambu_record_file_load(paths[p], on_file_record, &test), paths[p]);
+        TEST_ASSERT_EQ_INT(NUM_TEST_FILES, test.count, "every record");
+        TEST_ASSERT(test.matched, "records and scan times match");
+
+        // The callback stops the load
+        test.count = 0;
+        test.stop_after = 2;
+        TEST_ASSERT(!bambu_record_file_load(paths[p], on_file_record, &test), "stopped load fails");
+        TEST_ASSERT_EQ_INT(2, test.count, "no record after the stop");
+    }
+    TEST_ASSERT(!bambu_record_file_load("test_records_missing.log", on_file_record, &test), "missing file");
+    remove("test_records.bspc");
+    remove("test_records.log");
+    return true;
+}
+
+// ============================================================================
+// Query engine
+// ============================================================================
+
+// Helper: Reference answer by full scan
+static bool query_matches_row(const BambuInventory* inv, const BambuQuery* query, uint32_t row) {
+    const BambuSpoolRecord* record = &inv->records[row];
+    char color[32];
+    bambu_query_color_key(record, color, sizeof(color));
+    const char* keys[BambuQueryFieldCount] = {record->filament_type, record->detailed_type, color};
+    for (size_t f = 0; f < BambuQueryFieldCount; f++) {
+        if (query->value_count[f] == 0) continue;
+        bool any = false;
+        for (size_t v = 0; v < query->value_count[f]; v++) {
+            if (strcmp(keys[f], query->values[f][v]) == 0) any = true;
+        }
+        if (!any) return false;
+    }
+    uint32_t minutes = inv->production_minutes[row];
+    if (query->produced_from || query->produced_to) {
+        if (minutes == 0 || minutes < query->produced_from) return false;
+        if (query->produced_to && minutes > query->produced_to) return false;
+    }
+    if (record->weight_grams < query->min_weight_grams) return false;
+    if (query->max_weight_grams && record->weight_grams > query->max_weight_grams) return false;
+    return true;
+}
+
+// Helper: Compare an indexed query against the full scan
+static bool check_query(BambuInventory* inv, const BambuQuery* query, uint32_t* count) {
+    uint64_t matches[16];
+    BambuQueryAggregate aggregate;
+    if (!bambu_inventory_query(inv, query, matches, &aggregate)) return false;
+    uint32_t expected = 0;
+    for (uint32_t row = 0; row < inv->rows; row++) {
+        bool hit = (matches[row / 64] >> (row % 64)) & 1;
+        if (hit != query_matches_row(inv, query, row)) return false;
+        expected += hit;
+    }
+    *count = aggregate.count;
+    return expected == aggregate.count;
+}
+
+static bool test_query_matches_scan(void) {
+    BambuInventory inv;
+    TEST_ASSERT(bambu_inventory_init(&inv), "init");
+
+    // 600 spools: every dump with varied weights and production months
+    for (uint32_t i = 0; i < 600; i++) {
+        MfClassicData data;
+        BambuSpoolRecord record;
+        TEST_ASSERT(load_record(test_files[i % NUM_TEST_FILES], &data, &record), "load");
+        record.weight_grams = (uint16_t)(250 * (i % 5));
+        snprintf(record.production_date, sizeof(record.production_date),
+                 "%04u_%02u_01_12_00", 2022 + (i / 7) % 3, 1 + (i / 3) % 12);
+        if (i % 50 == 0) strcpy(record.production_date, "unknown");
+        TEST_ASSERT(bambu_inventory_add(&inv, &record, i), "add");
+    }
+    TEST_ASSERT(bambu_inventory_build_indexes(&inv), "build indexes");
+    TEST_ASSERT_EQ_INT(3, inv.dicts[BambuQueryFieldType].count, "type values");
+
+    // "All PETG produced before 2024-01-01 with more than 500 g"
+    BambuQuery query = {0};
+    uint32_t count;
+    bambu_query_add_value(&query, BambuQueryFieldType, "PETG");
+    TEST_ASSERT(bambu_date_parse("2023_12_31_23_59", &query.produced_to), "date");
+    query.min_weight_grams = 501;
+    TEST_ASSERT(check_query(&inv, &query, &count), "PETG/date/weight");
+    TEST_ASSERT(count > 0, "PETG/date/weight non-empty");
+
+    // OR within a field, AND across fields, closed date range
+    BambuQuery mixed = {0};
+    bambu_query_add_value(&mixed, BambuQueryFieldType, "PLA");
+    bambu_query_add_value(&mixed, BambuQueryFieldType, "ABS");
+    bambu_query_add_value(&mixed, BambuQueryFieldColor, "Dark Red");
+    bambu_query_add_value(&mixed, BambuQueryFieldColor, "#FFFFFF");
+    bambu_date_parse("2022_06_01_00_00", &mixed.produced_from);
+    bambu_date_parse("2023_06_30_23_59", &mixed.produced_to);
+    mixed.max_weight_grams = 750;
+    TEST_ASSERT(check_query(&inv, &mixed, &count), "mixed query");
+
+    // Unknown value matches nothing; empty query matches everything
+    BambuQuery none = {0};
+    bambu_query_add_value(&none, BambuQueryFieldDetailedType, "Unobtainium");
+    TEST_ASSERT(check_query(&inv, &none, &count), "unknown value");
+    TEST_ASSERT_EQ_INT(0, count, "unknown value count");
+    BambuQuery all = {0};
+    TEST_ASSERT(check_query(&inv, &all, &count), "empty query");
+    TEST_ASSERT_EQ_INT(600, count, "empty query count");
+
+    // Adding rows invalidates the indexes; the next query rebuilds them
+    MfClassicData data;
+    BambuSpoolRecord record;
+    TEST_ASSERT(load_record("Bambu_petg.nfc", &data, &record), "load");
+    TEST_ASSERT(bambu_inventory_add(&inv, &record, 600), "add after index");
+    TEST_ASSERT(!inv.indexed, "indexes dropped");
+    TEST_ASSERT(check_query(&inv, &all, &count), "rebuild");
+    TEST_ASSERT_EQ_INT(601, count, "rebuilt count");
+
+    // --older-than-months keeps the day, clamped to the length of the month
+    static const char* month_ends[][3] = {
+        {"2026_08_31_10_30", "1", "2026_07_31_10_30"},
+        {"2026_03_31_10_30", "1", "2026_02_28_10_30"},
+        {"2024_03_31_10_30", "1", "2024_02_29_10_30"},
+        {"2026_01_31_00_00", "2", "2025_11_30_00_00"},
+        {"2026_01_15_00_00", "13", "2024_12_15_00_00"},
+    };
+    for (size_t i = 0; i < sizeof(month_ends) / sizeof(month_ends[0]); i++) {
+        uint32_t now, expected;
+        TEST_ASSERT(bambu_date_parse(month_ends[i][0], &now), "month end now");
+        TEST_ASSERT(bambu_date_parse(month_ends[i][2], &expected), "month end cutoff");
+        TEST_ASSERT_EQ_INT(expected, bambu_query_months_before(now, (unsigned)atoi(month_ends[i][1])),
+                           month_ends[i][0]);
+    }
+
+    bambu_inventory_free(&inv);
+    return true;
+}
+
+// ============================================================================
+// Encoder and generator
+// ============================================================================
+
+// Helper: Encode, render in both formats, load back and decode
+static bool encode_roundtrip(const BambuSpoolRecord* record) {
+    MfClassicData encoded;
+    bambu_encode(record, &encoded);
+
+    char* text = NULL;
+    size_t text_len = 0;
+    FILE* f = open_memstream(&text, &text_len);
+    if (!f || !bambu_nfc_write(f, &encoded)) return false;
+    fclose(f);
+
+    uint8_t image[BAMBU_MFD_1K_SIZE];
+    f = fmemopen(image, sizeof(image), "wb");
+    if (!f || !bambu_mfd_write(f, &encoded)) return false;
+    fclose(f);
+
+    MfClassicData from_text;
+    MfClassicData from_image;
+    BambuSpoolRecord decoded;
+    bool ok = bambu_nfc_parse(text, text_len, &from_text) &&
+              bambu_decode(&from_text, &decoded) &&
+              memcmp(record, &decoded, sizeof(decoded)) == 0 &&
+              bambu_mfd_parse(image, sizeof(image), &from_image) &&
+              bambu_decode(&from_image, &decoded) &&
+              memcmp(record, &decoded, sizeof(decoded)) == 0;
+    free(text);
+    return ok;
+}
+
+static bool test_encode_real_dumps(void) {
+    for (size_t i = 0; i < NUM_TEST_FILES; i++) {
+        MfClassicData data;
+        BambuSpoolRecord record;
+        TEST_ASSERT(load_record(test_files[i], &data, &record), test_files[i]);
+        TEST_ASSERT(encode_roundtrip(&record), test_files[i]);
+
+        // Every block the decoder reads is reproduced byte for byte,
+        // except block 8 bytes 0-11 which the record does not carry
+        MfClassicData encoded;
+        bambu_encode(&record, &encoded);
+        static const size_t blocks[] = {0, 1, 2, 4, 5, 6, 9, 10, 12, 14, 16, 40};
+        for (size_t b = 0; b < sizeof(blocks) / sizeof(blocks[0]); b++) {
+            size_t len = blocks[b] == 0 ? 8 : 16;  // Manufacturer data after ATQA varies
+            TEST_ASSERT(memcmp(data.block[blocks[b]].data, encoded.block[blocks[b]].data, len) == 0, "block bytes");
+        }
+    }
+    return true;
+}
+
+static bool test_generator(void) {
+    size_t variants_seen = 0;
+    bool seen[BAMBU_FILAMENT_TABLE_SIZE] = {false};
+    BambuHashIndex uids;
+    TEST_ASSERT(bambu_hash_index_init(&uids, 4096), "index init");
+
+    for (uint64_t index = 0; index < 4000; index++) {
+        BambuSpoolRecord record;
+        BambuSpoolRecord again;
+        bambu_random_record(42, index, &record);
+        bambu_random_record(42, index, &again);
+        TEST_ASSERT(memcmp(&record, &again, sizeof(record)) == 0, "deterministic");
+        TEST_ASSERT(encode_roundtrip(&record), "random record round-trips");
+
+        const BambuFilamentInfo* info = bambu_lookup_filament(record.variant_id);
+        TEST_ASSERT(info != NULL, "variant from catalog");
+        size_t slot = (size_t)(info - bambu_filament_table);
+        if (!seen[slot]) variants_seen++;
+        seen[slot] = true;
+
+        uint32_t uid;
+        memcpy(&uid, record.uid, 4);
+        TEST_ASSERT(bambu_hash_index_put(&uids, uid, (uint32_t)index) == index, "unique UID");
+    }
+    bambu_hash_index_free(&uids);
+    TEST_ASSERT(variants_seen > BAMBU_FILAMENT_TABLE_SIZE / 2, "covers the catalog");
+
+    // Different seeds give different corpora
+    BambuSpoolRecord a;
+    BambuSpoolRecord b;
+    bambu_random_record(1, 7, &a);
+    bambu_random_record(2, 7, &b);
+    TEST_ASSERT(memcmp(&a, &b, sizeof(a)) != 0, "seed changes corpus");
+
+    // Overrides keep derived fields consistent
+    TEST_ASSERT(bambu_record_set_variant(&a, "G02-K0"), "set variant");
+    TEST_ASSERT_EQ_STR("GFG02", a.material_id, "material_id");
+    TEST_ASSERT_EQ_STR("PETG HF", a.detailed_type, "detailed_type");
+    TEST_ASSERT(!bambu_record_set_variant(&a, "Z99-X0"), "unknown prefix");
+    return true;
+}
+
+// ============================================================================
+// Key generator
+// ============================================================================
+
+static bool test_keygen_matches_scalar(void) {
+    // 4, 7 and 10 byte UIDs; 21 is not a multiple of the lane count
+    BambuKeygenUid uids[21];
+    for (size_t i = 0; i < 21; i++) {
+        uids[i].uid_len = (uint8_t)(i % 3 == 0 ? 4 : i % 3 == 1 ? 7 : 10);
+        for (size_t b = 0; b < uids[i].uid_len; b++) uids[i].uid[b] = (uint8_t)(i * 31 + b * 7);
+    }
+
+    BambuKeygenKeys vector_keys[21];
+    BambuKeygenKeys threaded_keys[21];
+    BambuKeygenKeys scalar_keys[21];
+    TEST_ASSERT(bambu_keygen_derive(uids, 21, 1, false, vector_keys), "8-lane");
+    TEST_ASSERT(bambu_keygen_derive(uids, 21, 3, false, threaded_keys), "threaded");
+    TEST_ASSERT(bambu_keygen_derive(uids, 21, 1, true, scalar_keys), "scalar");
+    TEST_ASSERT(memcmp(vector_keys, scalar_keys, sizeof(scalar_keys)) == 0, "8-lane matches scalar");
+    TEST_ASSERT(memcmp(threaded_keys, scalar_keys, sizeof(scalar_keys)) == 0, "threads match scalar");
+    TEST_ASSERT(bambu_keygen_derive(uids, 0, 4, false, vector_keys), "empty list");
+    return true;
+}
+
+// ============================================================================
+// Read simulator (host/bambu_sim.h, plugin/bambu_read.h)
+// ============================================================================
+
+static bool test_sim_strategies(void) {
+    char path[512];
+    snprintf(path, sizeof(path), "%s/Bambu_red.nfc", test_data_dir);
+    MfClassicData data;
+    TEST_ASSERT(bambu_nfc_load(path, &data), "load dump");
+    BambuSpoolRecord expected;
+    TEST_ASSERT(bambu_decode(&data, &expected), "decode dump");
+
+    BambuSimTiming timing = BAMBU_SIM_TIMING_DEFAULT;
+    uint64_t elapsed[3];
+    for (size_t strategy = 0; strategy < 3; strategy++) {
+        BambuSimCard card;
+        bambu_sim_card_init(&card, &data, &timing);
+        BambuSimDictionary dict;
+        BambuReadDictionary source;
+        bambu_sim_dictionary_init(&dict, &source, &card, 10);
+
+        BambuSimScan scan;
+        bambu_sim_scan(&card, (BambuReadStrategy)strategy, &source, &scan);
+        TEST_ASSERT(scan.verified && scan.read && scan.decoded, "scan succeeds");
+        TEST_ASSERT(strcmp(scan.record.material_id, expected.material_id) == 0, "material matches");
+        TEST_ASSERT(scan.record.weight_grams == expected.weight_grams, "weight matches");
+        TEST_ASSERT(scan.read_stats.auth_failures == 0 || strategy == BambuReadStrategyDictionary,
+                    "derived keys open every sector");
+        elapsed[strategy] = scan.elapsed_us;
+    }
+    TEST_ASSERT(elapsed[BambuReadStrategySectorLimited] < elapsed[BambuReadStrategyDerived], "limited < derived");
+    TEST_ASSERT(elapsed[BambuReadStrategyDerived] < elapsed[BambuReadStrategyDictionary], "derived < dictionary");
+
+    // A card that is not a Bambu spool (keys do not match) fails verify
+    MfClassicData other = data;
+    other.iso14443_3a_data.uid[0] ^= 0xFF;
+    BambuSimCard card;
+    bambu_sim_card_init(&card, &other, &timing);
+    memcpy(card.data.iso14443_3a_data.uid, data.iso14443_3a_data.uid, 4);
+    BambuSimScan scan;
+    bambu_sim_scan(&card, BambuReadStrategyDerived, NULL, &scan);
+    TEST_ASSERT(!scan.verified && !scan.decoded, "wrong keys rejected");
+    return true;
+}
+
+static bool test_sim_retries(void) {
+    char path[512];
+    snprintf(path, sizeof(path), "%s/Bambu_petg.nfc", test_data_dir);
+    MfClassicData data;
+    TEST_ASSERT(bambu_nfc_load(path, &data), "load dump");
+
+    BambuSimTiming timing = BAMBU_SIM_TIMING_DEFAULT;
+    timing.select_fail_rate = 0.05;
+    timing.auth_fail_rate = 0.05;
+    timing.read_fail_rate = 0.05;
+
+    // Same seed, same scans
+    BambuSimCard a, b;
+    bambu_sim_card_init(&a, &data, &timing);
+    bambu_sim_card_init(&b, &data, &timing);
+    size_t decoded = 0;
+    size_t retried = 0;
+    for (size_t run = 0; run < 200; run++) {
+        BambuSimScan scan_a, scan_b;
+        bambu_sim_scan(&a, BambuReadStrategyDerived, NULL, &scan_a);
+        bambu_sim_scan(&b, BambuReadStrategyDerived, NULL, &scan_b);
+        TEST_ASSERT(scan_a.elapsed_us == scan_b.elapsed_us, "deterministic");
+        if (scan_a.decoded) decoded++;
+        if (scan_a.read_stats.read_failures + scan_a.read_stats.auth_failures > 0) retried++;
+    }
+    TEST_ASSERT(retried > 0, "failures injected");
+    TEST_ASSERT(decoded >= 190, "retries recover transient failures");
+    return true;
+}
+
+// ============================================================================
+// Continuous scan (plugin/bambu_scan.h)
+// ============================================================================
+
+// A reader field: select fails while no card is present
+typedef struct {
+    BambuSimCard* card;
+} ScanField;
+
+static bool scan_field_select(void* context, uint8_t* uid, uint8_t* uid_len) {
+    ScanField* field = context;
+    return field->card && bambu_sim_select(field->card, uid, uid_len);
+}
+
+static bool scan_field_auth(void* context, uint8_t block, const uint8_t key[BAMBU_KEY_LEN], BambuKeyType type) {
+    ScanField* field = context;
+    return field->card && bambu_sim_auth(field->card, block, key, type);
+}
+
+static bool scan_field_read_block(void* context, uint8_t block, uint8_t data[16]) {
+    ScanField* field = context;
+    return field->card && bambu_sim_read_block(field->card, block, data);
+}
+
+static bool test_scan_state_machine(void) {
+    MfClassicData red_data, petg_data;
+    BambuSpoolRecord red, petg;
+    TEST_ASSERT(load_record("Bambu_red.nfc", &red_data, &red), "load red");
+    TEST_ASSERT(load_record("Bambu_petg.nfc", &petg_data, &petg), "load petg");
+    BambuSimTiming timing = BAMBU_SIM_TIMING_DEFAULT;
+    BambuSimCard red_card, petg_card;
+    bambu_sim_card_init(&red_card, &red_data, &timing);
+    bambu_sim_card_init(&petg_card, &petg_data, &timing);
+
+    ScanField field = {NULL};
+    BambuReadOps ops = {&field, scan_field_select, scan_field_auth, scan_field_read_block};
+    BambuScanner scanner;
+    bambu_scan_init(&scanner);
+    MfClassicData scratch;
+    memset(&scratch, 0, sizeof(scratch));
+    BambuSpoolRecord record;
+
+    TEST_ASSERT_EQ_INT(BambuScanEventNone, bambu_scan_poll(&scanner, &ops, &scratch, &record), "empty field");
+
+    // A new spool is read from sectors 0-1 only and reported once
+    field.card = &red_card;
+    TEST_ASSERT_EQ_INT(BambuScanEventSpool, bambu_scan_poll(&scanner, &ops, &scratch, &record), "new spool");
+    TEST_ASSERT_EQ_INT(BAMBU_SCAN_SECTORS, scanner.stats.sectors_read, "sectors read");
+    TEST_ASSERT(record.uid_len == red.uid_len && memcmp(record.uid, red.uid, red.uid_len) == 0, "uid");
+    TEST_ASSERT_EQ_STR(red.detailed_type, record.detailed_type, "type");
+    TEST_ASSERT_EQ_STR(red.variant_id, record.variant_id, "variant");
+    TEST_ASSERT_EQ_INT(red.weight_grams, record.weight_grams, "weight");
+    TEST_ASSERT(record.color_r == red.color_r && record.color_g == red.color_g && record.color_b == red.color_b,
+                "color");
+    TEST_ASSERT_EQ_INT(0, record.filament_length_m, "later sectors not read");
+    char type_line[BAMBU_SCAN_LINE_LEN];
+    char color_line[BAMBU_SCAN_LINE_LEN];
+    bambu_scan_summary(&record, type_line, color_line);
+    TEST_ASSERT_EQ_STR("PLA Matte 1000g", type_line, "summary type");
+    TEST_ASSERT_EQ_STR("Dark Red", color_line, "summary color");
+    for (size_t i = 0; i < sizeof(bambu_filament_table) / sizeof(bambu_filament_table[0]); i++) {
+        TEST_ASSERT(strlen(bambu_filament_table[i].color_name) < BAMBU_SCAN_LINE_LEN, "color name fits a line");
+    }
+
+    // Held: not read again, also across a short dropout
+    uint32_t reads = scanner.stats.reads;
+    for (int i = 0; i < 5; i++) {
+        TEST_ASSERT_EQ_INT(BambuScanEventHeld, bambu_scan_poll(&scanner, &ops, &scratch, &record), "held");
+    }
+    field.card = NULL;
+    for (int i = 0; i < BAMBU_SCAN_ABSENT_POLLS - 1; i++) {
+        TEST_ASSERT_EQ_INT(BambuScanEventHeld, bambu_scan_poll(&scanner, &ops, &scratch, &record), "dropout");
+    }
+    field.card = &red_card;
+    TEST_ASSERT_EQ_INT(BambuScanEventHeld, bambu_scan_poll(&scanner, &ops, &scratch, &record), "back in field");
+    TEST_ASSERT_EQ_INT(reads, scanner.stats.reads, "no reads while held");
+
+    // Leaving the field re-arms the same UID
+    field.card = NULL;
+    for (int i = 0; i < BAMBU_SCAN_ABSENT_POLLS - 1; i++) bambu_scan_poll(&scanner, &ops, &scratch, &record);
+    TEST_ASSERT_EQ_INT(BambuScanEventLeft, bambu_scan_poll(&scanner, &ops, &scratch, &record), "left");
+    TEST_ASSERT_EQ_INT(BambuScanEventNone, bambu_scan_poll(&scanner, &ops, &scratch, &record), "empty again");
+    field.card = &red_card;
+    TEST_ASSERT_EQ_INT(BambuScanEventSpool, bambu_scan_poll(&scanner, &ops, &scratch, &record), "rescanned");
+
+    // A spool swapped in between two polls is new
+    field.card = &petg_card;
+    TEST_ASSERT_EQ_INT(BambuScanEventSpool, bambu_scan_poll(&scanner, &ops, &scratch, &record), "swapped");
+    TEST_ASSERT_EQ_STR(petg.detailed_type, record.detailed_type, "petg type");
+    TEST_ASSERT_EQ_INT(3, (int)scanner.spools, "spools");
+    // Log line: one value per header column
+    char line[160];
+    // Log line: one value per header column
+    size_t len = bambu_scan_log_line(&record, 1700000000, line, sizeof(line));
+    TEST_ASSERT(len == strlen(line) && line[len - 1] == '\n', "newline terminated");
+    int tabs = 0, header_tabs = 0;
+    for (const char* c = line; *c; c++) tabs += *c == '\t';
+    for (const char* c = BAMBU_SCAN_LOG_HEADER; *c; c++) header_tabs += *c == '\t';
+    TEST_ASSERT_EQ_INT(header_tabs, tabs, "columns");
+    TEST_ASSERT(strncmp(line, "1700000000\t", 11) == 0, "timestamp first");
+
+    // A readable tag that is not a spool is reported once
+    MfClassicData other_data = red_data;
+    other_data.iso14443_3a_data.uid[0] ^= 0x55;
+    other_data.block[BLOCK_MATERIAL_IDS].data[8] = 'X';
+    BambuSimCard other_card;
+    bambu_sim_card_init(&other_card, &other_data, &timing);
+    field.card = &other_card;
+    TEST_ASSERT_EQ_INT(BambuScanEventNotSpool, bambu_scan_poll(&scanner, &ops, &scratch, &record), "not a spool");
+    TEST_ASSERT_EQ_INT(BambuScanEventHeld, bambu_scan_poll(&scanner, &ops, &scratch, &record), "not re-read");
+
+    // A tag the derived keys do not open is retried, then reported
+    memset(other_card.keys, 0, sizeof(other_card.keys));
+    other_card.data.iso14443_3a_data.uid[0] ^= 0x0F;
+    for (int i = 0; i < BAMBU_SCAN_READ_ATTEMPTS - 1; i++) {
+        TEST_ASSERT_EQ_INT(BambuScanEventNone, bambu_scan_poll(&scanner, &ops, &scratch, &record), "retry");
+    }
+    TEST_ASSERT_EQ_INT(BambuScanEventFailed, bambu_scan_poll(&scanner, &ops, &scratch, &record), "unreadable");
+    TEST_ASSERT_EQ_INT(BambuScanEventHeld, bambu_scan_poll(&scanner, &ops, &scratch, &record), "given up");
+    TEST_ASSERT_EQ_INT(3, (int)scanner.spools, "spools unchanged");
+    return true;
+}
+
+// ============================================================================
+// Spool pairing (host/bambu_pair.h)
+// ============================================================================
+
+static bool test_pair_join(void) {
+    BambuPairIndex index;
+    TEST_ASSERT(bambu_pair_init(&index, 16), "init");
+
+    // 40 tags of 20 spools, second tags in reverse order
+    BambuSpoolRecord record;
+    for (uint64_t tag = 0; tag < 40; tag += 2) {
+        bambu_random_pair_record(5, tag, &record);
+        TEST_ASSERT(bambu_pair_add(&index, &record, (uint32_t)tag), "add first tag");
+    }
+    for (uint64_t tag = 39; tag < 40; tag -= 2) {
+        bambu_random_pair_record(5, tag, &record);
+        if (tag == 7) record.weight_grams -= 1;  // One rewritten tag
+        TEST_ASSERT(bambu_pair_add(&index, &record, 100), "add second tag");
+    }
+    TEST_ASSERT_EQ_INT(20, (int)index.count, "one spool per tray UID");
+
+    // Rescan of a known tag, a clone under a third UID, a tag without tray UID
+    bambu_random_pair_record(5, 1, &record);
+    TEST_ASSERT(bambu_pair_add(&index, &record, 200), "rescan");
+    record.uid[0] ^= 0xFF;
+    TEST_ASSERT(bambu_pair_add(&index, &record, 0), "clone");
+    TEST_ASSERT(bambu_pair_add(&index, &record, 0), "clone rescan");
+    TEST_ASSERT_EQ_INT(3, index.spools[0].tags, "rescanned clone is not a new tag");
+    memset(record.tray_uid, 0, sizeof(record.tray_uid));
+    TEST_ASSERT(bambu_pair_add(&index, &record, 0), "no tray");
+    TEST_ASSERT_EQ_INT(21, (int)index.count, "tag without tray UID stands alone");
+    TEST_ASSERT_EQ_INT(2, (int)index.rescans, "rescans counted");
+
+    size_t counts[BambuPairStatusCount] = {0};
+    for (size_t i = 0; i < index.count; i++) counts[index.spools[i].status]++;
+    TEST_ASSERT_EQ_INT(18, (int)counts[BambuPairPaired], "paired");
+    TEST_ASSERT_EQ_INT(1, (int)counts[BambuPairMismatch], "mismatch");
+    TEST_ASSERT_EQ_INT(1, (int)counts[BambuPairExtra], "extra");
+    TEST_ASSERT_EQ_INT(1, (int)counts[BambuPairNoTray], "no tray");
+    TEST_ASSERT(index.spools[3].status == BambuPairMismatch, "rewritten tag flagged");
+    TEST_ASSERT(index.spools[0].status == BambuPairExtra && index.spools[0].scan_time == 200, "latest scan kept");
+
+    bambu_pair_free(&index);
+    return true;
+}
+
+// ============================================================================
+// Reloadable catalog (host/bambu_catalog.h)
+// ============================================================================
+
+typedef struct {
+    BambuCatalog* catalog;
+    atomic_bool* stop;
+    size_t lookups;
+    bool ok;
+} CatalogReaderJob;
+
+// Looks up the same variant until stopped; every answer must come from
+// the snapshot entered and versions must never go backwards
+static void* catalog_reader(void* context) {
+    CatalogReaderJob* job = context;
+    int reader = bambu_catalog_reader_register(job->catalog);
+    job->ok = reader >= 0;
+    uint64_t last_version = 0;
+    while (job->ok && !atomic_load(job->stop)) {
+        const BambuCatalogSnapshot* snapshot = bambu_catalog_enter(job->catalog, reader);
+        const BambuFilamentInfo* info = bambu_catalog_snapshot_lookup(snapshot, "A00-R3");
+        const char* expected = snapshot->text ? "Reloaded Pink" : "Hot Pink";
+        job->ok = info && strcmp(info->color_name, expected) == 0 && snapshot->version >= last_version;
+        last_version = snapshot->version;
+        bambu_catalog_exit(job->catalog, reader);
+        job->lookups++;
+    }
+    if (reader >= 0) bambu_catalog_reader_unregister(job->catalog, reader);
+    return NULL;
+}
+
+static bool test_catalog_reload(void) {
+    const char* path = "test_catalog.csv";
+    FILE* file = fopen(path, "w");
+    TEST_ASSERT(file, "create catalog");
+    fputs("# variant,code,color\r\nA00-R3,10204,Reloaded Pink\r\n\nZ99-X1,99999,Red, Green\n", file);
+    fclose(file);
+
+    size_t bad_line;
+    BambuCatalogSnapshot* loaded = bambu_catalog_snapshot_load(path, &bad_line);
+    TEST_ASSERT(loaded && loaded->count == 2, "load catalog file");
+    const BambuFilamentInfo* info = bambu_catalog_snapshot_lookup(loaded, "Z99-X1");
+    TEST_ASSERT(info && strcmp(info->color_name, "Red, Green") == 0, "color name keeps commas");
+    TEST_ASSERT(!bambu_catalog_snapshot_lookup(loaded, "A00-K0"), "unknown variant");
+    bambu_catalog_snapshot_free(loaded);
+
+    file = fopen(path, "w");
+    fputs("A00-R3,10204,Pink\nA00-K0,10101\n", file);
+    fclose(file);
+    TEST_ASSERT(!bambu_catalog_snapshot_load(path, &bad_line) && bad_line == 2, "malformed line");
+    file = fopen(path, "w");
+    fputs("A00-R3,10204,Pink\nA00-R3,10204,Pink\n", file);
+    fclose(file);
+    TEST_ASSERT(!bambu_catalog_snapshot_load(path, &bad_line) && bad_line == 2, "duplicate variant");
+
+    file = fopen(path, "w");
+    fputs("A00-R3,10204,Reloaded Pink\n", file);
+    fclose(file);
+
+    // Readers keep looking up while the catalog is swapped back and forth
+    BambuCatalog catalog;
+    BambuCatalogSnapshot* builtin = bambu_catalog_snapshot_builtin();
+    TEST_ASSERT(builtin && builtin->count == BAMBU_FILAMENT_TABLE_SIZE, "built-in snapshot");
+    TEST_ASSERT(bambu_catalog_init(&catalog, builtin), "init");
+
+    enum { Readers = 4, Swaps = 200 };
+    atomic_bool stop;
+    atomic_init(&stop, false);
+    CatalogReaderJob jobs[Readers];
+    pthread_t threads[Readers];
+    for (size_t i = 0; i < Readers; i++) {
+        jobs[i] = (CatalogReaderJob){&catalog, &stop, 0, false};
+        TEST_ASSERT(pthread_create(&threads[i], NULL, catalog_reader, &jobs[i]) == 0, "start reader");
+    }
+    bool swapped = true;
+    for (size_t swap = 0; swap < Swaps; swap++) {
+        if (swap % 2 == 0) {
+            swapped &= bambu_catalog_reload(&catalog, path, &bad_line);
+        } else {
+            BambuCatalogSnapshot* snapshot = bambu_catalog_snapshot_builtin();
+            if (snapshot) bambu_catalog_publish(&catalog, snapshot);
+            swapped &= snapshot != NULL;
+        }
+        sched_yield();
+    }
+    atomic_store(&stop, true);
+    bool readers_ok = true;
+    size_t lookups = 0;
+    for (size_t i = 0; i < Readers; i++) {
+        pthread_join(threads[i], NULL);
+        readers_ok &= jobs[i].ok;
+        lookups += jobs[i].lookups;
+    }
+    remove(path);
+    TEST_ASSERT(swapped, "swaps published");
+    TEST_ASSERT(readers_ok, "readers always see a complete snapshot");
+    TEST_ASSERT(lookups > 0, "readers ran during swaps");
+
+    bambu_catalog_synchronize(&catalog);
+    TEST_ASSERT_EQ_INT(Swaps, (int)catalog.reclaimed, "every replaced snapshot freed");
+    TEST_ASSERT_EQ_INT(Swaps + 1, (int)atomic_load(&catalog.current)->version, "current version");
+    bambu_catalog_free(&catalog);
+    return true;
+}
+
+// ============================================================================
+// Ingest metrics (host/bambu_metrics.h)
+// ============================================================================
+
+typedef struct {
+    BambuMetrics* metrics;
+    bool ok;
+} MetricsJob;
+
+// Records latencies 1..10000 us and one catalog hit or miss per value
+static void* metrics_writer(void* context) {
+    MetricsJob* job = context;
+    BambuMetricsShard* shard = bambu_metrics_shard(job->metrics);
+    job->ok = shard != NULL;
+    for (uint64_t us = 1; job->ok && us <= 10000; us++) {
+        bambu_metrics_count(shard, BambuCounterInputs);
+        bambu_metrics_count(shard, us % 10 ? BambuCounterCatalogHits : BambuCounterCatalogMisses);
+        bambu_metrics_observe(shard, BambuStageDecode, us * 1000);
+    }
+    return NULL;
+}
+
+static bool test_metrics(void) {
+    // Every value lands in the bucket whose bounds enclose it, within 12.5%
+    uint64_t state = 7;
+    for (int i = 0; i < 100000; i++) {
+        uint64_t value = bambu_rng_next(&state) >> (bambu_rng_next(&state) % 64);
+        if (value >> (BAMBU_METRICS_MAX_EXP + 1)) continue;
+        size_t bucket = bambu_histogram_bucket(value);
+        uint64_t max = bambu_histogram_bucket_max(bucket);
+        TEST_ASSERT(value <= max, "value within its bucket");
+        TEST_ASSERT(bucket == 0 || bambu_histogram_bucket_max(bucket - 1) < value, "previous bucket below value");
+        TEST_ASSERT(max - value <= value / 8, "bucket precision");
+    }
+    TEST_ASSERT_EQ_INT(BAMBU_METRICS_BUCKETS - 1, (int)bambu_histogram_bucket(UINT64_MAX), "overflow bucket");
+    for (unsigned exp = 0; exp <= BAMBU_METRICS_MAX_EXP; exp++) {
+        // Powers of two (the exported "le" bounds) end their bucket
+        TEST_ASSERT(bambu_histogram_bucket_max(bambu_histogram_bucket(1ULL << exp)) == 1ULL << exp, "bucket ends on bound");
+    }
+
+    BambuMetrics metrics;
+    TEST_ASSERT(bambu_metrics_init(&metrics, "test"), "init");
+    enum { Writers = 4 };
+    MetricsJob jobs[Writers];
+    pthread_t threads[Writers];
+    for (size_t i = 0; i < Writers; i++) {
+        jobs[i] = (MetricsJob){&metrics, false};
+        TEST_ASSERT(pthread_create(&threads[i], NULL, metrics_writer, &jobs[i]) == 0, "start writer");
+    }
+    bool ok = true;
+    for (size_t i = 0; i < Writers; i++) {
+        pthread_join(threads[i], NULL);
+        ok &= jobs[i].ok;
+    }
+    TEST_ASSERT(ok, "one shard per thread");
+    BambuMetricsShard* shard = bambu_metrics_shard(&metrics);
+    TEST_ASSERT(shard, "main thread shard");
+    bambu_metrics_observe(shard, BambuStageValidate, 128);
+
+    BambuMetricsTotals totals;
+    bambu_metrics_collect(&metrics, &totals);
+    TEST_ASSERT_EQ_INT(40000, (int)totals.counters[BambuCounterInputs], "inputs summed over shards");
+    TEST_ASSERT_EQ_INT(4000, (int)totals.counters[BambuCounterCatalogMisses], "catalog misses");
+    uint64_t p50 = bambu_metrics_quantile(&totals, BambuStageDecode, 0.5);
+    uint64_t p99 = bambu_metrics_quantile(&totals, BambuStageDecode, 0.99);
+    TEST_ASSERT(p50 >= 5000000 && p50 <= 5000000 + 5000000 / 8, "p50");
+    TEST_ASSERT(p99 >= 9900000 && p99 <= 9900000 + 9900000 / 8, "p99");
+
+    char* text = NULL;
+    size_t len = 0;
+    FILE* out = open_memstream(&text, &len);
+    TEST_ASSERT(out, "memstream");
+    bambu_metrics_write(&metrics, out);
+    fclose(out);
+    bool exported = strstr(text, "bambu_inputs_total{tool=\"test\"} 40000\n") &&
+                    strstr(text, "bambu_stage_seconds_bucket{tool=\"test\",stage=\"decode\",le=\"+Inf\"} 40000\n") &&
+                    strstr(text, "bambu_stage_seconds_sum{tool=\"test\",stage=\"decode\"} 200.020000000\n") &&
+                    strstr(text, "bambu_stage_seconds_count{tool=\"test\",stage=\"lookup\"} 0\n") &&
+                    // le is inclusive: 128 ns counts in the 128 ns bucket
+                    strstr(text, "bambu_stage_seconds_bucket{tool=\"test\",stage=\"validate\",le=\"1.28e-07\"} 1\n") &&
+                    !strstr(text, "stage=\"other\"");
+    free(text);
+    bambu_metrics_free(&metrics);
+    TEST_ASSERT(exported, "Prometheus text");
+    return true;
+}
+
+// ============================================================================
+// External merge (host/bambu_merge.h)
+// ============================================================================
+
+typedef struct {
+    BambuMergeKey key;
+    const uint32_t* latest;  // Expected scan time per tag index
+    uint8_t last_key[BAMBU_MERGE_KEY_LEN];
+    size_t count;
+    bool ok;
+} MergeCheck;
+
+static bool check_merged(const uint8_t* payload, size_t len, void* context) {
+    MergeCheck* check = context;
+    BambuSpoolRecord record;
+    uint32_t scan_time;
+    uint8_t key[BAMBU_MERGE_KEY_LEN];
+    check->ok = check->ok && bambu_record_unpack(payload, len, &record, &scan_time);
+    bambu_merge_make_key(check->key, &record, key);
+    if (check->count > 0 && memcmp(check->last_key, key, sizeof(key)) >= 0) check->ok = false;
+    memcpy(check->last_key, key, sizeof(key));
+    // Scan times encode the tag index in their low bits
+    if (check->latest[scan_time % 2000] != scan_time) check->ok = false;
+    check->count++;
+    return true;
+}
+
+static bool test_merge_external(void) {
+    // 40000 scans of 2000 tags (1000 spools) with the smallest budget and a
+    // fan-in of 4: tiers of 2 runs are merged while runs are written
+    uint32_t latest[2000] = {0};
+    BambuMergeSorter sorter;
+    BambuMergeKey keys[] = {BambuMergeByUid, BambuMergeByTray};
+    for (size_t k = 0; k < 2; k++) {
+        TEST_ASSERT(bambu_merge_init(&sorter, keys[k], BAMBU_MERGE_MIN_MEMORY, "."), "init");
+        sorter.fan_in = 4;
+        uint64_t state = 11;
+        for (uint32_t i = 0; i < 40000; i++) {
+            uint32_t tag = (uint32_t)bambu_rng_below(&state, 2000);
+            uint32_t scan_time = (uint32_t)bambu_rng_below(&state, 1000000) * 2000 + tag;
+            BambuSpoolRecord record;
+            bambu_random_pair_record(3, tag, &record);
+            TEST_ASSERT(bambu_merge_add(&sorter, &record, scan_time), "add");
+            // Per spool, the latest scan of either tag wins
+            uint32_t owner = keys[k] == BambuMergeByTray ? tag & ~1u : tag;
+            if (scan_time > latest[owner]) latest[owner] = scan_time;
+            if (keys[k] == BambuMergeByTray) latest[owner | 1] = latest[owner];
+        }
+        MergeCheck check = {keys[k], latest, {0}, 0, true};
+        TEST_ASSERT(bambu_merge_finish(&sorter, check_merged, &check), "merge");
+        TEST_ASSERT(check.ok, "sorted, latest scan per key");
+        size_t expected = keys[k] == BambuMergeByTray ? 1000 : 2000;
+        TEST_ASSERT_EQ_INT((int)expected, (int)check.count, "one record per key");
+        TEST_ASSERT_EQ_INT(40000 - (int)expected, (int)sorter.duplicates, "older scans dropped");
+        TEST_ASSERT(sorter.runs_written > 2 * sorter.fan_in, "multi-pass merge");
+        TEST_ASSERT(sorter.runs_peak <= sorter.fan_in, "open runs bounded by the fan-in");
+        bambu_merge_free(&sorter);
+        memset(latest, 0, sizeof(latest));
+    }
+    return true;
+}
+
+// ============================================================================
+// Decode cache (host/bambu_cache.h)
+// ============================================================================
+
+// Helper: Copy test/data/<name> to path
+static bool copy_test_file(const char* name, const char* path) {
+    char src[512];
+    char buf[BAMBU_DUMP_MAX_SIZE];
+    size_t len;
+    snprintf(src, sizeof(src), "%s/%s", test_data_dir, name);
+    FILE* out = fopen(path, "wb");
+    bool ok = out && bambu_dump_read(src, buf, &len) && fwrite(buf, 1, len, out) == len;
+    if (out) fclose(out);
+    return ok;
+}
+
+// Helper: Decode every test dump through the cache, checking the results
+static bool cache_decode_all(BambuCache* cache, const char* prefix) {
+    for (size_t i = 0; i < NUM_TEST_FILES; i++) {
+        char path[512];
+        snprintf(path, sizeof(path), "%s%s", prefix, test_files[i]);
+        BambuSpoolRecord cached, expected;
+        const BambuFilamentInfo* info = NULL;
+        MfClassicData data;
+        if (bambu_cache_decode_file(cache, path, &cached, &info) != BambuCacheDecoded) return false;
+        if (!load_record(test_files[i], &data, &expected)) return false;
+        if (memcmp(&cached, &expected, sizeof(cached)) != 0) return false;
+        if (info != bambu_lookup_filament(expected.variant_id)) return false;
+    }
+    return true;
+}
+
+static bool test_cache_incremental(void) {
+    const char* cache_path = "test_cache.bin";
+    for (size_t i = 0; i < NUM_TEST_FILES; i++) {
+        char path[512];
+        snprintf(path, sizeof(path), "test_cache_%s", test_files[i]);
+        TEST_ASSERT(copy_test_file(test_files[i], path), "copy dump");
+    }
+    FILE* junk = fopen("test_cache_junk.nfc", "w");
+    TEST_ASSERT(junk, "create junk");
+    fputs("Filetype: not a card\n", junk);
+    fclose(junk);
+    remove(cache_path);
+
+    // First run decodes everything, including the non-dump
+    BambuCache cache;
+    BambuSpoolRecord record;
+    const BambuFilamentInfo* info;
+    TEST_ASSERT(bambu_cache_open(&cache, cache_path), "open empty");
+    TEST_ASSERT(cache_decode_all(&cache, "test_cache_"), "first run matches bambu_decode");
+    TEST_ASSERT(bambu_cache_decode_file(&cache, "test_cache_junk.nfc", &record, &info) == BambuCacheNotDump, "junk");
+    TEST_ASSERT_EQ_INT(NUM_TEST_FILES + 1, (int)cache.misses, "all decoded");
+    TEST_ASSERT(bambu_cache_save(&cache, cache_path), "save");
+    bambu_cache_free(&cache);
+
+    // Second run: nothing is read again; a copy under a new name is only read
+    TEST_ASSERT(copy_test_file(test_files[0], "test_cache_copy.nfc"), "copy");
+    TEST_ASSERT(bambu_cache_open(&cache, cache_path), "reopen");
+    TEST_ASSERT(cache_decode_all(&cache, "test_cache_"), "cached results match");
+    TEST_ASSERT(bambu_cache_decode_file(&cache, "test_cache_junk.nfc", &record, &info) == BambuCacheNotDump, "junk cached");
+    TEST_ASSERT(bambu_cache_decode_file(&cache, "test_cache_copy.nfc", &record, &info) == BambuCacheDecoded, "copy");
+    TEST_ASSERT_EQ_INT(NUM_TEST_FILES + 1, (int)cache.stat_hits, "unchanged files not read");
+    TEST_ASSERT_EQ_INT(1, (int)cache.content_hits, "copy found by content");
+    TEST_ASSERT_EQ_INT(0, (int)cache.misses, "nothing decoded");
+    TEST_ASSERT(bambu_cache_save(&cache, cache_path), "save again");
+    bambu_cache_free(&cache);
+
+    // A cache from another catalog keeps decodes, re-resolves names
+    uint32_t header[4];
+    uint64_t catalog_hash = bambu_cache_catalog_hash() + 1;
+    FILE* f = fopen(cache_path, "r+b");
+    TEST_ASSERT(f, "open cache file");
+    TEST_ASSERT(fseek(f, 8, SEEK_SET) == 0 && fread(header, sizeof(header), 1, f) == 1, "read header");
+    fseek(f, 8 + sizeof(header), SEEK_SET);
+    fwrite(&catalog_hash, sizeof(catalog_hash), 1, f);
+    fclose(f);
+    TEST_ASSERT(bambu_cache_open(&cache, cache_path), "open stale");
+    TEST_ASSERT_EQ_INT(NUM_TEST_FILES, (int)cache.reresolved, "catalog indexes re-resolved");
+    TEST_ASSERT(cache_decode_all(&cache, "test_cache_"), "re-resolved results match");
+    TEST_ASSERT_EQ_INT(0, (int)cache.misses, "no re-decode");
+    TEST_ASSERT(bambu_cache_save(&cache, cache_path), "save current catalog");
+    bambu_cache_free(&cache);
+
+    // A catalog index that does not name the variant is not trusted
+    long first_content = (long)(8 + sizeof(header) + sizeof(catalog_hash) + header[2] * sizeof(BambuCachePath));
+    uint16_t bad_info = (uint16_t)BAMBU_FILAMENT_TABLE_SIZE;
+    f = fopen(cache_path, "r+b");
+    TEST_ASSERT(f, "open cache file");
+    fseek(f, first_content + (long)offsetof(BambuCacheContent, info), SEEK_SET);
+    fwrite(&bad_info, sizeof(bad_info), 1, f);
+    fclose(f);
+    TEST_ASSERT(bambu_cache_open(&cache, cache_path), "open bad index");
+    TEST_ASSERT_EQ_INT(1, (int)cache.reresolved, "bad index re-resolved");
+    TEST_ASSERT(cache_decode_all(&cache, "test_cache_"), "results match after a bad index");
+    TEST_ASSERT_EQ_INT(0, (int)cache.misses, "no re-decode for a bad index");
+    bambu_cache_free(&cache);
+
+    // Results of another decoder version are dropped
+    uint32_t old_decoder = BAMBU_CACHE_DECODER - 1;
+    f = fopen(cache_path, "r+b");
+    TEST_ASSERT(f, "open cache file");
+    fseek(f, 8 + sizeof(uint32_t), SEEK_SET);
+    fwrite(&old_decoder, sizeof(old_decoder), 1, f);
+    fclose(f);
+    TEST_ASSERT(bambu_cache_open(&cache, cache_path), "open old decoder");
+    TEST_ASSERT(cache_decode_all(&cache, "test_cache_"), "re-decoded results match");
+    TEST_ASSERT_EQ_INT(NUM_TEST_FILES, (int)cache.misses, "everything decoded again");
+    bambu_cache_free(&cache);
+
+    for (size_t i = 0; i < NUM_TEST_FILES; i++) {
+        char path[512];
+        snprintf(path, sizeof(path), "test_cache_%s", test_files[i]);
+        remove(path);
+    }
+    remove("test_cache_junk.nfc");
+    remove("test_cache_copy.nfc");
+    remove(cache_path);
+    return true;
+}
+
+// ============================================================================
+// Sharded inventory (host/bambu_shard.h)
+// ============================================================================
+
+static bool test_shard_ring(void) {
+    // 64 points per shard keep shards within ~25% of the mean, and a fifth
+    // shard only takes tags over from the others
+    BambuRing four, five;
+    TEST_ASSERT(bambu_ring_init(&four, 4, BAMBU_SHARD_VNODES), "ring 4");
+    TEST_ASSERT(bambu_ring_init(&five, 5, BAMBU_SHARD_VNODES), "ring 5");
+    uint32_t per_shard[4] = {0};
+    uint32_t moved = 0;
+    bool only_to_new = true;
+    for (uint32_t i = 0; i < 20000; i++) {
+        uint8_t uid[4] = {(uint8_t)i, (uint8_t)(i >> 8), (uint8_t)(i >> 16), 0x5A};
+        uint32_t a = bambu_ring_shard(&four, uid, sizeof(uid));
+        uint32_t b = bambu_ring_shard(&five, uid, sizeof(uid));
+        per_shard[a]++;
+        if (a != b) {
+            moved++;
+            if (b != 4) only_to_new = false;
+        }
+    }
+    for (size_t s = 0; s < 4; s++) {
+        TEST_ASSERT(per_shard[s] > 3750 && per_shard[s] < 6250, "balanced");
+    }
+    TEST_ASSERT(only_to_new, "tags move only to the new shard");
+    TEST_ASSERT(moved > 2000 && moved < 6000, "about 1/5 of tags move");
+    bambu_ring_free(&four);
+    bambu_ring_free(&five);
+    return true;
+}
+
+typedef struct {
+    uint32_t count;
+    uint64_t digest;  // Order-independent: sum of packed record hashes
+} ShardRows;
+
+static bool collect_shard_row(const BambuSpoolRecord* record, uint32_t scan_time, void* context) {
+    ShardRows* rows = context;
+    uint8_t payload[BAMBU_FRAME_MAX_PAYLOAD];
+    size_t len = bambu_record_pack(record, scan_time, payload);
+    rows->count++;
+    rows->digest += bambu_hash_mix(bambu_hash_bytes(BAMBU_HASH_SEED, payload, len));
+    return true;
+}
+
+static bool test_shard_router(void) {
+    // 6000 scans of 1500 tags with differing contents, routed to 3 worker
+    // processes; every query must match one partition holding everything
+    BambuShardRouter router;
+    BambuShardPartition reference;
+    fflush(NULL);
+    TEST_ASSERT(bambu_shard_router_start(&router, 3, BAMBU_SHARD_VNODES), "start workers");
+    TEST_ASSERT(bambu_shard_partition_init(&reference), "reference");
+    uint64_t state = 17;
+    for (uint32_t i = 0; i < 6000; i++) {
+        uint32_t tag = (uint32_t)bambu_rng_below(&state, 1500);
+        uint32_t scan_time = (uint32_t)bambu_rng_below(&state, 100) + 1;
+        BambuSpoolRecord record;
+        bambu_random_record(21, i, &record);
+        record.uid_len = 4;
+        memcpy(record.uid, &tag, sizeof(tag));
+        TEST_ASSERT(bambu_shard_router_add(&router, &record, scan_time), "route");
+        TEST_ASSERT(bambu_shard_partition_put(&reference, &record, scan_time), "reference put");
+    }
+
+    BambuQuery queries[3];
+    memset(queries, 0, sizeof(queries));
+    bambu_query_add_value(&queries[1], BambuQueryFieldType, "PLA");
+    bambu_query_add_value(&queries[1], BambuQueryFieldType, "PETG");
+    queries[1].min_weight_grams = 501;
+    TEST_ASSERT(bambu_date_parse("2023_06_01_00_00", &queries[2].produced_from), "date");
+
+    BambuInventory* inventory = &reference.inventory;
+    for (size_t q = 0; q < 3; q++) {
+        BambuQueryAggregate expected, merged;
+        uint64_t* matches = malloc((inventory->rows / 64 + 1) * sizeof(uint64_t));
+        TEST_ASSERT(matches && bambu_inventory_query(inventory, &queries[q], matches, &expected), "query");
+        ShardRows want = {0}, got = {0};
+        for (uint32_t row = 0; row < inventory->rows; row++) {
+            if (matches[row / 64] & (1ULL << (row % 64))) {
+                collect_shard_row(&inventory->records[row], inventory->scan_time[row], &want);
+            }
+        }
+        free(matches);
+
+        uint32_t rows;
+        TEST_ASSERT(
+            bambu_shard_router_query(&router, &queries[q], collect_shard_row, &got, &merged, &rows),
+            "sharded query");
+        TEST_ASSERT_EQ_INT((int)inventory->rows, (int)rows, "distinct tags");
+        TEST_ASSERT(memcmp(&expected, &merged, sizeof(expected)) == 0, "merged aggregate");
+        TEST_ASSERT(want.count == got.count && want.digest == got.digest, "same rows");
+        TEST_ASSERT(bambu_shard_router_query(&router, &queries[q], NULL, NULL, &merged, &rows), "count only");
+        TEST_ASSERT_EQ_INT((int)expected.count, (int)merged.count, "count only aggregate");
+    }
+    for (uint32_t i = 0; i < router.count; i++) {
+        TEST_ASSERT(router.workers[i].last.rows > 300, "every shard holds tags");
+    }
+    TEST_ASSERT(reference.replaced > 0 && reference.replaced < reference.added, "rescans replace rows");
+    TEST_ASSERT(bambu_shard_router_stop(&router), "workers exit cleanly");
+    bambu_shard_partition_free(&reference);
+    return true;
+}
+
+// ============================================================================
+// Allocator hooks (host/bambu_alloc.h)
+// ============================================================================
+
+static bool test_alloc_arena(void) {
+    const BambuAllocator* arena = &bambu_arena_allocator;
+    const BambuAllocCounters* other = &bambu_alloc_stats()->stages[BambuStageOther];
+
+    // Freed blocks are reused by the next request of the same size class
+    void* block = bambu_mem_alloc(arena, 100);
+    TEST_ASSERT(block && ((uintptr_t)block % 16) == 0, "16-byte aligned");
+    bambu_mem_free(arena, block, 100);
+    uint64_t system = other->system;
+    void* reused = bambu_mem_alloc(arena, 120);
+    TEST_ASSERT(reused == block, "free list reuse");
+    TEST_ASSERT(bambu_mem_resize(arena, reused, 120, 128) == reused, "resize within class");
+    void* grown = bambu_mem_resize(arena, reused, 128, 129);
+    TEST_ASSERT(grown && grown != reused, "resize to the next class moves");
+    bambu_mem_free(arena, grown, 129);
+    TEST_ASSERT(other->system == system, "small blocks never reach malloc");
+
+    // Large blocks and the heap allocator go to malloc
+    void* large = bambu_mem_alloc(arena, BAMBU_ARENA_MAX_BLOCK + 1);
+    TEST_ASSERT(large && other->system == system + 1, "large block from malloc");
+    bambu_mem_free(arena, large, BAMBU_ARENA_MAX_BLOCK + 1);
+    void* heap = bambu_mem_alloc(&bambu_heap_allocator, 16);
+    TEST_ASSERT(heap && other->system == system + 2, "heap allocator counted");
+    bambu_mem_free(&bambu_heap_allocator, heap, 16);
+
+    // Containers keep the allocator current when they were created
+    const BambuAllocator* previous = bambu_alloc_use(&bambu_heap_allocator);
+    BambuStringDict dict;
+    TEST_ASSERT(bambu_string_dict_init(&dict), "dict init");
+    bambu_alloc_use(previous);
+    TEST_ASSERT(dict.index.allocator == &bambu_heap_allocator, "dict on the heap");
+    TEST_ASSERT(bambu_string_dict_code(&dict, "PLA") == 0, "intern");
+    bambu_string_dict_free(&dict);
+    TEST_ASSERT(bambu_allocator() == &BAMBU_ALLOC_DEFAULT, "default restored");
+
+    // Counters follow the stage
+    BambuStage stage = bambu_alloc_stage(BambuStageOutput);
+    uint64_t output = bambu_alloc_stats()->stages[BambuStageOutput].allocs;
+    bambu_mem_free(arena, bambu_mem_alloc(arena, 32), 32);
+    bambu_alloc_stage(stage);
+    TEST_ASSERT(bambu_alloc_stats()->stages[BambuStageOutput].allocs == output + 1, "per stage");
+    return true;
+}
+
+// Helper: Load, validate, decode, look up and write every test dump
+static bool alloc_ingest_batch(BambuColumnarWriter* writer, const BambuCatalogSnapshot* catalog) {
+    for (size_t i = 0; i < NUM_TEST_FILES * 8; i++) {
+        char path[512];
+        char buf[BAMBU_DUMP_MAX_SIZE];
+        size_t len;
+        MfClassicData data;
+        BambuSpoolRecord record;
+        snprintf(path, sizeof(path), "%s/%s", test_data_dir, test_files[i % NUM_TEST_FILES]);
+        bambu_alloc_stage(BambuStageLoad);
+        if (!bambu_dump_read(path, buf, &len) || !bambu_dump_parse(buf, len, &data)) return false;
+        bambu_alloc_stage(BambuStageValidate);
+        if (!bambu_tag_is_valid(&data)) return false;
+        bambu_alloc_stage(BambuStageDecode);
+        if (!bambu_decode(&data, &record)) return false;
+        bambu_alloc_stage(BambuStageLookup);
+        const BambuFilamentInfo* info = bambu_catalog_snapshot_lookup(catalog, record.variant_id);
+        bambu_alloc_stage(BambuStageOutput);
+        if (!bambu_columnar_writer_add_info(writer, &record, (uint32_t)i, info)) return false;
+    }
+    bambu_alloc_stage(BambuStageOther);
+    bambu_columnar_writer_reset(writer);
+    return true;
+}
+
+static bool test_alloc_zero_per_tag(void) {
+    // Once the writer has seen a batch, further batches of tags allocate
+    // nothing at any stage
+    BambuCatalogSnapshot* catalog = bambu_catalog_snapshot_builtin();
+    BambuColumnarWriter writer;
+    TEST_ASSERT(catalog && bambu_columnar_writer_init(&writer), "init");
+    uint64_t output = bambu_alloc_stats()->stages[BambuStageOutput].allocs;
+    TEST_ASSERT(alloc_ingest_batch(&writer, catalog), "warm-up batch");
+    TEST_ASSERT(bambu_alloc_stats()->stages[BambuStageOutput].allocs > output, "output allocates while warming up");
+
+    // stdio and the warm-up have reached malloc, so the wraps are linked
+    TEST_ASSERT(heap_calls > 0, "heap calls are counted");
+    BambuAllocStats before = *bambu_alloc_stats();
+    uint64_t heap_before = heap_calls;
+    for (int batch = 0; batch < 100; batch++) {
+        TEST_ASSERT(alloc_ingest_batch(&writer, catalog), "steady-state batch");
+    }
+    TEST_ASSERT_EQ_INT(0, (int)(heap_calls - heap_before), "no heap calls at all");
+    const BambuAllocStats* after = bambu_alloc_stats();
+    for (size_t stage = 0; stage < BambuStageCount; stage++) {
+        TEST_ASSERT_EQ_INT((int)before.stages[stage].allocs, (int)after->stages[stage].allocs, "no allocations");
+        TEST_ASSERT_EQ_INT((int)before.stages[stage].system, (int)after->stages[stage].system, "no malloc");
+    }
+    bambu_columnar_writer_free(&writer);
+    bambu_catalog_snapshot_free(catalog);
+    return true;
+}
+
+// ============================================================================
+// Asynchronous loader (host/bambu_loader.h)
+// ============================================================================
+
+#define LOADER_ROUNDS 50
+
+typedef struct {
+    BambuSpoolRecord expected[NUM_TEST_FILES];
+    atomic_uint done;
+    atomic_uint matched;
+    atomic_uint failed;
+} LoaderTest;
+
+static void on_loader_dump(const char* path, const char* data, size_t len, int error, void* context) {
+    LoaderTest* test = context;
+    MfClassicData dump;
+    BambuSpoolRecord record;
+    if (error) {
+        test->failed++;
+    } else if (bambu_dump_parse(data, len, &dump) && bambu_decode(&dump, &record)) {
+        const char* name = strrchr(path, '/') + 1;
+        for (size_t i = 0; i < NUM_TEST_FILES; i++) {
+            if (strcmp(name, test_files[i]) == 0 && memcmp(&record, &test->expected[i], sizeof(record)) == 0) {
+                test->matched++;
+            }
+        }
+    }
+    test->done++;
+}
+
+// Helper: Load every test dump LOADER_ROUNDS times plus a missing file.
+// With break_ring, the io_uring descriptor is swapped for /dev/null first,
+// so every io_uring_enter() fails.
+static bool loader_run(BambuLoaderBackend backend, bool break_ring, const LoaderTest* expected) {
+    static LoaderTest test;
+    test = *expected;
+    BambuLoaderConfig config = {
+        .depth = 4,
+        .workers = 2,
+        .io_threads = 2,
+        .backend = backend,
+        .on_dump = on_loader_dump,
+        .context = &test,
+    };
+    BambuLoader loader;
+    if (!bambu_loader_start(&loader, &config)) {
+        // io_uring may be disabled (seccomp, kernel.io_uring_disabled)
+        TEST_ASSERT(backend == BambuLoaderIoUring, "start");
+        printf("  (io_uring unavailable, skipped)\n");
+        return true;
+    }
+    TEST_ASSERT(loader.backend == backend, "backend");
+    if (break_ring) {
+        // The I/O thread is idle until the first path is added
+        int null_fd = open("/dev/null", O_RDONLY);
+        TEST_ASSERT(null_fd >= 0 && dup2(null_fd, loader.ring.fd) == loader.ring.fd, "replace ring");
+        close(null_fd);
+    }
+
+    unsigned added = 0;
+    for (int round = 0; round < LOADER_ROUNDS; round++) {
+        for (size_t i = 0; i < NUM_TEST_FILES; i++) {
+            char path[512];
+            snprintf(path, sizeof(path), "%s/%s", test_data_dir, test_files[i]);
+            bambu_loader_add(&loader, path);
+            added++;
+            // A slot is only reused after its callback returned
+            TEST_ASSERT(added - test.done <= config.depth, "in flight bounded by depth");
+        }
+    }
+    bambu_loader_add(&loader, "test/data/missing.nfc");
+    bambu_loader_finish(&loader);
+
+    TEST_ASSERT_EQ_INT(LOADER_ROUNDS * NUM_TEST_FILES + 1, test.done, "callbacks");
+    TEST_ASSERT_EQ_INT(LOADER_ROUNDS * NUM_TEST_FILES, test.matched, "records match bambu_nfc_load");
+    TEST_ASSERT_EQ_INT(1, test.failed, "missing file reported");
+    TEST_ASSERT_EQ_INT(1, (int)loader.errors, "errors");
+    TEST_ASSERT_EQ_INT(LOADER_ROUNDS * NUM_TEST_FILES + 1, (int)loader.files, "files");
+    TEST_ASSERT(break_ring == (loader.uring_error != 0), "fell back to blocking reads");
+    return true;
+}
+
+static bool test_loader_backends(void) {
+    LoaderTest expected;
+    memset(&expected, 0, sizeof(expected));
+    for (size_t i = 0; i < NUM_TEST_FILES; i++) {
+        MfClassicData data;
+        TEST_ASSERT(load_record(test_files[i], &data, &expected.expected[i]), "load test dump");
+    }
+    TEST_ASSERT(loader_run(BambuLoaderThreads, false, &expected), "thread pool");
+    TEST_ASSERT(loader_run(BambuLoaderIoUring, false, &expected), "io_uring");
+    // A failing ring must not strand the files it held
+    TEST_ASSERT(loader_run(BambuLoaderIoUring, true, &expected), "io_uring failure");
+    return true;
+}
+
+// ============================================================================
+// Main test runner
+// ============================================================================
+
+static void run_test(const char* name, bool passed) {
+    if (passed) {
+        printf("  PASS: %s\n", name);
+        tests_passed++;
+    } else {
+        tests_failed++;
+    }
+}
+
+int main(int argc, char* argv[]) {
+    // Allow overriding test data directory
+    if (argc > 1) {
+        test_data_dir = argv[1];
+    }
+
+    printf("========================================\n");
+    printf("Bambu Lab Host Tools Tests\n");
+    printf("========================================\n\n");
+
+    printf("Host Loader (host/bambu_host.h):\n");
+    run_test("bambu_nfc_load", test_nfc_load());
+    run_test("bambu_date_parse", test_date_parse());
+    printf("\n");
+
+    printf("Framing (bambu_frame.h, host/bambu_stream.h):\n");
+    run_test("bambu_crc16", test_crc16());
+    run_test("record_pack_roundtrip", test_record_pack_roundtrip());
+    run_test("frame_rx_resync", test_frame_rx_resync());
+    run_test("stream_pty", test_stream_pty());
+    printf("\n");
+
+    printf("Clone Detection (host/bambu_dupes.h):\n");
+    run_test("hash_index", test_hash_index());
+    run_test("dupes_classification", test_dupes_classification());
+    printf("\n");
+
+    printf("Columnar Export (host/bambu_columnar.h):\n");
+    run_test("columnar_roundtrip", test_columnar_roundtrip());
+    run_test("record_file_load", test_record_file_load());
+    printf("\n");
+
+    printf("Query Engine (host/bambu_query.h):\n");
+    run_test("query_matches_scan", test_query_matches_scan());
+    printf("\n");
+
+    printf("Encoder (host/bambu_encode.h):\n");
+    run_test("encode_real_dumps", test_encode_real_dumps());
+    run_test("generator", test_generator());
+    printf("\n");
+
+    printf("Key Generator (host/bambu_keygen.h):\n");
+    run_test("keygen_matches_scalar", test_keygen_matches_scalar());
+    printf("\n");
+
+    printf("Spool Pairing (host/bambu_pair.h):\n");
+    run_test("pair_join", test_pair_join());
+    printf("\n");
+
+    printf("Reloadable Catalog (host/bambu_catalog.h):\n");
+    run_test("catalog_reload", test_catalog_reload());
+    printf("\n");
+
+    printf("Ingest Metrics (host/bambu_metrics.h):\n");
+    run_test("metrics", test_metrics());
+    printf("\n");
+
+    printf("External Merge (host/bambu_merge.h):\n");
+    run_test("merge_external", test_merge_external());
+    printf("\n");
+
+    printf("Decode Cache (host/bambu_cache.h):\n");
+    run_test("cache_incremental", test_cache_incremental());
+    printf("\n");
+
+    printf("Sharded Inventory (host/bambu_shard.h):\n");
+    run_test("shard_ring", test_shard_ring());
+    run_test("shard_router", test_shard_router());
+    printf("\n");
+
+    printf("Allocator Hooks (host/bambu_alloc.h):\n");
+    run_test("alloc_arena", test_alloc_arena());
+    run_test("alloc_zero_per_tag", test_alloc_zero_per_tag());
+    printf("\n");
+
+    printf("Asynchronous Loader (host/bambu_loader.h):\n");
+    run_test("loader_backends", test_loader_backends());
+    printf("\n");
+
+    printf("Read Simulator (host/bambu_sim.h):\n");
+    run_test("sim_strategies", test_sim_strategies());
+    run_test("sim_retries", test_sim_retries());
+    printf("\n");
+
+    printf("Continuous Scan (plugin/bambu_scan.h):\n");
+    run_test("scan_state_machine", test_scan_state_machine());
+    printf("\n");
+
+    // Summary
+    printf("========================================\n");
+    printf("Results: %d passed, %d failed\n", tests_passed, tests_failed);
+    printf("========================================\n");
+
+    return tests_failed > 0 ? 1 : 0;
+}